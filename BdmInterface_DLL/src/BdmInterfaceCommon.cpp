@@ -244,6 +244,17 @@ USBDM_ErrorCode BdmInterfaceCommon::closeBdm(void) {
    return USBDM_Close();
 }
 
+/*!  Select the BDM session used by the calling thread
+ *
+ *  @param usePrivate - true => use a session private to the calling thread, false => use the shared session
+ *
+ *  @return Error code indicating outcome.
+ */
+USBDM_ErrorCode BdmInterfaceCommon::useThreadSession(bool usePrivate) {
+   LOGGING_E;
+   return USBDM_UseThreadSession(usePrivate);
+}
+
 #define settingsKey "Shared"
 
 const string bdmSerialNumberKey(         settingsKey ".bdmSerialNumber");
@@ -845,7 +856,7 @@ USBDM_ErrorCode BdmInterfaceCommon::setTargetTypeWithRetry() {
  */
 static const char *utf16leToUtf8(const char *source) {
    const  uint8_t  *inPtr  = (const uint8_t*) source;
-   static uint8_t  buffer[100];
+   static thread_local uint8_t buffer[100];
           uint8_t  *outPtr = buffer;
           uint16_t utf16leValue;
 
@@ -1120,7 +1131,7 @@ USBDM_ErrorCode  BdmInterfaceCommon::setOptionsWithRetry(USBDM_ExtendedOptions_t
 }
 
 char const *BdmInterfaceCommon::getConnectionRetryName(RetryMode mode) {
-   static char buff[150] = "";
+   static thread_local char buff[150] = "";
 
    switch (mode & retryMask) {
    case retryAlways     : strcpy(buff,"ALWAYS");      break;
@@ -1234,6 +1245,12 @@ USBDM_ErrorCode BdmInterfaceCommon::readMemory( unsigned memorySpace, unsigned b
 USBDM_ErrorCode BdmInterfaceCommon::writeMemory( unsigned memorySpace, unsigned byteCount, unsigned address, unsigned const char *data) {
    return USBDM_WriteMemory(memorySpace, byteCount, address, data);
 };
+USBDM_ErrorCode BdmInterfaceCommon::readMemoryV(unsigned count, USBDM_MemoryRequest requests[]) {
+   return USBDM_ReadMemoryV(count, requests);
+};
+USBDM_ErrorCode BdmInterfaceCommon::writeMemoryV(unsigned count, USBDM_MemoryRequest requests[]) {
+   return USBDM_WriteMemoryV(count, requests);
+};
 USBDM_ErrorCode BdmInterfaceCommon::writePC(unsigned long regValue) {
    return BDM_RC_CF_ILLEGAL_COMMAND;
 }
@@ -47,6 +47,7 @@ public:
    virtual void                       setBdmSerialNumber(std::string serialNumber, bool matchRequired = false);
    virtual std::string               &getBdmSerialNumber();
    virtual bool                       getBdmMatchRequired();
+   virtual USBDM_ErrorCode            useThreadSession(bool usePrivate);
    virtual USBDM_ErrorCode            initBdm(void);
    virtual USBDM_ErrorCode            closeBdm(void);
    virtual USBDM_ExtendedOptions_t   &getBdmOptions();
@@ -82,6 +83,8 @@ public:
    virtual USBDM_ErrorCode            readDReg(unsigned int reg, unsigned long *value);
    virtual USBDM_ErrorCode            readMemory(unsigned memorySpace, unsigned byteCount, unsigned address, unsigned char *data);
    virtual USBDM_ErrorCode            writeMemory(unsigned memorySpace, unsigned byteCount, unsigned address, unsigned const char *data);
+   virtual USBDM_ErrorCode            readMemoryV(unsigned count, USBDM_MemoryRequest requests[]);
+   virtual USBDM_ErrorCode            writeMemoryV(unsigned count, USBDM_MemoryRequest requests[]);
    virtual USBDM_ErrorCode            writePC(unsigned long regValue);
    virtual USBDM_ErrorCode            readPC(unsigned long *regValue);
    virtual USBDM_ErrorCode            bdmCommand(unsigned txSize, unsigned rxSize, uint8_t data[]);
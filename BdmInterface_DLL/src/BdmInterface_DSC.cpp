@@ -238,6 +238,32 @@ USBDM_ErrorCode BdmInterface_DSC::writeMemory(unsigned memorySpace, unsigned byt
    return DSC_WriteMemory(memorySpace, byteCount, address, data);
 }
 
+/**
+ * DSC memory accesses are done individually as they require address translation
+ */
+USBDM_ErrorCode BdmInterface_DSC::readMemoryV(unsigned count, USBDM_MemoryRequest requests[]) {
+   for (unsigned index=0; index<count; index++) {
+      USBDM_ErrorCode rc = readMemory(requests[index].memorySpace, requests[index].byteCount, requests[index].address, requests[index].data);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * DSC memory accesses are done individually as they require address translation
+ */
+USBDM_ErrorCode BdmInterface_DSC::writeMemoryV(unsigned count, USBDM_MemoryRequest requests[]) {
+   for (unsigned index=0; index<count; index++) {
+      USBDM_ErrorCode rc = writeMemory(requests[index].memorySpace, requests[index].byteCount, requests[index].address, requests[index].data);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   return BDM_RC_OK;
+}
+
 USBDM_ErrorCode BdmInterface_DSC::writePC(unsigned long regValue) {
    return DSC_WriteRegister(DSC_RegPC, regValue);
 }
@@ -28,6 +28,8 @@ public:
    virtual USBDM_ErrorCode readReg(unsigned int reg, unsigned long *value);
    virtual USBDM_ErrorCode readMemory(unsigned memorySpace, unsigned byteCount, unsigned address, unsigned char *data);
    virtual USBDM_ErrorCode writeMemory(unsigned memorySpace, unsigned byteCount, unsigned address, unsigned const char *data);
+   virtual USBDM_ErrorCode readMemoryV(unsigned count, USBDM_MemoryRequest requests[]);
+   virtual USBDM_ErrorCode writeMemoryV(unsigned count, USBDM_MemoryRequest requests[]);
    virtual USBDM_ErrorCode writePC(unsigned long regValue);
    virtual USBDM_ErrorCode readPC(unsigned long *regValue);
 
@@ -335,7 +335,7 @@ ifeq ($(UNAME_S),Windows)
    CFLAGS  := -D__USE_MINGW_ANSI_STDIO # required for snprintf() to work!!
 else
    GCC_VISIBILITY_DEFS :=-fvisibility=hidden -fvisibility-inlines-hidden
-   THREADS := 
+   THREADS := -pthread
    CFLAGS := -fPIC
 endif
 
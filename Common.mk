@@ -342,7 +342,7 @@ ifeq ($(UNAME_S),Windows)
    CFLAGS  := -DWINVER=_WIN32_WINNT_WIN6 -D_WIN32_WINNT=_WIN32_WINNT_WIN6
 else
    GCC_VISIBILITY_DEFS :=-fvisibility=hidden -fvisibility-inlines-hidden
-   THREADS := 
+   THREADS := -pthread
    CFLAGS := -fPIC
 endif
 
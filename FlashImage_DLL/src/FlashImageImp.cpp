@@ -24,6 +24,12 @@
 \verbatim
  Change History
 +========================================================================================
+| 17 Oct 26 | Image cache keyed on file identity, hash only confirms    V4.12.1
+| 17 Oct 26 | Image no longer refers to mapped file after loading       V4.12.1
+| 17 Oct 26 | Added parsed image cache                                  V4.12.1
+| 17 Oct 26 | ELF files loaded from memory mapped file without copying V4.12.1
+| 17 Oct 26 | Memory mapped SREC loading, added Intel HEX loading       V4.12.1
+| 17 Oct 26 | Changed to extent based storage, added getData()          V4.12.1
 | 29 Dec 16 | Revised loading ELF files                                 V4.12.1.150 - pgo
 |  4 Mar 16 | Improved format of dumpRange()                            V4.12.1.80  - pgo
 | 29 May 15 | Added saveFile()                                          V4.11.1.40  - pgo
@@ -47,6 +53,14 @@
 #include <string.h>
 #include <map>
 #include <malloc.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "FlashImage.h"
 #include "MyException.h"
@@ -66,82 +80,6 @@ size_t CPP_DLL_EXPORT createPluginInstance(FlashImageImp *pp) {
    return TcreatePluginInstance<FlashImageImp>(pp);
 }
 
-/*
- * ======================================================================
- */
-
-/**
- *  Represents a memory 'page'.
- *  Note: A page does not correspond to a flash page or sector!
- */
-class MemoryPage {
-
-public:
-   /** Page of memory */
-   uint8_t data[FlashImageImp::PAGE_SIZE];
-
-   /** Indicates valid bytes in data */
-   uint8_t validBits[FlashImageImp::PAGE_SIZE/8];
-
-public:
-   MemoryPage();
-
-   bool     isValid(unsigned index) const;
-   void     setValue(unsigned index, uint8_t value);
-   void     remove(unsigned index);
-   uint8_t  getValue(unsigned index);
-};
-
-/**
- * Constructor
- */
-MemoryPage::MemoryPage() {
-   memset(data, 0xFF, sizeof(data));
-   memset(validBits, 0, sizeof(validBits));
-}
-
-/**
- * Indicates if a page[index] has been written to
- */
-bool MemoryPage::isValid(unsigned index) const {
-   if (index >= FlashImageImp::PAGE_SIZE) {
-      throw MyException("Page index out of range");
-   }
-   return (validBits[index/8] & (1<<(index&0x7)))?true:false;
-}
-
-/**
- * Sets page[index] to value & marks as valid
- */
-void MemoryPage::setValue(unsigned index, uint8_t value) {
-   if (index >= FlashImageImp::PAGE_SIZE) {
-      throw runtime_error("Page index out of range");
-   }
-   data[index]         = value;
-   validBits[index/8] |= (1<<(index&0x7));
-}
-
-/**
- *  Sets page[index] to 0xFF & marks as invalid
- */
-void MemoryPage::remove(unsigned index) {
-   if (index >= FlashImageImp::PAGE_SIZE) {
-      throw runtime_error("Page index out of range");
-   }
-   data[index]         = (uint8_t)-1;
-   validBits[index/8] &= ~(1<<(index&0x7));
-}
-
-/**
- *  Returns contents of page[index] if valid or (uint8_t)-1 otherwise
- */
-uint8_t MemoryPage::getValue(unsigned index) {
-   if (!isValid(index)) {
-      return  (uint8_t)-1;
-   }
-   return data[index];
-}
-
 /*
  * ======================================================================
  */
@@ -224,82 +162,42 @@ bool EnumeratorImp::setAddress(uint32_t addr) {
  *  @return false => No occupied locations remain, enumerator is left at last \e unoccupied location
  */
 bool EnumeratorImp::nextValid() {
-   MemoryPagePtr memoryPage;
-   uint16_t pageNum, offset;
    //   log.print("start=0x%06X\n", address);
+   if (address == (uint32_t)-1) {
+      return false;
+   }
    address++;
-   do {
-      FlashImageImp::addressToPageOffset(address, pageNum, offset);
-//      log.print("Checking 0x%06X)\n", address);
-
-      // At start of page or haven't checked this page yet
-      if ((offset == 0) || (memoryPage == NULL)) {
-         typename map<uint32_t, MemoryPagePtr>::iterator iter = memoryImage.memoryPages.find(pageNum);
-         if (iter == memoryImage.memoryPages.end()) {
-            memoryPage.reset();
-         }
-         else {
-            memoryPage = iter->second;
-         }
-      }
-      if (memoryPage == NULL) {
-         // Unallocated page - move to start of next page
-         //         log.print("enumerator::nextValid(a=0x%06X) - skipping unallocated page #0x%X\n", address, pageNum);
-         address += FlashImageImp::PAGE_SIZE;
-         address &= ~FlashImageImp::PAGE_MASK;
-         if (address > memoryImage.lastAllocatedAddress) {
-//            address = memoryImage.lastAllocatedAddress;
-//            log.print("end = 0x%06X, no remaining valid addresses\n", address);
-            return false;
-         }
-         continue;
-      }
-      // Check if valid byte in page
-      if (memoryPage->isValid(offset)) {
-         //         log.print("end = 0x%06X\n", address);
-         return true;
-      }
-      address++;
-   } while (1);
-   return false;
+   FlashImageImp::ExtentMap::iterator extent = memoryImage.findNextExtent(address);
+   if (extent == memoryImage.memoryExtents.end()) {
+      // No remaining valid addresses
+      return false;
+   }
+   if (address < extent->first) {
+      // Skip to start of next extent
+      address = extent->first;
+   }
+   return true;
 }
 
 /**
- *  Advance location to just before the next unoccupied flash location or page boundary
+ *  Advance location to the last occupied location before the next unoccupied flash location
  *  Assumes current location is occupied.
  */
 void EnumeratorImp::lastValid() {
-   uint16_t pageNum, offset;
-   LOGGING_Q;
 //   log.print("start=0x%06X\n", address);
-
-   FlashImageImp::addressToPageOffset(address, pageNum, offset);
-   typename map<uint32_t, MemoryPagePtr>::iterator iter = memoryImage.memoryPages.find(pageNum);
-   if (iter == memoryImage.memoryPages.end()) {
+   FlashImageImp::ExtentMap::iterator extent = memoryImage.findExtent(address);
+   if (extent == memoryImage.memoryExtents.end()) {
 //      log.print("end=0x%06), start address not allocated\n", address);
       return;
    }
-   MemoryPagePtr memoryPage = iter->second;
-   do {
-//      log.print("Checking 0x%06X)\n", address);
-      if (address == memoryImage.lastAllocatedAddress) {
-//         log.print("end=0x%06X, end of memory\n", address);
-         return;
-      }
-      FlashImageImp::addressToPageOffset(address, pageNum, offset);
-      // Check if at page boundary or probing one ahead fails
-      if ((offset == FlashImageImp::PAGE_SIZE-1) || !memoryPage->isValid(++offset)) {
-//         log.print("end=0x%06X\n", address);
-         return;
-      }
-      address++;
-   } while (1);
+   // Borrowed extents may abut
+   FlashImageImp::ExtentMap::iterator next = extent;
+   while ((++next != memoryImage.memoryExtents.end()) && (next->first == FlashImageImp::endOf(extent))) {
+      extent = next;
+   }
+   address = FlashImageImp::lastAddressOf(extent);
 }
 
-/*
- * ======================================================================
- */
-
 /**
  *   Constructor - creates an empty Flash image
  */
@@ -308,7 +206,6 @@ FlashImageImp::FlashImageImp() :
       wordAddresses(false),
       firstAllocatedAddress((unsigned )(-1)),
       lastAllocatedAddress(0),
-      lastPageNumAccessed((uint16_t )(-1)),
       elementCount(0),
       littleEndian(false),
       allowOverwrite(false),
@@ -316,8 +213,10 @@ FlashImageImp::FlashImageImp() :
       discardFF(true),
       printHeader(true),
       programHeaders(0),
-      symTable(0) {
+      symTable(0),
+      imageCacheEnabled(false) {
    LOGGING;
+   lastExtentAccessed = memoryExtents.end();
 }
 
 /**
@@ -358,16 +257,10 @@ const char *FlashImageImp::getErrorString(USBDM_ErrorCode rc) {
 void FlashImageImp::clear(void) {
 
    // Initialise flash image to unused value
-   typename std::map<uint32_t,MemoryPagePtr>::iterator it = memoryPages.begin();
-   while(it != memoryPages.end()){
-      it->second.reset();
-      it++;
-   }
-   memoryPages.clear();
+   memoryExtents.clear();
+   lastExtentAccessed     = memoryExtents.end();
    firstAllocatedAddress  = (unsigned )(-1);
    lastAllocatedAddress   = 0;
-   lastPageNumAccessed    = (uint16_t )(-1);
-   lastMemoryPageAccessed.reset();
    elementCount           = 0;
    littleEndian           = false;
 }
@@ -382,11 +275,7 @@ void FlashImageImp::clear(void) {
  *          false  => location is invalid
  */
 bool FlashImageImp::isValid(uint32_t address) {
-   uint16_t pageNum;
-   uint16_t offset;
-   addressToPageOffset(address, pageNum, offset);
-   MemoryPagePtr memoryPage = getmemoryPage(pageNum);
-   return (memoryPage != NULL) && (memoryPage->isValid(offset));
+   return findExtent(address) != memoryExtents.end();
 }
 
 /**
@@ -440,52 +329,58 @@ const string & FlashImageImp::getSourcePathname() const {
 }
 
 /**
- *  Locate Page from page number
+ *  Locate extent containing an address
  *
- *  @param   pageNum
+ *  @param address - Address to locate
  *
- *  @return  memory page or NULL if not found
+ *  @return Extent containing address or memoryExtents.end() if not allocated
  */
-MemoryPagePtr FlashImageImp::getmemoryPage(uint32_t pageNum) {
-   MemoryPagePtr memoryPage;
-   if ((pageNum == lastPageNumAccessed) && (lastMemoryPageAccessed != NULL)) {
-      // Used cached copy
-      memoryPage = lastMemoryPageAccessed;
+FlashImageImp::ExtentMap::iterator FlashImageImp::findExtent(uint32_t address) {
+   if ((lastExtentAccessed != memoryExtents.end()) &&
+       (address >= lastExtentAccessed->first) &&
+       (address <= lastAddressOf(lastExtentAccessed))) {
+      // Used cached extent
+      return lastExtentAccessed;
    }
-   else {
-      typename std::map<uint32_t, MemoryPagePtr>::iterator iter = memoryPages.find(pageNum);
-      if (iter == memoryPages.end()) {
-         memoryPage.reset();
-      }
-      else {
-         memoryPage = iter->second;
-      }
-      // Cache access
-      lastMemoryPageAccessed  = memoryPage;
+   ExtentMap::iterator extent = memoryExtents.upper_bound(address);
+   if (extent == memoryExtents.begin()) {
+      return memoryExtents.end();
+   }
+   --extent;
+   if (address > lastAddressOf(extent)) {
+      return memoryExtents.end();
    }
-   return memoryPage;
+   // Cache access
+   lastExtentAccessed = extent;
+   return extent;
 }
 
 /**
- *  Allocate page
+ *  Locate extent containing an address or the first extent following it
  *
- *  @param pageNum
+ *  @param address - Address to locate
+ *
+ *  @return Extent found or memoryExtents.end() if none
  */
-MemoryPagePtr FlashImageImp::allocatePage(uint32_t pageNum) {
-   LOGGING_Q;
-   MemoryPagePtr memoryPage;
-
-   memoryPage = getmemoryPage(pageNum);
-   if (memoryPage == NULL) {
-// log.print( "Allocating page #%2.2X [0x%06X-0x%06X]\n", pageNum, pageOffsetToAddress(pageNum, 0), pageOffsetToAddress(pageNum, PAGE_SIZE-1));
-      memoryPage.reset(new MemoryPage);
-      memoryPages.insert(pair<const uint32_t, MemoryPagePtr>(pageNum, memoryPage));
-      // Update cache
-      lastMemoryPageAccessed = memoryPage;
+FlashImageImp::ExtentMap::iterator FlashImageImp::findNextExtent(uint32_t address) {
+   ExtentMap::iterator extent = findExtent(address);
+   if (extent != memoryExtents.end()) {
+      return extent;
    }
-   return memoryPage;
+   return memoryExtents.upper_bound(address);
 }
 
+/**
+ *  Identifies a version of a file without reading its contents
+ */
+struct FileIdentity {
+   uint64_t size;          //!< Size of file
+   uint64_t modifiedTime;  //!< Time of last modification (ns from an arbitrary origin)
+   uint64_t fileId;        //!< File serial number (inode) or 0 if not available
+};
+
+static bool getFileIdentity(const string &filePath, FileIdentity &identity);
+
 /**
  *    Load a S19 or ELF file into the buffer. \n
  *
@@ -505,17 +400,20 @@ USBDM_ErrorCode  FlashImageImp::loadFile(const string &filePath, bool clearBuffe
    }
    log.print("File: \"%s\"\n", filePath.c_str());
 
-   // Try ELF Format
-   USBDM_ErrorCode rc = loadElfFile(filePath);
-   if (rc == SFILE_RC_UNKNOWN_FILE_FORMAT) {
-      // Try SREC Format if not recognized
-      rc = loadS1S9File(filePath);
+   // Cache is only used when the image holds nothing but the file contents
+   FileIdentity identity;
+   bool useCache = imageCacheEnabled && clearBuffer && getFileIdentity(filePath, identity);
+
+   USBDM_ErrorCode rc = SFILE_RC_UNKNOWN_FILE_FORMAT;
+   if (useCache) {
+      rc = loadImageCache(filePath, identity);
    }
    if (rc != SFILE_RC_OK) {
-      // Try absolute binary image format if not recognized as ELF
-      rc = loadAbsoluteFile(filePath);
+      rc = parseFile(filePath);
+      if (useCache && (rc == SFILE_RC_OK)) {
+         saveImageCache(filePath, identity);
+      }
    }
-
    if (rc == SFILE_RC_OK) {
 
       log.print(" Spans [0x%4.4X..0x%4.4X]\n",
@@ -530,6 +428,35 @@ USBDM_ErrorCode  FlashImageImp::loadFile(const string &filePath, bool clearBuffe
    return rc;
 }
 
+/**
+ *    Parse a file into the buffer trying each supported format. \n
+ *
+ *  @param filePath     Path of file to load
+ *
+ *  @return Error code
+ */
+USBDM_ErrorCode  FlashImageImp::parseFile(const string &filePath) {
+
+   // Try ELF Format
+   USBDM_ErrorCode rc = loadElfFile(filePath);
+   if (rc == SFILE_RC_UNKNOWN_FILE_FORMAT) {
+      // Try SREC Format if not recognized
+      rc = loadS1S9File(filePath);
+   }
+   if (rc == SFILE_RC_UNKNOWN_FILE_FORMAT) {
+      // Try Intel HEX Format if not recognized
+      rc = loadIntelHexFile(filePath);
+   }
+   if (rc != SFILE_RC_OK) {
+      // Try absolute binary image format if not recognized as ELF
+      USBDM_ErrorCode absoluteRc = loadAbsoluteFile(filePath);
+      if (absoluteRc != SFILE_RC_UNKNOWN_FILE_FORMAT) {
+         rc = absoluteRc;
+      }
+   }
+   return rc;
+}
+
 /**
  *  Save image buffer as a S19 file. \n
  *
@@ -552,12 +479,9 @@ USBDM_ErrorCode FlashImageImp::saveFile(const std::string &filePath, bool discar
       uint32_t end = e->getAddress();
       log.print("[0x%06X..0x%06X]\n", start, end);
       e->nextValid();
-      uint8_t data[end-start+1];
-      uint8_t *dataPtr = data;
-      for (uint32_t address=start; address<=end; address++) {
-         *dataPtr++ = getValue(address);
-      }
-      writeData(data, start, end-start+1);
+      std::vector<uint8_t> data(end-start+1);
+      getData(data.size(), start, data.data());
+      writeData(data.data(), start, data.size());
    }
    fclose(fp);
    return BDM_RC_OK;
@@ -656,15 +580,11 @@ void FlashImageImp::writeData(uint8_t *buffer, uint32_t address, unsigned size)
  *  @return Value (dummy value of 0xFF.. is unallocated address)
  */
 uint8_t FlashImageImp::getValue(uint32_t address) {
-   uint16_t         offset;
-   uint16_t         pageNum;
-   MemoryPagePtr    memoryPage;
-   addressToPageOffset(address, pageNum, offset);
-   memoryPage = getmemoryPage(pageNum);
-   if (memoryPage == NULL)
+   ExtentMap::iterator extent = findExtent(address);
+   if (extent == memoryExtents.end()) {
       return (uint8_t)-1;
-   else
-      return memoryPage->getValue(offset);
+   }
+   return extent->second[address-extent->first];
 }
 
 /**
@@ -676,22 +596,13 @@ uint8_t FlashImageImp::getValue(uint32_t address) {
  *  @note Allocates a memory location if necessary
  */
 void FlashImageImp::setValue(uint32_t address, uint8_t value) {
-   uint16_t offset;
-   uint16_t pageNum;
-
-   addressToPageOffset(address, pageNum, offset);
-   MemoryPagePtr memoryPage = allocatePage(pageNum);
-   if (!memoryPage->isValid(offset)) {
-      // new location
-      elementCount++;
-   }
-   memoryPage->setValue(offset, value);
-   if (firstAllocatedAddress > address) {
-      firstAllocatedAddress = address;
-   }
-   if (lastAllocatedAddress < address) {
-      lastAllocatedAddress = address;
+   ExtentMap::iterator extent = findExtent(address);
+   if (extent != memoryExtents.end()) {
+      // Existing location
+      extent->second.modifiableData()[address-extent->first] = value;
+      return;
    }
+   loadData(1, address, &value);
 }
 
 /*
@@ -700,17 +611,23 @@ void FlashImageImp::setValue(uint32_t address, uint8_t value) {
  *  @param address - Memory address
  */
 void FlashImageImp::remove(uint32_t address) {
-   uint16_t offset;
-   uint16_t pageNum;
-
-   addressToPageOffset(address, pageNum, offset);
-   MemoryPagePtr memoryPage = getmemoryPage(pageNum);
-   if ((memoryPage == NULL) || !memoryPage->isValid(offset)) {
+   ExtentMap::iterator extent = findExtent(address);
+   if (extent == memoryExtents.end()) {
       // Doesn't exist
       return;
    }
+   uint32_t     offset = address-extent->first;
+   MemoryExtent &data  = extent->second;
+   if (offset+1 < data.size()) {
+      // Move trailing portion to new extent
+      data.getTail(offset+1, memoryExtents[address+1]);
+   }
+   data.resize(offset);
+   if (data.empty()) {
+      memoryExtents.erase(extent);
+   }
+   lastExtentAccessed = memoryExtents.end();
    elementCount--;
-   memoryPage->remove(offset);
 }
 
 /**
@@ -796,6 +713,9 @@ void FlashImageImp::dumpRange(uint32_t startAddress, uint32_t endAddress) {
 /**
  *  Load data into Flash image
  *
+ *  The data is merged with any overlapping or adjacent extents so that
+ *  contiguous data is always held in a single extent.
+ *
  *  @param bufferSize    Size of data to load (in uint8_t)
  *  @param address       Address to load at
  *  @param data          Data to load
@@ -805,22 +725,90 @@ USBDM_ErrorCode FlashImageImp::loadData(uint32_t       bufferSize,
       uint32_t       address,
       const uint8_t data[],
       bool           dontOverwrite) {
-   uint32_t bufferAddress;
 
    //   log.print("FlashImageImp::loadData(0x%04X...0x%04X)\n", address, address+bufferSize-1);
-   bufferAddress = 0;
-   while (bufferAddress < bufferSize){
-      //      if (!allocatePage(address)) {
-      //         log.print("loadData() - Address is too large = 0x%08X > 0x%08lX\n",
-      //               address, MAX_SFILE_ADDRESS);
-      //
-      //         return SFILE_RC_ADDRESS_TOO_LARGE;
-      //      }
-      if (!this->isValid(address) || !dontOverwrite) {
-         this->setValue(address, data[bufferAddress]);
+   if (bufferSize == 0) {
+      return SFILE_RC_OK;
+   }
+   if ((uint64_t)address+bufferSize > (uint64_t)(uint32_t)-1+1) {
+      // Discard data past end of address space
+      bufferSize = (uint32_t)-address;
+   }
+   const uint64_t dataEnd  = (uint64_t)address+bufferSize; // Exclusive
+   uint64_t       newStart = address;
+   uint64_t       newEnd   = dataEnd;
+
+   // Locate first extent overlapping or adjacent to new data
+   ExtentMap::iterator first = memoryExtents.upper_bound(address);
+   if (first != memoryExtents.begin()) {
+      ExtentMap::iterator previous = first;
+      --previous;
+      if (endOf(previous) >= newStart) {
+         first = previous;
+      }
+   }
+   // Locate extent following last extent overlapping or adjacent to new data
+   ExtentMap::iterator last = first;
+   while ((last != memoryExtents.end()) && (last->first <= dataEnd)) {
+      if (last->first < newStart) {
+         newStart = last->first;
+      }
+      if (endOf(last) > newEnd) {
+         newEnd = endOf(last);
+      }
+      ++last;
+   }
+   if (first == last) {
+      // New isolated extent
+      memoryExtents[address].assign(data, data+bufferSize);
+      elementCount += bufferSize;
+   }
+   else {
+      // Merge new data with extents [first,last) into an extent starting at newStart
+      ExtentMap::iterator target = first;
+      if (first->first != newStart) {
+         target = memoryExtents.insert(first, ExtentMap::value_type((uint32_t)newStart, MemoryExtent()));
+      }
+      else {
+         // Re-use first extent as it starts at the same address
+         elementCount -= first->second.size();
+         ++first;
+      }
+      MemoryExtent   &merged   = target->second;
+      const uint64_t  targetEnd = newStart+merged.size(); // End of data originally in target
+      merged.resize(newEnd-newStart, (uint8_t)-1);
+      uint8_t *mergedData = merged.modifiableData();
+      if (dontOverwrite) {
+         // New data is only used where not already occupied
+         uint64_t nextData = (targetEnd > address)?targetEnd:address;
+         for (ExtentMap::iterator extent = first; extent != last; ++extent) {
+            if (extent->first > nextData) {
+               memcpy(mergedData+(nextData-newStart), data+(nextData-address), extent->first-nextData);
+            }
+            if (endOf(extent) > nextData) {
+               nextData = endOf(extent);
+            }
+         }
+         if (dataEnd > nextData) {
+            memcpy(mergedData+(nextData-newStart), data+(nextData-address), dataEnd-nextData);
+         }
+      }
+      for (ExtentMap::iterator extent = first; extent != last; ++extent) {
+         memcpy(mergedData+(extent->first-newStart), extent->second.data(), extent->second.size());
+         elementCount -= extent->second.size();
+      }
+      if (!dontOverwrite) {
+         memcpy(mergedData+(address-newStart), data, bufferSize);
       }
-      address++;
-      bufferAddress++;
+      memoryExtents.erase(first, last);
+      elementCount += merged.size();
+   }
+   lastExtentAccessed = memoryExtents.end();
+   if (firstAllocatedAddress > newStart) {
+      firstAllocatedAddress = newStart;
+   }
+   if (lastAllocatedAddress < newEnd-1) {
+      lastAllocatedAddress = newEnd-1;
    }
    //   printMemoryMap();
    return SFILE_RC_OK;
@@ -842,63 +830,112 @@ USBDM_ErrorCode FlashImageImp::loadDataBytes(uint32_t        bufferSize,
                                              bool            dontOverwrite) {
    LOGGING_Q;
    log.print("load[0x%04X...0x%04X]\n", address, address+bufferSize-1);
-   uint32_t bufferAddress = 0;
-   while (bufferAddress < bufferSize) {
-//      log.print("image[0x%08X] <= 0x%04X\n", address, data[bufferAddress]);
-      if (!this->isValid(address) || !dontOverwrite) {
-         this->setValue(address, data[bufferAddress]);
+   return loadData(bufferSize, address, data, dontOverwrite);
+}
+
+/**
+ *  Copy a range of the image to a buffer
+ *
+ *  @param bufferSize  Size of data to copy (in uint8_t)
+ *  @param address     Start address of range
+ *  @param data        Buffer for data (unallocated locations are returned as 0xFF)
+ */
+void FlashImageImp::getData(uint32_t bufferSize, uint32_t address, uint8_t data[]) {
+   while (bufferSize>0) {
+      ExtentMap::iterator extent = findNextExtent(address);
+      if ((extent == memoryExtents.end()) || ((extent->first > address) && (extent->first-address >= bufferSize))) {
+         // No more data in range
+         memset(data, (uint8_t)-1, bufferSize);
+         return;
+      }
+      if (extent->first > address) {
+         // Gap before extent
+         uint32_t gap = extent->first-address;
+         memset(data, (uint8_t)-1, gap);
+         data       += gap;
+         address    += gap;
+         bufferSize -= gap;
       }
-      address++;
-      bufferAddress++;
+      uint64_t size = endOf(extent)-address;
+      if (size > bufferSize) {
+         size = bufferSize;
+      }
+      memcpy(data, extent->second.data()+(address-extent->first), size);
+      data       += size;
+      address    += size;
+      bufferSize -= size;
    }
-   return BDM_RC_OK;
 }
 
 void FlashImageImp::fill(uint32_t size, uint32_t address, uint8_t fillValue) {
-   while (size-->0) {
-      setValue(address++, fillValue);
-   }
+   std::vector<uint8_t> buffer(size, fillValue);
+   loadData(size, address, buffer.data());
 }
 
 void FlashImageImp::fillUnused(uint32_t size, uint32_t address, uint8_t fillValue) {
-   while (size-->0) {
-      if (isValid(address)) {
-         // Already allocated address
-         continue;
-      }
-      setValue(address++, fillValue);
-   }
+   std::vector<uint8_t> buffer(size, fillValue);
+   loadData(size, address, buffer.data(), true);
 }
 
 /**
- *  Maps Address to PageNum:offset
+ *  Check if any location in a range of the image is occupied
  *
- *  @param address  Address
- *  @param pageNum  Page number portion of address
- *  @param offset   Offset within page
+ *  @param size      Size of range (in uint8_t)
+ *  @param address   Start address of range
  *
- *  @note - These values do NOT refer to the paging structure used by the target!
+ *  @return true if any location is occupied
  */
-void FlashImageImp::addressToPageOffset(uint32_t address, uint16_t &pageNum, uint16_t &offset) {
-   offset  = address & PAGE_MASK;
-   pageNum = address >> PAGE_BIT_OFFSET;
-   //      printf("%8.8X=>%2.2X:%4.4X\n", address, pageNum, offset);
+bool FlashImageImp::isOccupied(uint32_t size, uint32_t address) {
+   ExtentMap::iterator extent = findNextExtent(address);
+   return (size > 0) && (extent != memoryExtents.end()) &&
+          ((extent->first <= address) || (extent->first-address < size));
 }
 
 /**
- *  Maps PageNum:offset to Address
+ *  Load borrowed data into Flash image
  *
- *  @param pageNum  Page number portion of address
- *  @param offset   Offset within page
+ *  The data is not copied unless it overlaps existing data or is modified.
+ *  releaseBorrowedData() must be called before loading completes.
  *
- *  @return Address
+ *  @param bufferSize    Size of data to load (in uint8_t)
+ *  @param address       Address to load at
+ *  @param data          Data to load
+ *  @param owner         Object that keeps data valid while referenced
+ */
+void FlashImageImp::loadBorrowedData(uint32_t                     bufferSize,
+                                     uint32_t                     address,
+                                     const uint8_t                data[],
+                                     std::shared_ptr<const void>  owner) {
+   if ((uint64_t)address+bufferSize > (uint64_t)(uint32_t)-1+1) {
+      // Discard data past end of address space
+      bufferSize = (uint32_t)-address;
+   }
+   if ((bufferSize == 0) || isOccupied(bufferSize, address)) {
+      // Merge with existing data
+      loadData(bufferSize, address, data);
+      return;
+   }
+   memoryExtents[address].borrow(data, bufferSize, owner);
+   elementCount += bufferSize;
+   lastExtentAccessed = memoryExtents.end();
+   if (firstAllocatedAddress > address) {
+      firstAllocatedAddress = address;
+   }
+   if (lastAllocatedAddress < address+bufferSize-1) {
+      lastAllocatedAddress = address+bufferSize-1;
+   }
+}
+
+/**
+ *  Make private copies of all borrowed data
  *
- *  @note - These values do NOT refer to the paging structure used by the target!
+ *  The image must not depend on the file it was loaded from as the file may be
+ *  truncated or rewritten (e.g. by a rebuild) while the image exists.
  */
-uint32_t FlashImageImp::pageOffsetToAddress(uint16_t pageNum, uint16_t offset) {
-   if (offset>=PAGE_SIZE)
-      throw runtime_error("Page offset too large\n");
-   return (pageNum << PAGE_BIT_OFFSET) + offset;
+void FlashImageImp::releaseBorrowedData() {
+   for (ExtentMap::iterator it=memoryExtents.begin(); it!=memoryExtents.end(); ++it) {
+      it->second.makeOwned();
+   }
 }
 
 /**
@@ -979,6 +1016,220 @@ inline bool ends_with(std::string const & value, std::string const & ending) {
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
 }
 
+/**
+ *  Read-only memory mapping of an entire file
+ */
+class MappedFile {
+private:
+   const uint8_t *base;    //!< Start of mapped file
+   size_t         length;  //!< Size of file
+   bool           opened;  //!< File was opened & mapped successfully
+#ifdef _WIN32
+   HANDLE         fileHandle;
+   HANDLE         mappingHandle;
+#endif
+
+public:
+   MappedFile(const char *filePath) : base(0), length(0), opened(false) {
+#ifdef _WIN32
+      mappingHandle = NULL;
+      fileHandle    = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (fileHandle == INVALID_HANDLE_VALUE) {
+         return;
+      }
+      LARGE_INTEGER fileSize;
+      if (!GetFileSizeEx(fileHandle, &fileSize)) {
+         return;
+      }
+      length = (size_t)fileSize.QuadPart;
+      if (length > 0) {
+         mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+         if (mappingHandle == NULL) {
+            return;
+         }
+         base = (const uint8_t *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+         if (base == NULL) {
+            return;
+         }
+      }
+#else
+      int fd = open(filePath, O_RDONLY);
+      if (fd < 0) {
+         return;
+      }
+      struct stat fileStat;
+      if ((fstat(fd, &fileStat) != 0) || !S_ISREG(fileStat.st_mode)) {
+         close(fd);
+         return;
+      }
+      length = (size_t)fileStat.st_size;
+      if (length > 0) {
+         void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (mapping == MAP_FAILED) {
+            close(fd);
+            return;
+         }
+         base = (const uint8_t *)mapping;
+      }
+      close(fd);
+#endif
+      opened = true;
+      UsbdmSystem::Log::print("Mapped %s (%ld bytes)\n", filePath, (long)length);
+   }
+   ~MappedFile() {
+#ifdef _WIN32
+      if (base != NULL) {
+         UnmapViewOfFile(base);
+      }
+      if (mappingHandle != NULL) {
+         CloseHandle(mappingHandle);
+      }
+      if (fileHandle != INVALID_HANDLE_VALUE) {
+         CloseHandle(fileHandle);
+      }
+#else
+      if (base != NULL) {
+         munmap((void *)base, length);
+      }
+#endif
+   }
+   /** Indicates if the file was successfully opened */
+   bool isOpen() const {
+      return opened;
+   }
+   /** Start of file contents */
+   const uint8_t *data() const {
+      return base;
+   }
+   /** Size of file */
+   size_t size() const {
+      return length;
+   }
+   /**
+    * Indicates if the mapping may be referenced after loading completes.
+    *
+    * Windows prevents a mapped file from being replaced (e.g. by the linker)
+    * so the contents are copied there.
+    */
+   bool isShareable() const {
+#ifdef _WIN32
+      return false;
+#else
+      return true;
+#endif
+   }
+};
+
+/**
+ *  Iterates over the lines of a text file held in memory
+ */
+class LineReader {
+private:
+   const char *ptr;       //!< Start of next line
+   const char *end;       //!< End of text
+   unsigned    lineNum;   //!< Current line number
+
+public:
+   LineReader(const MappedFile &file) :
+      ptr((const char *)file.data()), end((const char *)file.data()+file.size()), lineNum(0) {
+   }
+   /**
+    * Get next non-blank line with leading & trailing white space removed
+    * A line starting with Ctrl-Z is treated as the end of the text
+    *
+    * @param line   - Start of line
+    * @param length - Length of line
+    *
+    * @return false if no lines remain
+    */
+   bool nextLine(const char *&line, unsigned &length) {
+      while (ptr < end) {
+         const char *lineEnd = (const char *)memchr(ptr, '\n', end-ptr);
+         if (lineEnd == NULL) {
+            lineEnd = end;
+         }
+         line = ptr;
+         ptr  = lineEnd+1;
+         lineNum++;
+         while ((line < lineEnd) && ((*line == ' ') || (*line == '\t') || (*line == '\r'))) {
+            line++;
+         }
+         while ((lineEnd > line) && ((lineEnd[-1] == ' ') || (lineEnd[-1] == '\t') || (lineEnd[-1] == '\r'))) {
+            lineEnd--;
+         }
+         if ((lineEnd > line) && (*line == '\x1A')) {
+            // DOS end of file marker
+            ptr = end;
+            return false;
+         }
+         if (lineEnd > line) {
+            length = lineEnd-line;
+            return true;
+         }
+      }
+      return false;
+   }
+   /** Current line number */
+   unsigned getLineNum() const {
+      return lineNum;
+   }
+};
+
+/**
+ *  Table to convert ASCII characters to hex digit values (0xFF => not a hex digit)
+ */
+static const struct HexTable {
+   uint8_t value[256];
+   HexTable() {
+      memset(value, 0xFF, sizeof(value));
+      for (int digit=0; digit<10; digit++) {
+         value['0'+digit] = digit;
+      }
+      for (int digit=0; digit<6; digit++) {
+         value['A'+digit] = 10+digit;
+         value['a'+digit] = 10+digit;
+      }
+   }
+} hexTable;
+
+/**
+ *  Convert pairs of hex characters to bytes
+ *
+ *  @param text      - Characters to convert (2*byteCount)
+ *  @param byteCount - Number of bytes to produce
+ *  @param data      - Where to place bytes
+ *
+ *  @return false if text contains an illegal character
+ */
+static bool decodeHex(const char *text, unsigned byteCount, uint8_t data[]) {
+   unsigned invalid = 0;
+   while (byteCount-->0) {
+      uint8_t high = hexTable.value[(uint8_t)*text++];
+      uint8_t low  = hexTable.value[(uint8_t)*text++];
+      invalid |= high|low;
+      *data++ = (high<<4)|low;
+   }
+   // Invalid characters have bit 7 set
+   return (invalid&0x80) == 0;
+}
+
+/**
+ *  Load a record of data into the image
+ *
+ *  @param address - Address to load at
+ *  @param data    - Data to load
+ *  @param size    - Size of data
+ *
+ *  @note A message is logged if the data overlaps existing data and allowOverwrite is false
+ */
+void FlashImageImp::loadRecordData(uint32_t address, const uint8_t data[], unsigned size) {
+   if (!allowOverwrite && isOccupied(size, address)) {
+      ExtentMap::iterator extent = findNextExtent(address);
+      UsbdmSystem::Log::print("Memory image overlaps @0x%X\n", (extent->first>address)?extent->first:address);
+   }
+   loadData(size, address, data);
+}
+
 /*
  *  Load a Absolute binary image file into the buffer. \n
  *
@@ -991,38 +1242,289 @@ inline bool ends_with(std::string const & value, std::string const & ending) {
  */
 USBDM_ErrorCode FlashImageImp::loadAbsoluteFile(const string &fileName) {
    LOGGING_Q;
-   char         buffer[1024];
-   uint32_t     addr = 0;
-   uint32_t     size;
 
    // Bit dopey but check if it is likely to be a binary file and reject otherwise -
    if (!ends_with(fileName, ".abs") && !ends_with(fileName, ".bin")) {
       return SFILE_RC_UNKNOWN_FILE_FORMAT;
    }
 
-   Openfile file(fileName.c_str(), "rb");
-   fp = file.getfp();
-
-   if (fp == NULL) {
+   MappedFile file(fileName.c_str());
+   if (!file.isOpen()) {
       log.print(" - Failed to open input file %s\n", fileName.c_str());
       return SFILE_RC_FILE_OPEN_FAILED;
    }
    log.print("filename = \"%s\"\n", fileName.c_str());
 
-   while ((size = fread(buffer, 1, sizeof(buffer), fp)) != 0) {
-      for (unsigned index=0; index<size; index++) {
-         if (this->isValid(addr) && !allowOverwrite) {
-            // Occupied address
-            log.print("Memory image overlaps @0x%X\n", addr);
-         }
-         this->setValue(addr++, (uint8_t)buffer[index]);
-      }
-   }
+   loadRecordData(0, file.data(), file.size());
+
    log.print("FlashImageImp::MemorySpace::loadS1S9File()\n");
    printMemoryMap();
    return SFILE_RC_OK;
 }
 
+/**
+ *  Get the identity of a file
+ *
+ *  @param filePath  Path of file
+ *  @param identity  Size, modification time and serial number of file
+ *
+ *  @return true if successful
+ */
+static bool getFileIdentity(const string &filePath, FileIdentity &identity) {
+#ifdef _WIN32
+   WIN32_FILE_ATTRIBUTE_DATA attributes;
+   if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &attributes)) {
+      return false;
+   }
+   identity.size         = ((uint64_t)attributes.nFileSizeHigh<<32)|attributes.nFileSizeLow;
+   identity.modifiedTime = (((uint64_t)attributes.ftLastWriteTime.dwHighDateTime<<32)|attributes.ftLastWriteTime.dwLowDateTime)*100;
+   identity.fileId       = 0;
+#else
+   struct stat fileStat;
+   if ((stat(filePath.c_str(), &fileStat) != 0) || !S_ISREG(fileStat.st_mode)) {
+      return false;
+   }
+   identity.size         = (uint64_t)fileStat.st_size;
+   identity.modifiedTime = (uint64_t)fileStat.st_mtim.tv_sec*1000000000ULL+fileStat.st_mtim.tv_nsec;
+   identity.fileId       = (uint64_t)fileStat.st_ino;
+#endif
+   return true;
+}
+
+/**
+ *  Check if two file identities refer to the same version of a file
+ */
+static bool isSameFile(const FileIdentity &left, const FileIdentity &right) {
+   return (left.size         == right.size) &&
+          (left.modifiedTime == right.modifiedTime) &&
+          (left.fileId       == right.fileId);
+}
+
+/**
+ *  Calculate the content hash of a file
+ *
+ *  This is a 64-bit FNV-1a style hash applied to 8-byte words.
+ *
+ *  @param filePath     Path of file
+ *  @param contentHash  Hash of file contents
+ *
+ *  @return true if successful
+ */
+static bool hashFile(const string &filePath, uint64_t &contentHash) {
+   MappedFile file(filePath.c_str());
+   if (!file.isOpen()) {
+      return false;
+   }
+   const uint8_t *ptr = file.data();
+   const uint8_t *end = ptr+file.size();
+   uint64_t hash = 0xCBF29CE484222325ULL;
+   while (end-ptr >= 8) {
+      uint64_t word;
+      memcpy(&word, ptr, sizeof(word));
+      ptr  += sizeof(word);
+      hash  = (hash ^ word) * 0x100000001B3ULL;
+   }
+   while (ptr < end) {
+      hash = (hash ^ *ptr++) * 0x100000001B3ULL;
+   }
+   contentHash = hash ^ file.size();
+   return true;
+}
+
+/**
+ *  Header of image cache file\n
+ *  Followed by the source path and then the extents as (address, size, data)
+ */
+struct ImageCacheHeader {
+   char     magic[8];        //!< IMAGE_CACHE_MAGIC
+   uint32_t version;         //!< IMAGE_CACHE_VERSION
+   uint32_t targetType;      //!< Target type image was parsed for
+   uint32_t wordAddresses;   //!< Image uses word addresses
+   uint32_t pathLength;      //!< Length of source path following header
+   uint64_t fileSize;        //!< Size of source file
+   uint64_t modifiedTime;    //!< Modification time of source file
+   uint64_t fileId;          //!< Serial number of source file
+   uint64_t contentHash;     //!< Hash of source file contents
+   uint32_t extentCount;     //!< Number of extents following path
+   uint32_t reserved;
+};
+
+static const char     IMAGE_CACHE_MAGIC[8]  = {'U','S','B','D','M','I','M','G'};
+static const uint32_t IMAGE_CACHE_VERSION   = 2;
+
+/**
+ *  Get path of image cache file for a source file
+ *
+ *  The name is derived from the source path and target type so a file has
+ *  a single cache entry that is replaced when the file changes.
+ *
+ *  @param filePath Path of source file
+ *
+ *  @return Path of cache file (empty if not available)
+ */
+string FlashImageImp::getImageCachePath(const string &filePath) {
+   uint64_t hash = 0xCBF29CE484222325ULL;
+   for (string::const_iterator it=filePath.begin(); it!=filePath.end(); ++it) {
+      hash = (hash ^ (uint8_t)*it) * 0x100000001B3ULL;
+   }
+   hash = (hash ^ (uint8_t)targetType) * 0x100000001B3ULL;
+   hash = (hash ^ (uint8_t)wordAddresses) * 0x100000001B3ULL;
+   char name[40];
+   snprintf(name, sizeof(name), "ImageCache-%016llX.bin", (unsigned long long)hash);
+   return UsbdmSystem::getConfigurationPath(name);
+}
+
+/**
+ *  Load image from the image cache
+ *
+ *  The cache entry is a candidate if the size, modification time and serial number
+ *  of the source file match.  The file contents are then hashed to confirm the hit.
+ *
+ *  @param filePath     Path of source file
+ *  @param identity     Identity of source file
+ *
+ *  @return SFILE_RC_OK if loaded from cache
+ *
+ *  @note The image is left clear on failure
+ */
+USBDM_ErrorCode FlashImageImp::loadImageCache(const string &filePath, const FileIdentity &identity) {
+   LOGGING_Q;
+
+   string cachePath = getImageCachePath(filePath);
+   if (cachePath.empty()) {
+      return SFILE_RC_FILE_OPEN_FAILED;
+   }
+   shared_ptr<MappedFile> cacheFile(new MappedFile(cachePath.c_str()));
+   if (!cacheFile->isOpen()) {
+      return SFILE_RC_FILE_OPEN_FAILED;
+   }
+   const uint8_t *ptr = cacheFile->data();
+   const uint8_t *end = ptr+cacheFile->size();
+
+   ImageCacheHeader header;
+   if ((size_t)(end-ptr) < sizeof(header)) {
+      return SFILE_RC_UNKNOWN_FILE_FORMAT;
+   }
+   memcpy(&header, ptr, sizeof(header));
+   ptr += sizeof(header);
+   if ((memcmp(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+       (header.version       != IMAGE_CACHE_VERSION) ||
+       (header.targetType    != (uint32_t)targetType) ||
+       (header.wordAddresses != (uint32_t)wordAddresses) ||
+       (header.fileSize      != identity.size) ||
+       (header.modifiedTime  != identity.modifiedTime) ||
+       (header.fileId        != identity.fileId) ||
+       (header.pathLength    != filePath.size()) ||
+       ((size_t)(end-ptr) < header.pathLength) ||
+       (memcmp(ptr, filePath.data(), header.pathLength) != 0)) {
+      log.print("Image cache is stale\n");
+      return SFILE_RC_UNKNOWN_FILE_FORMAT;
+   }
+   // Confirm candidate
+   uint64_t contentHash;
+   if (!hashFile(filePath, contentHash) || (header.contentHash != contentHash)) {
+      log.print("Image cache is stale (contents changed)\n");
+      return SFILE_RC_UNKNOWN_FILE_FORMAT;
+   }
+   ptr += header.pathLength;
+   for (uint32_t extentNum=0; extentNum<header.extentCount; extentNum++) {
+      uint32_t extentInfo[2];
+      if ((size_t)(end-ptr) < sizeof(extentInfo)) {
+         clear();
+         return SFILE_RC_UNKNOWN_FILE_FORMAT;
+      }
+      memcpy(extentInfo, ptr, sizeof(extentInfo));
+      ptr += sizeof(extentInfo);
+      if ((size_t)(end-ptr) < extentInfo[1]) {
+         clear();
+         return SFILE_RC_UNKNOWN_FILE_FORMAT;
+      }
+      if (cacheFile->isShareable()) {
+         loadBorrowedData(extentInfo[1], extentInfo[0], ptr, cacheFile);
+      }
+      else {
+         loadData(extentInfo[1], extentInfo[0], ptr);
+      }
+      ptr += extentInfo[1];
+   }
+   releaseBorrowedData();
+   log.print("Loaded from image cache \'%s\'\n", cachePath.c_str());
+   return SFILE_RC_OK;
+}
+
+/**
+ *  Save image to the image cache
+ *
+ *  @param filePath     Path of source file
+ *  @param identity     Identity of source file before parsing
+ *
+ *  @note Failure is not an error - the file is just parsed again next time
+ */
+void FlashImageImp::saveImageCache(const string &filePath, const FileIdentity &identity) {
+   LOGGING_Q;
+
+   // Discard if source changed while parsing
+   FileIdentity currentIdentity;
+   if (!getFileIdentity(filePath, currentIdentity) || !isSameFile(identity, currentIdentity)) {
+      return;
+   }
+   uint64_t contentHash;
+   if (!hashFile(filePath, contentHash)) {
+      return;
+   }
+   string cachePath = getImageCachePath(filePath);
+   if (cachePath.empty()) {
+      return;
+   }
+   // Write to a temporary file so other processes never see a partial cache file
+   char suffix[20];
+#ifdef _WIN32
+   snprintf(suffix, sizeof(suffix), ".%lu", (unsigned long)GetCurrentProcessId());
+#else
+   snprintf(suffix, sizeof(suffix), ".%lu", (unsigned long)getpid());
+#endif
+   string tempPath = cachePath+suffix;
+   FILE *cacheFp = fopen(tempPath.c_str(), "wb");
+   if (cacheFp == NULL) {
+      log.print("Failed to create \'%s\'\n", tempPath.c_str());
+      return;
+   }
+   ImageCacheHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic));
+   header.version       = IMAGE_CACHE_VERSION;
+   header.targetType    = (uint32_t)targetType;
+   header.wordAddresses = (uint32_t)wordAddresses;
+   header.pathLength    = filePath.size();
+   header.fileSize      = identity.size;
+   header.modifiedTime  = identity.modifiedTime;
+   header.fileId        = identity.fileId;
+   header.contentHash   = contentHash;
+   header.extentCount   = memoryExtents.size();
+
+   bool success = (fwrite(&header, sizeof(header), 1, cacheFp) == 1) &&
+                  (fwrite(filePath.data(), 1, filePath.size(), cacheFp) == filePath.size());
+   for (ExtentMap::const_iterator extent=memoryExtents.begin(); success && (extent!=memoryExtents.end()); ++extent) {
+      uint32_t extentInfo[2] = {extent->first, (uint32_t)extent->second.size()};
+      success = (fwrite(extentInfo, sizeof(extentInfo), 1, cacheFp) == 1) &&
+                (fwrite(extent->second.data(), 1, extent->second.size(), cacheFp) == extent->second.size());
+   }
+   success = (fclose(cacheFp) == 0) && success;
+   if (success) {
+#ifdef _WIN32
+      // Windows rename() doesn't replace an existing file
+      ::remove(cachePath.c_str());
+#endif
+      success = (rename(tempPath.c_str(), cachePath.c_str()) == 0);
+   }
+   if (!success) {
+      log.print("Failed to write \'%s\'\n", cachePath.c_str());
+      ::remove(tempPath.c_str());
+      return;
+   }
+   log.print("Saved image cache \'%s\'\n", cachePath.c_str());
+}
+
 /*
  *  Load a Freescale S-record file into the buffer. \n
  *
@@ -1035,33 +1537,25 @@ USBDM_ErrorCode FlashImageImp::loadAbsoluteFile(const string &fileName) {
  */
 USBDM_ErrorCode FlashImageImp::loadS1S9File(const string &fileName) {
    LOGGING_Q;
-   char        *ptr;
-   char         buffer[1024];
-   uint32_t     addr;
-   uint32_t     srecSize;
-   uint8_t      checkSum;
    bool         fileRecognized = false;
+   uint8_t      record[256];  // Byte count + address + data + checksum
 
-   Openfile file(fileName.c_str(), "rt");
-   fp = file.getfp();
-
-   if (fp == NULL) {
+   MappedFile file(fileName.c_str());
+   if (!file.isOpen()) {
       log.print("FlashImageImp::MemorySpace::loadS1S9File(\"%s\") - Failed to open input file\n", fileName.c_str());
       return SFILE_RC_FILE_OPEN_FAILED;
    }
    log.print("filename = \"%s\"\n", fileName.c_str());
 
-   unsigned int lineNum  = 0;
-   while (fgets(buffer, sizeof(buffer)-1, fp) != NULL) {
-      lineNum++;
-//      log.print("Input: %s",buffer);
-      ptr = buffer;
-      // Find first non-blank
-      while ((*ptr == ' ') || (*ptr == '\t') || (*ptr == '\n') || (*ptr == '\r'))
-         ptr++;
+   LineReader   reader(file);
+   const char  *line;
+   unsigned     length;
+   while (reader.nextLine(line, length)) {
+//      log.print("Input: %.*s\n", length, line);
+      unsigned addressSize;
       // Check if S-record
-      if ((*ptr != 'S') && (*ptr != 's')) {
-         log.print("- illegal line #%5d-%s", lineNum, buffer);
+      if ((length < 2) || ((line[0] != 'S') && (line[0] != 's'))) {
+         log.print("- illegal line #%5d-%.*s\n", reader.getLineNum(), length, line);
          if (fileRecognized) {
             return SFILE_RC_ILLEGAL_LINE;
          }
@@ -1069,7 +1563,7 @@ USBDM_ErrorCode FlashImageImp::loadS1S9File(const string &fileName) {
             return SFILE_RC_UNKNOWN_FILE_FORMAT;
          }
       }
-      switch (*(ptr+1)) {
+      switch (line[1]) {
       case '0': // Information header
       case '7': // 32-bit start address
       case '8': // 24-bit start address
@@ -1078,35 +1572,17 @@ USBDM_ErrorCode FlashImageImp::loadS1S9File(const string &fileName) {
       case '6': // 24-bit record length
          // Discard S0, S5, S6, S7, S8 & S9 records
          continue;
-      case '1':
-         // S1 = 16-bit address, data record
-         ptr +=2; // Skip 'S1'
-         srecSize = hex2ToDecimal( &ptr );
-         addr = hex4ToDecimal( &ptr );
-         checkSum = (uint8_t)srecSize + (uint8_t)(addr>>8) + (uint8_t)addr;
-         srecSize -= 3; // subtract 3 from byte count (srecSize + 2 addr bytes)
-//         log.print("(%2.2X)%4.4lX:\n",srecSize,addr);
+      case '1': // S1 = 16-bit address, data record
+         addressSize = 2;
          break;
-      case '2':
-         // S2 = 24-bit address, data record
-         ptr +=2; // Skip 'S2'
-         srecSize = hex2ToDecimal( &ptr );
-         addr = hex6ToDecimal( &ptr );
-         checkSum = (uint8_t)srecSize + (uint8_t)(addr>>16) + (uint8_t)(addr>>8) + (uint8_t)addr;
-         srecSize -= 4; // subtract 4 from byte count (srecSize + 3 addr bytes)
-//         log.print("srecSize=0x%02X, addr=0x%06X\n",srecSize,addr);
+      case '2': // S2 = 24-bit address, data record
+         addressSize = 3;
          break;
-      case '3':
-         // S3 32-bit address, data record
-         ptr +=2; // Skip 'S3'
-         srecSize = hex2ToDecimal( &ptr );
-         addr = hex8ToDecimal( &ptr );
-         checkSum = (uint8_t)srecSize + (uint8_t)(addr>>24) + (uint8_t)(addr>>16) + (uint8_t)(addr>>8) + (uint8_t)addr;
-         srecSize -= 5; // subtract 5 from byte count (srecSize + 4 addr bytes)
-//         log.print("S3: srecSize=0x%02X, addr=0x%08X, initial chk=0x%02X\n", srecSize, addr, checkSum);
+      case '3': // S3 32-bit address, data record
+         addressSize = 4;
          break;
       default:
-         log.print("- illegal line #%5d-%s", lineNum, buffer);
+         log.print("- illegal line #%5d-%.*s\n", reader.getLineNum(), length, line);
          if (fileRecognized) {
             return SFILE_RC_ILLEGAL_LINE;
          }
@@ -1114,40 +1590,133 @@ USBDM_ErrorCode FlashImageImp::loadS1S9File(const string &fileName) {
             return SFILE_RC_UNKNOWN_FILE_FORMAT;
          }
       }
-      if (wordAddresses) {
-         addr *= 2;
-      }
-      if (sizeof(uint8_t) == 1) {
-         while (srecSize>0) {
-            uint8_t data;
-            data = hex2ToDecimal( &ptr );
-            checkSum += (uint8_t)data;
-            if (this->isValid(addr) && !allowOverwrite) {
-               // Occupied address
-               log.print("Memory image overlaps @0x%X\n", addr);
-            }
-            this->setValue(addr++, (uint8_t)data);
-            srecSize--;
-//         log.print("%02X",data);
+      // Decode whole record after the type - byte count, address, data & checksum
+      unsigned recordSize = (length-2)/2;
+      if ((length < 4) || !decodeHex(line+2, 1, record) ||
+          (record[0] < addressSize+1) || (recordSize < (unsigned)record[0]+1U) ||
+          !decodeHex(line+2, record[0]+1U, record)) {
+         log.print("- illegal line #%5d-%.*s\n", reader.getLineNum(), length, line);
+         if (fileRecognized) {
+            return SFILE_RC_ILLEGAL_LINE;
+         }
+         else {
+            return SFILE_RC_UNKNOWN_FILE_FORMAT;
          }
       }
-      // Get checksum from record
-      uint8_t data = hex2ToDecimal( &ptr );
-      if ((uint8_t)~checkSum != data) {
-         log.print("- illegal line #%5d:\n%s", lineNum, buffer);
+      recordSize = record[0]+1U;
+      uint8_t checkSum = 0;
+      for (unsigned index=0; index<recordSize-1; index++) {
+         checkSum += record[index];
+      }
+      if ((uint8_t)~checkSum != record[recordSize-1]) {
+         log.print("- illegal line #%5d:\n%.*s\n", reader.getLineNum(), length, line);
          log.print("- checksum error, Checksum=0x%02X, "
                "Calculated Checksum=0x%02X\n",
-               data, (uint8_t)~checkSum);
+               record[recordSize-1], (uint8_t)~checkSum);
          return SFILE_RC_CHECKSUM;
       }
+      uint32_t addr = 0;
+      for (unsigned index=1; index<=addressSize; index++) {
+         addr = (addr<<8)|record[index];
+      }
+      if (wordAddresses) {
+         addr *= 2;
+      }
+      // Byte count includes address & checksum
+      loadRecordData(addr, record+1+addressSize, record[0]-addressSize-1);
       fileRecognized = true; // Read at least 1 record - assume it's a SREC file
-//      log.print("\n");
    }
 //   log.print("FlashImageImp::MemorySpace::loadS1S9File()\n");
 //   printMemoryMap();
    return SFILE_RC_OK;
 }
 
+/*
+ *  Load an Intel HEX file into the buffer. \n
+ *
+ *  @param fileName Path of file to load
+ *
+ *  @return Error code
+ */
+USBDM_ErrorCode FlashImageImp::loadIntelHexFile(const string &fileName) {
+   LOGGING_Q;
+   bool         fileRecognized = false;
+   uint8_t      record[256+5];  // Byte count + address + type + data + checksum
+   uint32_t     baseAddress    = 0;
+
+   MappedFile file(fileName.c_str());
+   if (!file.isOpen()) {
+      log.print("Failed to open input file \"%s\"\n", fileName.c_str());
+      return SFILE_RC_FILE_OPEN_FAILED;
+   }
+   log.print("filename = \"%s\"\n", fileName.c_str());
+
+   LineReader   reader(file);
+   const char  *line;
+   unsigned     length;
+   while (reader.nextLine(line, length)) {
+      // Record is ':' + byte count + address + type + data + checksum
+      if ((line[0] != ':') || (length < 11) || ((length&1) == 0) || !decodeHex(line+1, 1, record) ||
+          (length != 11U+2*record[0]) || !decodeHex(line+1, record[0]+5U, record)) {
+         log.print("- illegal line #%5d-%.*s\n", reader.getLineNum(), length, line);
+         if (fileRecognized) {
+            return SFILE_RC_ILLEGAL_LINE;
+         }
+         else {
+            return SFILE_RC_UNKNOWN_FILE_FORMAT;
+         }
+      }
+      unsigned recordSize = record[0]+5U;
+      uint8_t  checkSum   = 0;
+      for (unsigned index=0; index<recordSize; index++) {
+         checkSum += record[index];
+      }
+      if (checkSum != 0) {
+         log.print("- illegal line #%5d:\n%.*s\n", reader.getLineNum(), length, line);
+         log.print("- checksum error, Checksum=0x%02X, "
+               "Calculated Checksum=0x%02X\n",
+               record[recordSize-1], (uint8_t)(record[recordSize-1]-checkSum));
+         return SFILE_RC_CHECKSUM;
+      }
+      fileRecognized = true; // Read at least 1 record - assume it's a HEX file
+      uint8_t  dataSize = record[0];
+      uint32_t offset   = (record[1]<<8)|record[2];
+      uint8_t *data     = record+4;
+      switch (record[3]) {
+      case 0x00: { // Data record
+         uint32_t addr = baseAddress+offset;
+         if (wordAddresses) {
+            addr *= 2;
+         }
+         loadRecordData(addr, data, dataSize);
+         break;
+      }
+      case 0x01: // End of file
+         return SFILE_RC_OK;
+      case 0x02: // Extended segment address
+         if (dataSize != 2) {
+            return SFILE_RC_ILLEGAL_LINE;
+         }
+         baseAddress = ((data[0]<<8)|data[1])<<4;
+         break;
+      case 0x04: // Extended linear address
+         if (dataSize != 2) {
+            return SFILE_RC_ILLEGAL_LINE;
+         }
+         baseAddress = ((data[0]<<8)|data[1])<<16;
+         break;
+      case 0x03: // Start segment address
+      case 0x05: // Start linear address
+         // Discard
+         break;
+      default:
+         log.print("- illegal record type line #%5d-%.*s\n", reader.getLineNum(), length, line);
+         return SFILE_RC_ILLEGAL_LINE;
+      }
+   }
+   return SFILE_RC_OK;
+}
+
 /*=============================================================================
  * ELF Files
  *===========================================================================*/
@@ -1304,20 +1873,32 @@ USBDM_ErrorCode FlashImageImp::checkTargetType(Elf32_Half e_machine, TargetType_
    return BDM_RC_OK;
 }
 
+/**
+ *  Get a block of data from the ELF file being loaded
+ *
+ *  @param offset   Offset to block in file
+ *  @param size     Size of block in bytes
+ *
+ *  @return Pointer to data or NULL if block lies outside file
+ */
+const uint8_t *FlashImageImp::getElfData(uint32_t offset, uint32_t size) {
+   if ((elfFile == NULL) || ((uint64_t)offset+size > elfFile->size())) {
+      return NULL;
+   }
+   return elfFile->data()+offset;
+}
+
 /**
  *  Load a ELF block into the buffer.
  *
- *  The buffer is cleared to 0xFFFF before loading.  Modified locations will
- *  have a non-0xFF upper byte so used locations can be differentiated. \n
+ *  The block is referenced directly from the memory mapped file where possible.
  *
- *  @param fp       Open file pointer
  *  @param fOffset  Offset to block in file
  *  @param size     Size of block in bytes
  *  @param addr     Bytes address to load block
  */
 USBDM_ErrorCode FlashImageImp::loadElfBlock(
-      FILE       *fp,
-      long        fOffset,
+      uint32_t    fOffset,
       Elf32_Word  size,
       Elf32_Addr  addr) {
 
@@ -1330,40 +1911,26 @@ USBDM_ErrorCode FlashImageImp::loadElfBlock(
       //      log.print("[empty]\n");
       return BDM_RC_OK;
    }
-//#if defined(TARGET) && (TARGET == MC56F80xx)
-//      log.print("[0x%08X..0x%08X]\n", addr, addr+size/2-1);
-//#else
-//      log.print("[0x%08X..0x%08X]\n", addr, addr+size-1);
-//#endif
-   fseek(fp, fOffset, SEEK_SET);
-   while (size>0) {
-      uint8_t buff[1024];
-      Elf32_Word blockSize = size;
-      if (blockSize > sizeof(buff)) {
-         blockSize = sizeof(buff);
-      }
-      size_t sz;
-      if ((sz=fread(buff, 1, blockSize, fp)) != blockSize) {
-         log.print("- Failed - Undersize read of Block (Expected %lu, read %lu)\n", (unsigned long)blockSize, (unsigned long)sz);
-         return SFILE_RC_ELF_FORMAT_ERROR;
-      }
-//      #if defined(TARGET) && (TARGET == MC56F80xx)
-//            printDump(buff, blockSize, addr, UsbdmSystem::WORD_ADDRESS|UsbdmSystem::WORD_DISPLAY);
-//      #else
-//            log.printDump(buff, blockSize, addr, UsbdmSystem::BYTE_ADDRESS);
-//      #endif
-      for (unsigned index=0; index<blockSize; ) {
-         uint16_t value;
+   const uint8_t *buff = getElfData(fOffset, size);
+   if (buff == NULL) {
+      log.print("- Failed - Block lies outside file (Offset 0x%lX, size %lu)\n", (unsigned long)fOffset, (unsigned long)size);
+      return SFILE_RC_ELF_FORMAT_ERROR;
+   }
 #if defined(TARGET) && (TARGET == MC56F80xx)
-         value  = buff[index++];
-         value += buff[index++]<<8;
+   for (unsigned index=0; index<size; ) {
+      uint16_t value;
+      value  = buff[index++];
+      value += buff[index++]<<8;
+      this->setValue(addr++, value);
+   }
 #else
-         value = buff[index++];
-#endif
-         this->setValue(addr++, value);
-      }
-      size -= blockSize;
+   if (elfFile->isShareable()) {
+      loadBorrowedData(size, addr, buff, elfFile);
    }
+   else {
+      loadData(size, addr, buff);
+   }
+#endif
    return SFILE_RC_OK;
 }
 
@@ -1541,23 +2108,18 @@ const char * FlashImageImp::getElfString(unsigned index) {
          return empty;
       }
       // Load string table section header
-      fseek(fp, elfHeader.e_shoff+elfHeader.e_shstrndx*elfHeader.e_shentsize, SEEK_SET);
-      size_t sz;
-      if ((sz=fread(&stringSectionHeader, 1, sizeof(stringSectionHeader), fp)) != sizeof(stringSectionHeader)) {
-         UsbdmSystem::Log::error("Undersize read of String Section Header (Expected %lu, read %lu)\n",
-               (unsigned long)sizeof(stringSectionHeader), (unsigned long)sz);
+      const uint8_t *header = getElfData(elfHeader.e_shoff+elfHeader.e_shstrndx*elfHeader.e_shentsize, sizeof(stringSectionHeader));
+      if (header == NULL) {
+         UsbdmSystem::Log::error("String Section Header lies outside file\n");
          return empty;
       }
+      memcpy(&stringSectionHeader, header, sizeof(stringSectionHeader));
+      fixElfSectionHeaderSex(&stringSectionHeader);
       if (stringSectionHeader.sh_type == SHN_UNDEF) {
          return empty;
       }
-      symTable = (char*)malloc(stringSectionHeader.sh_size);
-      if (symTable == 0) {
-         UsbdmSystem::Log::error("Malloc failed\n");
-         return empty;
-      }
-      fseek(fp, stringSectionHeader.sh_offset, SEEK_SET);
-      if (fread(symTable, 1, stringSectionHeader.sh_size, fp) != stringSectionHeader.sh_size) {
+      symTable = (const char *)getElfData(stringSectionHeader.sh_offset, stringSectionHeader.sh_size);
+      if (symTable == NULL) {
          return empty;
       }
       noSymTable = false;
@@ -1579,20 +2141,38 @@ const char * FlashImageImp::getElfString(unsigned index) {
  */
 USBDM_ErrorCode FlashImageImp::loadElfFile(const string &filePath) {
    LOGGING_Q;
-   Openfile file(filePath.c_str(), "rb");
-   MallocWrapper<Elf32_Phdr> phWrapper(programHeaders);
-   MallocWrapper<char>       stWrapper(symTable);
 
-   fp = file.getfp();
-   if (fp == NULL) {
+   elfFile.reset(new MappedFile(filePath.c_str()));
+   if (!elfFile->isOpen()) {
+      elfFile.reset();
       log.error("Failed to open input file \'%s\'\n", filePath.c_str());
       return SFILE_RC_FILE_OPEN_FAILED;
    }
    //   log.print("Input file - \'%s\'\n", filePath.c_str());
 
-   if (fread(&elfHeader, 1, sizeof(elfHeader), fp) != sizeof(elfHeader)) {
+   USBDM_ErrorCode rc = loadMappedElfFile();
+
+   // Copy segments so the mapping can be released
+   releaseBorrowedData();
+   symTable = NULL;
+   elfFile.reset();
+   return rc;
+}
+
+/**
+ *  Load the ELF file that has been mapped into elfFile. \n
+ *
+ *  @return Error code
+ */
+USBDM_ErrorCode FlashImageImp::loadMappedElfFile() {
+   LOGGING_Q;
+   MallocWrapper<Elf32_Phdr> phWrapper(programHeaders);
+
+   const uint8_t *header = getElfData(0, sizeof(elfHeader));
+   if (header == NULL) {
       return SFILE_RC_UNKNOWN_FILE_FORMAT;
    }
+   memcpy(&elfHeader, header, sizeof(elfHeader));
    //   log.print("FlashImageImp::MemorySpace::loadElfFile() - \n");
    //   printElfHeader(&elfHeader);
 
@@ -1629,12 +2209,13 @@ USBDM_ErrorCode FlashImageImp::loadElfFile(const string &filePath) {
    if (programHeaders == 0) {
       return SFILE_RC_ELF_FORMAT_ERROR;
    }
-   fseek(fp, elfHeader.e_phoff, SEEK_SET);
-   size_t sz;
-   if ((sz=fread(programHeaders, 1, totalProgramHeaderSize, fp)) != totalProgramHeaderSize) {
-      log.error("Undersize read of Header (Expected %lu, read %lu)\n",
-            (unsigned long)totalProgramHeaderSize, (unsigned long)sz);
-      return SFILE_RC_ELF_FORMAT_ERROR;
+   for (Elf32_Half headerIndex=0; headerIndex<elfHeader.e_phnum; headerIndex++) {
+      const uint8_t *programHeader = getElfData(elfHeader.e_phoff+headerIndex*elfHeader.e_phentsize, sizeof(Elf32_Phdr));
+      if (programHeader == NULL) {
+         log.error("Program Header lies outside file\n");
+         return SFILE_RC_ELF_FORMAT_ERROR;
+      }
+      memcpy(programHeaders+headerIndex, programHeader, sizeof(Elf32_Phdr));
    }
 
    // Convert program headers to native format (and print)
@@ -1654,12 +2235,12 @@ USBDM_ErrorCode FlashImageImp::loadElfFile(const string &filePath) {
    printHeader = true;
    for(Elf32_Half sectionIndex=0; sectionIndex<elfHeader.e_shnum; sectionIndex++) {
       Elf32_Shdr sectionHeader;
-      fseek(fp, elfHeader.e_shoff+sectionIndex*elfHeader.e_shentsize, SEEK_SET);
-      size_t sz;
-      if ((sz=fread(&sectionHeader, 1, sizeof(sectionHeader), fp)) != sizeof(sectionHeader)) {
-         log.error("Undersize read of Section Header (Expected %lu, read %lu)\n", (unsigned long)sizeof(sectionHeader), (unsigned long)sz);
+      const uint8_t *header = getElfData(elfHeader.e_shoff+sectionIndex*elfHeader.e_shentsize, sizeof(sectionHeader));
+      if (header == NULL) {
+         log.error("Section Header lies outside file\n");
          return SFILE_RC_ELF_FORMAT_ERROR;
       }
+      memcpy(&sectionHeader, header, sizeof(sectionHeader));
       fixElfSectionHeaderSex(&sectionHeader);
       if (sectionHeader.sh_type&SHT_PROGBITS) {
          printElfSectionHeader(&sectionHeader);
@@ -1676,12 +2257,12 @@ USBDM_ErrorCode FlashImageImp::loadElfFile(const string &filePath) {
    // Load image based on suitable sections
    for(Elf32_Half sectionIndex=0; sectionIndex<elfHeader.e_shnum; sectionIndex++) {
       Elf32_Shdr sectionHeader;
-      fseek(fp, elfHeader.e_shoff+sectionIndex*elfHeader.e_shentsize, SEEK_SET);
-      size_t sz;
-      if ((sz=fread(&sectionHeader, 1, sizeof(sectionHeader), fp)) != sizeof(sectionHeader)) {
-         log.error("Undersize read of Section Header (Expected %lu, read %lu)\n", (unsigned long)sizeof(sectionHeader), (unsigned long)sz);
+      const uint8_t *header = getElfData(elfHeader.e_shoff+sectionIndex*elfHeader.e_shentsize, sizeof(sectionHeader));
+      if (header == NULL) {
+         log.error("Section Header lies outside file\n");
          return SFILE_RC_ELF_FORMAT_ERROR;
       }
+      memcpy(&sectionHeader, header, sizeof(sectionHeader));
       fixElfSectionHeaderSex(&sectionHeader);
       loadElfBlockBySectionHeader(&sectionHeader);
    }
@@ -1744,10 +2325,6 @@ USBDM_ErrorCode FlashImageImp::loadElfBlockBySectionHeader(Elf32_Shdr *sectionHe
    Elf32_Addr loadAddress = sectionHeader->sh_addr; //getLoadAddress(sectionHeader);
    Elf32_Word size        = sectionHeader->sh_size;
 
-#if defined(TARGET) && (TARGET == MC56F80xx)
-   // DSC image uses word addresses
-   addr /= 2;
-#endif
    if (size == 0) {
 //      log.print("[empty]\n");
       return BDM_RC_OK;
@@ -1757,32 +2334,7 @@ USBDM_ErrorCode FlashImageImp::loadElfBlockBySectionHeader(Elf32_Shdr *sectionHe
 #else
       log.print("loading [0x%08X..0x%08X] @0x%08X\n", sectionHeader->sh_addr, sectionHeader->sh_addr+size-1, loadAddress);
 #endif
-   fseek(fp, sectionHeader->sh_offset, SEEK_SET);
-   while (size>0) {
-      uint8_t buff[1000];
-      Elf32_Word blockSize = size;
-      if (blockSize > sizeof(buff)) {
-         blockSize = sizeof(buff);
-      }
-      size_t sz;
-      if ((sz=fread(buff, 1, blockSize, fp)) != blockSize) {
-         log.print("- Failed - Undersize read of Block (Expected %lu, read %lu)\n", (unsigned long)blockSize, (unsigned long)sz);
-         return SFILE_RC_ELF_FORMAT_ERROR;
-      }
-//      log.printDump(buff, blockSize, loadAddress);
-      for (unsigned index=0; index<blockSize; ) {
-         uint16_t value;
-#if defined(TARGET) && (TARGET == MC56F80xx)
-         value  = buff[index++];
-         value += buff[index++]<<8;
-#else
-         value = buff[index++];
-#endif
-         this->setValue(loadAddress++, value);
-      }
-      size -= blockSize;
-   }
-   return SFILE_RC_OK;
+   return loadElfBlock(sectionHeader->sh_offset, size, loadAddress);
 }
 #else
 /**
@@ -1822,7 +2374,7 @@ USBDM_ErrorCode FlashImageImp::loadElfBlockByProgramHeader(Elf32_Phdr *programHe
    if (programHeader->p_filesz>0) {
       printElfProgramHeader(programHeader, loadAddress);
    }
-   return loadElfBlock(fp, programHeader->p_offset, programHeader->p_filesz, loadAddress);
+   return loadElfBlock(programHeader->p_offset, programHeader->p_filesz, loadAddress);
 }
 #endif // USE_SECTIONS
 
@@ -20,6 +20,9 @@
 
     Change History
    +====================================================================
+   | 17 Oct 2026 | Added parsed image cache
+   | 17 Oct 2026 | Extents may borrow data from memory mapped files
+   | 17 Oct 2026 | Changed to extent based storage
    |    May 2015 | Created
    +====================================================================
     \endverbatim
@@ -28,12 +31,15 @@
 #define  _FLASHIMAGE_IMP_H_
 
 #include <stdio.h>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "FlashImage.h"
 
-class  MemoryPage;
 class  EnumeratorImp;
-typedef std::shared_ptr<MemoryPage> MemoryPagePtr;
+class  MappedFile;
+struct FileIdentity;
 
 class FlashImageImp : public FlashImage {
 
@@ -81,23 +87,100 @@ class FlashImageImp : public FlashImage {
       }
    };
 
-   friend MemoryPage;
    friend EnumeratorImp;
 
 protected:
-   static const int                  PAGE_BIT_OFFSET =  (15-sizeof(uint8_t));  // 2**14 = 16K pages
-   static const unsigned             PAGE_SIZE       =  (1U<<PAGE_BIT_OFFSET);
-   static const int                  PAGE_MASK       =  (PAGE_SIZE-1U);
    static const int                  MAX_SREC_SIZE   =  (1<<4);//! Maximum size of a S-record (2^N)
 
+   /**
+    * Contiguous run of occupied memory locations.
+    *
+    * The data may be borrowed from another object (e.g. a memory mapped file) while
+    * loading.  A private copy is made before it is modified or when loading completes.
+    */
+   class MemoryExtent {
+   private:
+      std::vector<uint8_t>          ownedData;     //!< Data if owned
+      const uint8_t                *borrowedData;  //!< Data if borrowed (NULL if owned)
+      size_t                        borrowedSize;  //!< Size of borrowed data
+      std::shared_ptr<const void>   owner;         //!< Keeps borrowed data valid
+
+   public:
+      /** Make private copy of borrowed data */
+      void makeOwned() {
+         if (borrowedData != NULL) {
+            ownedData.assign(borrowedData, borrowedData+borrowedSize);
+            borrowedData = NULL;
+            borrowedSize = 0;
+            owner.reset();
+         }
+      }
+      MemoryExtent() : borrowedData(NULL), borrowedSize(0) {
+      }
+      size_t size() const {
+         return (borrowedData != NULL)?borrowedSize:ownedData.size();
+      }
+      bool empty() const {
+         return size() == 0;
+      }
+      const uint8_t *data() const {
+         return (borrowedData != NULL)?borrowedData:ownedData.data();
+      }
+      uint8_t operator[](size_t index) const {
+         return data()[index];
+      }
+      /** Get data for modification (a private copy is made if borrowed) */
+      uint8_t *modifiableData() {
+         makeOwned();
+         return ownedData.data();
+      }
+      /** Set extent to a private copy of data */
+      void assign(const uint8_t *start, const uint8_t *end) {
+         borrowedData = NULL;
+         borrowedSize = 0;
+         owner.reset();
+         ownedData.assign(start, end);
+      }
+      /** Set extent to borrowed data that is kept valid by owner */
+      void borrow(const uint8_t *data, size_t size, std::shared_ptr<const void> owner) {
+         std::vector<uint8_t>().swap(ownedData);
+         borrowedData = data;
+         borrowedSize = size;
+         this->owner  = owner;
+      }
+      /** Change size - Truncating borrowed data does not make a copy */
+      void resize(size_t size, uint8_t fillValue = 0xFF) {
+         if ((borrowedData != NULL) && (size <= borrowedSize)) {
+            borrowedSize = size;
+            return;
+         }
+         makeOwned();
+         ownedData.resize(size, fillValue);
+      }
+      /** Set result to the data from offset to the end of this extent */
+      void getTail(size_t offset, MemoryExtent &result) const {
+         if (borrowedData != NULL) {
+            result.borrow(borrowedData+offset, borrowedSize-offset, owner);
+         }
+         else {
+            result.assign(ownedData.data()+offset, ownedData.data()+ownedData.size());
+         }
+      }
+   };
+
+   /**
+    * Extents indexed by start address.
+    * Extents never overlap.  They only abut where data has been borrowed.
+    */
+   typedef std::map<uint32_t,MemoryExtent> ExtentMap;
+
 protected:
    TargetType_t                      targetType;
    bool                              wordAddresses;
-   std::map<uint32_t,MemoryPagePtr>  memoryPages;            //!< Pointers to occupied memory pages
+   ExtentMap                         memoryExtents;          //!< Occupied memory
+   ExtentMap::iterator               lastExtentAccessed;     //!< Last extent accessed (memoryExtents.end() if none)
    unsigned                          firstAllocatedAddress;  //!< First used memory locations
    unsigned                          lastAllocatedAddress;   //!< Last used memory locations
-   uint16_t                          lastPageNumAccessed;    //!< Page # of last page accessed
-   MemoryPagePtr                     lastMemoryPageAccessed; //!< Last page accessed
    unsigned                          elementCount;           //!< Count of occupied bytes
    bool                              littleEndian;           //!< Target is little-endian
    std::string                       sourceFilename;         //!< Name of last file loaded
@@ -109,7 +192,9 @@ protected:
    Elf32_Ehdr                        elfHeader;
    Elf32_Shdr                        stringSectionHeader;
    Elf32_Phdr                       *programHeaders;
-   char                             *symTable;
+   const char                       *symTable;
+   std::shared_ptr<MappedFile>       elfFile;                //!< ELF file being loaded
+   bool                              imageCacheEnabled;      //!< Parsed images are cached
 
 public:
    FlashImageImp();
@@ -132,14 +217,20 @@ public:
    virtual void                  dumpRange(uint32_t startAddress, uint32_t endAddress);
    virtual USBDM_ErrorCode       loadData(uint32_t bufferSize, uint32_t address, const uint8_t  data[], bool dontOverwrite = false);
    virtual USBDM_ErrorCode       loadDataBytes(uint32_t bufferSize, uint32_t address, const uint8_t data[], bool dontOverwrite = false);
+   virtual void                  getData(uint32_t bufferSize, uint32_t address, uint8_t data[]);
    virtual unsigned              getFirstAllocatedAddress() { return firstAllocatedAddress; }
    virtual unsigned              getLastAllocatedAddress()  { return lastAllocatedAddress; }
    virtual void                  fill(uint32_t size, uint32_t address, uint8_t fillValue = 0xFF);
    virtual void                  fillUnused(uint32_t size, uint32_t address, uint8_t fillValue = 0xFF);
+   virtual void                  enableImageCache(bool enable = true) { imageCacheEnabled = enable; }
 
 protected:
-   virtual MemoryPagePtr   getmemoryPage(uint32_t pageNum);
-   virtual MemoryPagePtr   allocatePage(uint32_t pageNum);
+   ExtentMap::iterator     findExtent(uint32_t address);
+   ExtentMap::iterator     findNextExtent(uint32_t address);
+   /** Address following extent */
+   static uint64_t         endOf(ExtentMap::const_iterator extent) { return (uint64_t)extent->first + extent->second.size(); }
+   /** Last address within extent */
+   static uint32_t         lastAddressOf(ExtentMap::const_iterator extent) { return extent->first + (extent->second.size()-1); }
    uint32_t                targetToNative(uint32_t &);
    uint16_t                targetToNative(uint16_t &);
    int32_t                 targetToNative(int32_t &);
@@ -153,17 +244,27 @@ protected:
 
    void                    fixElfProgramHeaderSex(Elf32_Phdr *programHeader);
    void                    fixElfSectionHeaderSex(Elf32_Shdr *elfsHeader);
-   USBDM_ErrorCode         loadElfBlock(FILE *fp, long fOffset, Elf32_Word size, Elf32_Addr addr);
+   const uint8_t          *getElfData(uint32_t offset, uint32_t size);
+   USBDM_ErrorCode         loadElfBlock(uint32_t fOffset, Elf32_Word size, Elf32_Addr addr);
    USBDM_ErrorCode         loadElfBlockByProgramHeader(Elf32_Phdr *programHeader);
    USBDM_ErrorCode         loadElfBlockBySectionHeader(Elf32_Shdr *sectionHeader);
    USBDM_ErrorCode         recordElfProgramBlock(Elf32_Phdr *programHeader);
    USBDM_ErrorCode         loadElfFile(const std::string &fileName);
+   USBDM_ErrorCode         loadMappedElfFile();
    USBDM_ErrorCode         checkTargetType(Elf32_Half e_machine, TargetType_t targetType);
    USBDM_ErrorCode         loadS1S9File(const std::string &fileName);
+   USBDM_ErrorCode         loadIntelHexFile(const std::string &fileName);
+   void                    loadRecordData(uint32_t address, const uint8_t data[], unsigned size);
+   void                    loadBorrowedData(uint32_t bufferSize, uint32_t address, const uint8_t data[], std::shared_ptr<const void> owner);
+   void                    releaseBorrowedData();
+   bool                    isOccupied(uint32_t size, uint32_t address);
    USBDM_ErrorCode         loadAbsoluteFile(const std::string &fileName);
+   USBDM_ErrorCode         parseFile(const std::string &filePath);
+
+   std::string             getImageCachePath(const std::string &filePath);
+   USBDM_ErrorCode         loadImageCache(const std::string &filePath, const FileIdentity &identity);
+   void                    saveImageCache(const std::string &filePath, const FileIdentity &identity);
 
-   static void             addressToPageOffset(uint32_t address, uint16_t &pageNum, uint16_t &offset);
-   static uint32_t         pageOffsetToAddress(uint16_t pageNum, uint16_t offset);
    void                    writeSrec(uint8_t *buffer, uint32_t address, unsigned size);
    void                    writeData(uint8_t *buffer, uint32_t address, unsigned size);
    Elf32_Addr              getLoadAddress(Elf32_Shdr *sectionHeader);
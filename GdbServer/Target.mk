@@ -43,14 +43,18 @@ LIBDIRS += $(XERCES_LIBDIRS)
 ifneq ($(UNAME_S),Windows)
 #LIBS += $(USBDM_DSC_LIBS)
 endif
+ifneq ($(HEADLESS),Y)
 LIBS += $(WXWIDGETS_LIBS)
+endif
 #LIBS += $(XERCES_LIBS)
 LIBS += $(USBDM_DEVICE_LIBS)
 LIBS += $(USBDM_SYSTEM_LIBS)
 LIBS += $(SOCKET_LIBS)
 ifeq ($(UNAME_S),Windows)
+ifneq ($(HEADLESS),Y)
 LIBS += -lwxbase$(WXWIDGETS_VERSION_NUM)u_net_gcc_custom
 endif
+endif
 ifneq ($(UNAME_S),Windows)
 #LIBS += $(USBDM_WX_LIBS) # Needed for 64-bit, Why?
 endif
@@ -103,7 +107,7 @@ $(BUILDDIR)/%.o : %.cpp
 $(BUILDDIR)/$(TARGET_EXE): $(OBJ) $(RESOURCE_OBJ)
 	@echo --
 	@echo -- Linking Target $@
-	$(CC) -o $@ $(GUI_OPTS) $(LDFLAGS) $(OBJ) $(RESOURCE_OBJ) $(LIBDIRS) $(LIBS) 
+	$(CC) -o $@ $(if $(filter Y,$(HEADLESS)),,$(GUI_OPTS)) $(LDFLAGS) $(OBJ) $(RESOURCE_OBJ) $(LIBDIRS) $(LIBS) 
 
 # How to copy EXE to target directory
 #==============================================
@@ -26,7 +26,7 @@ GdbBreakpoints_ARM::~GdbBreakpoints_ARM() {
 //! @return ptr to static buffer containing value
 //!
 inline const uint8_t *getData4x8Le(uint32_t data) {
-   static uint8_t data8[4];
+   static thread_local uint8_t data8[4];
    data8[0]= data;
    data8[1]= data>>8;
    data8[2]= data>>16;
@@ -7,8 +7,10 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <string>
 #include <string.h>
+#include <vector>
 #include <algorithm>    // std::find_if
 
 #include "GdbHandlerCommon.h"
@@ -18,7 +20,9 @@
 #include "Names.h"
 #include "Utils.h"
 
-GdbHandlerCommon *GdbHandlerCommon::This=0;
+thread_local GdbHandlerCommon *GdbHandlerCommon::This=0;
+
+pthread_mutex_t GdbHandlerCommon::pluginMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static const char targetXML[] =
       "<?xml version=\"1.0\"?>\n"
@@ -47,7 +51,10 @@ GdbHandlerCommon::GdbHandlerCommon(
          deviceInterface(deviceInterface),
          deviceData(deviceInterface->getCurrentDevice()),
          tty(tty),
-         defaultResetMethod(defaultResetMethod)
+         defaultResetMethod(defaultResetMethod),
+         memoryCache(bdmInterface, deviceData),
+         incrementalProgramming(true),
+         rttConsole(bdmInterface, deviceData, tty)
          {
    LOGGING;
 
@@ -61,7 +68,11 @@ GdbHandlerCommon::GdbHandlerCommon(
    useFastRegisterRead          = true;
    unsuccessfulPollCount        = 0;
    targetBreakPending           = false;
+   breakSignal                  = TARGET_SIGNAL_INT;
+   nonStopMode                  = false;
+   stopQueryActive              = false;
    registerBufferSize           = 0;
+   registerBufferDummy          = false;
    targetRegsXMLSize            = 0;
    targetLastRegIndex           = 0;
    targetRegsXMLSize            = 0;
@@ -75,7 +86,10 @@ GdbHandlerCommon::GdbHandlerCommon(
 }
 
 GdbHandlerCommon::~GdbHandlerCommon() {
+   pthread_mutex_lock(&pluginMutex);
    tclInterpreter.reset();
+   flashImage.reset();
+   pthread_mutex_unlock(&pluginMutex);
 }
 
 USBDM_ErrorCode GdbHandlerCommon::initialise() {
@@ -267,7 +281,9 @@ void GdbHandlerCommon::reportStatusToGdb(const char *s, int size) {
  */
 UsbdmTclInterperPtr GdbHandlerCommon::getTclInterface() {
    if (tclInterpreter == nullptr) {
+      pthread_mutex_lock(&pluginMutex);
       tclInterpreter = UsbdmTclInterperFactory::createUsbdmTclInterpreter(bdmInterface);
+      pthread_mutex_unlock(&pluginMutex);
       tclInterpreter->setDeviceParameters(deviceData);
    }
    return tclInterpreter;
@@ -282,7 +298,13 @@ USBDM_ErrorCode GdbHandlerCommon::runTCLCommand(const char *command) {
    LOGGING;
    log.print("Command = '%s'\n", command);
 
+   // TCL may change anything
+   // Registers modified by GDB must reach the target before the script runs
+   flushRegisterCache();
+   memoryCache.invalidateAll();
+
    USBDM_ErrorCode rc = getTclInterface()->evalTclScript(command);
+   invalidateRegisterCache();
    if (rc != BDM_RC_OK) {
       log.error("Failed - rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
    }
@@ -321,6 +343,9 @@ USBDM_ErrorCode GdbHandlerCommon::resetTarget(DeviceData::ResetMethod resetMetho
 
    TargetMode_t targetMode;
 
+   // Pending register writes are lost on reset
+   invalidateRegisterCache();
+
    log.error("Reset method %s\n", DeviceData::getResetMethodName(resetMethod));
    if (resetMethod == DeviceData::resetTargetDefault) {
       resetMethod = getResetMethod();
@@ -342,6 +367,7 @@ USBDM_ErrorCode GdbHandlerCommon::resetTarget(DeviceData::ResetMethod resetMetho
          break;
    }
 
+   memoryCache.invalidateAll();
    USBDM_ErrorCode rc = bdmInterface->reset(targetMode);
    if (rc != BDM_RC_OK) {
       return rc;
@@ -363,6 +389,9 @@ USBDM_ErrorCode GdbHandlerCommon::haltTarget() {
  */
 USBDM_ErrorCode GdbHandlerCommon::stepTarget(bool disableInterrupts) {
    LOGGING_Q;
+   flushRegisterCache();
+   invalidateRegisterCache();
+   memoryCache.invalidateVolatile();
    maskInterrupts(disableInterrupts);
    unsigned long pc;
    readPC(&pc);
@@ -379,6 +408,8 @@ USBDM_ErrorCode GdbHandlerCommon::stepTarget(bool disableInterrupts) {
  */
 USBDM_ErrorCode GdbHandlerCommon::continueTarget(void) {
    LOGGING_Q;
+   flushRegisterCache();
+   invalidateRegisterCache();
    unsigned long currentPC;
    readPC(&currentPC);
    if (atBreakpoint(currentPC)) {
@@ -388,6 +419,8 @@ USBDM_ErrorCode GdbHandlerCommon::continueTarget(void) {
    }
    maskInterrupts(false);
    activateBreakpoints();
+   memoryCache.invalidateVolatile();
+   memoryCache.reportStatistics();
    log.print("Continue - executing...\n");
    bdmInterface->go();
    log.print("Continue - Now running\n");
@@ -481,15 +514,15 @@ USBDM_ErrorCode GdbHandlerCommon::doMonitorCommand(const char *cmd) {
       resetTarget();
       gdbInOut->sendGdbHexString("O", "User reset of target\n", -1);
       gdbInOut->sendGdbString("OK");
-      registerBufferSize = 0;
    }
    else if (strneq(command, "run", sizeof("run")-1)) {
       // ignore any parameters
       reportGdbPrintf(M_INFO, "User run of target\n");
+      flushRegisterCache();
+      invalidateRegisterCache();
       bdmInterface->go();
       gdbInOut->sendGdbHexString("O", "User run of target\n", -1);
       gdbInOut->sendGdbString("OK");
-      registerBufferSize = 0;
    }
    else if (strneq(command, "halt", sizeof("halt")-1)) {
       // ignore any parameters
@@ -497,7 +530,7 @@ USBDM_ErrorCode GdbHandlerCommon::doMonitorCommand(const char *cmd) {
       bdmInterface->halt();
       gdbInOut->sendGdbHexString("O", "User halt of target\n", -1);
       gdbInOut->sendGdbString("OK");
-      registerBufferSize = 0;
+      invalidateRegisterCache();
    }
    else if (strneq(command, "speed", sizeof("speed")-1)) {
       int speedValue = 1000 * atoi(command+sizeof("speed"));
@@ -540,13 +573,113 @@ USBDM_ErrorCode GdbHandlerCommon::doMonitorCommand(const char *cmd) {
          gdbInOut->sendGdbHexString("O", "maskisr off\n", -1);
       }
       gdbInOut->sendGdbString("OK");
-      registerBufferSize = 0;
+   }
+   else if (strneq(command, "cache", sizeof("cache")-1)) {
+      char *ptr = command+sizeof("cache")-1;
+      while (isspace(*ptr)) {
+         ptr++;
+      }
+      if (strneq(ptr, "1",  sizeof("1")-1) ||
+            strneq(ptr, "on", sizeof("on")-1) ||
+            strneq(ptr, "t",  sizeof("t")-1)) {
+         memoryCache.setEnabled(true);
+      }
+      else if (strneq(ptr, "0",   sizeof("0")-1) ||
+            strneq(ptr, "off", sizeof("off")-1) ||
+            strneq(ptr, "f",   sizeof("f")-1)) {
+         memoryCache.setEnabled(false);
+      }
+      else if (strneq(ptr, "flush", sizeof("flush")-1)) {
+         memoryCache.invalidateAll();
+      }
+      if (memoryCache.isEnabled()) {
+         reportGdbPrintf(M_INFO, "cache on\n");
+         gdbInOut->sendGdbHexString("O", "cache on\n", -1);
+      }
+      else {
+         reportGdbPrintf(M_INFO, "cache off\n");
+         gdbInOut->sendGdbHexString("O", "cache off\n", -1);
+      }
+      gdbInOut->sendGdbString("OK");
+   }
+   else if (strneq(command, "incremental", sizeof("incremental")-1)) {
+      char *ptr = command+sizeof("incremental")-1;
+      while (isspace(*ptr)) {
+         ptr++;
+      }
+      if (strneq(ptr, "1",  sizeof("1")-1) ||
+            strneq(ptr, "on", sizeof("on")-1) ||
+            strneq(ptr, "t",  sizeof("t")-1)) {
+         incrementalProgramming = true;
+      }
+      else if (strneq(ptr, "0",   sizeof("0")-1) ||
+            strneq(ptr, "off", sizeof("off")-1) ||
+            strneq(ptr, "f",   sizeof("f")-1)) {
+         incrementalProgramming = false;
+      }
+      if (incrementalProgramming) {
+         reportGdbPrintf(M_INFO, "incremental on\n");
+         gdbInOut->sendGdbHexString("O", "incremental on\n", -1);
+      }
+      else {
+         reportGdbPrintf(M_INFO, "incremental off\n");
+         gdbInOut->sendGdbHexString("O", "incremental off\n", -1);
+      }
+      gdbInOut->sendGdbString("OK");
+   }
+   else if (strneq(command, "rtt", sizeof("rtt")-1)) {
+      char *ptr = command+sizeof("rtt")-1;
+      while (isspace(*ptr)) {
+         ptr++;
+      }
+      unsigned long address;
+      if (strneq(ptr, "on", sizeof("on")-1)) {
+         rttConsole.setEnabled(true);
+      }
+      else if (strneq(ptr, "off", sizeof("off")-1)) {
+         rttConsole.setEnabled(false);
+      }
+      else if (strneq(ptr, "scan", sizeof("scan")-1)) {
+         rttConsole.restartScan();
+         rttConsole.setEnabled(true);
+      }
+      else if (strneq(ptr, "write", sizeof("write")-1)) {
+         ptr += sizeof("write")-1;
+         if (isspace(*ptr)) {
+            ptr++;
+         }
+         std::string text(ptr);
+         text += '\n';
+         if (rttConsole.write(text.data(), text.size()) != BDM_RC_OK) {
+            gdbInOut->sendGdbHexString("O", "rtt write failed\n", -1);
+         }
+      }
+      else if (sscanf(ptr, "%li", &address) == 1) {
+         rttConsole.setControlBlockAddress(address);
+         rttConsole.setEnabled(true);
+      }
+      char buff[100];
+      if (!rttConsole.isEnabled()) {
+         snprintf(buff, sizeof(buff), "rtt off\n");
+      }
+      else if (rttConsole.isLocated()) {
+         snprintf(buff, sizeof(buff), "rtt on @0x%08X\n", rttConsole.getControlBlockAddress());
+      }
+      else {
+         snprintf(buff, sizeof(buff), "rtt on (searching)\n");
+      }
+      reportGdbPrintf(M_INFO, buff);
+      gdbInOut->sendGdbHexString("O", buff, -1);
+      gdbInOut->sendGdbString("OK");
    }
    else if (strneq(command, "help", sizeof("help")-1)) {
       gdbInOut->sendGdbHexString("O",
                                  "MON commands\n"
                                  "=====================\n"
                                  "maskisr (on|off)\n"
+                                 "cache (on|off|flush)\n"
+                                 "incremental (on|off)\n"
+                                 "rtt (on|off|scan|<address>|write <text>)\n"
                                  "halt\n"
                                  "reset\n"
                                  "=====================\n",
@@ -574,44 +707,51 @@ USBDM_ErrorCode GdbHandlerCommon::doQCommands(const GdbPacket *pkt) {
    if (strncmp(cmd, "qSupported", sizeof("qSupported")-1) == 0) {
       log.print("qSupported\n");
       char buff[200];
-#if NON_STOP_MODE
-      sprintf(buff,"QStartNoAckMode+;qXfer:memory-map:read+;PacketSize=%X;QNonStop+;qXfer:features:read+",GdbPacket::MAX_MESSAGE-10);
-#else
-      sprintf(buff,"QStartNoAckMode+;qXfer:memory-map:read+;PacketSize=%X;qXfer:features:read+",GdbPacket::MAX_MESSAGE-10);
-#endif
+      sprintf(buff,"QStartNoAckMode+;qXfer:memory-map:read+;PacketSize=%X;QNonStop+;qXfer:features:read+;binary-upload+",GdbPacket::MAX_MESSAGE-10);
       gdbInOut->sendGdbString(buff);
    }
-#if THREAD_MODE
-   else if (strncmp(cmd, "qC", sizeof("qC")-1) == 0) { // set current thread
+   // Non-stop mode requires a thread - report a single thread
+   else if (nonStopMode && (strncmp(cmd, "qC", sizeof("qC")-1) == 0)) { // set current thread
       gdbInOut->sendGdbString("QC1");
    }
-   else if (strncmp(cmd, "qfThreadInfo", sizeof("qfThreadInfo")-1) == 0) {
-      if (getTargetStatus() != T_NOCONNECTION) {
-         gdbInOut->sendGdbString("m1");
-      }
-      else {
-         gdbInOut->sendGdbString("l");
-      }
+   else if (nonStopMode && (strncmp(cmd, "qfThreadInfo", sizeof("qfThreadInfo")-1) == 0)) {
+      gdbInOut->sendGdbString("m1");
    }
-   else if (strncmp(cmd, "qsThreadInfo", sizeof("qsThreadInfo")-1) == 0) {
+   else if (nonStopMode && (strncmp(cmd, "qsThreadInfo", sizeof("qsThreadInfo")-1) == 0)) {
       gdbInOut->sendGdbString("l");
    }
-   else if (strncmp(cmd, "qThreadExtraInfo", sizeof("qThreadExtraInfo")-1) == 0) {
-      gdbInOut->sendGdbHexString(NULL, "Runnable");
+   else if (nonStopMode && (strncmp(cmd, "qThreadExtraInfo", sizeof("qThreadExtraInfo")-1) == 0)) {
+      gdbInOut->sendGdbHexString(NULL, (runState == Halted)?"Stopped":"Running");
    }
-#endif
 #if DUMMY_TRACE_MODE
    else if (strncmp(cmd, "qTStatus", sizeof("qTStatus")-1) == 0) {
       // No trace experiment running right now
       gdbInOut->sendGdbString("T0;tnotrun:0");
    }
 #endif
-#if NON_STOP_MODE
-   else if (strncmp(cmd, "QNonStop", sizeof("QNonStop")-1) == 0) {
-      log.print("QNonStop\n");
+   else if (strncmp(cmd, "QNonStop:", sizeof("QNonStop:")-1) == 0) {
+      // QNonStop:1 - non-stop mode, QNonStop:0 - all-stop mode
+      nonStopMode = (cmd[sizeof("QNonStop:")-1] == '1');
+      log.print("QNonStop => %s\n", nonStopMode?"non-stop":"all-stop");
+      reportGdbPrintf(M_INFO, "Using %s mode\n", nonStopMode?"non-stop":"all-stop");
+      gdbInOut->sendGdbString("OK");
+   }
+   else if (strncmp(cmd, "qSymbol::", sizeof("qSymbol::")-1) == 0) {
+      // GDB offers symbol lookup - ask for RTT control block
+      log.print("qSymbol::\n");
+      gdbInOut->sendGdbHexString("qSymbol:", GdbRttConsole::SymbolName, -1);
+   }
+   else if (strncmp(cmd, "qSymbol:", sizeof("qSymbol:")-1) == 0) {
+      // qSymbol:addr:name - addr is empty if symbol is not known
+      unsigned long address;
+      if (sscanf(cmd, "qSymbol:%lx:", &address) == 1) {
+         log.print("qSymbol => %s @0x%08lX\n", GdbRttConsole::SymbolName, address);
+         reportGdbPrintf(M_INFO, "RTT control block @0x%08lX\n", address);
+         rttConsole.setControlBlockAddress(address);
+         rttConsole.setEnabled(true);
+      }
       gdbInOut->sendGdbString("OK");
    }
-#endif
    else if (strncmp(cmd, "qAttached", sizeof("qAttached")-1) == 0) {
       log.print("qAttached\n");
       gdbInOut->sendGdbString("1"); // TODO - try this change from 0
@@ -673,6 +813,25 @@ USBDM_ErrorCode GdbHandlerCommon::doQCommands(const GdbPacket *pkt) {
          gdbInOut->sendGdbString("");
       }
    }
+   else if (strncmp(cmd, "qCRC:", sizeof("qCRC:")-1) == 0) {
+      // qCRC:addr,length - used by compare-sections
+      unsigned address, length;
+      if (sscanf(cmd,"qCRC:%X,%X", &address, &length) != 2) {
+         log.print("Ill formed:\'%s\'", cmd);
+         gdbInOut->sendErrorMessage(0x01);
+      }
+      else {
+         uint32_t crc;
+         if (calculateCrc(address, length, crc) != BDM_RC_OK) {
+            gdbInOut->sendErrorMessage(0x03);
+         }
+         else {
+            char buff[20];
+            sprintf(buff, "C%08X", crc);
+            gdbInOut->sendGdbString(buff);
+         }
+      }
+   }
    else if (strncmp(cmd, "qRcmd,", sizeof("qRcmd,")-1) == 0) {
       // Monitor command
       doMonitorCommand(cmd);
@@ -699,7 +858,8 @@ USBDM_ErrorCode GdbHandlerCommon::doVCommands(const GdbPacket *pkt) {
       }
       else {
          log.print("vFlashErase:0x%X:0x%X\n", address, length);
-         reportGdbPrintf(M_INFO, "Erasing flash[%X..%X] - ignored\n", address, address+length-1);
+         // Erasing is deferred to vFlashDone where only changed sectors are erased
+         reportGdbPrintf(M_INFO, "Erasing flash[%X..%X] - deferred\n", address, address+length-1);
          gdbInOut->sendGdbString("OK");
       }
    }
@@ -713,25 +873,19 @@ USBDM_ErrorCode GdbHandlerCommon::doVCommands(const GdbPacket *pkt) {
          log.print("vFlashWrite:0x%X:\n", address);
          if (flashImage == NULL) {
             reportGdbPrintf(M_INFO, "Creating flash image\n");
+            pthread_mutex_lock(&pluginMutex);
             flashImage = FlashImageFactory::createFlashImage(targetType);
+            pthread_mutex_unlock(&pluginMutex);
          }
          reportGdbPrintf(M_INFO, "Writing to flash image[%X..", address);
          const char *vPtr = strchr(pkt->buffer,':');
          vPtr = strchr(++vPtr, ':');
          vPtr++;
          int size=pkt->size-(vPtr-pkt->buffer);
-         bool newLine = true;
-         while(size-->0) {
-            flashImage->setValue(address, *vPtr);
-            if (newLine)
-               log.printq("\n%8.8X:", address);
-            log.printq("%2.2X", (unsigned char)*vPtr);
-            address++;
-            vPtr++;
-            newLine = (address & 0x0F) == 0;
-         }
-         reportGdbPrintf(M_INFO, "%X]\n", address-1);
-         log.printq("\n");
+         // Load the whole block in one operation
+         flashImage->loadData(size, address, (const uint8_t *)vPtr);
+         log.print("vFlashWrite: Loaded [0x%08X..0x%08X]\n", address, address+size-1);
+         reportGdbPrintf(M_INFO, "%X]\n", address+size-1);
          gdbInOut->sendGdbString("OK");
       }
    }
@@ -741,7 +895,9 @@ USBDM_ErrorCode GdbHandlerCommon::doVCommands(const GdbPacket *pkt) {
       if (flashImage != NULL) {
          reportGdbPrintf(M_INFO, "Programming Target Flash....\n");
          USBDM_ErrorCode rc = programImage(flashImage);
+         pthread_mutex_lock(&pluginMutex);
          flashImage.reset();
+         pthread_mutex_unlock(&pluginMutex);
          if (rc != PROGRAMMING_RC_OK) {
             log.print("vFlashDone: Programming failed, rc=%s\n", bdmInterface->getErrorString(rc));
             reportGdbPrintf(M_FATAL, rc, "Programming Flash Image failed: ");
@@ -763,12 +919,12 @@ USBDM_ErrorCode GdbHandlerCommon::doVCommands(const GdbPacket *pkt) {
       gdbInOut->sendGdbString("OK");
    }
    else if (strncmp(cmd, "vCont", 5) == 0) {
-#ifdef VCONT_SUPPORTED
       doVContCommands(pkt);
-#else
-      // Not yet supported
-      gdbInOut->sendGdbString("");
-#endif
+   }
+   else if (strncmp(cmd, "vStopped", 8) == 0) {
+      // Only a single thread so there is never more than one stop notification outstanding
+      log.print("vStopped\n");
+      gdbInOut->sendGdbString("OK");
    }
    else {
       log.print("Unrecognised command:\'%s\'\n", cmd);
@@ -777,22 +933,70 @@ USBDM_ErrorCode GdbHandlerCommon::doVCommands(const GdbPacket *pkt) {
    return BDM_RC_OK;
 }
 
+/**
+ * Compare flash sectors with the target using CRCs (differential programming)
+ *
+ * The CRC of each sector of the image (unused locations are 0xFF) is compared against the
+ * CRC of the target sector.  The target CRCs are obtained together (a single run of code
+ * on the target where available).
+ *
+ * @param flashImage  Image to compare
+ * @param sectors     Sectors to compare, changed is updated
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbHandlerCommon::compareSectors(FlashImagePtr flashImage, std::vector<Sector> &sectors) {
+   LOGGING;
+
+   std::vector<CrcRange> ranges(sectors.size());
+   for (unsigned index=0; index<sectors.size(); index++) {
+      ranges[index].address = sectors[index].address;
+      ranges[index].length  = sectors[index].size;
+      ranges[index].crc     = 0;
+   }
+   USBDM_ErrorCode rc = calculateCrcs(ranges);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   std::vector<uint8_t> buffer;
+   for (unsigned index=0; index<sectors.size(); index++) {
+      buffer.resize(sectors[index].size);
+      flashImage->getData(buffer.size(), sectors[index].address, &buffer[0]);
+      sectors[index].changed = (updateCrc32Msb(0xFFFFFFFF, &buffer[0], buffer.size()) != ranges[index].crc);
+   }
+   return BDM_RC_OK;
+}
+
 USBDM_ErrorCode GdbHandlerCommon::programImage(FlashImagePtr flashImage) {
    LOGGING;
 
-   if (deviceData->getEraseMethod() == DeviceData::eraseNone) {
+   DeviceData::EraseMethod eraseMethod = deviceData->getEraseMethod();
+   if (eraseMethod == DeviceData::eraseNone) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
    if (deviceData->getSecurity() == SEC_SECURED) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
 
+   UsbdmTclInterperPtr tclInterface = getTclInterface();
+   pthread_mutex_lock(&pluginMutex);
    FlashProgrammerPtr flashProgrammer = FlashProgrammerFactory::createFlashProgrammer(bdmInterface);
-   flashProgrammer->setDeviceData(deviceData, getTclInterface());
+   pthread_mutex_unlock(&pluginMutex);
+   flashProgrammer->setDeviceData(deviceData, tclInterface);
    USBDM_ErrorCode rc = flashProgrammer->setDeviceData(deviceData);
    if (rc == BDM_RC_OK) {
+      // Only erase and program the sectors that differ from the target (Selective erase only)
+      flashProgrammer->setDifferentialProgramming(incrementalProgramming && (eraseMethod == DeviceData::eraseSelective));
+      flashProgrammer->setSectorComparer(this);
       rc = flashProgrammer->programFlash(flashImage, 0, true);
    }
+   if ((rc == BDM_RC_OK) && (flashProgrammer->getBytesSkipped() != 0)) {
+      reportGdbPrintf(M_INFO, "%d of %d bytes unchanged (skipped)\n", flashProgrammer->getBytesSkipped(), flashImage->getByteCount());
+   }
+   pthread_mutex_lock(&pluginMutex);
+   flashProgrammer.reset();
+   pthread_mutex_unlock(&pluginMutex);
+   memoryCache.invalidateAll();
    if (rc != PROGRAMMING_RC_OK) {
       log.print("programImage() - failed, rc = %s\n", bdmInterface->getErrorString(rc));
       return rc;
@@ -820,7 +1024,7 @@ void GdbHandlerCommon::createMemoryMapXML(const char **buffer, unsigned *bufferS
    static const char xmlSuffix[] =
       "</memory-map>\n";
 
-   static char xmlBuff[2000] = {0};
+   static thread_local char xmlBuff[2000] = {0};
    char *xmlPtr;
 
    xmlPtr = xmlBuff;
@@ -929,7 +1133,7 @@ bool GdbHandlerCommon::initRegisterDescription(void) {
  *  @return ptr to static buffer
  */
 const char *GdbHandlerCommon::getCachedPcAsString() {
-   static char buff[20];
+   static thread_local char buff[20];
 
    sprintf(buff, "0x%08X", getCachedPC());
    return buff;
@@ -953,7 +1157,9 @@ USBDM_ErrorCode GdbHandlerCommon::readRegs(void) {
 
       if (rc == BDM_RC_OK) {
          // OK
-         registerBufferSize = 4*(targetLastRegIndex+1);
+         registerBufferSize  = 4*(targetLastRegIndex+1);
+         registerBufferDummy = false;
+         registerDirty.assign(targetLastRegIndex+1, false);
          return BDM_RC_OK;
       }
       switch(rc) {
@@ -978,7 +1184,9 @@ USBDM_ErrorCode GdbHandlerCommon::readRegs(void) {
          // Return dummy register information
          reportGdbPrintf("Register read failed - ignored, rc = %s\n", bdmInterface->getErrorString(rc));
          log.error("Register read failed - ignored, rc = %s\n", bdmInterface->getErrorString(rc));
-         registerBufferSize = 4*(targetLastRegIndex+1);
+         registerBufferSize  = 4*(targetLastRegIndex+1);
+         registerBufferDummy = true;
+         registerDirty.assign(targetLastRegIndex+1, false);
          memset(registerBuffer, 0, 4*(targetLastRegIndex+1));
          return BDM_RC_OK;
       }
@@ -1007,13 +1215,95 @@ USBDM_ErrorCode GdbHandlerCommon::readRegs(void) {
       registerBufferSize = 0;
       unsigned char *buffPtr = registerBuffer;
       for (regNo = 0; regNo<=targetLastRegIndex; regNo++) {
-         readReg(regNo, buffPtr);
+         if (isValidRegister(regNo)) {
+            readReg(regNo, buffPtr);
+         }
+         else {
+            // Keep fixed 4-byte slot for unimplemented register
+            memset(buffPtr, 0, 4);
+            buffPtr += 4;
+         }
+      }
+      registerBufferSize  = buffPtr-registerBuffer;
+      registerBufferDummy = false;
+      registerDirty.assign(targetLastRegIndex+1, false);
+   }
+   return BDM_RC_OK;
+}
+
+//! Make sure register cache is loaded
+//! Registers are only read from the target once per stop
+//!
+//! @return Error code
+//!
+USBDM_ErrorCode GdbHandlerCommon::loadRegisterCache() {
+   if (registerBufferSize != 0) {
+      return BDM_RC_OK;
+   }
+   USBDM_ErrorCode rc = readRegs();
+   if ((rc == BDM_RC_OK) && (registerBufferSize == 0)) {
+      rc = BDM_RC_FAIL;
+   }
+   return rc;
+}
+
+//! Discard register cache including any unwritten changes
+//!
+void GdbHandlerCommon::invalidateRegisterCache() {
+   registerBufferSize  = 0;
+   registerBufferDummy = false;
+   registerDirty.clear();
+}
+
+//! Write modified registers in cache to target
+//! Done before the target is resumed
+//!
+//! @return Error code
+//!
+USBDM_ErrorCode GdbHandlerCommon::flushRegisterCache() {
+   LOGGING_Q;
+   if (registerBufferSize == 0) {
+      return BDM_RC_OK;
+   }
+   unsigned count = 0;
+   for (unsigned regNo=0; regNo<registerDirty.size(); regNo++) {
+      if (registerDirty[regNo]) {
+         // Buffer is in target byte order
+         writeReg(regNo, targetToBE32(get32bitBE(registerBuffer+(4*regNo))));
+         registerDirty[regNo] = false;
+         count++;
       }
-      registerBufferSize = buffPtr-registerBuffer;
+   }
+   if (count > 0) {
+      log.print("Wrote %d registers\n", count);
    }
    return BDM_RC_OK;
 }
 
+//! Append expedited registers to stop reply e.g. "0F:12345678;"
+//! Values are taken from the register cache and only added if the cache is valid
+//!
+//! @param cPtr    - Where to write
+//! @param regNos  - GDB numbers of registers to report
+//! @param count   - Number of registers
+//!
+//! @return Updated pointer
+//!
+char *GdbHandlerCommon::appendExpeditedRegisters(char *cPtr, const int regNos[], unsigned count) {
+   if ((registerBufferSize == 0) || registerBufferDummy) {
+      return cPtr;
+   }
+   for (unsigned index=0; index<count; index++) {
+      unsigned regNo = regNos[index];
+      if ((4*regNo+4) > registerBufferSize) {
+         continue;
+      }
+      const unsigned char *regPtr = registerBuffer+(4*regNo);
+      cPtr += sprintf(cPtr, "%2.2X:%2.2X%2.2X%2.2X%2.2X;", regNo, regPtr[0], regPtr[1], regPtr[2], regPtr[3]);
+   }
+   return cPtr;
+}
+
 //! Report register values to GDB
 //! Reads registers from target if necessary
 //!
@@ -1032,7 +1322,10 @@ void GdbHandlerCommon::sendRegs(void) {
       return;
    }
    gdbInOut->sendGdbHex(registerBuffer, registerBufferSize);
-   registerBufferSize = 0;
+   if (registerBufferDummy) {
+      // Don't keep dummy values
+      invalidateRegisterCache();
+   }
 }
 
 //! Write target registers from string buffer containing hex chars
@@ -1047,15 +1340,27 @@ void GdbHandlerCommon::writeRegs(const char *ccPtr) {
    unsigned regNo;
 
    reportGdbPrintf("Writing Registers\n");
+   if (loadRegisterCache() != BDM_RC_OK) {
+      // No cache - write directly
+      for (regNo = 0; regNo<=targetLastRegIndex; regNo++) {
+         if (!hexToInt32(ccPtr, &regValue))
+            break;
+         ccPtr += 8;
+         regValue = targetToBE32(regValue);
+         writeReg(regNo, regValue);
+      }
+      gdbInOut->sendGdbString("OK");
+      return;
+   }
+   // Update cache - written to target on resume
    for (regNo = 0; regNo<=targetLastRegIndex; regNo++) {
-      if (!hexToInt32(ccPtr, &regValue))
+      if (!convertFromHex(4, ccPtr, registerBuffer+(4*regNo))) {
          break;
+      }
       ccPtr += 8;
-      regValue = targetToBE32(regValue);
-      writeReg(regNo, regValue);
+      registerDirty[regNo] = isValidRegister(regNo);
    }
    gdbInOut->sendGdbString("OK");
-   registerBufferSize = 0;
 }
 
 static MemorySpace_t getAlignment(uint32_t address, uint32_t numBytes) {
@@ -1070,18 +1375,49 @@ static MemorySpace_t getAlignment(uint32_t address, uint32_t numBytes) {
    return align;
 }
 
-void GdbHandlerCommon::readMemory(uint32_t address, uint32_t numBytes) {
+//! Read target memory and send to GDB
+//!
+//! @param address  - start address
+//! @param numBytes - number of bytes to read
+//! @param binary   - true => reply as escaped binary ('x' packet), false => reply as hex ('m' packet)
+//!
+//! @note The reply may be shorter than requested if it would not fit in a packet
+//!
+void GdbHandlerCommon::readMemory(uint32_t address, uint32_t numBytes, bool binary) {
    LOGGING;
-   unsigned char buff[1000] = {0};
+
+   // Limit to what GDB may reasonably expect in one packet
+   uint32_t maxBytes = binary?(GdbPacket::MAX_MESSAGE-10):((GdbPacket::MAX_MESSAGE-10)/2);
+   if (numBytes > maxBytes) {
+      numBytes = maxBytes;
+   }
+   if (numBytes == 0) {
+      // Empty read e.g. probe for packet support
+      gdbInOut->sendGdbString(binary?"b":"");
+      return;
+   }
+   std::vector<unsigned char> buff(numBytes);
 
    MemorySpace_t align = getAlignment(address, numBytes);
    reportGdbPrintf(GdbHandler::M_BORINGINFO, "Reading Memory[%X..%X], align = %s\n", address, address+numBytes-1, getMemSpaceName(align));
 //   log.print("readMemory(addr=%X, size=%X)\n", address, numBytes);
-   if (bdmInterface->readMemory(align, numBytes, address, buff) != BDM_RC_OK) {
+   USBDM_ErrorCode rc;
+   if (runState == Halted) {
+      rc = memoryCache.readMemory(align, numBytes, address, &buff[0]);
+   }
+   else {
+      rc = bdmInterface->readMemory(align, numBytes, address, &buff[0]);
+   }
+   if (rc != BDM_RC_OK) {
       // Ignore errors
-      memset(buff, 0xAA, numBytes);
+      memset(&buff[0], 0xAA, numBytes);
+   }
+   if (binary) {
+      gdbInOut->sendGdbBinary("b", &buff[0], numBytes);
+   }
+   else {
+      gdbInOut->sendGdbHex(&buff[0], numBytes);
    }
-   gdbInOut->sendGdbHex(buff, numBytes);
 }
 
 //! Convert a hex string to a series of byte values
@@ -1107,17 +1443,140 @@ bool GdbHandlerCommon::convertFromHex(unsigned numBytes, const char *dataIn, uns
    return true;
 }
 
-void GdbHandlerCommon::writeMemory(const char *ccPtr, uint32_t address, uint32_t numBytes) {
-   unsigned char buff[1000];
-
+//! Write target memory
+//!
+//! @param address  - start address
+//! @param numBytes - number of bytes to write
+//! @param data     - data to write
+//!
+void GdbHandlerCommon::writeTargetMemory(uint32_t address, uint32_t numBytes, const unsigned char *data) {
    MemorySpace_t align = getAlignment(address, numBytes);
    reportGdbPrintf(GdbHandler::M_BORINGINFO, "Writing Memory[%X..%X], align = %s\n", address, address+numBytes-1, getMemSpaceName(align));
 //   log.print("writeMemory(addr=%X, size=%X)\n", address, numBytes);
-   convertFromHex(numBytes, ccPtr, buff);
-   bdmInterface->writeMemory(align, numBytes, address, buff);
+   memoryCache.invalidate(address, numBytes);
+   bdmInterface->writeMemory(align, numBytes, address, data);
+}
+
+//! Write target memory from hex data ('M' packet)
+//!
+//! @param ccPtr    - ptr to string of Hex chars (2 * numBytes)
+//! @param address  - start address
+//! @param numBytes - number of bytes to write
+//!
+void GdbHandlerCommon::writeMemory(const char *ccPtr, uint32_t address, uint32_t numBytes) {
+   if (numBytes > 0) {
+      std::vector<unsigned char> buff(numBytes);
+      convertFromHex(numBytes, ccPtr, &buff[0]);
+      writeTargetMemory(address, numBytes, &buff[0]);
+   }
    gdbInOut->sendGdbString("OK");
 }
 
+//! Write target memory from binary data ('X' packet)
+//!
+//! @param data     - ptr to data (already unescaped)
+//! @param dataSize - number of bytes available at data
+//! @param address  - start address
+//! @param numBytes - number of bytes to write
+//!
+void GdbHandlerCommon::writeMemoryBinary(const char *data, uint32_t dataSize, uint32_t address, uint32_t numBytes) {
+   LOGGING_Q;
+   if (dataSize != numBytes) {
+      log.print("X packet length mismatch, expected %d, received %d\n", numBytes, dataSize);
+      gdbInOut->sendErrorMessage(0x01);
+      return;
+   }
+   if (numBytes > 0) {
+      writeTargetMemory(address, numBytes, (const unsigned char *)data);
+   }
+   gdbInOut->sendGdbString("OK");
+}
+
+//! Calculate CRCs of target memory by executing code on the target
+//!
+//! @note Not available by default - host calculation is used
+//!
+USBDM_ErrorCode GdbHandlerCommon::calculateTargetCrcs(std::vector<CrcRange> &ranges) {
+   return BDM_RC_ILLEGAL_COMMAND;
+}
+
+//! Calculate CRC of target memory by reading memory and calculating the CRC on the host
+//!
+//! @param address - Start address
+//! @param length  - Number of bytes
+//! @param crc     - CRC calculated
+//!
+//! @return error code
+//!
+USBDM_ErrorCode GdbHandlerCommon::calculateHostCrc(uint32_t address, uint32_t length, uint32_t &crc) {
+   LOGGING_Q;
+
+   reportGdbPrintf(GdbHandler::M_BORINGINFO, "Calculating CRC of Memory[%X..%X] on host\n", address, address+length-1);
+   uint8_t buff[0x1000];
+   crc = 0xFFFFFFFF;
+   while (length > 0) {
+      uint32_t blockSize = length;
+      if (blockSize > sizeof(buff)) {
+         blockSize = sizeof(buff);
+      }
+      USBDM_ErrorCode rc = bdmInterface->readMemory(getAlignment(address, blockSize), blockSize, address, buff);
+      if (rc != BDM_RC_OK) {
+         log.error("Memory read failed @0x%08X, rc=%s\n", address, bdmInterface->getErrorString(rc));
+         return rc;
+      }
+      crc      = updateCrc32Msb(crc, buff, blockSize);
+      address += blockSize;
+      length  -= blockSize;
+   }
+   return BDM_RC_OK;
+}
+
+//! Calculate CRCs of several ranges of target memory (GDB qCRC form)
+//!
+//! Uses a single execution of code on the target if available, otherwise reads memory
+//! and calculates the CRCs on the host
+//!
+//! @param ranges - Ranges to process, crc is updated
+//!
+//! @return error code
+//!
+USBDM_ErrorCode GdbHandlerCommon::calculateCrcs(std::vector<CrcRange> &ranges) {
+   LOGGING;
+
+   if ((runState == Halted) && (calculateTargetCrcs(ranges) == BDM_RC_OK)) {
+      for (unsigned index=0; index<ranges.size(); index++) {
+         log.print("Target CRC[0x%08X..0x%08X] = 0x%08X\n",
+               ranges[index].address, ranges[index].address+ranges[index].length-1, ranges[index].crc);
+      }
+      return BDM_RC_OK;
+   }
+   for (unsigned index=0; index<ranges.size(); index++) {
+      USBDM_ErrorCode rc = calculateHostCrc(ranges[index].address, ranges[index].length, ranges[index].crc);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   return BDM_RC_OK;
+}
+
+//! Calculate CRC of target memory as required for GDB qCRC packet
+//!
+//! @param address - Start address
+//! @param length  - Number of bytes
+//! @param crc     - CRC calculated
+//!
+//! @return error code
+//!
+USBDM_ErrorCode GdbHandlerCommon::calculateCrc(uint32_t address, uint32_t length, uint32_t &crc) {
+   std::vector<CrcRange> ranges(1);
+   ranges[0].address = address;
+   ranges[0].length  = length;
+   ranges[0].crc     = 0;
+   USBDM_ErrorCode rc = calculateCrcs(ranges);
+   crc = ranges[0].crc;
+   return rc;
+}
+
 USBDM_ErrorCode GdbHandlerCommon::readReg(unsigned regNo, unsigned char *&buffPtr) {
    return BDM_RC_ILLEGAL_COMMAND;
 }
@@ -1130,33 +1589,103 @@ uint16_t GdbHandlerCommon::targetToNative16(uint16_t data) { return 0; }
 uint32_t GdbHandlerCommon::targetToBE32(uint32_t data)     { return 0; }
 uint16_t GdbHandlerCommon::targetToBE16(uint16_t data)     { return 0; }
 
-//! Handle 'vCont' commands
-//!
-USBDM_ErrorCode GdbHandlerCommon::doVContCommands(const GdbPacket *pkt) {
-#ifdef VCONT_SUPPORTED
-   LOGGING;
-//   int address, length;
-   const char *cmd = pkt->buffer;
-   if (strncmp(cmd, "vCont?", sizeof("vCont?")) == 0) {
-      gdbInOut->sendGdbString("vCont;c;s;t");
+/**
+ * Drain RTT console
+ */
+void GdbHandlerCommon::pollRttConsole() {
+   unsigned bytesTransferred;
+   rttConsole.poll(bytesTransferred);
+   if ((bytesTransferred > 0) && (runState == Halted)) {
+      // Buffer offsets in target RAM have changed
+      memoryCache.invalidateVolatile();
    }
-   else if (strncmp(cmd, "vCont;c", sizeof("vCont;c")) == 0) {
-      log.print("vCont;c - continue", cmd);
-      gdbInOut->sendGdbString("OK");
+}
+
+/**
+ * Send stop reply to GDB
+ *
+ * In non-stop mode asynchronous stops are reported using a %Stop notification
+ *
+ * @param reply Stop reply e.g. "T05"
+ */
+void GdbHandlerCommon::sendStopReply(const char *reply) {
+   if (!nonStopMode) {
+      gdbInOut->sendGdbString(reply);
+      return;
    }
-   else if (strncmp(cmd, "vCont;s", sizeof("vCont;s")) == 0) {
-      log.print("vCont;s - step", cmd);
-      gdbInOut->sendGdbString("OK");
+   char buff[120];
+   if (reply[0] == 'T') {
+      snprintf(buff, sizeof(buff), "%sthread:1;", reply);
    }
-   else if (strncmp(cmd, "vCont;s", sizeof("vCont;t")) == 0) {
-      log.print("vCont;t - halt", cmd);
-      gdbInOut->sendGdbString("OK");
+   else {
+      snprintf(buff, sizeof(buff), "%s", reply);
+   }
+   if (stopQueryActive) {
+      // Reply to '?' is a normal packet
+      gdbInOut->sendGdbString(buff);
    }
    else {
+      gdbInOut->sendGdbNotification(buff);
+   }
+}
+
+/**
+ * Handle 'vCont' commands
+ *
+ * vCont?
+ * vCont;action[:thread-id][;action[:thread-id]]...
+ *
+ * There is only one thread so the first action is applied to the target
+ */
+USBDM_ErrorCode GdbHandlerCommon::doVContCommands(const GdbPacket *pkt) {
+   LOGGING;
+   const char *cmd = pkt->buffer;
+
+   if (strncmp(cmd, "vCont?", sizeof("vCont?")-1) == 0) {
+      gdbInOut->sendGdbString("vCont;c;C;s;S;t");
+      return BDM_RC_OK;
+   }
+   if (strncmp(cmd, "vCont;", sizeof("vCont;")-1) != 0) {
       log.print("Unrecognized command:\'%s\'\n", cmd);
+      gdbInOut->sendGdbString("");
+      return BDM_RC_OK;
+   }
+   switch(cmd[sizeof("vCont;")-1]) {
+   case 'c' :
+   case 'C' :
+      log.print("vCont;c - continue\n");
+      reportGdbPrintf(M_INFO, "Continue @PC\n");
+      if (nonStopMode) {
+         gdbInOut->sendGdbString("OK");
+      }
+      continueTarget();
+      runState = Running;
+      break;
+   case 's' :
+   case 'S' :
+      log.print("vCont;s - step\n");
+      reportGdbPrintf(M_INFO, "Single step @PC\n");
+      if (nonStopMode) {
+         gdbInOut->sendGdbString("OK");
+      }
+      runState = Stepping;
+      stepTarget(bdmInterface->isMaskISR());
+      break;
+   case 't' :
+      log.print("vCont;t - halt\n");
       gdbInOut->sendGdbString("OK");
+      if (runState != Halted) {
+         // Halted on next poll - reported with signal 0
+         runState           = Breaking;
+         breakSignal        = TARGET_SIGNAL_0;
+         targetBreakPending = true;
+      }
+      break;
+   default:
+      log.print("Unrecognized action:\'%s\'\n", cmd);
+      gdbInOut->sendErrorMessage(0x01);
+      break;
    }
-#endif
    return BDM_RC_OK;
 }
 
@@ -1186,6 +1715,7 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
       runState = Breaking;
       log.print("Breaking...\n");
       reportGdbPrintf(M_INFO, "Breaking...\n");
+      breakSignal        = TARGET_SIGNAL_INT;
       targetBreakPending = true;
 //      USBDM_ErrorCode rc = bdmInterface->connect();
 //      if (rc != BDM_RC_OK) {
@@ -1249,6 +1779,38 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
 //      the server was able to read only part of the region of memory.
 //      'E NN' NN is errno
       break;
+   case 'x' : // 'x addr,length' - Read memory as binary
+      if (sscanf(pkt->buffer, "x%X,%x", &address, &numBytes) != 2) {
+         log.print("Illegal cmd format\n");
+         gdbInOut->sendErrorMessage(0x01);
+      }
+      else {
+         log.print("readMemory(binary) [0x%08X..0x%08X]\n", address, address+numBytes-1);
+         readMemory(address, numBytes, true);
+      }
+//      Reply:
+//      'b XX...' Memory contents as escaped binary data. The reply may contain
+//      fewer bytes than requested.
+//      'E NN' NN is errno
+      break;
+   case 'X' : // 'X addr,length:XX...' - Write memory as binary
+      if ((sscanf(pkt->buffer, "X%X,%x:", &address, &numBytes) != 2) ||
+          ((ccptr = strchr(pkt->buffer, ':')) == NULL)) {
+         log.print("Illegal cmd format\n");
+         gdbInOut->sendErrorMessage(0x01);
+      }
+      else {
+         ccptr++;
+         log.print("writeMemory(binary) [0x%08X...0x%08X]\n", address, address+numBytes-1);
+         writeMemoryBinary(ccptr, pkt->size-(ccptr-pkt->buffer), address, numBytes);
+      }
+//      Write length bytes of memory starting at address addr. XX. . . is the data
+//      as escaped binary (escapes are removed on reception).
+//      A zero length write is used by GDB to probe for support of this packet.
+//      Reply:
+//      'OK' for success
+//      'E NN' for an error
+      break;
    case 'M' : // 'M addr,length:XX...' - Write memory
       if ((sscanf(pkt->buffer, "M%X,%x:", &address, &numBytes) != 2) ||
           ((ccptr = strchr(pkt->buffer, ':')) == NULL)) {
@@ -1275,6 +1837,8 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
          address = targetToBE32(address);
          log.print("Continue @addr=%X\n", address);
          reportGdbPrintf(M_INFO, "Continue @addr=%X\n", address);
+         flushRegisterCache();
+         invalidateRegisterCache();
          writePC(address);
       }
       else {
@@ -1283,7 +1847,6 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
       }
       continueTarget();
       runState = Running;
-      registerBufferSize = 0;
 //      gdbPollTarget();
       break;
    case 's' :
@@ -1294,6 +1857,8 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
          // Set PC to address
          log.print("Single step @addr=%X\n", address);
          reportGdbPrintf(M_INFO, "Single step @addr=%X\n", address);
+         flushRegisterCache();
+         invalidateRegisterCache();
          writePC(address);
       }
       else {
@@ -1302,7 +1867,6 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
       }
       runState = Stepping;
       stepTarget(bdmInterface->isMaskISR());
-      registerBufferSize = 0;
 //      gdbPollTarget();
       break;
    case 'Z' :
@@ -1350,7 +1914,14 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
 //      log.print("GDB-P regNo=%x, val=%X\n", regNo, value);
       if (isValidRegister(regNo)) {
          value = targetToBE32(value);
-         writeReg(regNo, value);
+         if (((unsigned)regNo <= targetLastRegIndex) && (loadRegisterCache() == BDM_RC_OK) && !registerBufferDummy &&
+               convertFromHex(4, strchr(pkt->buffer, '=')+1, registerBuffer+(4*regNo))) {
+            // Cache updated - written to target on resume
+            registerDirty[regNo] = true;
+         }
+         else {
+            writeReg(regNo, value);
+         }
          gdbInOut->sendGdbString("OK");
          reportGdbPrintf(M_BORINGINFO, "Write register %d <= 0x%X\n", regNo, value);
       }
@@ -1359,7 +1930,6 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
          gdbInOut->sendErrorMessage(0x11);
          reportGdbPrintf(M_BORINGINFO, "Write register - illegal!\n");
       }
-      registerBufferSize = 0;
       break;
    case 'p' : // 'p n...' Read register n...
       if (sscanf(pkt->buffer, "p%x", &regNo) != 1) {
@@ -1368,7 +1938,17 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
          break;
       }
       log.print("Read reg %d\n", regNo);
-      {
+      if (!isValidRegister(regNo)) {
+         gdbInOut->sendErrorMessage(0x11);
+      }
+      else if (((unsigned)regNo <= targetLastRegIndex) && (loadRegisterCache() == BDM_RC_OK)) {
+         // Use register cache - shared with 'g' and stop reply
+         gdbInOut->sendGdbHex(registerBuffer+(4*regNo), 4);
+         if (registerBufferDummy) {
+            invalidateRegisterCache();
+         }
+      }
+      else {
          unsigned char buff[10];
          unsigned char *tBuff = buff;
          readReg(regNo, tBuff);
@@ -1383,18 +1963,21 @@ USBDM_ErrorCode GdbHandlerCommon::doCommand(const GdbPacket *pkt) {
 //         gdbInOut->sendErrorMessage(0x11);
 //      }
       break;
-#if THREAD_MODE
    case 'H' : // 'H c thread-id' Set thread (e.g. Hc0, Hc-1, Hg0)
-      // Dummy response
-      gdbInOut->sendGdbString("OK");
-      break;
    case 'T' : // Thread status
-      log.print("Thread Status\n");
-      gdbInOut->sendGdbString("OK");
+      // Only a single thread - only supported in non-stop mode
+      log.print("Thread command\n");
+      gdbInOut->sendGdbString(nonStopMode?"OK":"");
       break;
-#endif
    case '?' : // '?' Indicate the reason the target stopped.
+      if (nonStopMode && (runState != Halted) && (runState != UserInput)) {
+         // No stopped threads
+         gdbInOut->sendGdbString("OK");
+         break;
+      }
+      stopQueryActive = true;
       reportLocation('T', TARGET_SIGNAL_TRAP);
+      stopQueryActive = false;
       break;
    case 'k' : // Kill
       reportGdbPrintf(M_INFO, "Kill...\n");
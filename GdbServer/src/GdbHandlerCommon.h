@@ -9,6 +9,8 @@
 #define SRC_GDBHANDLERCOMMON_H_
 
 #include <stdint.h>
+#include <pthread.h>
+#include <vector>
 //#include "DeviceTclInterface.h"
 #include "UsbdmTclInterpreterFactory.h"
 #include "GdbHandler.h"
@@ -16,8 +18,10 @@
 #include "GdbBreakpoints.h"
 #include "DeviceInterface.h"
 #include "IGdbTty.h"
+#include "GdbMemoryCache.h"
+#include "GdbRttConsole.h"
 
-class GdbHandlerCommon: public GdbHandler {
+class GdbHandlerCommon: public GdbHandler, protected FlashProgrammer::SectorComparer {
 
 public:
    GdbHandlerCommon(
@@ -55,10 +59,17 @@ protected:
    FlashImagePtr                   flashImage;             //!< Flash image for programming
    unsigned                        unsuccessfulPollCount;  //!< Count of unsuccessful polls of target
    bool                            targetBreakPending;
+   int                             breakSignal;            //!< Signal reported when a pending break halts the target
+   bool                            nonStopMode;            //!< GDB non-stop mode (QNonStop:1) - stops are reported by notification
+   bool                            stopQueryActive;        //!< Replying to '?' - stop reply is not a notification
    uint32_t                        lastStoppedPC;
-   static GdbHandlerCommon         *This;
+   static thread_local GdbHandlerCommon *This;
+   static pthread_mutex_t          pluginMutex;            //!< Serialises plug-in creation/deletion (plug-in factories are not thread-safe)
    static void                     errorLogger(const char *msg);
    const DeviceData::ResetMethod   defaultResetMethod;
+   GdbMemoryCache                  memoryCache;            //!< Cache of target memory while halted
+   bool                            incrementalProgramming; //!< Only erase/program flash sectors that differ from the target (Selective erase only)
+   GdbRttConsole                   rttConsole;             //!< Memory-polled console (RTT)
 
    void               clearAllBreakpoints(void)            { gdbBreakpoints->clearAllBreakpoints(); };
    void               checkAndAdjustBreakpointHalt(void)   { gdbBreakpoints->checkAndAdjustBreakpointHalt(); };
@@ -96,21 +107,49 @@ protected:
    virtual USBDM_ErrorCode       haltTarget() override;
 
    virtual USBDM_ErrorCode       programImage(FlashImagePtr flashImage);
+   virtual USBDM_ErrorCode       compareSectors(FlashImagePtr flashImage, std::vector<Sector> &sectors) override;
    virtual void                  maskInterrupts(bool disableInterrupts) = 0;
    virtual uint32_t              getCachedPC() = 0;
    virtual const char           *getCachedPcAsString();
    virtual USBDM_ErrorCode       readRegs(void);
    virtual USBDM_ErrorCode       readReg(unsigned regNo, unsigned char *&buffPtr);
+   USBDM_ErrorCode               loadRegisterCache();
+   USBDM_ErrorCode               flushRegisterCache();
+   void                          invalidateRegisterCache();
+   char                         *appendExpeditedRegisters(char *cPtr, const int regNos[], unsigned count);
    virtual void                  sendRegs(void);
    virtual void                  writeReg(unsigned regNo, unsigned long regValue);
    virtual void                  writeRegs(const char *ccPtr);
-   virtual void                  readMemory(uint32_t address, uint32_t numBytes);
+   virtual void                  readMemory(uint32_t address, uint32_t numBytes, bool binary=false);
    virtual void                  writeMemory(const char *ccPtr, uint32_t address, uint32_t numBytes);
+   virtual void                  writeMemoryBinary(const char *data, uint32_t dataSize, uint32_t address, uint32_t numBytes);
+   virtual void                  writeTargetMemory(uint32_t address, uint32_t numBytes, const unsigned char *data);
    bool                          convertFromHex(unsigned numBytes, const char *dataIn, unsigned char *dataOut);
+   /**
+    * Range of target memory and its CRC
+    */
+   struct CrcRange {
+      uint32_t address;  //!< Start address
+      uint32_t length;   //!< Number of bytes
+      uint32_t crc;      //!< CRC calculated (GDB qCRC form)
+   };
+   /**
+    * Calculate CRCs of several ranges of target memory by executing code on the target
+    *
+    * @param ranges  Ranges to process, crc is updated
+    *
+    * @return BDM_RC_OK if successful, error if not available (host calculation is used instead)
+    */
+   virtual USBDM_ErrorCode       calculateTargetCrcs(std::vector<CrcRange> &ranges);
+   USBDM_ErrorCode               calculateHostCrc(uint32_t address, uint32_t length, uint32_t &crc);
+   USBDM_ErrorCode               calculateCrcs(std::vector<CrcRange> &ranges);
+   USBDM_ErrorCode               calculateCrc(uint32_t address, uint32_t length, uint32_t &crc);
    virtual bool                  isValidRegister(unsigned regNo) = 0;
 
    virtual bool                  initRegisterDescription(void);
    virtual void                  reportLocation(char mode, int reason);
+   void                          sendStopReply(const char *reply);
+   void                          pollRttConsole();
    virtual bool                  checkHostedBreak(uint32_t currentPC) = 0;
            unsigned              getConnectionTimeout();
    virtual USBDM_ErrorCode       writePC(unsigned long value) = 0;
@@ -155,6 +194,8 @@ protected:
 
    unsigned char registerBuffer[1000];
    unsigned registerBufferSize;       // Number of bytes valid in buffer, 0 => register cache invalid
+   bool     registerBufferDummy;      // Buffer holds dummy values (target running/inaccessible)
+   std::vector<bool> registerDirty;   // Registers modified in buffer but not yet written to target
 
    char     targetRegsXML[6000];
    unsigned targetRegsXMLSize;
@@ -8,6 +8,8 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <vector>
+#include <algorithm>
 #include "GdbHandler_ARM.h"
 #include "ArmDefinitions.h"
 #include "Names.h"
@@ -27,7 +29,12 @@ GdbHandler_ARM::GdbHandler_ARM(GdbInOut *gdbInOut, BdmInterfacePtr bdmInterface,
          new GdbBreakpoints_ARM(bdmInterface),
          gdbCallBackPtr,
          tty,
-         DeviceData::resetHardware) {
+         DeviceData::resetHardware),
+         pollResetAttempted(false),
+         pollBusy(0),
+         pollLastRunState(Halted),
+         gdbTargetStatus(T_UNKNOWN),
+         lastStatus(T_UNKNOWN) {
    isKinetisDevice = false;
 }
 
@@ -241,7 +248,7 @@ bool GdbHandler_ARM::isValidRegister(unsigned regNo) {
  *  @note The pointer is incremented by size of register
  *  @note Bytes are read in target byte order
  */
-USBDM_ErrorCode GdbHandler_ARM::readReg(unsigned regNo, char *&buffPtr) {
+USBDM_ErrorCode GdbHandler_ARM::readReg(unsigned regNo, unsigned char *&buffPtr) {
    LOGGING_Q;
    unsigned long regValue;
 
@@ -249,6 +256,7 @@ USBDM_ErrorCode GdbHandler_ARM::readReg(unsigned regNo, char *&buffPtr) {
       log.print("reg[%d] => Invalid GDB register number\n", regNo);
       reportGdbPrintf(GdbHandler::M_ERROR, BDM_RC_ILLEGAL_PARAMS, "Invalid GDB register number. ");
       memset(buffPtr, 0x00, 4);
+      buffPtr += 4;
       return BDM_RC_ILLEGAL_PARAMS;
    }
    int usbdmRegNo = registerMap[regNo];
@@ -447,7 +455,7 @@ USBDM_ErrorCode GdbHandler_ARM::haltTarget() {
    USBDM_ErrorCode   rc;
 
    // Read status for debugging
-   static auto readStatus = [log, this] () {
+   auto readStatus = [log, this] () {
          // Read status (for debug)
          unsigned long  mdm_ap_status;
          USBDM_ErrorCode rc;
@@ -527,7 +535,6 @@ USBDM_ErrorCode GdbHandler_ARM::haltTarget() {
 GdbHandler::GdbTargetStatus GdbHandler_ARM::getTargetStatus() {
    LOGGING;
 
-   static GdbTargetStatus  lastStatus = T_UNKNOWN;
    GdbTargetStatus         status     = T_UNKNOWN;
 
    USBDM_ErrorCode         rc = BDM_RC_OK;
@@ -636,24 +643,20 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::getTargetStatus() {
    return status;
 }
 
-//#define REPORT_LONG_LOCATION
-
 void GdbHandler_ARM::reportLocation(char mode, int reason) {
    LOGGING_Q;
    char buff[100];
    char *cPtr = buff;
 
    cPtr += sprintf(buff, "%c%2.2X", mode, reason);
-#if defined(REPORT_LONG_LOCATION)
    static const int regsToReport[] = {15, 14, 13, 16}; // PC, LR, SP, PSR
-   for (unsigned index=0; index<(sizeof(regsToReport)/sizeof(regsToReport[0])); index++) {
-      cPtr += sprintf(cPtr, "%X:", regsToReport[index]);
-      cPtr += readReg(regsToReport[index], cPtr);
-      *cPtr++ = ';';
+   if (mode == 'T') {
+      // Expedited registers from register cache
+      loadRegisterCache();
+      cPtr = appendExpeditedRegisters(cPtr, regsToReport, sizeof(regsToReport)/sizeof(regsToReport[0]));
    }
-#endif
    *cPtr++ = '\0';
-   gdbInOut->sendGdbString(buff);
+   sendStopReply(buff);
 }
 
 #define SEMI_HOSTING_OPCODE      (0xBEAB)
@@ -687,40 +690,102 @@ struct HeapInfoBlock {
     uint32_t stack_base;
     uint32_t stack_limit;
 };
-HeapInfoBlock heapInfo = {0};
 
 struct OpenInfoBlock {
    uint32_t name;
    uint32_t mode;
    uint32_t length;
 };
-OpenInfoBlock openInfoBlock = {0};
 
 struct ReadInfoBlock {
    uint32_t handle;
    uint32_t dataPtr;
    uint32_t length;
 };
-ReadInfoBlock readInfoBlock = {0};
 
 struct WriteInfoBlock {
    uint32_t handle;
    uint32_t dataPtr;
    uint32_t length;
 };
-WriteInfoBlock writeInfoBlock = {0};
 
 struct IsTtyInfoBlock {
    uint32_t handle;
 };
-IsTtyInfoBlock isTtyInfoBlock = {0};
 
 struct CloseInfoBlock {
    uint32_t handle;
 };
-CloseInfoBlock closeInfoBlock = {0};
 
-static uint32_t semiHostingErrno = 0;
+static thread_local uint32_t semiHostingErrno = 0;
+
+//! Size of blocks used to transfer semi-hosting data to/from the target
+static constexpr unsigned SEMI_HOSTING_BLOCK_SIZE = 4096;
+
+//! Console output is passed to the TTY when this much has accumulated (or target stops trapping)
+static constexpr unsigned SEMI_HOSTING_FLUSH_SIZE = 1024;
+
+//! Maximum number of consecutive semi-hosting calls serviced in a single poll
+static constexpr unsigned SEMI_HOSTING_MAX_CALLS_PER_POLL = 100;
+
+/**
+ * Read registers used by a semi-hosting call
+ *
+ * Uses a single multiple-register read where supported by the BDM
+ *
+ * @param pc   PC
+ * @param r0   R0 (operation)
+ * @param r1   R1 (parameter)
+ *
+ * @return Error code
+ */
+USBDM_ErrorCode GdbHandler_ARM::readHostedRegisters(unsigned long &pc, unsigned long &r0, unsigned long &r1) {
+   if (useFastRegisterRead) {
+      uint8_t buff[4*(ARM_RegPC+1)];
+      if (bdmInterface->readMultipleRegs(buff, ARM_RegR0, ARM_RegPC) == BDM_RC_OK) {
+         r0 = get32bitLE(buff+4*ARM_RegR0);
+         r1 = get32bitLE(buff+4*ARM_RegR1);
+         pc = get32bitLE(buff+4*ARM_RegPC);
+         return BDM_RC_OK;
+      }
+   }
+   USBDM_ErrorCode rc = readPC(&pc);
+   if (rc == BDM_RC_OK) {
+      rc = readR0(&r0);
+   }
+   if (rc == BDM_RC_OK) {
+      rc = readR1(&r1);
+   }
+   return rc;
+}
+
+/**
+ * Add semi-hosting console output
+ *
+ * Output is collected and passed to the TTY in large pieces
+ *
+ * @param data    Data to write
+ * @param length  Number of bytes
+ */
+void GdbHandler_ARM::writeHostedOutput(const char *data, unsigned length) {
+   hostedOutput.append(data, length);
+   if (hostedOutput.size() >= SEMI_HOSTING_FLUSH_SIZE) {
+      flushHostedOutput();
+   }
+}
+
+/**
+ * Pass any collected semi-hosting console output to the TTY
+ */
+void GdbHandler_ARM::flushHostedOutput() {
+   if (hostedOutput.empty()) {
+      return;
+   }
+   // puts() is string based
+   hostedOutput.erase(std::remove(hostedOutput.begin(), hostedOutput.end(), '\0'), hostedOutput.end());
+   tty->puts(&hostedOutput[0]);
+   hostedOutput.clear();
+}
 
 /**
  * Checks if target at a semi-hosting break
@@ -755,13 +820,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
       // Change to halt
       return T_HALT;
    }
-   if (readPC(&pc) != BDM_RC_OK) {
-      return T_HALT;
-   }
-   if (readR0(&r0) != BDM_RC_OK) {
-      return T_HALT;
-   }
-   if (readR1(&r1) != BDM_RC_OK) {
+   if (readHostedRegisters(pc, r0, r1) != BDM_RC_OK) {
       return T_HALT;
    }
    log.print("pc=0x%08lX, r0=0x%08lX, r1=0x%08lX\n", pc, r0, r1);
@@ -776,13 +835,21 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
 
    bool adjustPCandContinue = false;
    char commandBuff[2000];
+   std::vector<char> dataBuff;
    uint32_t buffLength;
-   char *p;
    bool success;
    int handle = -1;
    unsigned long ch;
    int len;
 
+   // Parameter blocks are local as several handlers may run concurrently (-bind)
+   HeapInfoBlock  heapInfo       = {0};
+   OpenInfoBlock  openInfoBlock  = {0};
+   ReadInfoBlock  readInfoBlock  = {0};
+   WriteInfoBlock writeInfoBlock = {0};
+   IsTtyInfoBlock isTtyInfoBlock = {0};
+   CloseInfoBlock closeInfoBlock = {0};
+
    switch(r0) {
    case SEMI_HOSTED_HEAPINFO:
       log.print("Semi-hosting heapInfo\n");
@@ -842,6 +909,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
    case SEMI_HOSTED_CLOSE:
       log.print("Semi-hosting close %ld\n", r0);
       reportGdbPrintf(M_INFO, "Semi-hosting close %d\n", r0);
+      flushHostedOutput();
       bdmInterface->readMemory(MS_Byte, sizeof(closeInfoBlock), r1, (uint8_t *)&closeInfoBlock);
       switch (closeInfoBlock.handle) {
       case IGdbTty::STD_IN:
@@ -861,6 +929,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
    case SEMI_HOSTED_READC:
       log.print("Semi-hosting readc\n");
       reportGdbPrintf(M_INFO, "Semi-hosting readc\n");
+      flushHostedOutput();
       bdmInterface->writeReg(ARM_RegR0, tty->getChar());
       adjustPCandContinue = true;
 //      targetStatus = T_USER_INPUT;
@@ -874,7 +943,10 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
       log.print("handle=%d, data=0x%08X, length=%d\n", readInfoBlock.handle, readInfoBlock.dataPtr, readInfoBlock.length);
       switch (readInfoBlock.handle) {
       case IGdbTty::STD_IN:
-         len = tty->gets(commandBuff, readInfoBlock.length);
+         flushHostedOutput();
+         buffLength = std::min(readInfoBlock.length, SEMI_HOSTING_BLOCK_SIZE);
+         dataBuff.resize(buffLength+1);
+         len = tty->gets(&dataBuff[0], buffLength);
          break;
       case IGdbTty::STD_OUT:
       case IGdbTty::STD_ERR:
@@ -882,12 +954,17 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
          len = EOF;
          break;
       }
-      buffLength = readInfoBlock.length;
-      if (len==EOF) {
-         // Indicates EOF
+      if ((len==EOF) || (len<=0)) {
+         // Indicates EOF (no bytes read)
          len = readInfoBlock.length;
       }
-      // Indicates EOF
+      else {
+         // Transfer data to target as a single block
+         bdmInterface->writeMemory(MS_Byte, len, readInfoBlock.dataPtr, (const uint8_t *)&dataBuff[0]);
+         memoryCache.invalidate(readInfoBlock.dataPtr, len);
+         // Return number of bytes not read
+         len = readInfoBlock.length - len;
+      }
       bdmInterface->writeReg(ARM_RegR0, len);
 //      adjustPCandContinue = false;
 //      targetStatus = T_USER_INPUT;
@@ -898,8 +975,11 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
    case SEMI_HOSTED_WRITEC:
       log.print("Semi-hosting writec\n");
       reportGdbPrintf(M_INFO, "Semi-hosting writec\n");
-      bdmInterface->readReg(ARM_RegR0, &ch);
-      tty->putChar(ch);
+      // R1 points at character
+      ch = 0;
+      bdmInterface->readMemory(MS_Byte, 1, r1, (uint8_t *)&ch);
+      commandBuff[0] = (char)ch;
+      writeHostedOutput(commandBuff, 1);
       adjustPCandContinue = true;
       break;
 
@@ -917,39 +997,40 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHostedBreak() {
       case IGdbTty::STD_OUT:
       case IGdbTty::STD_ERR:
          success = true;
-         buffLength = writeInfoBlock.length;
-         if (buffLength>sizeof(commandBuff)) {
-            buffLength = sizeof(commandBuff);
+         // Transfer data from target in large blocks
+         for (uint32_t offset=0; offset<writeInfoBlock.length; offset += buffLength) {
+            buffLength = std::min(writeInfoBlock.length-offset, SEMI_HOSTING_BLOCK_SIZE);
+            dataBuff.resize(buffLength);
+            if (bdmInterface->readMemory(MS_Byte, buffLength, writeInfoBlock.dataPtr+offset, (uint8_t *)&dataBuff[0]) != BDM_RC_OK) {
+               success = false;
+               break;
+            }
+            writeHostedOutput(&dataBuff[0], buffLength);
          }
-         bdmInterface->readMemory(MS_Byte, buffLength, writeInfoBlock.dataPtr, (uint8_t *)commandBuff);
-         commandBuff[buffLength] = '\0';
-         tty->puts(commandBuff);
-         log.print("Semi-hosting write - %s\n", commandBuff);
+         log.print("Semi-hosting write - %d bytes\n", writeInfoBlock.length);
          break;
       }
-      bdmInterface->writeReg(ARM_RegR0, success?0:-1);
+      // Return number of bytes not written
+      bdmInterface->writeReg(ARM_RegR0, success?0:writeInfoBlock.length);
       adjustPCandContinue = true;
       break;
 
    case SEMI_HOSTED_WRITE0:
       log.print("Semi-hosting write0\n");
       reportGdbPrintf(M_INFO, "Semi-hosting write0\n");
-      p = commandBuff;
-      do {
-         // Read message a few bytes at a time to help prevent overrun without
-         // being horribly inefficient
-         char buff[22];
-         bdmInterface->readMemory(MS_Byte, sizeof(buff)-1, r1, (uint8_t *)buff);
-         buff[sizeof(buff)-1] = '\0';
-         strcat(p, buff);
-         int len = strlen(buff);
-         p += len;
-         if ((len == 0) || (p >= (commandBuff+sizeof(commandBuff)))) {
+      for (uint32_t address=r1; address<r1+SEMI_HOSTING_BLOCK_SIZE; address += buffLength) {
+         // Read message in blocks that don't cross a 64 byte boundary
+         // to avoid reading beyond the end of memory
+         buffLength = 64 - (address & 63);
+         if (bdmInterface->readMemory(MS_Byte, buffLength, address, (uint8_t *)commandBuff) != BDM_RC_OK) {
+            break;
+         }
+         len = strnlen(commandBuff, buffLength);
+         writeHostedOutput(commandBuff, len);
+         if (len < (int)buffLength) {
             break;
          }
-      } while (1);
-      *p = '\0';
-      tty->puts(commandBuff);
+      }
       adjustPCandContinue = true;
       break;
 
@@ -1038,7 +1119,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHalted() {
       // No change
       return T_USER_INPUT;
    case Breaking : // user breaking -> halted
-      reportLocation('T', TARGET_SIGNAL_INT);
+      reportLocation('T', breakSignal);
       log.print("Target has halted (from breaking) @0x%08X\n", lastStoppedPC);
       reportGdbPrintf(M_INFO, "Target has halted (due to user break)  @0x%08X\n", lastStoppedPC);
       deactivateBreakpoints();
@@ -1089,25 +1170,19 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::handleHalted() {
  */
 GdbHandler::GdbTargetStatus GdbHandler_ARM::pollTarget(void) {
    LOGGING;
-   static int      unsuccessfulPollCount = 0;                    // Count of unsuccessful polls of the target
-   static bool     resetAttempted = false;                       // Set if reset already tried
-   static int      busy = 0;
-   static RunState lastRunState = RunState::Halted;
-
-   int         timeoutLimit   = getConnectionTimeout() * 10; // Scale to 100 ms ticks
+   unsigned timeoutLimit = getConnectionTimeout() * 10; // Scale to 100 ms ticks
 
-   static GdbTargetStatus gdbTargetStatus = GdbTargetStatus::T_UNKNOWN;
-   static constexpr int BREAK_TIMEOUT = 20; // 2 seconds
+   static constexpr unsigned BREAK_TIMEOUT = 20; // 2 seconds
 
-   if (lastRunState != runState) {
-      lastRunState = runState;
+   if (pollLastRunState != runState) {
+      pollLastRunState = runState;
       unsuccessfulPollCount = 0;
    }
-   if (busy>0) {
+   if (pollBusy>0) {
       log.print("Recursed\n");
       return gdbTargetStatus;
    }
-   busy++;
+   pollBusy++;
 
    log.print("runState(on entry)       = %s, pollCount = %d\n", getRunStateName(runState), unsuccessfulPollCount);
 
@@ -1124,7 +1199,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::pollTarget(void) {
       }
 
       if (gdbTargetStatus == T_NOCONNECTION) {
-         if (resetAttempted) {
+         if (pollResetAttempted) {
             // Already attempted reset - just give up
             gdbTargetStatus = T_NOCONNECTION;
             break;
@@ -1152,7 +1227,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::pollTarget(void) {
          gdbTargetStatus = getTargetStatus();
          if (gdbTargetStatus == T_NOCONNECTION) {
             resetTarget();
-            resetAttempted = true;
+            pollResetAttempted = true;
             gdbTargetStatus = getTargetStatus();
             if (gdbTargetStatus == T_NOCONNECTION) {
                gdbTargetStatus = T_UNKNOWN;
@@ -1160,7 +1235,7 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::pollTarget(void) {
             }
          }
       }
-      resetAttempted = false;
+      pollResetAttempted = false;
       unsuccessfulPollCount = 0;
 
       if (gdbTargetStatus == T_VLLSxEXIT) {
@@ -1195,20 +1270,45 @@ GdbHandler::GdbTargetStatus GdbHandler_ARM::pollTarget(void) {
          configureKinetisMDM_AP();
          break;
       }
-      if ((gdbTargetStatus == T_HALT)) {
+      // Service semi-hosting calls
+      // Consecutive calls are handled immediately rather than waiting for the next poll
+      bool hostedCallPending = false;
+      for (unsigned count=0; (gdbTargetStatus == T_HALT) && (count<SEMI_HOSTING_MAX_CALLS_PER_POLL); count++) {
          // Check for semi-hosting
+         hostedCallPending = false;
          unsigned long pc;
          readPC(&pc);
-         if (checkHostedBreak(pc)) {
-            gdbTargetStatus = handleHostedBreak();
+         if (!checkHostedBreak(pc)) {
+            break;
          }
+         gdbTargetStatus = handleHostedBreak();
+         if (gdbTargetStatus != T_RUNNING) {
+            break;
+         }
+         gdbTargetStatus   = getTargetStatus();
+         hostedCallPending = (gdbTargetStatus == T_HALT);
+      }
+      if (hostedCallPending) {
+         // Limit reached with target halted (probably at another call)
+         // Treat as running - the halt is checked on the next poll
+         log.print("Semi-hosting call limit reached - deferred to next poll\n");
+         gdbTargetStatus = T_RUNNING;
+      }
+      else {
+         // Target has stopped producing output
+         flushHostedOutput();
       }
       if ((gdbTargetStatus == T_HALT)) {
          gdbTargetStatus = handleHalted();
       }
    } while (false);
 
-   busy--;
+   if ((gdbTargetStatus == T_RUNNING) || (gdbTargetStatus == T_HALT)) {
+      // Memory may be accessed while running
+      pollRttConsole();
+   }
+
+   pollBusy--;
 
    log.print("gdbTargetStatus(on exit) = %s\n", getStatusName(gdbTargetStatus));
    log.print("runState(on exit)        = %s\n", getRunStateName(runState));
@@ -1235,6 +1335,215 @@ USBDM_ErrorCode GdbHandler_ARM::readR1(unsigned long *value) {
    return bdmInterface->readReg(ARM_RegR1, value);
 }
 
+/**
+ * Thumb code to calculate CRCs as used by GDB qCRC (runs on all Cortex-M)
+ *
+ * The table holds {address, length} pairs.  Each length is replaced by the CRC of that range.
+ *
+ * Entry: r6 = table address, r7 = number of entries, r3 = polynomial
+ * Exit:  r7 = 0, halts on BKPT
+ */
+static const uint8_t crcTargetCode[] = {
+      0x00, 0x2F,   //    cmp   r7, #0
+      0x15, 0xD0,   //    beq   done
+      0x30, 0x68,   // next: ldr   r0, [r6, #0]
+      0x71, 0x68,   //    ldr   r1, [r6, #4]
+      0x00, 0x22,   //    movs  r2, #0
+      0xD2, 0x43,   //    mvns  r2, r2
+      0x00, 0x29,   // start: cmp   r1, #0
+      0x0B, 0xD0,   //    beq   store
+      0x04, 0x78,   //    ldrb  r4, [r0]
+      0x01, 0x30,   //    adds  r0, #1
+      0x24, 0x06,   //    lsls  r4, r4, #24
+      0x62, 0x40,   //    eors  r2, r4
+      0x08, 0x25,   //    movs  r5, #8
+      0x52, 0x00,   // bit: lsls  r2, r2, #1
+      0x00, 0xD3,   //    bcc   noXor
+      0x5A, 0x40,   //    eors  r2, r3
+      0x01, 0x3D,   // noXor: subs  r5, #1
+      0xFA, 0xD1,   //    bne   bit
+      0x01, 0x39,   //    subs  r1, #1
+      0xF1, 0xE7,   //    b     start
+      0x72, 0x60,   // store: str   r2, [r6, #4]
+      0x08, 0x36,   //    adds  r6, #8
+      0x01, 0x3F,   //    subs  r7, #1
+      0xE9, 0xD1,   //    bne   next
+      0x00, 0xBE,   // done: bkpt  #0
+      0x00, 0x00,   //    (padding)
+};
+static const uint32_t crcTargetCodeDoneOffset = 48;  //!< Offset of BKPT in crcTargetCode
+
+//! Maximum number of ranges in the table used by crcTargetCode
+static constexpr unsigned MaximumTargetCrcRanges = 256;
+
+/**
+ * Calculate CRCs of several ranges of target memory by executing code in target RAM
+ *
+ * All ranges are processed by a single execution of the code (if RAM allows).
+ * The RAM used and the registers modified are saved and restored.
+ *
+ * @param ranges  Ranges to process, crc is updated (GDB qCRC form)
+ *
+ * @return BDM_RC_OK if successful, error if target calculation failed
+ */
+USBDM_ErrorCode GdbHandler_ARM::calculateTargetCrcs(std::vector<CrcRange> &ranges) {
+   LOGGING;
+
+   // Small areas are quicker to read
+   static const uint32_t MinimumTargetCrcSize = 0x400;
+   uint32_t totalLength = 0;
+   for (unsigned index=0; index<ranges.size(); index++) {
+      totalLength += ranges[index].length;
+   }
+   if (totalLength < MinimumTargetCrcSize) {
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   // Locate RAM for code and table
+   uint32_t codeAddress = 0;
+   uint32_t ramSize     = 0;
+   for (int memIndex=0; ; memIndex++) {
+      MemoryRegionPtr pMemoryRegion(deviceData->getMemoryRegion(memIndex));
+      if (!pMemoryRegion) {
+         break;
+      }
+      if (pMemoryRegion->getMemoryType() != MemRAM) {
+         continue;
+      }
+      const MemoryRegion::MemoryRange *memoryRange = pMemoryRegion->getMemoryRange(0);
+      if ((memoryRange != NULL) && ((memoryRange->end-memoryRange->start+1) >= sizeof(crcTargetCode)+8)) {
+         codeAddress = memoryRange->start;
+         ramSize     = memoryRange->end-memoryRange->start+1;
+         break;
+      }
+   }
+   if (ramSize == 0) {
+      log.print("No RAM available for CRC code\n");
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   const uint32_t tableAddress  = codeAddress+sizeof(crcTargetCode);
+   const unsigned maxRanges     = std::min((unsigned)((ramSize-sizeof(crcTargetCode))/8), MaximumTargetCrcRanges);
+   const uint32_t workSize      = sizeof(crcTargetCode)+8*std::min((unsigned)ranges.size(), maxRanges);
+   for (unsigned index=0; index<ranges.size(); index++) {
+      if ((ranges[index].address < codeAddress+workSize) && (codeAddress < ranges[index].address+ranges[index].length)) {
+         log.print("CRC area overlaps CRC code\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
+   // Save target state
+   static const ARM_Registers_t savedRegs[] = {
+         ARM_RegR0, ARM_RegR1, ARM_RegR2, ARM_RegR3, ARM_RegR4,
+         ARM_RegR5, ARM_RegR6, ARM_RegR7, ARM_RegPC, ARM_RegxPSR,
+   };
+   unsigned long        regValues[sizeof(savedRegs)/sizeof(savedRegs[0])];
+   std::vector<uint8_t> savedRam(workSize);
+   unsigned long        dhcsr, dfsr;
+
+   USBDM_ErrorCode rc;
+   do {
+      rc = armReadMemoryWord(DHCSR, &dhcsr);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      rc = armReadMemoryWord(DFSR, &dfsr);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      for (unsigned index=0; index<sizeof(savedRegs)/sizeof(savedRegs[0]); index++) {
+         rc = bdmInterface->readReg(savedRegs[index], &regValues[index]);
+         if (rc != BDM_RC_OK) {
+            break;
+         }
+      }
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      rc = bdmInterface->readMemory(MS_Long, workSize, codeAddress, &savedRam[0]);
+   } while (false);
+   if (rc != BDM_RC_OK) {
+      log.print("Failed to save target state, rc=%s\n", bdmInterface->getErrorString(rc));
+      return rc;
+   }
+   // Load and run code with interrupts masked
+   rc = bdmInterface->writeMemory(MS_Long, sizeof(crcTargetCode), codeAddress, crcTargetCode);
+   if (rc == BDM_RC_OK) {
+      maskInterrupts(true);
+   }
+   std::vector<uint8_t> table;
+   for (unsigned first=0; (rc == BDM_RC_OK) && (first<ranges.size()); first+=maxRanges) {
+      unsigned count  = std::min((unsigned)ranges.size()-first, maxRanges);
+      uint32_t length = 0;
+      table.resize(8*count);
+      for (unsigned index=0; index<count; index++) {
+         uint32_t values[2] = { ranges[first+index].address, ranges[first+index].length };
+         for (unsigned byte=0; byte<8; byte++) {
+            table[8*index+byte] = (uint8_t)(values[byte/4]>>(8*(byte%4)));
+         }
+         length += ranges[first+index].length;
+      }
+      unsigned long remaining = 1;
+      unsigned long finalPC   = 0;
+      rc = bdmInterface->writeMemory(MS_Long, table.size(), tableAddress, &table[0]);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      bdmInterface->writeReg(ARM_RegR6,   tableAddress);
+      bdmInterface->writeReg(ARM_RegR7,   count);
+      bdmInterface->writeReg(ARM_RegR3,   0x04C11DB7);
+      bdmInterface->writeReg(ARM_RegxPSR, 0x01000000); // Thumb state
+      rc = bdmInterface->writeReg(ARM_RegPC, codeAddress);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      rc = bdmInterface->go();
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      // Allow ~10 us/byte (bit-wise CRC on a slow target)
+      int timeout = 100 + length/100; // x 1 ms
+      unsigned long status;
+      do {
+         UsbdmSystem::milliSleep(1);
+         rc = armReadMemoryWord(DHCSR, &status);
+      } while ((rc == BDM_RC_OK) && ((status & (DHCSR_S_HALT|DHCSR_S_LOCKUP)) == 0) && (--timeout > 0));
+      if ((rc != BDM_RC_OK) || ((status & DHCSR_S_HALT) == 0)) {
+         log.print("CRC code failed to complete\n");
+         bdmInterface->halt();
+         rc = BDM_RC_TARGET_BUSY;
+         break;
+      }
+      bdmInterface->readReg(ARM_RegR7, &remaining);
+      rc = bdmInterface->readReg(ARM_RegPC, &finalPC);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      if ((remaining != 0) || (finalPC != codeAddress+crcTargetCodeDoneOffset)) {
+         // e.g. stopped by watchpoint
+         log.print("CRC code stopped early, PC=0x%08lX, remaining=%ld\n", finalPC, remaining);
+         rc = BDM_RC_TARGET_BUSY;
+         break;
+      }
+      rc = bdmInterface->readMemory(MS_Long, table.size(), tableAddress, &table[0]);
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      for (unsigned index=0; index<count; index++) {
+         ranges[first+index].crc = get32bitLE(&table[8*index+4]);
+      }
+   }
+   // Restore target state
+   bdmInterface->writeMemory(MS_Long, workSize, codeAddress, &savedRam[0]);
+   for (unsigned index=0; index<sizeof(savedRegs)/sizeof(savedRegs[0]); index++) {
+      bdmInterface->writeReg(savedRegs[index], regValues[index]);
+   }
+   maskInterrupts((dhcsr & DHCSR_C_MASKINTS) != 0);
+   if ((dfsr & DFSR_BKPT) == 0) {
+      // Clear break indication caused by CRC code (W1C)
+      const uint8_t clearBkpt[4] = {DFSR_BKPT, 0, 0, 0};
+      bdmInterface->writeMemory(MS_Long, 4, DFSR, clearBkpt);
+   }
+   return rc;
+}
+
 USBDM_ErrorCode GdbHandler_ARM::updateTarget() {
    return BDM_RC_OK;
 }
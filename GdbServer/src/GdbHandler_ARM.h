@@ -8,12 +8,20 @@
 #ifndef SRC_GDBHANDLER_ARM_H_
 #define SRC_GDBHANDLER_ARM_H_
 
+#include <string>
 #include "GdbHandlerCommon.h"
 
 class GdbHandler_ARM: public GdbHandlerCommon {
 protected:
    bool  isKinetisDevice;
 
+   bool              pollResetAttempted;  //!< Reset already tried to recover connection
+   int               pollBusy;            //!< Guards against recursive polling
+   RunState          pollLastRunState;    //!< Run state at last poll
+   GdbTargetStatus   gdbTargetStatus;     //!< Status from last poll
+   GdbTargetStatus   lastStatus;          //!< Status from last getTargetStatus() (change detection)
+   std::string       hostedOutput;        //!< Semi-hosting console output waiting to be passed to TTY
+
    USBDM_ErrorCode configureMDM_AP();
 
 public:
@@ -40,12 +48,15 @@ public:
    USBDM_ErrorCode           configureKinetisMDM_AP();
    GdbTargetStatus           handleHostedBreak();
    bool                      checkHostedBreak(uint32_t currentPC);
+   USBDM_ErrorCode           readHostedRegisters(unsigned long &pc, unsigned long &r0, unsigned long &r1);
+   void                      writeHostedOutput(const char *data, unsigned length);
+   void                      flushHostedOutput();
 
    virtual uint32_t          getCachedPC() override;
    uint32_t                  getCachedR0();
    uint32_t                  getCachedR1();
    virtual bool              isValidRegister(unsigned regNo) override;
-   USBDM_ErrorCode           readReg(unsigned regNo, char *&buffPtr);
+   virtual USBDM_ErrorCode   readReg(unsigned regNo, unsigned char *&buffPtr) override;
 
    USBDM_ErrorCode           armReadMemoryWord(unsigned long address, unsigned long *data);
    GdbTargetStatus           getTargetStatus();
@@ -62,6 +73,7 @@ public:
    USBDM_ErrorCode           readR1(unsigned long *value);
    virtual USBDM_ErrorCode   writeSP(unsigned long value) override;
    virtual USBDM_ErrorCode   updateTarget() override;
+   virtual USBDM_ErrorCode   calculateTargetCrcs(std::vector<CrcRange> &ranges) override;
 
    uint32_t          getCachedRegister(ARM_Registers_t reg);
 
@@ -26,7 +26,8 @@ GdbHandler_CFVx::GdbHandler_CFVx(GdbInOut *gdbInOut, BdmInterfacePtr bdmInterfac
          new GdbBreakpoints_CFV1(bdmInterface),
          gdbCallBackPtr,
          tty,
-         DeviceData::resetHardware) {
+         DeviceData::resetHardware),
+         lastStatus(T_UNKNOWN) {
 }
 
 GdbHandler_CFVx::~GdbHandler_CFVx() {
@@ -201,7 +202,7 @@ bool GdbHandler_CFVx::isValidRegister(unsigned regNo) {
 //! @note The pointer is incremented by size of register
 //! @note Bytes are read in target byte order
 //!
-USBDM_ErrorCode GdbHandler_CFVx::readReg(unsigned regNo, char *&buffPtr) {
+USBDM_ErrorCode GdbHandler_CFVx::readReg(unsigned regNo, unsigned char *&buffPtr) {
    LOGGING_Q;
    unsigned long regValue;
 
@@ -209,6 +210,7 @@ USBDM_ErrorCode GdbHandler_CFVx::readReg(unsigned regNo, char *&buffPtr) {
       log.print("reg[%d] => Invalid GDB register number\n", regNo);
       reportGdbPrintf(GdbHandler::M_ERROR, BDM_RC_ILLEGAL_PARAMS, "Invalid GDB register number. ");
       memset(buffPtr, 0x00, 4);
+      buffPtr += 4;
       return BDM_RC_ILLEGAL_PARAMS;
    }
    int usbdmRegNo = registerMap[regNo];
@@ -285,7 +287,6 @@ void GdbHandler_CFVx::writeReg(unsigned regNo, unsigned long regValue) {
 GdbHandler::GdbTargetStatus GdbHandler_CFVx::getTargetStatus(void) {
    LOGGING_Q;
 
-   static GdbTargetStatus  lastStatus = T_UNKNOWN;
    GdbTargetStatus         status     = T_UNKNOWN;
 
    do {
@@ -318,24 +319,20 @@ GdbHandler::GdbTargetStatus GdbHandler_CFVx::getTargetStatus(void) {
    return status;
 }
 
-//#define REPORT_LONG_LOCATION
-
 void GdbHandler_CFVx::reportLocation(char mode, int reason) {
    LOGGING_Q;
    char buff[100];
    char *cPtr = buff;
 
    cPtr += sprintf(buff, "%c%2.2X", mode, reason);
-#if defined(REPORT_LONG_LOCATION)
    static const int regsToReport[] = {17, 15, 14, 16}; // PC, SP, FP, SR
-   for (unsigned index=0; index<(sizeof(regsToReport)/sizeof(regsToReport[0])); index++) {
-      cPtr += sprintf(cPtr, "%X:", regsToReport[index]);
-      cPtr += readReg(regsToReport[index], cPtr);
-      *cPtr++ = ';';
+   if (mode == 'T') {
+      // Expedited registers from register cache
+      loadRegisterCache();
+      cPtr = appendExpeditedRegisters(cPtr, regsToReport, sizeof(regsToReport)/sizeof(regsToReport[0]));
    }
-#endif
    *cPtr++ = '\0';
-   gdbInOut->sendGdbString(buff);
+   sendStopReply(buff);
 }
 /**
  * Checks if target at a semi-hosting break
@@ -369,7 +366,7 @@ GdbHandler::GdbTargetStatus GdbHandler_CFVx::handleHalted() {
       // No change
       break;
    case Breaking : // user breaking -> halted
-      reportLocation('T', TARGET_SIGNAL_INT);
+      reportLocation('T', breakSignal);
       log.print("Target has halted (from breaking) @0x%08X\n", lastStoppedPC);
       reportGdbPrintf(M_INFO, "Target has halted (due to user break)  @0x%08X\n", lastStoppedPC);
       deactivateBreakpoints();
@@ -420,8 +417,8 @@ GdbHandler::GdbTargetStatus GdbHandler_CFVx::handleHalted() {
  */
 GdbHandler::GdbTargetStatus GdbHandler_CFVx::pollTarget(void) {
    LOGGING;
-   static int  unsuccessfulPollCount = 0;                    // Count of unsuccessful polls of the target
-   static bool resetAttempted = false;                       // Set if reset already tried
+   static thread_local int  unsuccessfulPollCount = 0;       // Count of unsuccessful polls of the target
+   static thread_local bool resetAttempted = false;          // Set if reset already tried
    int         timeoutLimit   = getConnectionTimeout() * 10; // Scale to 100 ms ticks
 
    if (targetBreakPending) {
@@ -22,6 +22,8 @@ public:
 
 
 protected:
+   GdbTargetStatus           lastStatus;     //!< Status from last getTargetStatus() (change detection)
+
    virtual USBDM_ErrorCode   resetTarget(DeviceData::ResetMethod resetMethod=DeviceData::resetTargetDefault) override;
    virtual void              maskInterrupts(bool disableInterrupts) override;
    virtual USBDM_ErrorCode   continueTarget(void) override;
@@ -38,7 +40,7 @@ protected:
 
    virtual uint32_t          getCachedPC() override;
    virtual bool              isValidRegister(unsigned regNo) override;
-   USBDM_ErrorCode           readReg(unsigned regNo, char *&buffPtr);
+   virtual USBDM_ErrorCode   readReg(unsigned regNo, unsigned char *&buffPtr) override;
 
    GdbTargetStatus           getTargetStatus();
 
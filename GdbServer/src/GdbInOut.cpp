@@ -25,6 +25,8 @@
     \verbatim
    Change History
    -==================================================================================
+   | 17 Oct 2026 | Added binary packets, larger packets & growable Tx buffer     - pgo
+   +==================================================================================
    | 23 Jun 2013 | Sockets version created and merged                            - pgo
    +==================================================================================
    | 23 Apr 2012 | Created                                                       - pgo
@@ -65,9 +67,10 @@ const GdbPacket GdbPacket::breakToken  = {
 GdbInOut::GdbInOut() :
    state(hunt),
    connectionActive(false),
+   gdbTxBuffer(MAX_GDB_MESSAGE_SIZE+20),
    gdbTxChecksum(0),
    gdbTxCharCount(0),
-   gdbTxPtr(gdbTxBuffer),
+   gdbTxIndex(0),
    rxBufferIndex(0),
    rxBufferLength(0),
    ackMode(true),
@@ -181,12 +184,13 @@ int GdbInOut::getChar() {
  */
 const GdbPacket *GdbInOut::processRxByte(int byte) {
    LOGGING_Q;
-   static GdbPacket packet1;
-   static GdbPacket packet2;
-   static GdbPacket *packet = &packet1;
-   static unsigned char  checksum    = 0;
-   static unsigned char  xmitcsum    = 0;
-   static unsigned int   sequenceNum = 0;
+   static thread_local GdbPacket packet1;
+   static thread_local GdbPacket packet2;
+   static thread_local GdbPacket *packet = &packet1;
+   static thread_local unsigned char  checksum    = 0;
+   static thread_local unsigned char  xmitcsum    = 0;
+   static thread_local unsigned int   sequenceNum = 0;
+   static thread_local bool           overflow    = false;
 
    if (!connectionActive) {
       log.print("Connection not active\n");
@@ -207,6 +211,7 @@ const GdbPacket *GdbInOut::processRxByte(int byte) {
             state         = data;
             checksum      = 0;
             packet->size  = 0;
+            overflow      = false;
          }
          else if (byte == 0x03) { // Break request
             return &GdbPacket::breakToken;
@@ -221,6 +226,7 @@ const GdbPacket *GdbInOut::processRxByte(int byte) {
             state          = data;
             checksum       = 0;
             packet->size   = 0;
+            overflow       = false;
          }
          else if (byte == '#') { // End of data token
             state    = checksum1;
@@ -229,6 +235,9 @@ const GdbPacket *GdbInOut::processRxByte(int byte) {
             if (packet->size < GdbPacket::MAX_MESSAGE) {
                packet->buffer[packet->size++] = byte;
             }
+            else {
+               overflow = true;
+            }
             checksum  = checksum + byte;
          }
          break;
@@ -239,6 +248,9 @@ const GdbPacket *GdbInOut::processRxByte(int byte) {
          if (packet->size < GdbPacket::MAX_MESSAGE) {
             packet->buffer[packet->size++] = byte;
          }
+         else {
+            overflow = true;
+         }
          break;
       case checksum1: // 1st Checksum byte
          state    = checksum2;
@@ -253,6 +265,11 @@ const GdbPacket *GdbInOut::processRxByte(int byte) {
             log.print(" -- Bad buffer: \"%s\"\n", packet->buffer);
             state = hunt;
          }
+         else if (overflow) {
+            // Truncated packet - discard rather than act on partial data
+            log.print("\nPacket too large (> %d bytes) - discarded\n", GdbPacket::MAX_MESSAGE);
+            state = hunt;
+         }
          else {
             // Complete packet
             packet->checkSum = checksum;
@@ -305,11 +322,11 @@ void GdbInOut::putGdbChar(char ch) {
    LOGGING_Q;
    gdbTxChecksum   += ch;
    gdbTxCharCount  += 1;
-   if (gdbTxCharCount > sizeof(gdbTxBuffer)) {
-      log.print( "buffer overflow\n");
-      exit(-1);
+   if (gdbTxIndex >= gdbTxBuffer.size()) {
+      log.print("Growing Tx buffer to %lu\n", (unsigned long)(2*gdbTxBuffer.size()));
+      gdbTxBuffer.resize(2*gdbTxBuffer.size());
    }
-   *gdbTxPtr++      = ch;
+   gdbTxBuffer[gdbTxIndex++] = ch;
 }
 
 /*!  Add character to GDB Tx buffer
@@ -337,6 +354,17 @@ void GdbInOut::putGdbString(const char *s, int size) {
    }
 }
 
+/*!  Add bytes to GDB Tx buffer as escaped binary data
+ *
+ *   @param buff  Buffer to add
+ *   @param size  Size of buffer
+ */
+void GdbInOut::putGdbBinary(const unsigned char *buffer, unsigned size) {
+  for (unsigned index=0; index<size; index++) {
+     putGdbEscapedChar(buffer[index]);
+  }
+}
+
 /*!  Add bytes to GDB Tx buffer as Hex character pairs
  *
  *   @param buff  Buffer to add
@@ -388,7 +416,7 @@ int GdbInOut::putGdbPrintf(const char *format, ...) {
   *   @param marker - packet marker to use
   */
 void GdbInOut::putGdbPreamble(char marker) {
-   gdbTxPtr = gdbTxBuffer;
+   gdbTxIndex = 0;
    putGdbChar(marker);
    gdbTxChecksum  = 0;
    gdbTxCharCount = 0;
@@ -408,8 +436,8 @@ void GdbInOut::putGdbChecksum(void) {
   */
 void GdbInOut::txGdbPkt(void) {
    LOGGING_Q;
-   writeBuffer(gdbTxBuffer, gdbTxCharCount);
-   log.print( "txGdbPkt()=>:%3d%*s\n", gdbTxCharCount, gdbTxCharCount, gdbTxBuffer);
+   writeBuffer(&gdbTxBuffer[0], gdbTxCharCount);
+   log.print( "txGdbPkt()=>:%3d%*s\n", gdbTxCharCount, gdbTxCharCount, (const char *)&gdbTxBuffer[0]);
 }
 
  /*!  Immediately send string to GDB (pre-amble and postscript are added)
@@ -471,6 +499,23 @@ void GdbInOut::sendGdbHex(const unsigned char *buffer, unsigned size) {
    txGdbPkt();
 }
 
+/*!  Immediately send bytes to GDB as escaped binary data with leading id string
+ *
+ *   @param id       - '\0' terminated string to send unencoded (may be NULL)
+ *   @param buffer   - data to send
+ *   @param size     - size of data (in bytes)
+ */
+void GdbInOut::sendGdbBinary(const char *id, const unsigned char *buffer, unsigned size) {
+   if (id == NULL) {
+      id = "";
+   }
+   putGdbPreamble();
+   putGdbString(id);
+   putGdbBinary(buffer, size);
+   putGdbChecksum();
+   txGdbPkt();
+}
+
  /*!  Immediately send notification packet to GDB  (pre-amble and postscript are added)
   *
   *   @param buffer - data to send ('\0' terminated)
@@ -9,6 +9,7 @@
 #define GDBINOUT_H_
 
 #include <stdint.h>
+#include <vector>
 
 #define GDB_OK               (0)
 #define GDB_FATAL_ERROR      (1)
@@ -17,7 +18,9 @@
 //==========================================================
 //
 
-#define MAX_GDB_MESSAGE_SIZE (2000) //! Maximum size of a GDB packet
+#ifndef MAX_GDB_MESSAGE_SIZE
+#define MAX_GDB_MESSAGE_SIZE (0x4000) //! Maximum size of a GDB packet (may be overridden by the build)
+#endif
 
 /*! Represents a packet received from GDB
  */
@@ -27,7 +30,7 @@ public:
    static const GdbPacket breakToken;                        //!< Packet representing a 'break' from GDB
    static const int       MAX_MESSAGE=MAX_GDB_MESSAGE_SIZE;  //!< Maximum size of message buffer
    int   size;                                               //!< Size of valid data in buffer
-   char  buffer[MAX_MESSAGE];                                //!< Raw data from GDB
+   char  buffer[MAX_MESSAGE+1];                              //!< Raw data from GDB (unescaped, '\0' terminated)
    int   checkSum;                                           //!< Checksum for data
    int   sequence;                                           //!< Sequence number for message
    bool  isBreak() const {                                   //!< Check if this is a 'break' packet
@@ -52,10 +55,10 @@ protected:
    StateType               state;               //!< State of GDB packet Rx state machine
    bool                    connectionActive;    //!< Active connection to GDB
 
-   unsigned char           gdbTxBuffer[2000];   //!< Buffer for assembling GDB Tx packet
+   std::vector<unsigned char> gdbTxBuffer;      //!< Buffer for assembling GDB Tx packet (grows as needed)
    int                     gdbTxChecksum;       //!< Checksum for gdbTxBuffer
    unsigned                gdbTxCharCount;      //!< Byte count for gdbTxBuffer
-   unsigned char *         gdbTxPtr;            //!< Pointer into gdbTxBuffer
+   unsigned                gdbTxIndex;          //!< Write index into gdbTxBuffer
 
    unsigned char    gdbRxBuffer[MAX_GDB_MESSAGE_SIZE+20]; //! Buffer for Rx data from GDB
    unsigned         rxBufferIndex;                        //! Read index for gdbRxBuffer
@@ -103,6 +106,7 @@ public:
    void putGdbChar(char ch);
    void putGdbEscapedChar(char ch);
    void putGdbHex(const unsigned char *buffer, unsigned size);
+   void putGdbBinary(const unsigned char *buffer, unsigned size);
    void putGdbString(const char *s, int size=-1);
    void putGdbHexString(const char *s, int size=-1);
    int  putGdbPrintf(const char *format, ...);
@@ -113,6 +117,7 @@ public:
    void sendGdbBuffer(void);
    void sendGdbHexDataString(const char *id, const uint8_t *data, unsigned size);
    void sendGdbHex(const unsigned char *buffer, unsigned size);
+   void sendGdbBinary(const char *id, const unsigned char *buffer, unsigned size);
    void sendGdbString(const char *buffer, int size=-1);
    void sendGdbHexString(const char *id, const char *buffer, int size=-1);
    void sendGdbNotification(const char *buffer, int size=-1);
@@ -0,0 +1,216 @@
+/*! \file
+    \brief Handles GDB output, and GDB input over a plain socket
+
+    GdbInOutSocket.cpp
+
+    \verbatim
+    USBDM
+    Copyright (C) 2009  Peter O'Donoghue
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+    \endverbatim
+
+    \verbatim
+   Change History
+   -==================================================================================
+   | 17 Oct 2026 | Created (headless server)                                     - pgo
+   +==================================================================================
+   \endverbatim
+*/
+
+#ifdef _WIN32
+#include <winsock2.h>
+#define poll         WSAPoll
+#define SOCKET_ERRNO WSAGetLastError()
+#define WOULD_BLOCK  WSAEWOULDBLOCK
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#define SOCKET_ERRNO errno
+#define WOULD_BLOCK  EWOULDBLOCK
+#endif
+
+#include "GdbInOutSocket.h"
+#include "UsbdmSystem.h"
+
+//! Maximum time to wait for GDB to accept output (ms)
+static const int writeTimeout = 5000;
+
+/*
+ *
+ */
+GdbInOutSocket::GdbInOutSocket(SocketHandle clientSocket) :
+   GdbInOut(),
+   clientSocket(clientSocket) {
+   connectionActive = true;
+}
+
+/*
+ *
+ */
+GdbInOutSocket::~GdbInOutSocket() {
+   LOGGING_E;
+   finish();
+}
+
+/*!  Set socket to non-blocking mode
+ *
+ *   @param socket Socket to modify
+ *
+ *   @return true on success
+ */
+bool GdbInOutSocket::setNonBlocking(SocketHandle socket) {
+#ifdef _WIN32
+   u_long mode = 1;
+   return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+   int flags = fcntl(socket, F_GETFL, 0);
+   return (flags >= 0) && (fcntl(socket, F_SETFL, flags|O_NONBLOCK) == 0);
+#endif
+}
+
+/*!  Close socket
+ *
+ *   @param socket Socket to close
+ */
+void GdbInOutSocket::closeSocket(SocketHandle socket) {
+   if (socket == INVALID_SOCKET) {
+      return;
+   }
+#ifdef _WIN32
+   closesocket(socket);
+#else
+   close(socket);
+#endif
+}
+
+//=====================================================================
+// Input functions
+//=====================================================================
+
+/*!  Finish up
+ *
+ *  - Set end of file
+ */
+void GdbInOutSocket::finish(void) {
+   LOGGING_Q;
+   log.print("GdbInOutSocket::finish()\n");
+   GdbInOut::finish();
+}
+
+/*!  Get GDB Packet
+ *
+ *   @return next GDB packet received or NULL if none available
+ *
+ *   @note Non-blocking
+ */
+const GdbPacket *GdbInOutSocket::getGdbPacket(void) {
+   LOGGING_Q;
+   if (!connectionActive) {
+      return NULL;
+   }
+   const GdbPacket *packet;
+   int byte;
+   do {
+      byte = getChar();
+      packet = processRxByte(byte);
+   } while ((byte >= 0) && (packet == NULL));
+   if (packet != NULL) {
+      log.print("Rx<=#:%d:%03d$%*.*s#%2.2x\n", packet->sequence, packet->size, packet->size, packet->size, packet->buffer, packet->checkSum);
+      if (ackMode) {
+         sendAck();
+      }
+   }
+   return packet;
+}
+
+/*!  Get data from GDB
+ *
+ *   @param buff   - buffer for data
+ *   @param size   - maximum number of bytes to read
+ *
+ *   @return  >0                  - Number of bytes read \n
+ *           -GDB_NON_FATAL_ERROR - No data \n
+ *           -GDB_FATAL_ERROR     - Connection closed or unexpected error
+ */
+int GdbInOutSocket::getData(unsigned char *buffer, int size) {
+   LOGGING_Q;
+
+   int bytesRead = recv(clientSocket, (char *)buffer, size, 0);
+   if (bytesRead > 0) {
+      return bytesRead;
+   }
+   if ((bytesRead < 0) && (SOCKET_ERRNO == WOULD_BLOCK)) {
+      return -GDB_NON_FATAL_ERROR;
+   }
+#ifndef _WIN32
+   if ((bytesRead < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+      return -GDB_NON_FATAL_ERROR;
+   }
+#endif
+   // Orderly shutdown by GDB or socket error
+   log.print("Connection closed (rc=%d)\n", bytesRead);
+   connectionActive = false;
+   return -GDB_FATAL_ERROR;
+}
+
+//=====================================================================
+// Output functions
+//=====================================================================
+
+/*!  Write buffer to GDB
+ *
+ *   @param buffer buffer to write
+ *   @param size number of bytes to write
+ *
+ *   @note Blocks (with timeout) while the socket is full
+ */
+void GdbInOutSocket::writeBuffer(unsigned char *buffer, int size) {
+   while (connectionActive && (size > 0)) {
+      int bytesWritten = send(clientSocket, (const char *)buffer, size, 0);
+      if (bytesWritten > 0) {
+         buffer += bytesWritten;
+         size   -= bytesWritten;
+         continue;
+      }
+      int error = SOCKET_ERRNO;
+#ifndef _WIN32
+      if (error == EINTR) {
+         continue;
+      }
+      if (error == EAGAIN) {
+         error = WOULD_BLOCK;
+      }
+#endif
+      if (error == WOULD_BLOCK) {
+         // Wait for space in socket
+         struct pollfd pfd;
+         pfd.fd      = clientSocket;
+         pfd.events  = POLLOUT;
+         pfd.revents = 0;
+         if (poll(&pfd, 1, writeTimeout) > 0) {
+            continue;
+         }
+      }
+      if (errorLogger != 0) {
+         errorLogger("clientSocket error");
+      }
+      connectionActive = false;
+   }
+}
@@ -0,0 +1,50 @@
+/*
+ * GdbInOutSocket.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#ifndef GDBINOUTSOCKET_H_
+#define GDBINOUTSOCKET_H_
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET SocketHandle;
+#else
+typedef int SocketHandle;
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+#endif
+
+#include "GdbInOut.h"
+
+/**
+ * GDB I/O over a plain (non-blocking) socket
+ *
+ * Used by the headless GDB server - no wxWidgets dependencies.
+ * The socket is owned by the caller and is not closed by this class.
+ */
+class GdbInOutSocket : public GdbInOut {
+
+public:
+   GdbInOutSocket(SocketHandle clientSocket);
+   virtual ~GdbInOutSocket();
+   virtual const GdbPacket *getGdbPacket();
+
+   static bool setNonBlocking(SocketHandle socket);
+   static void closeSocket(SocketHandle socket);
+
+private:
+   SocketHandle     clientSocket;
+
+private:
+   virtual void     writeBuffer(unsigned char *buffer, int size);
+   virtual int      getData(unsigned char *buffer, int size);
+
+public:
+   virtual void     finish(void);
+};
+
+#endif /* GDBINOUTSOCKET_H_ */
@@ -0,0 +1,180 @@
+/*
+ * GdbMemoryCache.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#include <string.h>
+
+#include "GdbMemoryCache.h"
+#include "UsbdmSystem.h"
+
+GdbMemoryCache::GdbMemoryCache(BdmInterfacePtr bdmInterface, DeviceDataPtr const &deviceData) :
+   bdmInterface(bdmInterface),
+   deviceData(deviceData),
+   enabled(true),
+   hits(0),
+   misses(0),
+   bypasses(0) {
+}
+
+GdbMemoryCache::~GdbMemoryCache() {
+}
+
+/**
+ * Determine how a line may be cached from the device memory map
+ *
+ * @param lineAddress - Address of start of line
+ *
+ * @return Line type, uncachedLine if the line is not entirely within a single cacheable region
+ */
+GdbMemoryCache::LineType GdbMemoryCache::getLineType(uint32_t lineAddress) {
+   if (!deviceData) {
+      return uncachedLine;
+   }
+   MemoryRegionConstPtr memoryRegion = deviceData->getMemoryRegionFor(lineAddress);
+   if (!memoryRegion) {
+      // Unknown memory - may be peripheral
+      return uncachedLine;
+   }
+   uint32_t lastAddress;
+   if (!memoryRegion->findLastContiguous(lineAddress, &lastAddress) || (lastAddress < (lineAddress+LineSize-1))) {
+      return uncachedLine;
+   }
+   switch (memoryRegion->getMemoryType()) {
+   case MemFLASH:
+   case MemPFlash:
+   case MemDFlash:
+   case MemFlexNVM:
+   case MemROM:
+      return persistentLine;
+   case MemRAM:
+   case MemEEPROM:
+   case MemFlexRAM:
+      return volatileLine;
+   default:
+      return uncachedLine;
+   }
+}
+
+/**
+ * Read target memory using cache where possible
+ *
+ * @param memorySpace - Memory space and access size to use if cache is bypassed
+ * @param numBytes    - Number of bytes to read
+ * @param address     - Start address
+ * @param data        - Buffer for data
+ *
+ * @return error code
+ *
+ * @note The target must be halted
+ */
+USBDM_ErrorCode GdbMemoryCache::readMemory(unsigned memorySpace, uint32_t numBytes, uint32_t address, uint8_t *data) {
+   LOGGING_Q;
+
+   if (numBytes == 0) {
+      return BDM_RC_OK;
+   }
+   uint32_t firstLine = address&~(LineSize-1);
+   uint32_t lastLine  = (address+numBytes-1)&~(LineSize-1);
+
+   bool cacheable = enabled && (lastLine >= firstLine);
+   for (uint32_t lineAddress=firstLine; cacheable; lineAddress+=LineSize) {
+      if (getLineType(lineAddress) == uncachedLine) {
+         cacheable = false;
+      }
+      if (lineAddress == lastLine) {
+         break;
+      }
+   }
+   if (!cacheable) {
+      bypasses++;
+      return bdmInterface->readMemory(memorySpace, numBytes, address, data);
+   }
+   for (uint32_t lineAddress=firstLine; ; lineAddress+=LineSize) {
+      std::map<uint32_t, CacheLine>::iterator it = lines.find(lineAddress);
+      if (it == lines.end()) {
+         CacheLine line;
+         USBDM_ErrorCode rc = bdmInterface->readMemory(MS_Long, LineSize, lineAddress, line.data);
+         if (rc != BDM_RC_OK) {
+            log.print("Line read failed @0x%08X, rc=%s\n", lineAddress, bdmInterface->getErrorString(rc));
+            bypasses++;
+            return bdmInterface->readMemory(memorySpace, numBytes, address, data);
+         }
+         line.persistent = (getLineType(lineAddress) == persistentLine);
+         it = lines.insert(std::make_pair(lineAddress, line)).first;
+         misses++;
+      }
+      else {
+         hits++;
+      }
+      // Copy overlapping portion
+      uint32_t start = (address > lineAddress)?address:lineAddress;
+      uint32_t end   = address+numBytes-1;
+      if (end > (lineAddress+LineSize-1)) {
+         end = lineAddress+LineSize-1;
+      }
+      memcpy(data+(start-address), it->second.data+(start-lineAddress), end-start+1);
+      if (lineAddress == lastLine) {
+         break;
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Discard cached lines overlapping a range e.g. after a write
+ *
+ * @param address  - Start address
+ * @param numBytes - Number of bytes
+ */
+void GdbMemoryCache::invalidate(uint32_t address, uint32_t numBytes) {
+   if ((numBytes == 0) || lines.empty()) {
+      return;
+   }
+   std::map<uint32_t, CacheLine>::iterator first = lines.lower_bound(address&~(LineSize-1));
+   std::map<uint32_t, CacheLine>::iterator last  = lines.upper_bound((address+numBytes-1)&~(LineSize-1));
+   lines.erase(first, last);
+}
+
+/**
+ * Discard lines for memory that may be changed by the target e.g. before the target is resumed
+ */
+void GdbMemoryCache::invalidateVolatile() {
+   std::map<uint32_t, CacheLine>::iterator it = lines.begin();
+   while (it != lines.end()) {
+      if (it->second.persistent) {
+         ++it;
+      }
+      else {
+         lines.erase(it++);
+      }
+   }
+}
+
+/**
+ * Discard all lines e.g. after reset or programming
+ */
+void GdbMemoryCache::invalidateAll() {
+   lines.clear();
+}
+
+/**
+ * Enable/disable cache
+ *
+ * @param enable - true/false to enable/disable
+ */
+void GdbMemoryCache::setEnabled(bool enable) {
+   enabled = enable;
+   invalidateAll();
+}
+
+/**
+ * Log cache statistics
+ */
+void GdbMemoryCache::reportStatistics() {
+   LOGGING_Q;
+   log.print("Memory cache: %lu lines, hits=%u, misses=%u, bypassed=%u\n",
+         (unsigned long)lines.size(), hits, misses, bypasses);
+}
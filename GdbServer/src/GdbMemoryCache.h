@@ -0,0 +1,62 @@
+/*
+ * GdbMemoryCache.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#ifndef SRC_GDBMEMORYCACHE_H_
+#define SRC_GDBMEMORYCACHE_H_
+
+#include <stdint.h>
+#include <map>
+
+#include "USBDM_API.h"
+#include "BdmInterface.h"
+#include "DeviceData.h"
+
+/**
+ * Cache of target memory used while the target is halted
+ *
+ * Lines are classified using the device memory map:
+ *   - FLASH/ROM lines are kept for the session (until invalidateAll())
+ *   - RAM/EEPROM lines are kept until the target is resumed (invalidateVolatile())
+ *   - I/O and unmapped memory are never cached so reads have no side effects
+ *
+ * Any write through invalidate() discards the affected lines.
+ */
+class GdbMemoryCache {
+public:
+   static const unsigned LineSize = 64;   //!< Size of cache line (bytes, power of 2)
+
+   GdbMemoryCache(BdmInterfacePtr bdmInterface, DeviceDataPtr const &deviceData);
+   virtual ~GdbMemoryCache();
+
+   USBDM_ErrorCode   readMemory(unsigned memorySpace, uint32_t numBytes, uint32_t address, uint8_t *data);
+   void              invalidate(uint32_t address, uint32_t numBytes);
+   void              invalidateVolatile();
+   void              invalidateAll();
+   void              setEnabled(bool enable);
+   bool              isEnabled() const { return enabled; }
+   void              reportStatistics();
+
+private:
+   enum LineType {uncachedLine, volatileLine, persistentLine};
+
+   struct CacheLine {
+      bool     persistent;       //!< Line is retained when the target is resumed
+      uint8_t  data[LineSize];   //!< Cached memory contents
+   };
+
+   BdmInterfacePtr         bdmInterface;
+   DeviceDataPtr const    &deviceData;
+   std::map<uint32_t, CacheLine>   lines;     //!< Cached lines indexed by line address
+   bool                    enabled;
+   unsigned                hits;
+   unsigned                misses;
+   unsigned                bypasses;
+
+   LineType          getLineType(uint32_t lineAddress);
+};
+
+#endif /* SRC_GDBMEMORYCACHE_H_ */
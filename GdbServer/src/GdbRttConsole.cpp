@@ -0,0 +1,315 @@
+/*
+ * GdbRttConsole.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "GdbRttConsole.h"
+#include "UsbdmSystem.h"
+
+const char *const GdbRttConsole::SymbolName = "_SEGGER_RTT";
+
+//! ID at start of control block (including terminator)
+static const char controlBlockId[] = "SEGGER RTT";
+
+/**
+ * Get 32-bit little-endian value from buffer
+ */
+static uint32_t getLE32(const uint8_t *buff) {
+   return buff[0]|(buff[1]<<8)|(buff[2]<<16)|(buff[3]<<24);
+}
+
+GdbRttConsole::GdbRttConsole(BdmInterfacePtr bdmInterface, DeviceDataPtr const &deviceData, IGdbTty *tty) :
+   bdmInterface(bdmInterface),
+   deviceData(deviceData),
+   tty(tty),
+   enabled(false),
+   located(false),
+   addressKnown(false),
+   controlBlockAddress(0),
+   pollsUntilScan(0),
+   upBuffer(),
+   downBuffer(),
+   haveDownBuffer(false) {
+}
+
+GdbRttConsole::~GdbRttConsole() {
+}
+
+/**
+ * Enable/disable draining of the console
+ *
+ * @param enable - true to enable
+ */
+void GdbRttConsole::setEnabled(bool enable) {
+   enabled = enable;
+}
+
+/**
+ * Set known address of control block (e.g. from symbol)
+ *
+ * @param address - Address of control block
+ */
+void GdbRttConsole::setControlBlockAddress(uint32_t address) {
+   LOGGING_Q;
+   log.print("Control block @0x%08X\n", address);
+   controlBlockAddress = address;
+   addressKnown        = true;
+   located             = false;
+}
+
+/**
+ * Discard control block location and scan RAM for it again
+ */
+void GdbRttConsole::restartScan() {
+   addressKnown   = false;
+   located        = false;
+   pollsUntilScan = 0;
+}
+
+/**
+ * Read buffer descriptor and check it is sensible
+ *
+ * @param descAddress - Address of descriptor
+ * @param buffer      - Buffer information
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbRttConsole::readBufferDesc(uint32_t descAddress, Buffer &buffer) {
+   uint8_t desc[DescSize];
+   USBDM_ErrorCode rc = bdmInterface->readMemory(MS_Long, sizeof(desc), descAddress, desc);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   buffer.descAddress = descAddress;
+   buffer.pBuffer     = getLE32(desc+4);
+   buffer.size        = getLE32(desc+8);
+   if ((buffer.size == 0) || (buffer.size > MaxBufferSize)) {
+      return BDM_RC_FAIL;
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Check for valid control block at address
+ *
+ * @param address - Address to check
+ *
+ * @return true if located
+ */
+bool GdbRttConsole::checkControlBlock(uint32_t address) {
+   LOGGING_Q;
+   uint8_t header[HeaderSize];
+   if (bdmInterface->readMemory(MS_Long, sizeof(header), address, header) != BDM_RC_OK) {
+      return false;
+   }
+   if (memcmp(header, controlBlockId, sizeof(controlBlockId)) != 0) {
+      return false;
+   }
+   uint32_t numUp   = getLE32(header+IdSize);
+   uint32_t numDown = getLE32(header+IdSize+4);
+   if ((numUp < 1) || (numUp > 16) || (numDown > 16)) {
+      return false;
+   }
+   if (readBufferDesc(address+HeaderSize, upBuffer) != BDM_RC_OK) {
+      return false;
+   }
+   haveDownBuffer = (numDown > 0) &&
+         (readBufferDesc(address+HeaderSize+numUp*DescSize, downBuffer) == BDM_RC_OK);
+   controlBlockAddress = address;
+   located             = true;
+   log.print("Located @0x%08X, up buffer [0x%08X,%d], %s\n",
+         address, upBuffer.pBuffer, upBuffer.size, haveDownBuffer?"down buffer":"no down buffer");
+   return true;
+}
+
+/**
+ * Scan device RAM for control block
+ *
+ * @return true if located
+ */
+bool GdbRttConsole::scanForControlBlock() {
+   LOGGING_Q;
+   if (!deviceData) {
+      return false;
+   }
+   std::vector<uint8_t> scanBuffer(ScanBlockSize);
+   for (int memIndex=0; true; memIndex++) {
+      MemoryRegionPtr memoryRegion(deviceData->getMemoryRegion(memIndex));
+      if (!memoryRegion) {
+         break;
+      }
+      if (memoryRegion->getMemoryType() != MemRAM) {
+         continue;
+      }
+      for (unsigned memRange=0; memRange<memoryRegion->memoryRanges.size(); memRange++) {
+         const MemoryRegion::MemoryRange *memoryRange = memoryRegion->getMemoryRange(memRange);
+         if (memoryRange == NULL) {
+            break;
+         }
+         uint32_t address = memoryRange->start;
+         while (address+sizeof(controlBlockId) <= memoryRange->end+1) {
+            uint32_t size = std::min((uint32_t)ScanBlockSize, memoryRange->end-address+1);
+            if (bdmInterface->readMemory(MS_Long, size, address, &scanBuffer[0]) != BDM_RC_OK) {
+               return false;
+            }
+            // Control block is word aligned
+            for (uint32_t offset=0; offset+sizeof(controlBlockId)<=size; offset+=4) {
+               if ((memcmp(&scanBuffer[offset], controlBlockId, sizeof(controlBlockId)) == 0) &&
+                   checkControlBlock(address+offset)) {
+                  return true;
+               }
+            }
+            if (size < ScanBlockSize) {
+               break;
+            }
+            // Overlap blocks so an ID straddling blocks is found
+            address += size-IdSize;
+         }
+      }
+   }
+   log.print("Not found\n");
+   return false;
+}
+
+/**
+ * Read write and read offsets of buffer
+ *
+ * @param buffer - Buffer to examine
+ * @param wrOff  - Write offset
+ * @param rdOff  - Read offset
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbRttConsole::readOffsets(const Buffer &buffer, uint32_t &wrOff, uint32_t &rdOff) {
+   uint8_t offsets[8];
+   USBDM_ErrorCode rc = bdmInterface->readMemory(MS_Long, sizeof(offsets), buffer.descAddress+12, offsets);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   wrOff = getLE32(offsets);
+   rdOff = getLE32(offsets+4);
+   if ((wrOff >= buffer.size) || (rdOff >= buffer.size)) {
+      // Control block has been overwritten or re-initialised
+      located = false;
+      return BDM_RC_FAIL;
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Write 32-bit offset to target
+ *
+ * @param address - Address to write
+ * @param value   - Value to write
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbRttConsole::writeOffset(uint32_t address, uint32_t value) {
+   uint8_t buff[4] = {(uint8_t)value, (uint8_t)(value>>8), (uint8_t)(value>>16), (uint8_t)(value>>24)};
+   return bdmInterface->writeMemory(MS_Long, sizeof(buff), address, buff);
+}
+
+/**
+ * Drain up buffer #0 to the TTY
+ * Locates the control block first if necessary
+ *
+ * @param bytesTransferred - Number of bytes removed from the target buffer
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbRttConsole::poll(unsigned &bytesTransferred) {
+   LOGGING_Q;
+
+   bytesTransferred = 0;
+   if (!enabled) {
+      return BDM_RC_OK;
+   }
+   if (!located) {
+      if (pollsUntilScan > 0) {
+         pollsUntilScan--;
+         return BDM_RC_OK;
+      }
+      pollsUntilScan = ScanInterval;
+      if (addressKnown) {
+         if (!checkControlBlock(controlBlockAddress)) {
+            return BDM_RC_OK;
+         }
+      }
+      else if (!scanForControlBlock()) {
+         return BDM_RC_OK;
+      }
+   }
+   uint32_t wrOff, rdOff;
+   USBDM_ErrorCode rc = readOffsets(upBuffer, wrOff, rdOff);
+   if ((rc != BDM_RC_OK) || (wrOff == rdOff)) {
+      return rc;
+   }
+   // Data may wrap around end of buffer - read both pieces in one transaction
+   uint32_t count1 = (wrOff > rdOff)?(wrOff-rdOff):(upBuffer.size-rdOff);
+   uint32_t count2 = (wrOff > rdOff)?0:wrOff;
+   dataBuffer.resize(count1+count2+1);
+   USBDM_MemoryRequest requests[] = {
+      {MS_Byte, count1, upBuffer.pBuffer+rdOff, &dataBuffer[0]},
+      {MS_Byte, count2, upBuffer.pBuffer,       &dataBuffer[count1]},
+   };
+   rc = bdmInterface->readMemoryV((count2>0)?2:1, requests);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   // Release space in target buffer
+   rc = writeOffset(upBuffer.descAddress+16, wrOff);
+   bytesTransferred = count1+count2;
+
+   // TTY is string based
+   dataBuffer.resize(bytesTransferred);
+   dataBuffer.erase(std::remove(dataBuffer.begin(), dataBuffer.end(), 0), dataBuffer.end());
+   dataBuffer.push_back(0);
+   tty->puts((char *)&dataBuffer[0]);
+   log.print("%d bytes\n", bytesTransferred);
+   return rc;
+}
+
+/**
+ * Write data to down buffer #0
+ *
+ * @param data   - Data to write
+ * @param length - Number of bytes
+ *
+ * @return error code
+ *
+ * @note Data that doesn't fit in the target buffer is discarded
+ */
+USBDM_ErrorCode GdbRttConsole::write(const char *data, unsigned length) {
+   LOGGING_Q;
+   if (!located || !haveDownBuffer) {
+      return BDM_RC_FAIL;
+   }
+   uint32_t wrOff, rdOff;
+   USBDM_ErrorCode rc = readOffsets(downBuffer, wrOff, rdOff);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   // One location is always left empty
+   uint32_t space = (rdOff+downBuffer.size-wrOff-1) % downBuffer.size;
+   length = std::min(length, space);
+   if (length == 0) {
+      return BDM_RC_OK;
+   }
+   uint32_t count1 = std::min(length, downBuffer.size-wrOff);
+   uint32_t count2 = length-count1;
+   USBDM_MemoryRequest requests[] = {
+      {MS_Byte, count1, downBuffer.pBuffer+wrOff, (uint8_t *)data},
+      {MS_Byte, count2, downBuffer.pBuffer,       (uint8_t *)data+count1},
+   };
+   rc = bdmInterface->writeMemoryV((count2>0)?2:1, requests);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   log.print("%d bytes\n", length);
+   return writeOffset(downBuffer.descAddress+12, (wrOff+length)%downBuffer.size);
+}
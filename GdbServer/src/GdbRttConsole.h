@@ -0,0 +1,87 @@
+/*
+ * GdbRttConsole.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#ifndef SRC_GDBRTTCONSOLE_H_
+#define SRC_GDBRTTCONSOLE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "USBDM_API.h"
+#include "BdmInterface.h"
+#include "DeviceData.h"
+#include "IGdbTty.h"
+
+/**
+ * Host side of a memory-polled ring-buffer console (SEGGER RTT compatible layout)
+ *
+ * The target keeps a control block in RAM:
+ *   - char     acID[16]            "SEGGER RTT"
+ *   - int32_t  maxNumUpBuffers
+ *   - int32_t  maxNumDownBuffers
+ *   - buffer   up[maxNumUpBuffers]     (target -> host)
+ *   - buffer   down[maxNumDownBuffers] (host -> target)
+ *
+ * Each buffer descriptor is {name, pBuffer, sizeOfBuffer, wrOff, rdOff, flags}.
+ *
+ * The console is enabled when GDB provides the control block symbol address (qSymbol)
+ * or by monitor command.  Without an address the device RAM regions are scanned.  Up buffer #0 is drained using bulk memory
+ * reads while the target runs and the data is passed to the TTY.
+ *
+ * @note Assumes a little-endian target that allows memory access while running (ARM)
+ */
+class GdbRttConsole {
+public:
+   static const char *const SymbolName;         //!< Symbol naming the control block
+
+   GdbRttConsole(BdmInterfacePtr bdmInterface, DeviceDataPtr const &deviceData, IGdbTty *tty);
+   virtual ~GdbRttConsole();
+
+   USBDM_ErrorCode   poll(unsigned &bytesTransferred);
+   USBDM_ErrorCode   write(const char *data, unsigned length);
+   void              setControlBlockAddress(uint32_t address);
+   void              setEnabled(bool enable);
+   void              restartScan();
+   bool              isEnabled() const { return enabled; }
+   bool              isLocated() const { return located; }
+   uint32_t          getControlBlockAddress() const { return controlBlockAddress; }
+
+private:
+   static const unsigned IdSize         = 16;     //!< Size of ID field at start of control block
+   static const unsigned HeaderSize     = 24;     //!< ID + buffer counts
+   static const unsigned DescSize       = 24;     //!< Size of buffer descriptor
+   static const unsigned ScanBlockSize  = 4096;   //!< Size of blocks read when scanning RAM
+   static const unsigned ScanInterval   = 20;     //!< Number of polls between scans for control block
+   static const unsigned MaxBufferSize  = 0x10000;//!< Sanity limit on buffer size
+
+   struct Buffer {
+      uint32_t descAddress;   //!< Address of buffer descriptor
+      uint32_t pBuffer;       //!< Address of data
+      uint32_t size;          //!< Size of data area
+   };
+
+   BdmInterfacePtr         bdmInterface;
+   DeviceDataPtr const    &deviceData;
+   IGdbTty                *tty;
+   bool                    enabled;
+   bool                    located;
+   bool                    addressKnown;        //!< Control block address given rather than scanned for
+   uint32_t                controlBlockAddress;
+   unsigned                pollsUntilScan;
+   Buffer                  upBuffer;
+   Buffer                  downBuffer;
+   bool                    haveDownBuffer;
+   std::vector<uint8_t>    dataBuffer;
+
+   bool              checkControlBlock(uint32_t address);
+   bool              scanForControlBlock();
+   USBDM_ErrorCode   readBufferDesc(uint32_t descAddress, Buffer &buffer);
+   USBDM_ErrorCode   readOffsets(const Buffer &buffer, uint32_t &wrOff, uint32_t &rdOff);
+   USBDM_ErrorCode   writeOffset(uint32_t address, uint32_t value);
+};
+
+#endif /* SRC_GDBRTTCONSOLE_H_ */
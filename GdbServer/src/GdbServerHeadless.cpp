@@ -0,0 +1,1001 @@
+/*! \file
+    \brief Headless GDB Server (no wxWidgets)
+
+    GdbServerHeadless.cpp
+
+    \verbatim
+    USBDM
+    Copyright (C) 2009  Peter O'Donoghue
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+    \endverbatim
+
+    \verbatim
+   Change History
+   -=========================================================================================
+   | 17 Oct 2026 | Reduced fast poll interval to 20 ms                     - pgo V4.12.1
+   | 17 Oct 2026 | Adaptive polling while target is running                - pgo V4.12.1
+   | 17 Oct 2026 | Added multi-target mode (-bind)                         - pgo V4.12.1
+   | 17 Oct 2026 | Created - event driven server using poll()              - pgo V4.12.1
+   +=========================================================================================
+   \endverbatim
+*/
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#define poll         WSAPoll
+#define SOCKET_ERRNO WSAGetLastError()
+#define INTERRUPTED  WSAEINTR
+typedef int socklen_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#define SOCKET_ERRNO errno
+#define INTERRUPTED  EINTR
+#endif
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "UsbdmSystem.h"
+#include "Common.h"
+#include "DeviceData.h"
+#include "BdmInterfaceFactory.h"
+#include "DeviceInterface.h"
+#include "GdbInOutSocket.h"
+#include "GdbHandler.h"
+#include "GdbHandlerFactory.h"
+#include "StdioTty.h"
+
+using namespace std;
+
+class OpenLog {
+public:
+   OpenLog() {
+      UsbdmSystem::Log::openLogFile("GDBServerHeadless.log", "GDB Server (headless)");
+      UsbdmSystem::Log::setLoggingLevel(100);
+   }
+   ~OpenLog() {
+      UsbdmSystem::Log::closeLogFile();
+   }
+};
+
+//! Set by signal handler to request shutdown
+static volatile sig_atomic_t quitRequested = 0;
+
+static void signalHandler(int) {
+   quitRequested = 1;
+}
+
+/**
+ * Get monotonic time
+ *
+ * @return Time in milliseconds from an arbitrary origin
+ */
+static int64_t getTimeNow() {
+#ifdef _WIN32
+   return (int64_t)GetTickCount64();
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (int64_t)now.tv_sec*1000 + now.tv_nsec/1000000;
+#endif
+}
+
+/**
+ * GDB server without GUI
+ *
+ * A single poll() loop services the listening socket and the GDB connection.
+ * The loop wakes immediately when GDB sends data and otherwise sleeps until the
+ * next target poll is due. The target is polled quickly while running and slowly
+ * while halted (same schedule as the GUI server).
+ *
+ * In multi-target mode each server runs on its own thread using the per-thread
+ * BDM sessions.
+ */
+class GdbServerHeadless {
+
+private:
+   static thread_local GdbServerHeadless *me;   //!< Used by message callback (one server per thread)
+   static pthread_mutex_t        bdmOpenMutex;  //!< Serialises opening of BDMs
+
+   BdmInterfacePtr               bdmInterface;
+   DeviceInterfacePtr            deviceInterface;
+
+   SocketHandle                  serverSocket;
+   SocketHandle                  clientSocket;
+
+   GdbInOutSocket               *gdbInOut;
+   GdbHandlerPtr                 gdbHandler;
+   IGdbTty                      *tty;
+
+   GdbHandler::GdbMessageLevel   loggingLevel;
+   GdbHandler::GdbTargetStatus   targetStatus;
+
+   bool                          deferredFail;
+   bool                          deferredOpen;
+   bool                          exitRequested;
+
+   int64_t                       nextPollTime;   //!< Time of next target poll (ms)
+   int                           runPollInterval;//!< Current poll interval while running (ms)
+   string                        messagePrefix;  //!< Prefix for console messages (identifies target)
+
+   // Target polling stays on the server thread as BDM sessions belong to the thread that
+   // opened them.  Halt latency while running is therefore bounded by pollIntervalFast.
+   static const int              pollIntervalVeryFast = 1;    // ms
+   static const int              pollIntervalFast     = 20;   // ms
+   static const int              pollIntervalSlow     = 1000; // ms
+
+   static USBDM_ErrorCode callback(const char *msg, GdbHandler::GdbMessageLevel level, USBDM_ErrorCode rc);
+
+   USBDM_ErrorCode   reportError(const char *msg, GdbHandler::GdbMessageLevel level, USBDM_ErrorCode rc);
+   void              printMessage(const char *format, ...);
+   void              acceptConnection();
+   void              dropConnection();
+   void              processInput();
+   void              pollTarget();
+
+public:
+   GdbServerHeadless(BdmInterfacePtr bdmInterface, DeviceInterfacePtr deviceInterface, GdbHandler::GdbMessageLevel loggingLevel, string messagePrefix="");
+   ~GdbServerHeadless();
+
+   USBDM_ErrorCode   createServer();
+   USBDM_ErrorCode   run();
+};
+
+thread_local GdbServerHeadless *GdbServerHeadless::me = NULL;
+
+pthread_mutex_t GdbServerHeadless::bdmOpenMutex = PTHREAD_MUTEX_INITIALIZER;
+
+GdbServerHeadless::GdbServerHeadless(BdmInterfacePtr bdmInterface, DeviceInterfacePtr deviceInterface, GdbHandler::GdbMessageLevel loggingLevel, string messagePrefix) :
+   bdmInterface(bdmInterface),
+   deviceInterface(deviceInterface),
+   serverSocket(INVALID_SOCKET),
+   clientSocket(INVALID_SOCKET),
+   gdbInOut(NULL),
+   tty(new StdioTty()),
+   loggingLevel(loggingLevel),
+   targetStatus(GdbHandler::T_UNKNOWN),
+   deferredFail(false),
+   deferredOpen(false),
+   exitRequested(false),
+   nextPollTime(0),
+   runPollInterval(pollIntervalVeryFast),
+   messagePrefix(messagePrefix) {
+   me = this;
+}
+
+GdbServerHeadless::~GdbServerHeadless() {
+   dropConnection();
+   GdbInOutSocket::closeSocket(serverSocket);
+   serverSocket = INVALID_SOCKET;
+   delete tty;
+   me = NULL;
+}
+
+/**
+ *  Call back to display messages from GDB handler
+ *
+ *   @param msg   Message to display
+ *   @param level Level
+ *   @param rc    Error code
+ *
+ *   @return      Modified error code
+ */
+USBDM_ErrorCode GdbServerHeadless::callback(const char *msg, GdbHandler::GdbMessageLevel level, USBDM_ErrorCode rc) {
+   return me->reportError(msg, level, rc);
+}
+
+/**
+ *  Print message to console (prefixed to identify target)
+ *
+ *   @param format Format string (printf style)
+ */
+void GdbServerHeadless::printMessage(const char *format, ...) {
+   char    buff[1000];
+   va_list list;
+   va_start(list, format);
+   vsnprintf(buff, sizeof(buff), format, list);
+   va_end(list);
+   // Single write so messages from different targets don't interleave
+   fprintf(stderr, "%s%s", messagePrefix.c_str(), buff);
+}
+
+/**
+ *  Report error message
+ *
+ *   @param msg   Message to display
+ *   @param level Level
+ *   @param rc    Error code
+ */
+USBDM_ErrorCode GdbServerHeadless::reportError(const char *msg, GdbHandler::GdbMessageLevel level, USBDM_ErrorCode rc) {
+   GdbHandler::GdbMessageLevel baseLevel = (GdbHandler::GdbMessageLevel)(level&~GdbHandler::M_DIALOGUE);
+
+   if ((rc != BDM_RC_OK) || (baseLevel >= loggingLevel) || (level&GdbHandler::M_DIALOGUE)) {
+      printMessage("%s", msg);
+      if (baseLevel == GdbHandler::M_FATAL) {
+         deferredFail = true;
+      }
+   }
+   if (rc != BDM_RC_OK) {
+      printMessage("%s\n", bdmInterface->getErrorString(rc));
+   }
+   return rc;
+}
+
+/**
+ *  Create server listening on socket (localhost only)
+ *
+ *  @return error code
+ */
+USBDM_ErrorCode GdbServerHeadless::createServer() {
+   LOGGING_E;
+
+   int port = bdmInterface->getGdbServerPort();
+
+   serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+   if (serverSocket == INVALID_SOCKET) {
+      printMessage("ERROR: Could not create server socket\n");
+      return BDM_RC_FAIL;
+   }
+   int reuse = 1;
+   setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+
+   struct sockaddr_in listenAddr;
+   memset(&listenAddr, 0, sizeof(listenAddr));
+   listenAddr.sin_family      = AF_INET;
+   listenAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   listenAddr.sin_port        = htons(port);
+
+   if ((bind(serverSocket, (struct sockaddr *)&listenAddr, sizeof(listenAddr)) != 0) ||
+       (listen(serverSocket, 1) != 0) ||
+       !GdbInOutSocket::setNonBlocking(serverSocket)) {
+      printMessage("ERROR: Could not create server at the specified port (%d)!\n", port);
+      GdbInOutSocket::closeSocket(serverSocket);
+      serverSocket = INVALID_SOCKET;
+      return BDM_RC_FAIL;
+   }
+   string bdmSerialNumber = bdmInterface->getBdmSerialNumber();
+   if (bdmSerialNumber.length() > 0) {
+      printMessage("Using %s USBDM interface S/N = \'%s\'\n",
+            bdmInterface->getBdmMatchRequired()?"required":"preferred", bdmSerialNumber.c_str());
+   }
+   else {
+      printMessage("Using any suitable USBDM interface\n");
+   }
+   printMessage("Server created @localhost:%d\n", port);
+   log.print("Server created @localhost:%d\n", port);
+   return BDM_RC_OK;
+}
+
+/**
+ *  Accept pending connection on server socket
+ *
+ *  - A second connection is rejected while a client is connected
+ */
+void GdbServerHeadless::acceptConnection() {
+   LOGGING;
+
+   struct sockaddr_in peerAddr;
+   socklen_t          peerAddrLength = sizeof(peerAddr);
+
+   SocketHandle newSocket = accept(serverSocket, (struct sockaddr *)&peerAddr, &peerAddrLength);
+   if (newSocket == INVALID_SOCKET) {
+      log.print("accept() failed\n");
+      return;
+   }
+   if (clientSocket != INVALID_SOCKET) {
+      printMessage("Client connection while busy - rejected\n");
+      GdbInOutSocket::closeSocket(newSocket);
+      return;
+   }
+   if (!GdbInOutSocket::setNonBlocking(newSocket)) {
+      printMessage("Error: couldn't accept a new connection\n");
+      GdbInOutSocket::closeSocket(newSocket);
+      return;
+   }
+   clientSocket = newSocket;
+
+   printMessage(
+         "\n=====================================\n"
+         "New client connection from %s:%u accepted\n",
+         inet_ntoa(peerAddr.sin_addr), ntohs(peerAddr.sin_port));
+
+   deferredFail = false;
+   deferredOpen = true;
+
+   // Open is deferred until GDB sends something
+   nextPollTime = getTimeNow() + pollIntervalSlow;
+}
+
+/**
+ *  Drop client connection and clean up
+ */
+void GdbServerHeadless::dropConnection() {
+   LOGGING;
+   if (gdbInOut != NULL) {
+      gdbInOut->finish();
+      delete gdbInOut;
+      gdbInOut = NULL;
+   }
+   if (gdbHandler != 0) {
+      gdbHandler.reset();
+   }
+   bdmInterface->closeBdm();
+   if (clientSocket != INVALID_SOCKET) {
+      GdbInOutSocket::closeSocket(clientSocket);
+      clientSocket = INVALID_SOCKET;
+      printMessage(
+            "\n=====================\n"
+            "Dropped connection\n");
+      if (!deferredOpen && bdmInterface->isExitOnClose()) {
+         printMessage("Closing\n\n");
+         exitRequested = true;
+      }
+   }
+   targetStatus = GdbHandler::T_UNKNOWN;
+}
+
+/**
+ *  Process data available on client socket
+ *
+ *  - Opens the BDM on first data from GDB
+ *  - Processes all complete packets
+ */
+void GdbServerHeadless::processInput() {
+   LOGGING_Q;
+
+   if (deferredOpen) {
+      log.print("Deferred Open\n");
+
+      // Open on first access after socket creation
+      deferredOpen = false;
+
+      // Opening a BDM briefly opens every BDM to read its serial number
+      pthread_mutex_lock(&bdmOpenMutex);
+      USBDM_ErrorCode rc = bdmInterface->initBdm();
+      pthread_mutex_unlock(&bdmOpenMutex);
+      if (rc != BDM_RC_OK) {
+         reportError("BDM Open failed, reason: ", GdbHandler::M_FATAL, rc);
+         log.error("BDM Open failed\n");
+         dropConnection();
+         return;
+      }
+      gdbInOut = new GdbInOutSocket(clientSocket);
+
+      gdbHandler = GdbHandlerFactory::createGdbHandler(
+            bdmInterface->getBdmOptions().targetType,
+            gdbInOut,
+            bdmInterface,
+            deviceInterface,
+            callback,
+            tty);
+
+      rc = gdbHandler->initialise();
+      if (rc != BDM_RC_OK) {
+         // Try again after Reset
+         bdmInterface->reset();
+         rc = gdbHandler->initialise();
+      }
+      if (rc != BDM_RC_OK) {
+         reportError("GDB Handler initialisation failed, reason: ", GdbHandler::M_FATAL, rc);
+         log.error("GDB Handler initialisation failed\n");
+         dropConnection();
+         return;
+      }
+      printMessage("BDM Open OK\n");
+   }
+   const GdbPacket *packet;
+   USBDM_ErrorCode rc = BDM_RC_OK;
+   do {
+      // Process packets from GDB until idle
+      packet = gdbInOut->getGdbPacket();
+      if (packet != NULL) {
+         rc = gdbHandler->doCommand(packet);
+         if (rc != BDM_RC_OK) {
+            printMessage("%s\n", bdmInterface->getErrorString(rc));
+         }
+      }
+   } while ((packet != NULL) && (rc == BDM_RC_OK) && !deferredFail && !quitRequested);
+
+   if (deferredFail) {
+      // A fatal error was reported - drop connection
+      log.error("DeferredFail\n");
+      dropConnection();
+   }
+   else if (gdbInOut->isEOF()) {
+      log.print("Connection lost\n");
+      dropConnection();
+   }
+   else {
+      // Poll target immediately (also adjusts polling rate)
+      // Restart fast polling as the target may have just been started
+      runPollInterval = pollIntervalVeryFast;
+      pollTarget();
+   }
+}
+
+/**
+ * Poll target to check run status and schedule next poll
+ */
+void GdbServerHeadless::pollTarget() {
+   LOGGING;
+
+   if ((gdbHandler == 0) || deferredOpen || deferredFail) {
+      // Don't poll before opening target or shutting down
+      return;
+   }
+   GdbHandler::GdbTargetStatus lastTargetStatus = targetStatus;
+
+   targetStatus = gdbHandler->pollTarget();
+   log.print("Status = %s\n", GdbHandler::getStatusName(targetStatus));
+
+   int pollInterval = pollIntervalFast;
+   switch (targetStatus) {
+      case GdbHandler::T_HALT:
+      case GdbHandler::T_RESET:
+      case GdbHandler::T_USER_INPUT:
+         pollInterval = pollIntervalSlow;
+         break;
+      case GdbHandler::T_RUNNING:
+      case GdbHandler::T_WAIT:
+      case GdbHandler::T_STOP:
+      case GdbHandler::T_VLPR:
+      case GdbHandler::T_VLPW:
+      case GdbHandler::T_VLPS:
+         // Adaptive - poll very quickly just after starting and back off to the normal rate
+         // This catches short runs (step over, run to breakpoint) with little latency
+         pollInterval    = runPollInterval;
+         runPollInterval = std::min(2*runPollInterval, (int)pollIntervalFast);
+         break;
+      default:
+         break;
+   }
+   if ((targetStatus != lastTargetStatus) && (GdbHandler::M_INFO >= loggingLevel)) {
+      printMessage("Target status: %s\n", GdbHandler::getStatusName(targetStatus));
+   }
+   nextPollTime = getTimeNow() + pollInterval;
+}
+
+/**
+ * Server event loop
+ *
+ * @return error code
+ */
+USBDM_ErrorCode GdbServerHeadless::run() {
+   LOGGING;
+
+   while (!quitRequested && !exitRequested) {
+      struct pollfd fds[2];
+      int           numFds = 0;
+
+      fds[numFds].fd      = serverSocket;
+      fds[numFds].events  = POLLIN;
+      fds[numFds].revents = 0;
+      numFds++;
+      if (clientSocket != INVALID_SOCKET) {
+         fds[numFds].fd      = clientSocket;
+         fds[numFds].events  = POLLIN;
+         fds[numFds].revents = 0;
+         numFds++;
+      }
+      // Sleep until data arrives or next target poll is due
+      // When idle still wake occasionally as a signal may be delivered to another thread
+      int timeout = pollIntervalSlow;
+      if (clientSocket != INVALID_SOCKET) {
+         int64_t delay = nextPollTime - getTimeNow();
+         timeout = (delay>0)?(int)delay:0;
+      }
+      int rc = poll(fds, numFds, timeout);
+      if (rc < 0) {
+         if (SOCKET_ERRNO == INTERRUPTED) {
+            continue;
+         }
+         log.error("poll() failed\n");
+         return BDM_RC_FAIL;
+      }
+      if ((numFds > 1) && (fds[1].revents & (POLLIN|POLLHUP|POLLERR))) {
+         processInput();
+      }
+      if (fds[0].revents & POLLIN) {
+         acceptConnection();
+      }
+      if ((gdbHandler != 0) && (getTimeNow() >= nextPollTime)) {
+         pollTarget();
+      }
+   }
+   dropConnection();
+   return BDM_RC_OK;
+}
+
+
+//=========================================================================================
+
+static void usage() {
+   fprintf(stderr,
+         "USBDM GDB Server (headless)\n\n"
+         "Usage: UsbdmGdbServerHeadless -device=<name> [options]\n"
+         "       UsbdmGdbServerHeadless -bind=<serial>,<device>,<port> [-bind=...] [options]\n"
+         "  -target=<cfv1|cfvx|arm>          Target type (default from program name)\n"
+         "  -device=<name>                   Target device e.g. MK20DX128M5\n"
+         "  -port=<n>                        Server port # to use for GDB e.g. 1234\n"
+         "  -bdm=<serial>                    Serial number of preferred BDM to use\n"
+         "  -requiredBdm=<serial>            Serial number of required BDM to use\n"
+         "  -bind=<serial>,<device>,<port>   Serve BDM <serial> with <device> on <port>\n"
+         "                                   (may be repeated - each target uses its own thread)\n"
+         "  -erase=<Mass|All|Selective|Vendor|None>\n"
+         "  -resetMethod=<Hardware|Software|Vendor>\n"
+         "  -vdd=<3V3|5V>                    Supply Vdd to target\n"
+         "  -speed=<kHz>                     Interface speed (CFVx/Kinetis/DSC)\n"
+         "  -timeout=<s>                     Connection timeout, 0 indicates indefinite\n"
+         "  -catchvlls                       Catch VLLSx resets\n"
+         "  -exitOnClose                     Exit Server when connection closed\n"
+         "  -maskInterrupts                  Mask interrupts when stepping\n"
+         "  -useReset                        Use hardware reset\n"
+         "  -verbose                         Report all GDB handler messages\n"
+         );
+}
+
+/**
+ * Find all occurrences of option of form -name=value
+ *
+ * @param argc    Argument count
+ * @param argv    Arguments
+ * @param name    Option name
+ *
+ * @return Values found (in order)
+ */
+static vector<string> findOptions(int argc, char *argv[], const char *name) {
+   vector<string> values;
+   size_t length = strlen(name);
+   for (int index=1; index<argc; index++) {
+      const char *arg = argv[index];
+      if ((*arg == '-') && (strncmp(arg+1, name, length) == 0) && (arg[length+1] == '=')) {
+         values.push_back(string(arg+length+2));
+      }
+   }
+   return values;
+}
+
+/**
+ * Find option of form -name or -name=value
+ *
+ * @param argc    Argument count
+ * @param argv    Arguments
+ * @param name    Option name
+ * @param value   Value found (if any)
+ *
+ * @return true if option is present
+ */
+static bool findOption(int argc, char *argv[], const char *name, string *value=NULL) {
+   size_t length = strlen(name);
+   for (int index=1; index<argc; index++) {
+      const char *arg = argv[index];
+      if ((*arg != '-') || (strncmp(arg+1, name, length) != 0)) {
+         continue;
+      }
+      char terminator = arg[length+1];
+      if (terminator == '\0') {
+         if (value != NULL) {
+            // Value required
+            return false;
+         }
+         return true;
+      }
+      if ((terminator == '=') && (value != NULL)) {
+         *value = string(arg+length+2);
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * Check all options are recognised
+ */
+static bool checkOptions(int argc, char *argv[]) {
+   static const char *const names[] = {
+         "target", "device", "port", "bdm", "requiredBdm", "bind", "erase", "resetMethod", "vdd",
+         "speed", "timeout", "catchvlls", "exitOnClose", "maskInterrupts", "useReset", "verbose",
+   };
+   for (int index=1; index<argc; index++) {
+      const char *arg = argv[index];
+      bool found = false;
+      for (unsigned nameIndex=0; nameIndex<sizeof(names)/sizeof(names[0]); nameIndex++) {
+         size_t length = strlen(names[nameIndex]);
+         if ((*arg == '-') && (strncmp(arg+1, names[nameIndex], length) == 0) &&
+             ((arg[length+1] == '\0') || (arg[length+1] == '='))) {
+            found = true;
+            break;
+         }
+      }
+      if (!found) {
+         fprintf(stderr, "***** Error: Unknown option \'%s\'\n", arg);
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool getUnsigned(const string &sValue, unsigned long &uValue) {
+   char *end;
+   uValue = strtoul(sValue.c_str(), &end, 10);
+   return (sValue.length() > 0) && (*end == '\0');
+}
+
+/**
+ * Determine target type from command line or program name
+ *
+ * @param targetType  Target type
+ *
+ * @return  error code
+ */
+static USBDM_ErrorCode getTargetType(int argc, char *argv[], TargetType_t &targetType) {
+   string sValue;
+
+   targetType = T_ARM;
+   if (findOption(argc, argv, "target", &sValue)) {
+      if (strcasecmp(sValue.c_str(), "cfv1") == 0) {
+         targetType = T_CFV1;
+      }
+      else if (strcasecmp(sValue.c_str(), "cfvx") == 0) {
+         targetType = T_CFVx;
+      }
+      else if (strcasecmp(sValue.c_str(), "arm") == 0) {
+         targetType = T_ARM;
+      }
+      else {
+         fprintf(stderr, "***** Error: Illegal target type.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
+   else {
+      // Determine target from name of program
+      if (strstr(argv[0], "CFV1") != NULL) {
+         targetType = T_CFV1;
+      }
+      else if (strstr(argv[0], "CFVX") != NULL) {
+         targetType = T_CFVx;
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Create interfaces for a target and apply command line options
+ *
+ * @param argc             Argument count
+ * @param argv             Arguments
+ * @param targetType       Target type
+ * @param deviceName       Device to select
+ * @param deviceDatabase   Device database to share (loaded if NULL)
+ * @param bdmInterface     BDM interface created
+ * @param deviceInterface  Device interface created
+ *
+ * @return  error code
+ */
+static USBDM_ErrorCode configureTarget(
+      int argc, char *argv[],
+      TargetType_t          targetType,
+      const string         &deviceName,
+      DeviceDataBasePtr     deviceDatabase,
+      BdmInterfacePtr      &bdmInterface,
+      DeviceInterfacePtr   &deviceInterface) {
+   LOGGING;
+   string        sValue;
+   unsigned long uValue;
+
+   bdmInterface = BdmInterfaceFactory::createInterface(targetType);
+   deviceInterface.reset(new DeviceInterface(targetType, deviceDatabase));
+
+   USBDM_ErrorCode rc = deviceInterface->setCurrentDeviceByName(deviceName);
+   if (rc != BDM_RC_OK) {
+      log.error("Failed to set device to \'%s\'\n", deviceName.c_str());
+      fprintf(stderr, "***** Error: Failed to find device \'%s\'.\n", deviceName.c_str());
+      return rc;
+   }
+   USBDM_ExtendedOptions_t &bdmOptions = bdmInterface->getBdmOptions();
+   DeviceDataPtr            deviceData = deviceInterface->getCurrentDevice();
+
+   // Disable clock trim
+   deviceData->setClockTrimFreq(0);
+   deviceData->setSecurity(SEC_DEFAULT);
+
+   bdmInterface->setMaskISR(findOption(argc, argv, "maskInterrupts"));
+   bdmInterface->setExitOnClose(findOption(argc, argv, "exitOnClose"));
+   bdmInterface->setCatchVLLSx(findOption(argc, argv, "catchvlls"));
+   bdmOptions.useResetSignal = findOption(argc, argv, "useReset");
+
+   if (findOption(argc, argv, "erase", &sValue)) {
+      if (strcasecmp(sValue.c_str(), "Mass") == 0) {
+         deviceData->setEraseMethod(DeviceData::eraseMass);
+      }
+      else if (strcasecmp(sValue.c_str(), "All") == 0) {
+         deviceData->setEraseMethod(DeviceData::eraseAll);
+      }
+      else if (strcasecmp(sValue.c_str(), "Selective") == 0) {
+         deviceData->setEraseMethod(DeviceData::eraseSelective);
+      }
+      else if (strcasecmp(sValue.c_str(), "Vendor") == 0) {
+         deviceData->setEraseMethod(DeviceData::eraseTargetDefault);
+      }
+      else if (strcasecmp(sValue.c_str(), "None") == 0) {
+         deviceData->setEraseMethod(DeviceData::eraseNone);
+      }
+      else {
+         fprintf(stderr, "***** Error: Illegal erase value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
+   if (findOption(argc, argv, "resetMethod", &sValue)) {
+      if (strcasecmp(sValue.c_str(), "Hardware") == 0) {
+         deviceData->setResetMethod(DeviceData::resetHardware);
+      }
+      else if (strcasecmp(sValue.c_str(), "Software") == 0) {
+         deviceData->setResetMethod(DeviceData::resetSoftware);
+      }
+      else if (strcasecmp(sValue.c_str(), "Vendor") == 0) {
+         deviceData->setResetMethod(DeviceData::resetVendor);
+      }
+      else {
+         fprintf(stderr, "***** Error: Illegal resetMethod value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
+   if (findOption(argc, argv, "vdd", &sValue)) {
+      if (strcasecmp(sValue.c_str(), "3V3") == 0) {
+         bdmOptions.targetVdd = BDM_TARGET_VDD_3V3;
+      }
+      else if (strcasecmp(sValue.c_str(), "5V") == 0) {
+         bdmOptions.targetVdd = BDM_TARGET_VDD_5V;
+      }
+      else {
+         fprintf(stderr, "***** Error: Illegal vdd value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
+   if (findOption(argc, argv, "bdm", &sValue)) {
+      bdmInterface->setBdmSerialNumber(sValue, false);
+   }
+   if (findOption(argc, argv, "requiredBdm", &sValue)) {
+      bdmInterface->setBdmSerialNumber(sValue, true);
+   }
+   if (findOption(argc, argv, "speed", &sValue)) {
+      if (!getUnsigned(sValue, uValue)) {
+         fprintf(stderr, "***** Error: Illegal speed value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      bdmOptions.interfaceFrequency = uValue;
+   }
+   if (findOption(argc, argv, "port", &sValue)) {
+      if (!getUnsigned(sValue, uValue)) {
+         fprintf(stderr, "***** Error: Illegal GDB port value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      bdmInterface->setGdbServerPort(uValue);
+   }
+   if (findOption(argc, argv, "timeout", &sValue)) {
+      if (!getUnsigned(sValue, uValue)) {
+         fprintf(stderr, "***** Error: Illegal timeout value.\n");
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      bdmInterface->setConnectionTimeout(uValue);
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Describes one (BDM, device, port) binding in multi-target mode
+ */
+struct TargetBinding {
+   string                        serialNumber;     //!< Serial number of BDM (required)
+   string                        deviceName;       //!< Target device
+   unsigned long                 port;             //!< GDB server port
+   BdmInterfacePtr               bdmInterface;     //!< Interface for this BDM
+   DeviceInterfacePtr            deviceInterface;  //!< Device (shares database with other bindings)
+   GdbHandler::GdbMessageLevel   loggingLevel;     //!< Console message level
+   USBDM_ErrorCode               rc;               //!< Result of server
+   pthread_t                     thread;           //!< Worker thread
+   bool                          started;          //!< Worker thread was created (needs joining)
+};
+
+/**
+ * Parse binding of form <serial>,<device>,<port>
+ *
+ * @param value    Value to parse
+ * @param binding  Binding to update
+ *
+ * @return true on success
+ */
+static bool parseBinding(const string &value, TargetBinding &binding) {
+   size_t comma1 = value.find(',');
+   if (comma1 == string::npos) {
+      return false;
+   }
+   size_t comma2 = value.find(',', comma1+1);
+   if (comma2 == string::npos) {
+      return false;
+   }
+   binding.serialNumber = value.substr(0, comma1);
+   binding.deviceName   = value.substr(comma1+1, comma2-comma1-1);
+   return (binding.serialNumber.length() > 0) && (binding.deviceName.length() > 0) &&
+          getUnsigned(value.substr(comma2+1), binding.port) && (binding.port > 0) && (binding.port < 65536);
+}
+
+/**
+ * Worker thread running the server for one binding
+ *
+ * @param arg - TargetBinding describing target
+ *
+ * @return NULL
+ */
+static void *serverWorker(void *arg) {
+   LOGGING;
+   TargetBinding &binding = *(TargetBinding *)arg;
+
+   char prefix[20];
+   snprintf(prefix, sizeof(prefix), "[%lu] ", binding.port);
+
+   GdbServerHeadless server(binding.bdmInterface, binding.deviceInterface, binding.loggingLevel, prefix);
+   binding.rc = server.createServer();
+   if (binding.rc == BDM_RC_OK) {
+      binding.rc = server.run();
+   }
+   log.print("Server on port %lu exited, rc = %d\n", binding.port, binding.rc);
+   return NULL;
+}
+
+/**
+ * Multi-target mode - one server thread per binding
+ *
+ * The device database is loaded once and shared by all bindings.
+ * Plug-ins (e.g. the TCL interpreter) are loaded once per process.
+ *
+ * @return Error code (first failure)
+ */
+static USBDM_ErrorCode runMultiTarget(int argc, char *argv[], TargetType_t targetType, GdbHandler::GdbMessageLevel loggingLevel) {
+   LOGGING;
+
+   if (findOption(argc, argv, "device") || findOption(argc, argv, "port") ||
+       findOption(argc, argv, "bdm")    || findOption(argc, argv, "requiredBdm")) {
+      fprintf(stderr, "***** Error: -device, -port, -bdm and -requiredBdm can't be used with -bind.\n");
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   vector<string>        bindValues = findOptions(argc, argv, "bind");
+   vector<TargetBinding> bindings(bindValues.size());
+   DeviceDataBasePtr     deviceDatabase;
+
+   // Create interfaces etc. for each binding
+   // This is done before starting any threads as the plug-in factories are not thread-safe
+   for (unsigned index=0; index<bindings.size(); index++) {
+      TargetBinding &binding = bindings[index];
+      if (!parseBinding(bindValues[index], binding)) {
+         fprintf(stderr, "***** Error: Illegal bind value \'%s\'.\n", bindValues[index].c_str());
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      for (unsigned other=0; other<index; other++) {
+         if ((bindings[other].port == binding.port) || (bindings[other].serialNumber == binding.serialNumber)) {
+            fprintf(stderr, "***** Error: Duplicate BDM or port in \'%s\'.\n", bindValues[index].c_str());
+            return BDM_RC_ILLEGAL_PARAMS;
+         }
+      }
+      USBDM_ErrorCode rc = configureTarget(argc, argv, targetType, binding.deviceName, deviceDatabase, binding.bdmInterface, binding.deviceInterface);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      // Share the database loaded for the first binding
+      deviceDatabase = binding.deviceInterface->getDeviceDatabase();
+
+      binding.bdmInterface->setBdmSerialNumber(binding.serialNumber, true);
+      binding.bdmInterface->setGdbServerPort(binding.port);
+      binding.loggingLevel = loggingLevel;
+      binding.rc           = BDM_RC_OK;
+      binding.started      = false;
+   }
+   for (vector<TargetBinding>::iterator it = bindings.begin(); it != bindings.end(); it++) {
+      log.print("Starting server for BDM %s on port %lu\n", it->serialNumber.c_str(), it->port);
+      if (pthread_create(&it->thread, NULL, serverWorker, &*it) != 0) {
+         log.error("Failed to create thread for BDM %s\n", it->serialNumber.c_str());
+         it->rc = BDM_RC_FAIL;
+      }
+      else {
+         it->started = true;
+      }
+   }
+   USBDM_ErrorCode returnValue = BDM_RC_OK;
+   for (vector<TargetBinding>::iterator it = bindings.begin(); it != bindings.end(); it++) {
+      if (it->started) {
+         pthread_join(it->thread, NULL);
+      }
+      if ((it->rc != BDM_RC_OK) && (returnValue == BDM_RC_OK)) {
+         returnValue = it->rc;
+      }
+   }
+   for (vector<TargetBinding>::iterator it = bindings.begin(); it != bindings.end(); it++) {
+      it->bdmInterface.reset();
+   }
+   return returnValue;
+}
+
+int main(int argc, char *argv[]) {
+   OpenLog openLog;
+   LOGGING;
+
+#ifdef _WIN32
+   WSADATA wsaData;
+   if (WSAStartup(MAKEWORD(2,2), &wsaData) != 0) {
+      fprintf(stderr, "***** Error: Failed to initialise sockets.\n");
+      return BDM_RC_FAIL;
+   }
+#else
+   // Socket errors are handled where they occur
+   signal(SIGPIPE, SIG_IGN);
+#endif
+   signal(SIGINT,  signalHandler);
+   signal(SIGTERM, signalHandler);
+
+   GdbHandler::GdbMessageLevel loggingLevel = findOption(argc, argv, "verbose")?GdbHandler::M_BORINGINFO:GdbHandler::M_INFO;
+
+   TargetType_t    targetType;
+   string          deviceName;
+   USBDM_ErrorCode rc = BDM_RC_ILLEGAL_PARAMS;
+
+   if (checkOptions(argc, argv)) {
+      rc = getTargetType(argc, argv, targetType);
+   }
+   if (rc != BDM_RC_OK) {
+      usage();
+   }
+   else if (findOptions(argc, argv, "bind").size() > 0) {
+      rc = runMultiTarget(argc, argv, targetType, loggingLevel);
+   }
+   else if (!findOption(argc, argv, "device", &deviceName)) {
+      fprintf(stderr, "***** Error: A device must be given.\n");
+      usage();
+      rc = BDM_RC_ILLEGAL_PARAMS;
+   }
+   else {
+      BdmInterfacePtr    bdmInterface;
+      DeviceInterfacePtr deviceInterface;
+
+      rc = configureTarget(argc, argv, targetType, deviceName, DeviceDataBasePtr(), bdmInterface, deviceInterface);
+      if (rc != BDM_RC_OK) {
+         usage();
+      }
+      else {
+         GdbServerHeadless server(bdmInterface, deviceInterface, loggingLevel);
+         rc = server.createServer();
+         if (rc == BDM_RC_OK) {
+            rc = server.run();
+         }
+      }
+   }
+#ifdef _WIN32
+   WSACleanup();
+#endif
+   log.print(" - return value = %d\n", rc);
+   return rc;
+}
@@ -5,6 +5,8 @@
  *      Author: podonoghue
  */
 
+#include <algorithm>
+
 #include "GdbServerWindow.h"
 
 #include "GdbServerDialogue.h"
@@ -28,7 +30,8 @@ GdbServerWindow::GdbServerWindow(BdmInterfacePtr bdmInterface, DeviceInterfacePt
    gdbInOut(NULL),
    statusTimer(NULL),
    deferredFail(false),
-   deferredOpen(false) {
+   deferredOpen(false),
+   runPollInterval(pollIntervalVeryFast) {
    LOGGING;
 
    serverSocket = NULL;
@@ -606,6 +609,8 @@ GdbHandler::GdbMessageLevel GdbServerWindow::getLoggingLevel() {
           }
           else {
              // Poll target immediately (also adjusts polling rate)
+             // Restart fast polling as the target may have just been started
+             runPollInterval = pollIntervalVeryFast;
              pollTarget();
           }
           if (clientSocket != NULL) {
@@ -671,6 +676,12 @@ GdbHandler::GdbMessageLevel GdbServerWindow::getLoggingLevel() {
              entryTextControl->Enable();
              pollInterval = pollIntervalSlow;
              break;
+          case GdbHandler::T_RUNNING:
+             // Adaptive - poll quickly just after starting and back off to the normal rate
+             entryTextControl->Enable(false);
+             pollInterval    = runPollInterval;
+             runPollInterval = std::min(2*runPollInterval, (int)pollIntervalFast);
+             break;
           default:
              entryTextControl->Enable(false);
              break;
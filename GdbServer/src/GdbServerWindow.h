@@ -107,12 +107,14 @@ protected:
 
    bool                          deferredFail;
    bool                          deferredOpen;
+   int                           runPollInterval;     //!< Current poll interval while running (ms)
 
    IGdbTty                      *tty;
    GdbHandlerPtr                 gdbHandler;
 
+   // Polled from statusTimer (GUI thread) - pollIntervalFast limits halt latency while running
    static const int              pollIntervalVeryFast = 10;   // ms
-   static const int              pollIntervalFast     = 100;  // ms
+   static const int              pollIntervalFast     = 20;   // ms
    static const int              pollIntervalSlow     = 1000; // ms
 
    enum {
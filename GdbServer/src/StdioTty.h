@@ -0,0 +1,46 @@
+/*
+ * StdioTty.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: podonoghue
+ */
+
+#ifndef SRC_STDIOTTY_H_
+#define SRC_STDIOTTY_H_
+
+#include <stdio.h>
+#include "IGdbTty.h"
+
+/**
+ * Semi-hosting console using the process stdout
+ *
+ * Used by the headless server - input is not supported as stdin
+ * is not polled by the server loop.
+ */
+class StdioTty: public IGdbTty {
+
+public:
+   StdioTty() {
+   }
+
+   virtual ~StdioTty() {
+   }
+
+   void putChar(int ch) {
+      fputc(ch, stdout);
+      fflush(stdout);
+   }
+   void puts(char *s) {
+      fputs(s, stdout);
+      fflush(stdout);
+   }
+   int getChar() {
+      return EOF;
+   }
+   int gets(char s[], int len) {
+      s[0] = '\0';
+      return 0;
+   }
+};
+
+#endif /* SRC_STDIOTTY_H_ */
@@ -0,0 +1,25 @@
+# Build list for headless GDB Server (no wxWidgets)
+
+# List source file to include from current directory
+SRC += GdbBreakpoints_ARM.cpp
+SRC += GdbBreakpoints_CFV1.cpp
+SRC += GdbBreakpoints.cpp
+SRC += GdbHandler_ARM.cpp
+SRC += GdbHandler_CFV1.cpp
+SRC += GdbHandler_CFVx.cpp
+SRC += GdbHandler.cpp
+SRC += GdbHandlerCommon.cpp
+SRC += GdbHandlerFactory.cpp
+SRC += GdbInOut.cpp
+SRC += GdbInOutSocket.cpp
+SRC += GdbMemoryCache.cpp
+SRC += GdbRttConsole.cpp
+SRC += GdbServerHeadless.cpp
+
+# Shared files $(SHARED_SRC)
+VPATH := $(SHARED_SRC) $(VPATH)
+
+INCS  += -I$(SHARED_SRC)
+SRC += Names.cpp
+SRC += Utils.cpp
+SRC += DeviceInterface.cpp
@@ -14,6 +14,8 @@ SRC += GdbHandlerCommon.cpp
 SRC += GdbHandlerFactory.cpp
 SRC += GdbInOut.cpp
 SRC += GdbInOutWx.cpp
+SRC += GdbMemoryCache.cpp
+SRC += GdbRttConsole.cpp
 SRC += GdbServerApp.cpp
 SRC += GdbServerDialogue.cpp
 SRC += GdbServerWindow.cpp
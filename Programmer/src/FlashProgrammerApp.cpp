@@ -25,6 +25,9 @@
     \verbatim
    Change History
    -=========================================================================================
+   | 17 Oct 2026 | Added -diff option                                      - V4.12.1
+   | 17 Oct 2026 | Added -imageCache option                                - V4.12.1
+   | 17 Oct 2026 | Added -gang option                                      - V4.12.1
    | 15 Mar 2015 | Complete redesign using wxFormBuilder                   - pgo V4.10.6.260
    +=========================================================================================
    \endverbatim
@@ -37,6 +40,10 @@
 #include <wx/wx.h>
 #include <wx/cmdline.h>
 #include <wx/stdpaths.h>
+#include <wx/stopwatch.h>
+
+#include <pthread.h>
+#include <vector>
 
 #include "ProgrammerDialogue.h"
 
@@ -76,6 +83,10 @@ private:
    bool                         verify;
    bool                         program;
    bool                         verbose;
+   bool                         gang;
+   bool                         imageCache;
+   bool                         differential;
+   wxString                     gangPattern;
    wxString                     hexFileName;
    double                       trimFrequency;
    long                         trimNVAddress;
@@ -87,6 +98,7 @@ private:
    USBDM_ErrorCode              commandLineRC;
 
    USBDM_ErrorCode doCommandLineProgram();
+   USBDM_ErrorCode doGangProgram();
    USBDM_ErrorCode parseCommandLine(wxCmdLineParser& parser);
 
 public:
@@ -124,6 +136,9 @@ FlashProgrammerApp::FlashProgrammerApp() :
    useGUI         = true;
    trimNVAddress  = 0;
    verbose        = false;
+   gang           = false;
+   imageCache     = false;
+   differential   = false;
    trimFrequency  = 0;
    verify         = false;
    program        = false;
@@ -154,6 +169,7 @@ USBDM_ErrorCode FlashProgrammerApp::doCommandLineProgram() {
          break;
       }
       if (!hexFileName.IsEmpty()) {
+         flashImage->enableImageCache(imageCache);
          returnValue = flashImage->loadFile((const char *)hexFileName.c_str(), targetType);
          if (returnValue != BDM_RC_OK) {
             break;
@@ -170,13 +186,17 @@ USBDM_ErrorCode FlashProgrammerApp::doCommandLineProgram() {
       }
       if (program) {
          // Program & Verify
+         flashProgrammer->setDifferentialProgramming(differential);
          if (verbose) {
             returnValue = flashProgrammer->programFlash(flashImage, programmerCallBack);
          }
          else {
             returnValue = flashProgrammer->programFlash(flashImage, NULL);
          }
-
+         if (differential && (returnValue == PROGRAMMING_RC_OK)) {
+            fprintf(stdout, "Differential programming: %u of %u bytes unchanged (skipped)\n",
+                  flashProgrammer->getBytesSkipped(), flashImage->getByteCount());
+         }
       }
       else {
          // Verify only
@@ -208,6 +228,205 @@ USBDM_ErrorCode FlashProgrammerApp::doCommandLineProgram() {
    return returnValue;
 }
 
+static long connectionNullCallback(std::string message, std::string  caption, long style);
+
+/**
+ * Describes one board being programmed in gang mode
+ */
+struct GangBoard {
+   std::string         serialNumber;     //!< Serial number of BDM connected to board
+   BdmInterfacePtr     bdmInterface;     //!< Interface for this BDM
+   FlashProgrammerPtr  flashProgrammer;  //!< Programmer using bdmInterface
+   FlashImagePtr       flashImage;       //!< Private copy of image (programming may modify security/trim locations)
+   DeviceDataPtr       deviceData;       //!< Device being programmed
+   bool                program;          //!< Program & verify (rather than just verify)
+   USBDM_ErrorCode     rc;               //!< Result of programming
+   long                time;             //!< Time taken (ms)
+   pthread_t           thread;           //!< Worker thread
+   bool                started;          //!< Worker thread was created (and must be joined)
+};
+
+/**
+ * Serialises opening of BDMs in gang mode.\n
+ * Opening a BDM briefly opens every BDM to read its serial number,
+ * which would fail if another worker had that BDM open at the time.
+ */
+static pthread_mutex_t gangOpenMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Worker thread that programs one board in gang mode
+ *
+ * @param arg - GangBoard describing board
+ *
+ * @return NULL
+ */
+static void *gangWorker(void *arg) {
+   LOGGING;
+   GangBoard  &board = *(GangBoard *)arg;
+   wxStopWatch stopWatch;
+
+   USBDM_ErrorCode returnValue = BDM_RC_OK;
+   do {
+      // Each worker drives its own BDM so needs a private session
+      returnValue = board.bdmInterface->useThreadSession(true);
+      if (returnValue != BDM_RC_OK) {
+         break;
+      }
+      // Initialise the BDM
+      pthread_mutex_lock(&gangOpenMutex);
+      returnValue = board.bdmInterface->initBdm();
+      pthread_mutex_unlock(&gangOpenMutex);
+      if (returnValue != BDM_RC_OK) {
+         break;
+      }
+      returnValue = board.flashProgrammer->setDeviceData(board.deviceData);
+      if (returnValue != BDM_RC_OK) {
+         break;
+      }
+      if (board.program) {
+         // Program & Verify
+         returnValue = board.flashProgrammer->programFlash(board.flashImage, NULL);
+         log.print("BDM %s, %u bytes skipped\n", board.serialNumber.c_str(), board.flashProgrammer->getBytesSkipped());
+      }
+      else {
+         // Verify only
+         returnValue = board.flashProgrammer->verifyFlash(board.flashImage);
+      }
+   } while (false);
+   if (returnValue != PROGRAMMING_RC_OK) {
+      log.error("BDM %s failed, rc = %s\n", board.serialNumber.c_str(), board.bdmInterface->getErrorString(returnValue));
+   }
+   if (board.bdmInterface->getBdmOptions().leaveTargetPowered) {
+      board.bdmInterface->reset((TargetMode_t)(RESET_DEFAULT|RESET_NORMAL));
+   }
+   board.bdmInterface->closeBdm();
+
+   board.rc   = returnValue;
+   board.time = stopWatch.Time();
+   return NULL;
+}
+
+/**
+ * Copy contents of one flash image to another
+ *
+ * @param source      - Image to copy from
+ * @param destination - Image to copy to (assumed empty)
+ */
+static void copyFlashImage(FlashImagePtr source, FlashImagePtr destination) {
+   std::vector<uint8_t> buffer;
+   FlashImage::EnumeratorPtr enumerator = source->getEnumerator();
+   while (enumerator->isValid()) {
+      uint32_t startAddress = enumerator->getAddress();
+      enumerator->lastValid();
+      uint32_t endAddress = enumerator->getAddress();
+      buffer.resize(endAddress-startAddress+1);
+      source->getData(buffer.size(), startAddress, buffer.data());
+      destination->loadData(buffer.size(), startAddress, buffer.data());
+      // Move to start of next block (if any)
+      if (!enumerator->setAddress(endAddress+1)) {
+         break;
+      }
+   }
+}
+
+/**
+ * Gang programming - programs the same image into all BDMs
+ * with serial numbers matching gangPattern in parallel.
+ *
+ * The image file and device data are loaded once.
+ * A worker thread is used for each BDM.
+ *
+ * @return Error code (first failure)
+ */
+USBDM_ErrorCode FlashProgrammerApp::doGangProgram() {
+   LOGGING;
+   FlashImagePtr   flashImage  = FlashImageFactory::createFlashImage(targetType);
+   USBDM_ErrorCode returnValue = BDM_RC_OK;
+
+   if (!hexFileName.IsEmpty()) {
+      flashImage->enableImageCache(imageCache);
+      returnValue = flashImage->loadFile((const char *)hexFileName.c_str(), targetType);
+      if (returnValue != BDM_RC_OK) {
+         log.error("Failed to load image, rc = %s\n", bdmInterface->getErrorString(returnValue));
+         return returnValue;
+      }
+   }
+   // Copy device description and change mutable settings
+   DeviceDataPtr &deviceData = deviceInterface->getCurrentDevice();
+   if (deviceData->getSecurity() == SEC_CUSTOM) {
+      deviceData->setCustomSecurity(customSecurityValue);
+   }
+   // Locate BDMs
+   std::vector<BdmInformation> bdmInformation;
+   bdmInterface->findBDMs(bdmInformation);
+
+   // Create a programmer etc for each matching BDM
+   // This is done before starting any threads as the plug-in factories are not thread-safe
+   std::vector<GangBoard> boards;
+   for (std::vector<BdmInformation>::iterator it = bdmInformation.begin(); it != bdmInformation.end(); it++) {
+      if (!it->isSuitable() || !wxString(it->getSerialNumber()).Matches(gangPattern)) {
+         log.print("Ignoring BDM %s\n", it->getSerialNumber().c_str());
+         continue;
+      }
+      GangBoard board;
+      board.serialNumber    = it->getSerialNumber();
+      board.bdmInterface    = BdmInterfaceFactory::createInterface(targetType, connectionNullCallback);
+      board.bdmInterface->getBdmOptions() = bdmInterface->getBdmOptions();
+      board.bdmInterface->setBdmSerialNumber(board.serialNumber, true);
+      board.flashProgrammer = FlashProgrammerFactory::createFlashProgrammer(board.bdmInterface);
+      board.flashProgrammer->setDifferentialProgramming(differential);
+      board.flashImage      = FlashImageFactory::createFlashImage(targetType);
+      copyFlashImage(flashImage, board.flashImage);
+      board.deviceData      = deviceData;
+      board.program         = program;
+      board.rc              = BDM_RC_OK;
+      board.time            = 0;
+      board.started         = false;
+      boards.push_back(board);
+   }
+   if (boards.empty()) {
+      log.error("No BDMs match \'%s\'\n", (const char *)gangPattern.c_str());
+      fprintf(stderr, "No suitable BDMs match \'%s\'\n", (const char *)gangPattern.c_str());
+      return BDM_RC_SELECTED_BDM_NOT_FOUND;
+   }
+   // Program all boards in parallel
+   wxStopWatch stopWatch;
+   for (std::vector<GangBoard>::iterator it = boards.begin(); it != boards.end(); it++) {
+      log.print("Starting BDM %s\n", it->serialNumber.c_str());
+      if (pthread_create(&it->thread, NULL, gangWorker, &*it) != 0) {
+         log.error("Failed to create thread for BDM %s\n", it->serialNumber.c_str());
+         it->rc = BDM_RC_FAIL;
+      }
+      else {
+         it->started = true;
+      }
+   }
+   for (std::vector<GangBoard>::iterator it = boards.begin(); it != boards.end(); it++) {
+      if (it->started) {
+         pthread_join(it->thread, NULL);
+      }
+   }
+   // Report results
+   unsigned passCount = 0;
+   fprintf(stdout, "\n%-30s %-8s %9s  %s\n", "BDM", "Result", "Time (s)", "Reason");
+   for (std::vector<GangBoard>::iterator it = boards.begin(); it != boards.end(); it++) {
+      if (it->rc == PROGRAMMING_RC_OK) {
+         passCount++;
+      }
+      else if (returnValue == BDM_RC_OK) {
+         returnValue = it->rc;
+      }
+      fprintf(stdout, "%-30s %-8s %9.2f  %s\n",
+            it->serialNumber.c_str(),
+            (it->rc == PROGRAMMING_RC_OK)?"PASS":"FAIL",
+            it->time/1000.0,
+            (it->rc == PROGRAMMING_RC_OK)?"":it->bdmInterface->getErrorString(it->rc));
+      log.print("BDM %s, rc = %s, time = %ld ms\n", it->serialNumber.c_str(), it->bdmInterface->getErrorString(it->rc), it->time);
+   }
+   fprintf(stdout, "%d of %d boards passed, total time %.2f s\n", passCount, (int)boards.size(), stopWatch.Time()/1000.0);
+   return returnValue;
+}
+
 bool FlashProgrammerApp::OnInit() {
    LOGGING;
 
@@ -260,6 +479,9 @@ int FlashProgrammerApp::OnRun(void) {
       appSettings->save();
       dialogue->Destroy();
    }
+   else if (gang) {
+      returnValue = doGangProgram();
+   }
    else {
       returnValue = doCommandLineProgram();
    }
@@ -288,8 +510,11 @@ static const wxCmdLineEntryDesc g_cmdLineDesc[] = {
       { wxCMD_LINE_OPTION, _("bdm"),           NULL, _("Serial number of preferred BDM to use"),                          wxCMD_LINE_VAL_STRING },
       { wxCMD_LINE_OPTION, _("requiredBdm"),   NULL, _("Serial number of required BDM to use"),                           wxCMD_LINE_VAL_STRING },
       { wxCMD_LINE_OPTION, _("device"),        NULL, _("Target device e.g. MCF51CN128"),                                  wxCMD_LINE_VAL_STRING },
+      { wxCMD_LINE_SWITCH, _("diff"),          NULL, _("Only erase and program flash sectors that differ from the target (Selective or None erase)") },
       { wxCMD_LINE_OPTION, _("erase"),         NULL, _("Erase method (Mass, All, Selective, Vendor, None)"),     wxCMD_LINE_VAL_STRING },
       { wxCMD_LINE_SWITCH, _("execute"),       NULL, _("Leave target power on & reset to normal mode at completion"), },
+      { wxCMD_LINE_OPTION, _("gang"),          NULL, _("Program all BDMs with serial number matching pattern in parallel e.g. USBDM-*"), wxCMD_LINE_VAL_STRING },
+      { wxCMD_LINE_SWITCH, _("imageCache"),    NULL, _("Cache parsed image for faster loading of unchanged files") },
       { wxCMD_LINE_OPTION, _("flexNVM"),       NULL, _("FlexNVM parameters (eeprom,partition hex values)"),               wxCMD_LINE_VAL_STRING },
       { wxCMD_LINE_SWITCH, _("masserase"),     NULL, _("Equivalent to erase=Mass") },
       { wxCMD_LINE_SWITCH, _("noerase"),       NULL, _("Equivalent to erase=None") },
@@ -335,7 +560,15 @@ void FlashProgrammerApp::OnInitCmdLine(wxCmdLineParser& parser) {
           "in flash are still unprogrammed (0xFF) when using the -trim option. The \n"
           "target must not be secured and cannot be made secured when using -erase=None.\n\n"
           "Programming image with custom security value:\n"
-          "  FlashProgrammer -target=arm -device=MKL25Z128M4 -vdd=3v3 -erase=mass -program -securityValue=123456789ABCDEF0FFFFFFFFFEFFFFFF Image.elf"
+          "  FlashProgrammer -target=arm -device=MKL25Z128M4 -vdd=3v3 -erase=mass -program -securityValue=123456789ABCDEF0FFFFFFFFFEFFFFFF Image.elf\n\n"
+          "Differential programming:\n"
+          "  FlashProgrammer -target=arm -device=MK20DX128M5 -erase=Selective -diff -program Image.elf\n"
+          "This will compare each flash sector used by Image.elf with the target and only\n"
+          "erase and program the sectors that differ.\n\n"
+          "Gang programming:\n"
+          "  FlashProgrammer -target=arm -device=MK20DX128M5 -program -gang=USBDM-* Image.elf\n"
+          "This will program Image.elf into the target attached to each BDM with a serial\n"
+          "number matching USBDM-* in parallel and report the result for each board."
           ));
 #endif
 }
@@ -626,6 +859,35 @@ USBDM_ErrorCode FlashProgrammerApp::parseCommandLine(wxCmdLineParser& parser) {
    if (parser.Found(_("requiredBdm"), &sValue)) {
       bdmInterface->setBdmSerialNumber(sValue.ToStdString(), true);
    }
+   if (parser.Found(_("gang"), &gangPattern)) {
+      if (parser.Found(_("bdm")) || parser.Found(_("requiredBdm"))) {
+         logUsageError(parser, _("***** Error: -gang can't be used with -bdm or -requiredBdm.\n"));
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      if (parser.Found(_("trim"))) {
+         // Trim value is individual to each board but is written to the image
+         logUsageError(parser, _("***** Error: -gang can't be used with -trim.\n"));
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      gang = true;
+   }
+   imageCache   = parser.Found(_("imageCache"));
+   differential = parser.Found(_("diff"));
+   if (differential) {
+      // Sectors are only compared when erasing selectively (or not at all)
+      DeviceData::EraseMethod eraseMethod = deviceData->getEraseMethod();
+      if ((eraseMethod == DeviceData::eraseTargetDefault) && (deviceData->getEraseMethods() != nullptr)) {
+         eraseMethod = deviceData->getEraseMethods()->getDefaultMethod();
+      }
+      if (targetType == T_RS08) {
+         logUsageError(parser, _("***** Error: -diff is not supported for RS08 targets.\n"));
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+      if ((eraseMethod == DeviceData::eraseMass) || (eraseMethod == DeviceData::eraseAll)) {
+         logUsageError(parser, _("***** Error: -diff requires -erase=Selective or -erase=None.\n"));
+         return BDM_RC_ILLEGAL_PARAMS;
+      }
+   }
    if (parser.Found(_("trim"), &sValue)) {
       double    dValue;
       if (!sValue.ToDouble(&dValue)) {
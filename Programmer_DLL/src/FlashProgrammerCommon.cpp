@@ -25,6 +25,17 @@
 +============================================================================================
 | Revision History
 +============================================================================================
+| 17 Oct 26 | Cache relocated target programs, skip download if CRC matches  - pgo 4.12.1
+| 17 Oct 26 | Shared loadTargetProgram() and program flags (TargetTraits)     - pgo 4.12.1
+| 17 Oct 26 | Checksum mismatch is located by reading back that block only    - pgo 4.12.1
+| 17 Oct 26 | Shared doFlashBlock()/executeTargetProgram() (double buffering) - pgo 4.12.1
+| 17 Oct 26 | Cache parsed target program images                              - pgo 4.12.1
+| 17 Oct 26 | Shared applyFlashOperation()/doReadbackVerify() (TargetTraits)  - pgo 4.12.1
+| 17 Oct 26 | Added CRC-32 of image range for target checksum verify          - pgo 4.12.1
+| 17 Oct 26 | Added differential programming (getChangedSectors())            - pgo 4.12.1
+| 17 Oct 26 | Added selective erase planner (planSelectiveErase())            - pgo 4.12.1
+| 17 Oct 26 | Added adaptive polling of target programs with timing statistics - pgo 4.12.1
++-----------+--------------------------------------------------------------------------------
 | 29 Mar 15 | Refactored mostly from Clocktrimming.cpp                        - pgo 4.10.7.10
 +-----------+--------------------------------------------------------------------------------
 | 04 Nov 12 | Added writeClockRegister()                                      - pgo 4.10.4
@@ -33,27 +44,47 @@
 */
 
 #include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <map>
 
 #include "UsbdmTclInterpreterFactory.h"
+#include "FlashImageFactory.h"
 #include "FlashProgrammerCommon.h"
 #include "TargetDefines.h"
 #include "Utils.h"
 #include "Names.h"
+#include "SimpleSRecords.h"
 
 /**
  * Constructor
  */
-FlashProgrammerCommon::FlashProgrammerCommon(DeviceData::EraseMethod defaultEraseMethod, DeviceData::ResetMethod defaultResetMethod) :
+FlashProgrammerCommon::FlashProgrammerCommon(const TargetTraits &targetTraits, DeviceData::EraseMethod defaultEraseMethod, DeviceData::ResetMethod defaultResetMethod) :
    flashReady(false),
    progressTimer(new ProgressTimer()),
    calculatedClockTrimValue(0),
    securityAreaCount(0),
+   differentialProgramming(false),
+   bytesSkipped(0),
+   sectorComparer(NULL),
+   currentFlashOperation(OpNone),
+   currentFlashAlignment(0),
+   doRamWrites(false),
+   nextDoubleBuffer(0),
+   targetTraits(targetTraits),
    defaultEraseMethod(defaultEraseMethod),
    defaultResetMethod(defaultResetMethod),
    ramStart(0),
    ramEnd(0) {
    LOGGING_E;
 
+   memset(&targetProgramInfo,      0, sizeof(targetProgramInfo));
+   memset(&flashOperationInfo,     0, sizeof(flashOperationInfo));
+   memset(targetProgramStatistics, 0, sizeof(targetProgramStatistics));
+
    log.print("defaultResetMethod = %s\n", DeviceData::getResetMethodName(defaultResetMethod));
    log.print("defaultEraseMethod = %s\n", DeviceData::getEraseMethodName(defaultEraseMethod));
 }
@@ -69,6 +100,246 @@ FlashProgrammerCommon::~FlashProgrammerCommon() {
    currentFlashProgram.reset();
 }
 
+/**
+ * Get current time for timing target programs
+ *
+ * @return time in seconds from an arbitrary origin
+ */
+static double getTimeNow() {
+   timespec now;
+   if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+      UsbdmSystem::Log::print("getTimeNow() - clock_gettime() failed!\n");
+      return 0.0;
+   }
+   return now.tv_sec + now.tv_nsec/1000000000.0;
+}
+
+/**
+ * Default execution rates for target programs used before any measurements are available.\n
+ * Operations with data are in seconds per byte, others are in seconds.
+ */
+static const double defaultTargetProgramTime[] = {
+      /* OpNone             */ 0.0,
+      /* OpSelectiveErase   */ 20e-6,
+      /* OpBlockErase       */ 50e-3,
+      /* OpBlankCheck       */ 0.1e-6,
+      /* OpProgram          */ 10e-6,
+      /* OpVerify           */ 0.1e-6,
+      /* OpWriteRam         */ 0.0,
+      /* OpPartitionFlexNVM */ 50e-3,
+      /* OpTiming           */ 50e-3,
+};
+
+/**
+ * Indicates if the execution time of an operation is proportional to the size of the data
+ */
+static bool isDataSizedOperation(FlashProgrammer::FlashOperation flashOperation) {
+   switch (flashOperation) {
+   case FlashProgrammer::OpSelectiveErase :
+   case FlashProgrammer::OpBlankCheck     :
+   case FlashProgrammer::OpProgram        :
+   case FlashProgrammer::OpVerify         :
+   case FlashProgrammer::OpWriteRam       :
+      return true;
+   default:
+      return false;
+   }
+}
+
+/**
+ * Indicates if the execution time of an operation is limited by the target CPU rather than the flash
+ */
+static bool isCpuBoundOperation(FlashProgrammer::FlashOperation flashOperation) {
+   switch (flashOperation) {
+   case FlashProgrammer::OpBlankCheck :
+   case FlashProgrammer::OpVerify     :
+   case FlashProgrammer::OpTiming     :
+      return true;
+   default:
+      return false;
+   }
+}
+
+/**
+ * Estimate execution time of a target program
+ *
+ * @param flashOperation   Operation being executed
+ * @param dataSize         Size of data being processed (bytes)
+ * @param busFrequency     Target bus frequency (kHz, 0 if unknown)
+ *
+ * @return Estimated time in seconds
+ */
+double FlashProgrammerCommon::estimateTargetProgramTime(FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency) {
+   if ((unsigned)flashOperation > OpTiming) {
+      return 0.0;
+   }
+   const TargetProgramStatistics &stats = targetProgramStatistics[flashOperation];
+   double time = defaultTargetProgramTime[flashOperation];
+   if (stats.count > 0) {
+      time = stats.learnedTime;
+      if (isCpuBoundOperation(flashOperation) && (stats.busFrequency != 0) && (busFrequency != 0)) {
+         // Scale to current bus frequency
+         time = (time * stats.busFrequency) / busFrequency;
+      }
+   }
+   if (isDataSizedOperation(flashOperation)) {
+      time *= dataSize;
+   }
+   return time;
+}
+
+/**
+ * Record execution time of a target program to refine later estimates
+ *
+ * @param flashOperation   Operation executed
+ * @param dataSize         Size of data processed (bytes)
+ * @param busFrequency     Target bus frequency (kHz, 0 if unknown)
+ * @param time             Measured execution time (s)
+ * @param polls            Number of status polls used
+ */
+void FlashProgrammerCommon::recordTargetProgramTime(FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency, double time, unsigned polls) {
+   if ((unsigned)flashOperation > OpTiming) {
+      return;
+   }
+   double sample = time;
+   if (isDataSizedOperation(flashOperation)) {
+      if (dataSize == 0) {
+         // Can't learn a rate from this (e.g. streamed operation)
+         return;
+      }
+      sample = time/dataSize;
+   }
+   TargetProgramStatistics &stats = targetProgramStatistics[flashOperation];
+   if (stats.count == 0) {
+      stats.minTime     = time;
+      stats.maxTime     = time;
+      stats.learnedTime = sample;
+   }
+   else {
+      if (isCpuBoundOperation(flashOperation) && (stats.busFrequency != 0) && (busFrequency != 0)) {
+         // Re-base to current bus frequency
+         stats.learnedTime = (stats.learnedTime * stats.busFrequency) / busFrequency;
+      }
+      // Exponential moving average follows changes (e.g. different flash regions) while smoothing jitter
+      stats.learnedTime = 0.75*stats.learnedTime + 0.25*sample;
+      if (time < stats.minTime) {
+         stats.minTime = time;
+      }
+      if (time > stats.maxTime) {
+         stats.maxTime = time;
+      }
+   }
+   stats.busFrequency  = busFrequency;
+   stats.count++;
+   stats.polls        += polls;
+   stats.totalTime    += time;
+}
+
+/**
+ * Log execution statistics for target programs
+ */
+void FlashProgrammerCommon::reportTargetProgramStatistics() {
+   LOGGING_Q;
+   for (unsigned op=OpNone; op<=OpTiming; op++) {
+      const TargetProgramStatistics &stats = targetProgramStatistics[op];
+      if (stats.count == 0) {
+         continue;
+      }
+      log.print("%-18s : n=%4u, total=%8.3f s, min=%8.3f ms, avg=%8.3f ms, max=%8.3f ms, polls/run=%5.1f\n",
+            getFlashOperationName((FlashOperation)op), stats.count, stats.totalTime,
+            1000*stats.minTime, 1000*stats.totalTime/stats.count, 1000*stats.maxTime,
+            (double)stats.polls/stats.count);
+   }
+}
+
+/**
+ * Create wait for target program that has just been started
+ *
+ * @param owner            Programmer executing the program
+ * @param flashOperation   Operation being executed
+ * @param dataSize         Size of data being processed (bytes)
+ * @param busFrequency     Target bus frequency (kHz, 0 if unknown)
+ */
+FlashProgrammerCommon::TargetProgramWait::TargetProgramWait(
+      FlashProgrammerCommon &owner, FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency) :
+   owner(owner),
+   flashOperation(flashOperation),
+   dataSize(dataSize),
+   busFrequency(busFrequency),
+   startTime(getTimeNow()),
+   stopTime(0.0),
+   pollInterval(MinPollInterval),
+   pollCount(0),
+   timedOut(false) {
+
+   expectedTime = owner.estimateTargetProgramTime(flashOperation, dataSize, busFrequency);
+   timeout      = 4*expectedTime;
+   if (timeout < MinTimeout/1000.0) {
+      timeout = MinTimeout/1000.0;
+   }
+}
+
+/**
+ * Delay before next poll of the target
+ *
+ * The first delay is about half the expected execution time (may be zero),
+ * later delays back off exponentially
+ */
+void FlashProgrammerCommon::TargetProgramWait::delay() {
+   int sleepTime;
+   if (pollCount++ == 0) {
+      sleepTime = (int)(1000*(expectedTime/2 - elapsedTime()));
+   }
+   else {
+      sleepTime    = pollInterval;
+      pollInterval = 2*pollInterval;
+      if (pollInterval > MaxPollInterval) {
+         pollInterval = MaxPollInterval;
+      }
+   }
+   if (sleepTime > 0) {
+      UsbdmSystem::milliSleep(sleepTime);
+   }
+}
+
+/**
+ * Stop timing - used once the target has stopped
+ */
+void FlashProgrammerCommon::TargetProgramWait::stop() {
+   if (stopTime == 0.0) {
+      stopTime = getTimeNow();
+   }
+}
+
+/**
+ * Get time since the program was started or until stop() was called
+ *
+ * @return time in seconds
+ */
+double FlashProgrammerCommon::TargetProgramWait::elapsedTime() const {
+   return ((stopTime != 0.0)?stopTime:getTimeNow()) - startTime;
+}
+
+/**
+ * Indicates if the program has taken too long.\n
+ * After stop() this reports whether a timeout was detected while polling.
+ */
+bool FlashProgrammerCommon::TargetProgramWait::isTimedOut() {
+   if ((stopTime == 0.0) && (elapsedTime() > timeout)) {
+      timedOut = true;
+   }
+   return timedOut;
+}
+
+/**
+ * Record successful completion of program for later estimates
+ */
+void FlashProgrammerCommon::TargetProgramWait::complete() {
+   UsbdmSystem::Log::print("%s, size=%u, expected=%.2f ms, actual=%.2f ms, polls=%u\n",
+         getFlashOperationName(flashOperation), dataSize, 1000*expectedTime, 1000*elapsedTime(), pollCount);
+   owner.recordTargetProgramTime(flashOperation, dataSize, busFrequency, elapsedTime(), pollCount);
+}
+
 /**
  * Sets target intyerface to use when communicating with BDM
  *
@@ -595,25 +866,22 @@ USBDM_ErrorCode FlashProgrammerCommon::trimTargetClock(uint32_t       trimAddres
    int              index;
    USBDM_ErrorCode  rc = PROGRAMMING_RC_OK;
 
-#if TARGET == RS08
-   mask = RS08_BDCSCR_CLKSW;
-#elif TARGET == HCS08
-   mask = HC08_BDCSCR_CLKSW;
-#elif TARGET == HCS12
-   mask = HC12_BDMSTS_CLKSW;
-#elif TARGET == CFV1
-   mask = CFV1_XCSR_CLKSW;
-#endif
+   switch (targetTraits.targetType) {
+   case T_RS08  : mask = RS08_BDCSCR_CLKSW; break;
+   case T_HCS08 : mask = HC08_BDCSCR_CLKSW; break;
+   case T_CFV1  : mask = CFV1_XCSR_CLKSW;   break;
+   default      : mask = HC12_BDMSTS_CLKSW; break;
+   }
 
    unsigned long BDMStatusReg;
    rc = USBDM_ReadStatusReg(&BDMStatusReg);
    if ((BDMStatusReg&mask) == 0) {
       log.print("Setting CLKSW\n");
       BDMStatusReg |= mask;
-#if TARGET == CFV1
-      // Make sure we don't accidently do a mass erase
-      mask &= ~CFV1_XCSR_ERASE;
-#endif
+      if (targetTraits.targetType == T_CFV1) {
+         // Make sure we don't accidently do a mass erase
+         mask &= ~CFV1_XCSR_ERASE;
+      }
       rc = USBDM_WriteControlReg(BDMStatusReg);
       rc = USBDM_Connect();
    }
@@ -1069,13 +1337,12 @@ USBDM_ErrorCode FlashProgrammerCommon::setFlashTrimValues(FlashImagePtr flashIma
       return PROGRAMMING_RC_OK;
    }
 
-#if TARGET == RS08
-   uint32_t NVTRIM_address  = device->getClockTrimNVAddress();
-   uint32_t NVFTRIM_address = device->getClockTrimNVAddress()+1;
-#else
    uint32_t NVFTRIM_address = device->getClockTrimNVAddress();
    uint32_t NVTRIM_address  = device->getClockTrimNVAddress()+1;
-#endif
+   if (targetTraits.targetType == T_RS08) {
+      NVTRIM_address  = device->getClockTrimNVAddress();
+      NVFTRIM_address = device->getClockTrimNVAddress()+1;
+   }
 
    switch (device->getClockType()) {
       case CLKEXT:
@@ -1355,6 +1622,2083 @@ void FlashProgrammerCommon::restoreSecurityAreas(FlashImagePtr flashImage) {
    securityAreaCount = 0;
 }
 
+/**
+ * Determine the flash ranges to erase for a flash image
+ *
+ * Image blocks are mapped onto sector boundaries of the containing memory region.
+ * Blocks sharing or adjoining sectors of the same region are merged so that each
+ * sector is erased once and contiguous sectors are erased by a single operation.
+ * Blocks outside programmable memory are passed through unchanged.
+ *
+ * @param flashImage  Flash image used to determine regions to erase
+ * @param eraseRanges Ranges to erase in address order
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note The ranges are not rounded to sector boundaries - the target erases
+ *       all sectors touched by a range.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::planSelectiveErase(FlashImagePtr flashImage, std::vector<EraseRange> &eraseRanges) {
+   LOGGING;
+
+   eraseRanges.clear();
+
+   MemoryRegionConstPtr lastRegion;         // Region of last range (NULL if not mergeable)
+   uint32_t             lastSector = 0;     // Last sector touched by last range
+   unsigned             blockCount = 0;
+
+   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
+   while (enumerator->isValid()) {
+      uint32_t startBlock = enumerator->getAddress();
+      enumerator->lastValid();
+      uint32_t endBlock   = enumerator->getAddress();
+      blockCount++;
+
+      // Split block at memory region boundaries
+      while (startBlock <= endBlock) {
+         MemorySpace_t memorySpace       = MS_None;     // Memory space for target access
+         uint32_t      memoryAddressMask = 0xFFFFFFFF;  // Mask to apply to flash address to get memory address
+         if (targetTraits.splitDataSpace) {
+            // MC56F80xx map DATA addresses as high addresses in flashImage
+            if (startBlock >= FlashImage::DataOffset) {
+               memorySpace       = MS_XWord;
+               memoryAddressMask = 0x00FFFFFF;
+            }
+            else {
+               memorySpace       = MS_PWord;
+            }
+         }
+         uint32_t endRange = endBlock;
+         MemoryRegionConstPtr memoryRegionPtr = device->getMemoryRegionFor(startBlock&memoryAddressMask, memorySpace);
+         uint32_t lastContiguous;
+         if (memoryRegionPtr && memoryRegionPtr->findLastContiguous(startBlock&memoryAddressMask, &lastContiguous, memorySpace)) {
+            lastContiguous += startBlock-(startBlock&memoryAddressMask);
+            if (lastContiguous < endRange) {
+               endRange = lastContiguous;
+            }
+         }
+         uint32_t sectorSize = 0;
+         if (memoryRegionPtr && memoryRegionPtr->isProgrammableMemory()) {
+            sectorSize = memoryRegionPtr->getSectorSize();
+         }
+         if (sectorSize == 0) {
+            // Not erasable - leave for erase operation to skip or report
+            EraseRange range = {startBlock, endRange};
+            eraseRanges.push_back(range);
+            lastRegion.reset();
+         }
+         else {
+            uint32_t firstSector = startBlock/sectorSize;
+            if (lastRegion && (lastRegion == memoryRegionPtr) && (firstSector <= lastSector+1)) {
+               // Shares or adjoins sectors of previous range - extend it
+               eraseRanges.back().end = endRange;
+            }
+            else {
+               EraseRange range = {startBlock, endRange};
+               eraseRanges.push_back(range);
+               lastRegion = memoryRegionPtr;
+            }
+            lastSector = endRange/sectorSize;
+         }
+         if (endRange == 0xFFFFFFFF) {
+            break;
+         }
+         startBlock = endRange+1;
+      }
+      if (!enumerator->nextValid()) {
+         break;
+      }
+   }
+   log.print("%d image blocks => %d erase ranges\n", blockCount, (int)eraseRanges.size());
+   for (unsigned index=0; index<eraseRanges.size(); index++) {
+      log.print("  [0x%06X..0x%06X]\n", eraseRanges[index].start, eraseRanges[index].end);
+   }
+   return PROGRAMMING_RC_OK;
+}
+
+/**
+ * Copy allocated locations in a range from one flash image to another
+ *
+ * @param source        Image to copy from
+ * @param destination   Image to copy to
+ * @param startAddress  Start of range
+ * @param endAddress    End of range (inclusive)
+ */
+static void copyImageRange(FlashImagePtr source, FlashImagePtr destination, uint32_t startAddress, uint32_t endAddress) {
+   std::vector<uint8_t> buffer;
+   FlashImage::EnumeratorPtr enumerator = source->getEnumerator(startAddress);
+   while (enumerator->isValid() && (enumerator->getAddress() <= endAddress)) {
+      uint32_t blockStart = enumerator->getAddress();
+      enumerator->lastValid();
+      uint32_t blockEnd = enumerator->getAddress();
+      if (blockEnd > endAddress) {
+         blockEnd = endAddress;
+      }
+      buffer.resize(blockEnd-blockStart+1);
+      source->getData(buffer.size(), blockStart, &buffer[0]);
+      destination->loadData(buffer.size(), blockStart, &buffer[0]);
+      if ((blockEnd == endAddress) || !enumerator->nextValid()) {
+         break;
+      }
+   }
+}
+
+/**
+ * Create an image containing only the flash sectors that differ from the target
+ *
+ * Each flash sector touched by the image is compared with the target (unused locations
+ * are taken as erased i.e. 0xFF).  With Selective erase the sectors are compared using
+ * sectorComparer if set, otherwise they are read back.
+ * Sectors that match are dropped.  Non-flash data is always retained.
+ *
+ * @param flashImage    Complete image (after security/trim modifications)
+ * @param changedImage  Image to erase and program (may be flashImage)
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note bytesSkipped is updated
+ * @note Paged flash (HCS08/HCS12) is always programmed
+ */
+USBDM_ErrorCode FlashProgrammerCommon::getChangedSectors(FlashImagePtr flashImage, FlashImagePtr &changedImage) {
+   LOGGING;
+   const uint32_t MAX_BUFFER=0x800;
+
+   changedImage = flashImage;
+   bytesSkipped = 0;
+
+   DeviceData::EraseMethod eraseMethod = getEraseMethod();
+   if ((eraseMethod != DeviceData::eraseSelective) && (eraseMethod != DeviceData::eraseNone)) {
+      log.print("Differential programming not used with erase method %s\n", DeviceData::getEraseMethodName(eraseMethod));
+      return PROGRAMMING_RC_OK;
+   }
+   progressTimer->restart("Comparing...");
+
+   FlashImagePtr newImage = FlashImageFactory::createFlashImage(bdmInterface->getBdmOptions().targetType);
+
+   // Sector touched by image and how to read it back
+   struct TargetSector {
+      SectorComparer::Sector sector;       //!< Sector (image address)
+      MemorySpace_t          memorySpace;  //!< Memory space for read-back
+      uint32_t               offset;       //!< Offset from image to target address
+   };
+   std::vector<TargetSector> targetSectors;
+
+   // Locate flash sectors touched by image
+   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
+   while (enumerator->isValid()) {
+      uint32_t startBlock = enumerator->getAddress();
+      enumerator->lastValid();
+      uint32_t endBlock = enumerator->getAddress();
+      uint32_t address  = startBlock;
+      for(;;) {
+         uint32_t      offset;
+         MemorySpace_t memorySpace = getTargetMemorySpace(address, offset);
+         MemoryRegionConstPtr memoryRegion = device->getMemoryRegionFor(address-offset, memorySpace);
+         uint32_t sectorSize = 0;
+         if (memoryRegion && memoryRegion->isProgrammableMemory() && (memoryRegion->getMemoryType() != MemEEPROM)) {
+            sectorSize = memoryRegion->getSectorSize();
+         }
+         if (targetTraits.pagedAddresses && (address > 0xFFFF)) {
+            // Paged/linear address - not directly readable
+            sectorSize = 0;
+         }
+         if ((sectorSize == 0) || ((sectorSize & (sectorSize-1)) != 0)) {
+            // Not sector organised flash - always program
+            log.print("Keeping [0x%08X..0x%08X]\n", address, endBlock);
+            copyImageRange(flashImage, newImage, address, endBlock);
+            break;
+         }
+         if (targetTraits.limitToRegionAlignment && (memoryRegion->getAlignment()<memorySpace)) {
+            memorySpace = (MemorySpace_t)memoryRegion->getAlignment();
+         }
+         uint32_t sectorStart = address & ~(sectorSize-1);
+         if (targetSectors.empty() || (targetSectors.back().sector.address != sectorStart)) {
+            TargetSector targetSector = { { sectorStart, sectorSize, true }, memorySpace, offset };
+            targetSectors.push_back(targetSector);
+         }
+         if (sectorStart+sectorSize-1 >= endBlock) {
+            break;
+         }
+         address = sectorStart+sectorSize;
+      }
+      if (!enumerator->nextValid()) {
+         break;
+      }
+   }
+   // Sectors with matching image and target addresses may be compared by sectorComparer
+   std::vector<SectorComparer::Sector> comparedSectors;
+   if ((sectorComparer != NULL) && (eraseMethod == DeviceData::eraseSelective)) {
+      for (unsigned index=0; index<targetSectors.size(); index++) {
+         if (targetSectors[index].offset == 0) {
+            comparedSectors.push_back(targetSectors[index].sector);
+         }
+      }
+      if (!comparedSectors.empty() && (sectorComparer->compareSectors(flashImage, comparedSectors) != BDM_RC_OK)) {
+         log.print("Sector comparer failed - reading back\n");
+         comparedSectors.clear();
+      }
+   }
+   std::vector<uint8_t> imageData;
+   std::vector<uint8_t> targetData;
+   unsigned changedCount  = 0;
+   unsigned comparedIndex = 0;
+   for (unsigned sectorIndex=0; sectorIndex<targetSectors.size(); sectorIndex++) {
+      const TargetSector &targetSector = targetSectors[sectorIndex];
+      uint32_t sectorStart = targetSector.sector.address;
+      uint32_t sectorSize  = targetSector.sector.size;
+      uint32_t sectorEnd   = sectorStart + sectorSize - 1;
+      bool     changed     = false;
+      if ((comparedIndex<comparedSectors.size()) && (comparedSectors[comparedIndex].address == sectorStart)) {
+         changed = comparedSectors[comparedIndex++].changed;
+      }
+      else {
+         imageData.resize(sectorSize);
+         targetData.resize(sectorSize);
+         flashImage->getData(sectorSize, sectorStart, &imageData[0]);
+         for (uint32_t index=0; index<sectorSize; index+=MAX_BUFFER) {
+            uint32_t size = sectorSize-index;
+            if (size > MAX_BUFFER) {
+               size = MAX_BUFFER;
+            }
+            if (bdmInterface->readMemory(targetSector.memorySpace, size, sectorStart+index-targetSector.offset, &targetData[index]) != BDM_RC_OK) {
+               // Can't tell - program it
+               changed = true;
+               break;
+            }
+         }
+         for (uint32_t index=0; !changed && (index<sectorSize); index++) {
+            // Without erasing only the locations being programmed matter
+            changed = (imageData[index] != targetData[index]) &&
+                      ((eraseMethod != DeviceData::eraseNone) || flashImage->isValid(sectorStart+index));
+         }
+      }
+      if (changed) {
+         log.print("Sector [0x%08X..0x%08X] changed\n", sectorStart, sectorEnd);
+         changedCount++;
+         copyImageRange(flashImage, newImage, sectorStart, sectorEnd);
+      }
+      progressTimer->progress(sectorSize, NULL);
+   }
+   bytesSkipped = flashImage->getByteCount() - newImage->getByteCount();
+   log.print("%d of %d sectors changed, %d bytes skipped\n", changedCount, (int)targetSectors.size(), bytesSkipped);
+   changedImage = newImage;
+   return PROGRAMMING_RC_OK;
+}
+
+/**
+ * Get memory space and offset used to access an image address on the target
+ *
+ * @param imageAddress  Address in flash image
+ * @param offset        Offset to subtract from image address to obtain target address
+ *
+ * @return Memory space for bulk access
+ */
+MemorySpace_t FlashProgrammerCommon::getTargetMemorySpace(uint32_t imageAddress, uint32_t &offset) const {
+   offset = 0;
+   if (!targetTraits.splitDataSpace) {
+      return targetTraits.memorySpace;
+   }
+   // MC56F80xx map DATA addresses as high addresses in flashImage
+   if (imageAddress >= FlashImage::DataOffset) {
+      offset = FlashImage::DataOffset;
+      return MS_XWord;
+   }
+   return MS_PWord;
+}
+
+/**
+ * Apply a flash operation to target based upon occupied flash addresses
+ *
+ * Each allocated block of the image is passed to doFlashBlock()
+ *
+ * @param flashImage       Flash image to use
+ * @param flashOperation   Operation to do on flash
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::applyFlashOperation(FlashImagePtr flashImage, FlashOperation flashOperation) {
+   LOGGING;
+   USBDM_ErrorCode rc = PROGRAMMING_RC_OK;
+   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
+
+   log.print("Op=%s, Total Bytes = %d\n", getFlashOperationName(flashOperation), flashImage->getByteCount());
+   // Go through each allocated block of memory applying operation
+   while (enumerator->isValid()) {
+      // Start address of block to program to flash
+      uint32_t startBlock = enumerator->getAddress();
+      // Find end of block to process
+      enumerator->lastValid();
+      uint32_t blockSize = enumerator->getAddress() - startBlock + 1;
+      if (blockSize>0) {
+         // Process block [startBlock..endBlock]
+         rc = doFlashBlock(flashImage, blockSize, startBlock, flashOperation);
+         if (rc != PROGRAMMING_RC_OK) {
+            log.error("applyFlashOperation() - Error \n");
+            break;
+         }
+      }
+      else {
+         log.print("applyFlashOperation() - empty block\n");
+      }
+      enumerator->setAddress(startBlock);
+   }
+   return rc;
+}
+
+/**
+ * Apply a flash operation to a block of the target
+ *
+ * @param flashImage       Flash image to use
+ * @param blockSize        Size of block
+ * @param flashAddress     Start address of block (updated)
+ * @param flashOperation   Operation to do on flash
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note Blocks crossing memory regions are split.
+ * @note Program and verify use double buffering if the target program supports it.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::doFlashBlock(FlashImagePtr   flashImage,
+                                                    unsigned int    blockSize,
+                                                    uint32_t       &flashAddress,
+                                                    FlashOperation  flashOperation) {
+   LOGGING;
+   log.print("op=%s, [0x%06X..0x%06X]\n", getFlashOperationName(flashOperation), flashAddress, flashAddress+blockSize-1);
+
+   if (!flashReady) {
+      log.error(" - Error, Flash not ready\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   // OK for empty block
+   if (blockSize==0) {
+      return PROGRAMMING_RC_OK;
+   }
+   //
+   // Find flash region to program - this will recurse to handle sub regions
+   //
+   uint32_t      offset;         // Offset to subtract from flash address to get memory address
+   MemorySpace_t memorySpace = getTargetMemorySpace(flashAddress, offset);
+   uint32_t      memoryAddress = flashAddress-offset;
+
+   // Locate containing Memory region (Programmable or RAM)
+   MemoryRegionConstPtr memoryRegionPtr = device->getMemoryRegionFor(memoryAddress, memorySpace);
+   if (memoryRegionPtr == NULL) {
+      log.error("Block %s[0x%06X...] is not within target memory.\n", getMemSpaceName(memorySpace), memoryAddress);
+      return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
+   }
+   uint32_t lastContiguous;  // Last contiguous address in memory space
+   if (!memoryRegionPtr->findLastContiguous(memoryAddress, &lastContiguous, memorySpace)) {
+      // This should never fail!
+      log.error("Block %s[0x%06X...] is within target memory BUT location not found!.\n", getMemSpaceName(memorySpace), memoryAddress);
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+
+   // Check if block crosses boundary and will need to be split
+   if ((memoryAddress+blockSize-1) > lastContiguous) {
+      // The block is split into a contiguous block + rest. Each is handled by recursion
+      log.print("  ...Block crosses FLASH boundary - recursing\n");
+      uint32_t firstBlockSize = lastContiguous - memoryAddress + 1;
+      USBDM_ErrorCode rc;
+      rc = doFlashBlock(flashImage, firstBlockSize, flashAddress, flashOperation);
+      if (rc != PROGRAMMING_RC_OK) {
+         return rc;
+      }
+      rc = doFlashBlock(flashImage, blockSize-firstBlockSize, flashAddress, flashOperation);
+      return rc;
+   }
+
+   /*
+    * We have a memory block to process
+    * Check that operation is suitable for this phase
+    */
+   if (memoryRegionPtr->isProgrammableMemory()) {
+      /*
+       * ROM type
+       */
+      switch (flashOperation) {
+         case OpBlankCheck:
+         case OpProgram:
+         case OpSelectiveErase:
+         case OpVerify:
+            // OK operation on ROM
+            break;
+         case OpWriteRam:
+            // Assume to be done in later RAM phase
+            log.print("  ...Skipping block %s[0x%06X..0x%06X] as ROM memory assumed processed in earlier phase\n",
+                  memoryRegionPtr->getMemoryTypeName(), memoryAddress, memoryAddress+blockSize-1);
+            // No further processing of this block
+            flashAddress += blockSize;
+            return BDM_RC_OK;
+         default:
+            // Unexpected
+            log.error("  ...Unexpected flashOperation\n");
+            return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+   }
+   else if (memoryRegionPtr->isWritableMemory() && doRamWrites) {
+      /*
+       * RAM type & writes enabled
+       */
+      switch (flashOperation) {
+         case OpBlankCheck:
+         case OpProgram:
+         case OpSelectiveErase:
+            // Assume done in earlier Flash pass or not applicable
+            log.print("  ...Skipping block %s[0x%06X..0x%06X] as RAM memory assumed processed in later phase\n",
+                  memoryRegionPtr->getMemoryTypeName(), memoryAddress, memoryAddress+blockSize-1);
+            // No further processing of this block
+            flashAddress += blockSize;
+            return BDM_RC_OK;
+         case OpWriteRam:
+         case OpVerify:
+            // OK Operation on RAM
+            break;
+         default:
+            // Unexpected
+            log.error("  ...Unexpected ramOperation\n");
+            return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+   }
+   else {
+      // Unexpected
+      log.error("Block %s[0x%06X..0x%06X] is not within target memory\n",
+            memoryRegionPtr->getMemoryTypeName(), memoryAddress, memoryAddress+blockSize-1);
+      return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
+   }
+
+   /*
+    * Have block and suitable operation
+    */
+   MemType_t memoryType = memoryRegionPtr->getMemoryType();
+   log.print("Processing %s[0x%06X..0x%06X]\n",
+         MemoryRegion::getMemoryTypeName(memoryType), memoryAddress, memoryAddress+blockSize-1);
+
+   flashOperationInfo.controller = memoryRegionPtr->getRegisterAddress();
+   flashOperationInfo.alignment  = memoryRegionPtr->getAlignment();
+   flashOperationInfo.sectorSize = memoryRegionPtr->getSectorSize();
+
+   if ((flashOperation == OpSelectiveErase) && (flashOperationInfo.sectorSize == 0)) {
+      log.error("Error: sector size is 0\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   // Maximum size of data to write
+   unsigned int maxSplitBlockSize = RamWriteBlockSize;
+
+   USBDM_ErrorCode rc = PROGRAMMING_RC_OK;
+   if (flashOperation != OpWriteRam) {
+      // RAM is written directly without a target program
+      rc = loadTargetProgram(memoryRegionPtr, flashOperation);
+      if (rc != PROGRAMMING_RC_OK) {
+         return rc;
+      }
+      maxSplitBlockSize = targetProgramInfo.maxDataSize;
+   }
+
+   // Buffer for memory write (header+buffer)
+   uint8_t  buffer[100+maxSplitBlockSize];
+   memset(buffer, 0, sizeof(buffer));
+   uint8_t *bufferData = buffer+targetProgramInfo.dataOffset;
+
+   uint32_t alignMask = memoryRegionPtr->getAlignment()-1;
+   log.print("Align mask = 0x%08X\n", alignMask);
+
+   // splitBlockSize must be aligned
+   maxSplitBlockSize &= ~alignMask;
+
+   // Calculate any odd padding bytes at start of block
+   unsigned int oddBytes = flashAddress & alignMask;
+
+   // Verify by target checksum if supported - no data transfer needed
+   bool checksumVerify = (flashOperation == OpVerify) && (targetTraits.dataAddressOffset != 0) &&
+                         ((targetProgramInfo.capabilities&CAP_CHECKSUM_RANGE) != 0);
+
+   uint32_t addressFlag = 0;        // Modifier for target memory address
+
+   if (targetTraits.dataFlashA23 && ((memoryType == MemFlexNVM) || (memoryType == MemDFlash))) {
+      // Flag needed for DFLASH/FlexNVM access
+      addressFlag |= ADDRESS_A23;
+   }
+   if (targetTraits.splitDataSpace && (memoryType == MemXROM)) {
+      // Flag used to indicate data (X:) address
+      log.print("Setting MemXROM address\n");
+      addressFlag |= ADDRESS_DATA;
+   }
+   if (targetTraits.pagedAddresses) {
+      if (memoryType == MemEEPROM) {
+         log.print("Setting EEPROM address flag\n");
+         addressFlag |= ADDRESS_EEPROM;
+      }
+      // Set up linear address
+      if (memoryRegionPtr->getAddressType() == AddrLinear) {
+         // Set Linear address
+         log.print("Setting Linear address\n");
+         addressFlag |= ADDRESS_LINEAR;
+      }
+   }
+   // Round start address off to alignment requirements
+   flashAddress  &= ~alignMask;
+
+   // Pad block size with odd leading bytes
+   blockSize += oddBytes;
+
+   // Pad block size to alignment requirements
+   blockSize = (blockSize+alignMask)&~alignMask;
+
+   progressTimer->progress(0, NULL);
+
+   // Data transfer overlaps target execution if supported
+   bool doubleBuffered = ((targetProgramInfo.capabilities&CAP_DOUBLE_BUFFER) != 0) && !checksumVerify &&
+                         ((flashOperation == OpProgram)||(flashOperation == OpVerify));
+   if (doubleBuffered) {
+      log.print("Using double-buffered transfer\n");
+      rc = startDoubleBufferedProgram();
+      if (rc != PROGRAMMING_RC_OK) {
+         return rc;
+      }
+   }
+   while (blockSize>0) {
+      unsigned flashIndex  = 0;
+      unsigned size        = 0;
+      // Determine size of block to process
+      unsigned int splitBlockSize = blockSize;
+      if (checksumVerify) {
+         // Limit size so a mismatch is localised
+         if (splitBlockSize>MaxChecksumBlockSize) {
+            splitBlockSize = MaxChecksumBlockSize;
+         }
+         flashIndex = (splitBlockSize+alignMask)&~alignMask;
+         size       = 0;
+      }
+      else if ((flashOperation == OpProgram)||(flashOperation == OpVerify)||(flashOperation == OpWriteRam)) {
+         // Requires data transfer using buffer
+         if (splitBlockSize>maxSplitBlockSize) {
+            splitBlockSize = maxSplitBlockSize;
+         }
+         // Pad any odd leading elements as 0xFF..
+         for (flashIndex=0; flashIndex<oddBytes; flashIndex++) {
+            bufferData[flashIndex] = (uint8_t)-1;
+         }
+         // Copy flash data to buffer
+         flashImage->getData(splitBlockSize, flashAddress, bufferData);
+         flashIndex = splitBlockSize;
+         // Pad trailing elements to aligned address
+         for (; (flashIndex&alignMask) != 0; flashIndex++) {
+            bufferData[flashIndex] = flashImage->getValue(flashAddress+flashIndex);
+         }
+         // Actual data bytes to write
+         size = flashIndex;
+      }
+      else {
+         // No data transfer so no size limits
+         flashIndex  = (blockSize+alignMask)&~alignMask;
+         size = 0;
+      }
+      uint32_t targetAddress = flashAddress-offset;
+      if (targetTraits.pagedAddresses && (memoryRegionPtr->getAddressType() != AddrLinear)) {
+         // Map paged address
+         uint8_t pageNo;
+         rc = getPageAddress(memoryRegionPtr, flashAddress, &pageNo);
+         if (rc != PROGRAMMING_RC_OK) {
+            return rc;
+         }
+         targetAddress = (pageNo<<16)|(flashAddress&0xFFFF);
+      }
+      flashOperationInfo.flashAddress = addressFlag|targetAddress;
+      flashOperationInfo.dataSize     = flashIndex;
+      if (splitBlockSize==0) {
+         log.error(" - Error: splitBlockSize size is 0\n");
+         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+      flashOperationInfo.pageAddress  = memoryRegionPtr->getPageAddress();
+
+      if (flashOperation == OpWriteRam) {
+         /*
+          * RAM Writes
+          */
+         log.print("ramBlock splitBlock %s, %s[0x%06X..0x%06X]\n",
+               MemoryRegion::getMemoryTypeName(memoryType), getMemSpaceName(memorySpace), targetAddress, targetAddress+splitBlockSize-1);
+         rc = bdmInterface->writeMemory(memorySpace, splitBlockSize, targetAddress, bufferData);
+      }
+      else {
+         /*
+          * Flash writes
+          */
+         log.print("splitBlock %s[0x%06X..0x%06X]\n",
+               MemoryRegion::getMemoryTypeName(memoryType), flashAddress-offset, flashAddress-offset+splitBlockSize-1);
+         log.print("flashOperationInfo.flashAddress = 0x%08X\n", flashOperationInfo.flashAddress);
+         if (doubleBuffered) {
+            rc = queueDoubleBufferedBlock(bufferData, size);
+         }
+         else {
+            rc = executeTargetProgram(buffer, size);
+         }
+         if ((rc == PROGRAMMING_RC_OK) && checksumVerify) {
+            rc = checkTargetChecksum(flashImage, flashAddress, flashIndex);
+         }
+      }
+      if (rc != PROGRAMMING_RC_OK) {
+         log.error("Error rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
+         return rc;
+      }
+      // Advance to next block of data
+      flashAddress  += splitBlockSize;
+      blockSize     -= splitBlockSize;
+      oddBytes       = 0; // No odd bytes on subsequent blocks
+      progressTimer->progress(splitBlockSize*sizeof(uint8_t), NULL);
+   }
+   if (doubleBuffered) {
+      rc = finishDoubleBufferedProgram();
+      if (rc != PROGRAMMING_RC_OK) {
+         log.error("Error rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
+         return rc;
+      }
+   }
+   return PROGRAMMING_RC_OK;
+}
+
+/**
+ * Read a header field in target byte order
+ *
+ * @param data  Field to read
+ * @param size  Size of field (2 or 4 bytes)
+ *
+ * @return Value
+ */
+uint32_t FlashProgrammerCommon::getTargetField(const uint8_t data[], unsigned size) const {
+   uint32_t value = 0;
+   for (unsigned index=0; index<size; index++) {
+      unsigned byteNum = targetTraits.bigEndian?index:(size-1-index);
+      value = (value<<8)|data[byteNum];
+   }
+   return value;
+}
+
+/**
+ * Write a header field in target byte order
+ *
+ * @param data   Field to write
+ * @param size   Size of field (2 or 4 bytes)
+ * @param value  Value to write
+ */
+void FlashProgrammerCommon::setTargetField(uint8_t data[], unsigned size, uint32_t value) const {
+   for (unsigned index=0; index<size; index++) {
+      unsigned byteNum = targetTraits.bigEndian?(size-1-index):index;
+      data[byteNum] = (uint8_t)value;
+      value >>= 8;
+   }
+}
+
+/**
+ * Executes target program (start and wait for completion)
+ *
+ * @param pBuffer   Buffer including space for header describing operation (may be NULL)
+ * @param dataSize  Size of data following header in bytes
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::executeTargetProgram(uint8_t *pBuffer, uint32_t dataSize) {
+   USBDM_ErrorCode rc = startTargetProgram(pBuffer, dataSize);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   return waitForTargetProgram();
+}
+
+/**
+ * Starts target program
+ *
+ * @param pBuffer     Buffer including space for header describing operation (may be NULL)
+ * @param dataSize    Size of data following header in bytes
+ * @param extraFlags  Additional action flags e.g. DO_DOUBLE_BUFFER
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::startTargetProgram(uint8_t *pBuffer, uint32_t dataSize, uint32_t extraFlags) {
+   LOGGING;
+   log.print("dataSize=0x%X\n", dataSize);
+
+   USBDM_ErrorCode rc = BDM_RC_OK;
+   uint8_t buffer[1000] = {0};
+   if (pBuffer == NULL) {
+      if (dataSize != 0) {
+         log.error("Error: No buffer but size non-zero\n");
+         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+      pBuffer = buffer;
+   }
+   if (targetProgramInfo.smallProgram) {
+      rc = initSmallTargetBuffer(pBuffer);
+   }
+   else {
+      rc = initLargeTargetBuffer(pBuffer);
+   }
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   if (extraFlags != 0) {
+      uint8_t *flags = pBuffer+targetTraits.flagsOffset;
+      setTargetField(flags, targetTraits.flagsSize, getTargetField(flags, targetTraits.flagsSize)|extraFlags);
+   }
+   return runTargetProgram(pBuffer, dataSize);
+}
+
+/**
+ * Writes header and data to target and starts target program
+ *
+ * @param pBuffer     Buffer including initialised header describing operation
+ * @param dataSize    Size of data following header in bytes
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::runTargetProgram(uint8_t *pBuffer, uint32_t dataSize) {
+   LOGGING_Q;
+
+   log.print("Writing Header+Data\n");
+
+   // Write the flash parameters & data to target memory
+   if (bdmInterface->writeMemory(targetTraits.headerMemorySpace,
+                   (targetProgramInfo.dataOffset+dataSize)*sizeof(uint8_t),
+                   targetProgramInfo.headerAddress,
+                   (uint8_t *)pBuffer) != BDM_RC_OK) {
+      return PROGRAMMING_RC_ERROR_BDM_WRITE;
+   }
+   // Set target PC to start of code & verify
+   uint32_t      entryPC = getTargetProgramPC();
+   unsigned long targetRegPC;
+   if (bdmInterface->writePC(entryPC) != BDM_RC_OK) {
+      log.error("PC write failed\n");
+      return PROGRAMMING_RC_ERROR_BDM_WRITE;
+   }
+   if (bdmInterface->readPC(&targetRegPC) != BDM_RC_OK) {
+      log.error("PC read failed\n");
+      return PROGRAMMING_RC_ERROR_BDM_READ;
+   }
+   if (entryPC != targetRegPC) {
+      log.error("PC verify failed\n");
+      return PROGRAMMING_RC_ERROR_BDM_WRITE;
+   }
+   // Execute the Flash program on target
+   if (bdmInterface->go() != BDM_RC_OK) {
+      log.error("bdmInterface->go() failed\n");
+      return PROGRAMMING_RC_ERROR_BDM;
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Waits for target program to complete and obtains the result
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::waitForTargetProgram() {
+   LOGGING;
+   USBDM_ErrorCode rc = BDM_RC_OK;
+
+   progressTimer->progress(0, NULL);
+#ifdef LOG
+   log.print("Polling");
+   int dotCount = 50;
+#endif
+   // Wait for target stop at execution completion
+   TargetProgramWait wait(*this, currentFlashOperation, flashOperationInfo.dataSize, flashOperationInfo.targetBusFrequency);
+   do {
+      wait.delay();
+#ifdef LOG
+      log.printq(".");
+      if (++dotCount == 100) {
+         log.printq("\n");
+         dotCount = 0;
+      }
+#endif
+      rc = getRunStatus();
+      if ((rc != BDM_RC_OK) && (rc != BDM_RC_BUSY)) {
+         log.printq("\n");
+         log.error("Status read failed\n");
+         break;
+      }
+      progressTimer->progress(0, NULL);
+   } while ((rc == BDM_RC_BUSY) && !wait.isTimedOut());
+   wait.stop();
+   log.printq("\n");
+   bdmInterface->halt();
+   unsigned long value;
+   bdmInterface->connect();
+   bdmInterface->readPC(&value);
+   log.print("Start PC = 0x%08lX, end PC = 0x%08lX\n", (unsigned long)getTargetProgramPC(), (unsigned long)value);
+
+   // Read the flash parameters back from target memory
+   uint8_t  executionResult[16];
+   unsigned resultSize = targetTraits.errorCodeOffset+2;
+   if (resultSize < (unsigned)(targetTraits.flagsOffset+targetTraits.flagsSize)) {
+      resultSize = targetTraits.flagsOffset+targetTraits.flagsSize;
+   }
+   // Round to 32-bit access
+   resultSize = (resultSize+3)&~3;
+   if (bdmInterface->readMemory(targetTraits.headerMemorySpace, resultSize,
+                  targetProgramInfo.headerAddress,
+                  executionResult) != BDM_RC_OK) {
+      return PROGRAMMING_RC_ERROR_BDM_READ;
+   }
+   uint16_t errorCode = getTargetField(executionResult+targetTraits.errorCodeOffset, 2);
+   if (wait.isTimedOut() && (errorCode == FLASH_ERR_OK)) {
+      errorCode = FLASH_ERR_TIMEOUT;
+      log.error("Error, Timeout waiting for completion.\n");
+   }
+   else if (errorCode == FLASH_ERR_OK) {
+      wait.complete();
+   }
+   if (targetProgramInfo.smallProgram) {
+      log.print("Complete, errCode=%d\n", errorCode);
+   }
+   else {
+      uint32_t flags = getTargetField(executionResult+targetTraits.flagsOffset, targetTraits.flagsSize);
+      if ((flags != targetTraits.completeFlag) && (errorCode == FLASH_ERR_OK)) {
+         errorCode = FLASH_ERR_UNKNOWN;
+         log.error("Error, Unexpected flag result.\n");
+      }
+      log.print("Complete, flags = 0x%08X, errCode=%d\n", flags, errorCode);
+   }
+   rc = convertTargetErrorCode((FlashDriverError_t)errorCode);
+   if (rc != BDM_RC_OK) {
+      log.error("Raw error code - %d\n", errorCode);
+      log.error("Error - %s\n", bdmInterface->getErrorString(rc));
+      reportTargetProgramFailure();
+   }
+   return rc;
+}
+
+/**
+ * Starts target program in double-buffered mode
+ *
+ * The target program processes blocks queued by queueDoubleBufferedBlock()
+ * until finishDoubleBufferedProgram() is called.
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * Target Memory map (RAM buffer)
+ * +---------------------------------------------------+
+ * |   LargeTargetFlashDataHeader      flashData;      |
+ * +---------------------------------------------------+
+ * |   DoubleBufferControl             bufferControl;  |
+ * +---------------------------------------------------+
+ * |   Data buffer 0 (maxDataSize)                     |
+ * +---------------------------------------------------+
+ * |   Data buffer 1 (maxDataSize)                     |
+ * +---------------------------------------------------+
+ */
+USBDM_ErrorCode FlashProgrammerCommon::startDoubleBufferedProgram() {
+   LOGGING_Q;
+
+   uint8_t buffer[100] = {0};
+   if ((targetProgramInfo.dataOffset > sizeof(buffer)) ||
+       (targetProgramInfo.dataOffset < targetTraits.headerSize+sizeof(DoubleBufferControl))) {
+      log.error("Header size inconsistent\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   uint32_t bufferAddress = targetProgramInfo.headerAddress+targetProgramInfo.dataOffset;
+   uint8_t *control       = buffer+targetTraits.headerSize;
+   setTargetField(control+offsetof(DoubleBufferControl, dataAddress[0]), 4, bufferAddress);
+   setTargetField(control+offsetof(DoubleBufferControl, dataAddress[1]), 4, bufferAddress+targetProgramInfo.maxDataSize);
+
+   nextDoubleBuffer  = 0;
+   flashOperationInfo.dataSize = 0;
+   return startTargetProgram(buffer, 0, DO_DOUBLE_BUFFER);
+}
+
+/**
+ * Waits for a double buffer to be released by the target
+ *
+ * @param bufferNum  Buffer to wait for (0 or 1)
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note If the target stops before releasing the buffer the result of the
+ *       target program is returned (an error if the target did not complete).
+ */
+USBDM_ErrorCode FlashProgrammerCommon::waitForDoubleBuffer(unsigned bufferNum) {
+   LOGGING_Q;
+
+   uint32_t controlAddress  = targetProgramInfo.headerAddress+targetTraits.headerSize;
+   uint32_t dataSizeAddress = controlAddress+offsetof(DoubleBufferControl, dataSize)+4*bufferNum;
+   uint8_t  dataSize[4];
+
+   // Buffer is released once the target has processed a full buffer at most.
+   // Not recorded by wait.complete() as the wait doesn't start with the block.
+   TargetProgramWait wait(*this, currentFlashOperation, targetProgramInfo.maxDataSize, flashOperationInfo.targetBusFrequency);
+   do {
+      if (bdmInterface->readMemory(targetTraits.headerMemorySpace, sizeof(dataSize), dataSizeAddress, dataSize) != BDM_RC_OK) {
+         log.error("Status read failed\n");
+         return PROGRAMMING_RC_ERROR_BDM_READ;
+      }
+      if (getTargetField(dataSize, sizeof(dataSize)) == 0) {
+         return BDM_RC_OK;
+      }
+      USBDM_ErrorCode rc = getRunStatus();
+      if (rc != BDM_RC_BUSY) {
+         // Target stopped early
+         log.error("Target stopped while buffer %d in use\n", bufferNum);
+         rc = waitForTargetProgram();
+         return (rc != BDM_RC_OK)?rc:PROGRAMMING_RC_ERROR_FAILED_FLASH_COMMAND;
+      }
+      progressTimer->progress(0, NULL);
+      wait.delay();
+   } while (!wait.isTimedOut());
+   log.error("Timeout waiting for buffer %d\n", bufferNum);
+   bdmInterface->halt();
+   return convertTargetErrorCode(FLASH_ERR_TIMEOUT);
+}
+
+/**
+ * Queues a block of data for the target program in double-buffered mode
+ *
+ * The block is written to the next free buffer while the target is processing
+ * the other buffer.
+ *
+ * @param data       Data to transfer
+ * @param dataSize   Size of data in bytes (<= targetProgramInfo.maxDataSize)
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note flashOperationInfo.flashAddress is the address for the data
+ */
+USBDM_ErrorCode FlashProgrammerCommon::queueDoubleBufferedBlock(const uint8_t *data, uint32_t dataSize) {
+   LOGGING_Q;
+
+   unsigned bufferNum = nextDoubleBuffer;
+   USBDM_ErrorCode rc = waitForDoubleBuffer(bufferNum);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   uint32_t controlAddress  = targetProgramInfo.headerAddress+targetTraits.headerSize;
+   uint32_t addressAddress  = controlAddress+offsetof(DoubleBufferControl, address)+4*bufferNum;
+   uint32_t dataSizeAddress = controlAddress+offsetof(DoubleBufferControl, dataSize)+4*bufferNum;
+   uint32_t bufferAddress   = targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+bufferNum*targetProgramInfo.maxDataSize;
+   uint8_t  address[4];
+   uint8_t  size[4];
+   setTargetField(address, sizeof(address), flashOperationInfo.flashAddress);
+   setTargetField(size,    sizeof(size),    dataSize);
+
+   // Size is written last as it hands the buffer to the target
+   MemorySpace_t memorySpace = targetTraits.headerMemorySpace;
+   USBDM_MemoryRequest requests[] = {
+      {memorySpace, dataSize,        bufferAddress,   (uint8_t *)data},
+      {memorySpace, sizeof(address), addressAddress,  address},
+      {memorySpace, sizeof(size),    dataSizeAddress, size},
+   };
+   log.print("Buffer %d <= [0x%08X..0x%08X]\n", bufferNum, flashOperationInfo.flashAddress, flashOperationInfo.flashAddress+dataSize-1);
+   if (bdmInterface->writeMemoryV(sizeof(requests)/sizeof(requests[0]), requests) != BDM_RC_OK) {
+      bdmInterface->halt();
+      return PROGRAMMING_RC_ERROR_BDM_WRITE;
+   }
+   nextDoubleBuffer = bufferNum^1;
+   return BDM_RC_OK;
+}
+
+/**
+ * Completes target program in double-buffered mode
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::finishDoubleBufferedProgram() {
+   LOGGING_Q;
+
+   unsigned bufferNum = nextDoubleBuffer;
+   USBDM_ErrorCode rc = waitForDoubleBuffer(bufferNum);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   uint32_t controlAddress = targetProgramInfo.headerAddress+targetTraits.headerSize;
+   uint8_t  size[4];
+   setTargetField(size, sizeof(size), DoubleBufferEnd);
+   if (bdmInterface->writeMemory(targetTraits.headerMemorySpace, sizeof(size),
+                                 controlAddress+offsetof(DoubleBufferControl, dataSize)+4*bufferNum, size) != BDM_RC_OK) {
+      bdmInterface->halt();
+      return PROGRAMMING_RC_ERROR_BDM_WRITE;
+   }
+   return waitForTargetProgram();
+}
+
+/**
+ * Check CRC calculated by target program (DO_CHECKSUM_RANGE) against flash image
+ *
+ * @param flashImage  Flash image to check against
+ * @param address     Start of range
+ * @param size        Size of range in bytes
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::checkTargetChecksum(FlashImagePtr flashImage, uint32_t address, uint32_t size) {
+   LOGGING_Q;
+   // Target returns result in dataAddress field of header
+   uint8_t result[4];
+   if (bdmInterface->readMemory(targetTraits.headerMemorySpace, sizeof(result),
+                  targetProgramInfo.headerAddress+targetTraits.dataAddressOffset,
+                  result) != BDM_RC_OK) {
+      return PROGRAMMING_RC_ERROR_BDM_READ;
+   }
+   uint32_t targetCrc = getTargetField(result, sizeof(result));
+   uint32_t imageCrc  = calculateImageCrc32(flashImage, address, size);
+   if (targetCrc != imageCrc) {
+      log.error("Block [0x%08X..0x%08X] failed, target CRC=0x%08X != image CRC=0x%08X\n",
+            address, address+size-1, targetCrc, imageCrc);
+      // Locate failure by reading back only this block
+      return readbackVerifyRange(flashImage, address, size);
+   }
+   log.print("Block [0x%08X..0x%08X] CRC=0x%08X => OK\n", address, address+size-1, imageCrc);
+   return PROGRAMMING_RC_OK;
+}
+
+/**
+ * Verifies a range of target memory against the flash image by reading back the target
+ *
+ * Used to confirm and locate a failure reported by a target checksum
+ * without reading back the entire image.
+ *
+ * @param flashImage  Flash image to check against
+ * @param address     Start of range (image address)
+ * @param size        Size of range in bytes
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::readbackVerifyRange(FlashImagePtr flashImage, uint32_t address, uint32_t size) {
+   LOGGING_Q;
+   const uint32_t MAX_BUFFER=0x800;
+   uint8_t targetBuffer[MAX_BUFFER];
+   uint8_t imageBuffer[MAX_BUFFER];
+
+   uint32_t      offset;
+   MemorySpace_t memorySpace = getTargetMemorySpace(address, offset);
+   if (!targetTraits.splitDataSpace && (((address|size) & ((memorySpace&MS_SIZE)-1)) != 0)) {
+      // Unaligned range
+      memorySpace = (MemorySpace_t)((memorySpace&~MS_SIZE)|MS_Byte);
+   }
+   while (size>0) {
+      uint32_t blockSize = (size>MAX_BUFFER)?MAX_BUFFER:size;
+      if (bdmInterface->readMemory(memorySpace, blockSize, address-offset, targetBuffer) != BDM_RC_OK) {
+         return PROGRAMMING_RC_ERROR_BDM_READ;
+      }
+      flashImage->getData(blockSize, address, imageBuffer);
+      if (memcmp(targetBuffer, imageBuffer, blockSize) != 0) {
+         uint32_t index = 0;
+         while (targetBuffer[index] == imageBuffer[index]) {
+            index++;
+         }
+         log.error("First failed location[0x%8.8X]=>failed, image=%2.2X != target=%2.2X\n",
+               address+index, imageBuffer[index], targetBuffer[index]);
+         return PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+      }
+      address += blockSize;
+      size    -= blockSize;
+   }
+   log.print("Read-back of block matches image\n");
+   return PROGRAMMING_RC_OK;
+}
+
+//! Guards the target program caches which are shared between programmer instances (gang programming)
+static pthread_mutex_t targetProgramCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//! Binary image of a target flash program
+struct TargetProgramImage {
+   std::vector<uint8_t> image;        //!< Image as loaded from S-records
+   uint32_t             loadAddress;  //!< Memory address for start of image
+};
+
+//! Parsed target flash programs indexed by S-record text (and word address flag)
+static std::map<std::string, TargetProgramImage> targetProgramImages;
+
+//! Description of code most recently written to target RAM by this process
+struct TargetProgramLoad {
+   uint32_t address;  //!< Target address of code
+   uint32_t size;     //!< Size of code in bytes
+   uint32_t crc;      //!< CRC-32 of code
+};
+
+//! Code most recently written to target RAM indexed by BDM serial number and target name
+static std::map<std::string, TargetProgramLoad> targetProgramLoads;
+
+/**
+ * Loads the default flash program for the device
+ *
+ * @param flashOperation   Intended operation in case of partial loading
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note - see loadTargetProgram(FlashProgramConstPtr, FlashOperation) for details
+ */
+USBDM_ErrorCode FlashProgrammerCommon::loadTargetProgram(FlashOperation flashOperation) {
+   LOGGING;
+   FlashProgramConstPtr flashProgram = device->getFlashProgram();
+   return loadTargetProgram(flashProgram, flashOperation);
+}
+
+/**
+ * Loads the flash program for an operation on a memory region
+ *
+ * @param memoryRegionPtr  Memory region being operated on
+ * @param flashOperation   Operation to do on flash
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note - Uses the device common flash program if the region does not have one
+ * @note - see loadTargetProgram(FlashProgramConstPtr, FlashOperation) for details
+ */
+USBDM_ErrorCode FlashProgrammerCommon::loadTargetProgram(MemoryRegionConstPtr memoryRegionPtr, FlashOperation flashOperation) {
+   LOGGING_Q;
+
+   FlashProgramConstPtr flashProgram = memoryRegionPtr->getFlashprogram();
+   if (!flashProgram) {
+      // Try to get device general routines
+      flashProgram = device->getCommonFlashProgram();
+   }
+   return loadTargetProgram(flashProgram, flashOperation);
+}
+
+/**
+ * Loads the given flash program
+ *
+ * @param flashProgram     Flash program to load
+ * @param flashOperation   Intended operation in case of partial loading
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note - Assumes the target has been connected to
+ *         Confirms download (if necessary) and checks RAM boundaries.
+ * @note - The program is only reloaded if the program, operation or alignment has changed
+ */
+USBDM_ErrorCode FlashProgrammerCommon::loadTargetProgram(FlashProgramConstPtr flashProgram, FlashOperation flashOperation) {
+   LOGGING;
+   uint8_t     buffer[4000] = {0};
+
+   log.print("Op=%s\n", getFlashOperationName(flashOperation));
+   switch(flashOperation) {
+      case OpSelectiveErase:
+      case OpBlockErase:
+      case OpBlankCheck:
+      case OpProgram:
+      case OpVerify:
+      case OpPartitionFlexNVM:
+      case OpTiming:
+         break;
+      default:
+         // All other operations don't require target Flash code
+         currentFlashOperation = OpNone;
+         log.print("No target program load needed\n");
+         return BDM_RC_OK;
+   }
+   // Check if we have a target flash programming code for this region
+   if (!flashProgram) {
+      log.error("Failed, no flash program found for target memory region\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   // Reload flash code if
+   //  - code changed
+   //  - operation changed
+   //  - alignment changed
+   if (currentFlashProgram != flashProgram)  {
+      log.print("Reloading due to change in flash code\n");
+   }
+   else if ((currentFlashOperation == OpNone) || (currentFlashOperation != flashOperation)) {
+      log.print("Reloading due to change in flash operation\n");
+   }
+   else if (currentFlashAlignment != flashOperationInfo.alignment) {
+      log.print("Reloading due to change in flash alignment\n");
+   }
+   else {
+      log.print("Re-using existing code\n");
+      return PROGRAMMING_RC_OK;
+   }
+   currentFlashOperation = OpNone;
+
+   unsigned size; // In uint8_t
+   uint32_t loadAddress;
+   USBDM_ErrorCode rc = getTargetProgramImage(flashProgram,
+                                              buffer,
+                                              sizeof(buffer)/sizeof(buffer[0]),
+                                              &size,
+                                              &loadAddress,
+                                              targetTraits.wordAddresses);
+   if (rc !=  BDM_RC_OK) {
+      log.error("Failed, getTargetProgramImage() failed\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+
+   // Find RAM region to use
+   device->getRamRegionFor(loadAddress, ramStart, ramEnd);
+   log.print("Using RAM region [0x%8X..0x%8X]\n", ramStart, ramEnd);
+
+   memset(&targetProgramInfo, 0, sizeof(targetProgramInfo));
+
+   // Probe RAM buffer (DSC data RAM is word addressed)
+   MemorySpace_t memorySpace = targetTraits.wordAddresses?MS_XWord:MS_Byte;
+   rc = probeMemory(memorySpace, ramStart);
+   if (rc == BDM_RC_OK) {
+      rc = probeMemory(memorySpace, ramEnd);
+   }
+   if (rc != BDM_RC_OK) {
+      log.error("Failed, probeMemory() failed\n");
+      return rc;
+   }
+   // LoadInfoStruct.flags is the first byte of the image
+   targetProgramInfo.smallProgram = targetTraits.smallPrograms && ((buffer[0]&OPT_SMALL_CODE) != 0);
+   if (targetProgramInfo.smallProgram) {
+      return loadSmallTargetProgram(buffer, loadAddress, size, flashProgram, flashOperation);
+   }
+   return loadLargeTargetProgram(buffer, loadAddress, size, flashProgram, flashOperation);
+}
+
+/**
+ * Loads a large target program image described by a LargeTargetImageHeader
+ *
+ * The relocated image is cached for the life of the process by program, RAM region,
+ * operation and alignment.  The code download is skipped if writeTargetProgramCode()
+ * confirms that the target RAM still holds an identical copy.
+ *
+ * @param buffer           Buffer containing program image
+ * @param loadAddress      Address to load image at
+ * @param size             Size of image in bytes
+ * @param flashProgram     Flash program corresponding to image
+ * @param flashOperation   Intended operation
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note - Assumes the target has been connected to
+ *         targetProgramInfo is updated with load information
+ */
+USBDM_ErrorCode FlashProgrammerCommon::loadLargeTargetProgram(uint8_t              *buffer,
+                                                              uint32_t              loadAddress,
+                                                              uint32_t              size,
+                                                              FlashProgramConstPtr  flashProgram,
+                                                              FlashOperation        flashOperation) {
+   LOGGING;
+   log.print("Op=%s\n", getFlashOperationName(flashOperation));
+
+   //! Target flash program after relocation to target RAM
+   struct RelocatedTargetProgram {
+      std::vector<uint8_t> image;            //!< Relocated image
+      uint32_t             codeLoadAddress;  //!< Target address of code
+      TargetProgramInfo    programInfo;      //!< Load information
+   };
+   //! Relocated target flash programs indexed by program, RAM region, operation and alignment
+   static std::map<std::string, RelocatedTargetProgram> relocatedTargetPrograms;
+
+   // The watchdog address is also patched into the image
+   uint32_t watchdogAddress = (targetTraits.watchdogAddressOffset != 0)?device->getWatchdogAddress():0;
+   char keySuffix[100];
+   snprintf(keySuffix, sizeof(keySuffix), ":%c:[0x%08X..0x%08X]:%s:%u:0x%08X",
+         targetTraits.wordAddresses?'W':'B', ramStart, ramEnd,
+         getFlashOperationName(flashOperation), flashOperationInfo.alignment, watchdogAddress);
+   std::string key = flashProgram->getFlashProgram()+keySuffix;
+
+   uint32_t codeLoadAddress;
+   pthread_mutex_lock(&targetProgramCacheMutex);
+   std::map<std::string, RelocatedTargetProgram>::iterator it = relocatedTargetPrograms.find(key);
+   if ((it != relocatedTargetPrograms.end()) && (it->second.image.size() == size)) {
+      const RelocatedTargetProgram &relocated = it->second;
+      memcpy(buffer, relocated.image.data(), size);
+      codeLoadAddress   = relocated.codeLoadAddress;
+      targetProgramInfo = relocated.programInfo;
+      pthread_mutex_unlock(&targetProgramCacheMutex);
+      log.print("Using cached relocated image, code[0x%06X...0x%06X]\n", codeLoadAddress, codeLoadAddress+size-1);
+   }
+   else {
+      pthread_mutex_unlock(&targetProgramCacheMutex);
+      USBDM_ErrorCode rc = relocateLargeTargetProgram(buffer, loadAddress, size, codeLoadAddress);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+      pthread_mutex_lock(&targetProgramCacheMutex);
+      RelocatedTargetProgram &relocated = relocatedTargetPrograms[key];
+      relocated.image.assign(buffer, buffer+size);
+      relocated.codeLoadAddress = codeLoadAddress;
+      relocated.programInfo     = targetProgramInfo;
+      pthread_mutex_unlock(&targetProgramCacheMutex);
+   }
+   if (currentFlashProgram != flashProgram)  {
+      log.print("Reloading due to change in flash code\n");
+      // Write the flash programming code to target memory
+      USBDM_ErrorCode rc = writeTargetProgramCode(targetTraits.codeMemorySpace, codeLoadAddress, size, buffer);
+      if (rc != BDM_RC_OK) {
+         return rc;
+      }
+   }
+   else {
+      log.print("Suppressing code load as unchanged\n");
+   }
+   currentFlashProgram   = flashProgram;
+   currentFlashOperation = flashOperation;
+   currentFlashAlignment = flashOperationInfo.alignment;
+
+   // Loaded routines support extended operations
+   targetProgramInfo.programOperation = DO_BLANK_CHECK_RANGE|DO_PROGRAM_RANGE|DO_VERIFY_RANGE;
+   return BDM_RC_OK;
+}
+
+/**
+ * Relocates a large target program image described by a LargeTargetImageHeader
+ *
+ * @param buffer           Buffer containing program image (modified)
+ * @param loadAddress      Address image was linked at
+ * @param size             Size of image in bytes
+ * @param codeLoadAddress  Address to load relocated code at
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note - Checks RAM boundaries using ramStart and ramEnd.
+ *         targetProgramInfo is updated with load information
+ * @note - Image addresses are scaled to byte addresses for word addressed targets (DSC)
+ *
+ * Target Memory map
+ * +---------------------------------------------------+ -+
+ * |   LargeTargetImageHeader  flashProgramHeader;     |  |
+ * +---------------------------------------------------+   > Unchanging written once
+ * |   Flash program code....                          |  |
+ * +---------------------------------------------------+ -+
+ */
+USBDM_ErrorCode FlashProgrammerCommon::relocateLargeTargetProgram(uint8_t  *buffer,
+                                                                  uint32_t  loadAddress,
+                                                                  uint32_t  size,
+                                                                  uint32_t &codeLoadAddress) {
+   LOGGING;
+
+   const unsigned addressScale = targetTraits.wordAddresses?2:1;
+   const unsigned addressSize  = targetTraits.imageAddressSize;
+
+   // Find 'header' in download image
+   uint32_t headerAddress = loadAddress;
+   if (!targetTraits.headerAtImageStart) {
+      headerAddress = addressScale*getTargetField(buffer, addressSize);
+   }
+   if ((headerAddress < loadAddress) || (headerAddress >= loadAddress+size)) {
+      log.error("Header ptr out of range\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   uint8_t *headerPtr = buffer+(headerAddress-loadAddress);
+
+   // Save the programming data structure
+   codeLoadAddress            = addressScale*getTargetField(headerPtr, addressSize);
+   uint32_t codeEntry         = addressScale*getTargetField(headerPtr+targetTraits.entryOffset, addressSize);
+   uint32_t capabilities      = getTargetField(headerPtr+targetTraits.capabilitiesOffset, targetTraits.capabilitiesSize);
+   uint32_t dataHeaderAddress = addressScale*getTargetField(headerPtr+targetTraits.flashDataOffset, addressSize);
+   uint32_t calibFrequency    = 0;
+   uint32_t calibFactor       = 1;
+   if (targetTraits.calibFrequencyOffset != 0) {
+      calibFrequency = getTargetField(headerPtr+targetTraits.calibFrequencyOffset, 2);
+   }
+   if (targetTraits.calibFactorOffset != 0) {
+      calibFactor = getTargetField(headerPtr+targetTraits.calibFactorOffset, 4);
+   }
+   log.print("Loaded Image (unmodified) :\n");
+   log.print("   flashProgramHeader headerAddress   = 0x%08X\n",     headerAddress);
+   log.print("   flashProgramHeader.loadAddress     = 0x%08X\n",     codeLoadAddress);
+   log.print("   flashProgramHeader.entry           = 0x%08X\n",     codeEntry);
+   log.print("   flashProgramHeader.capabilities    = 0x%08X(%s)\n", capabilities, getProgramCapabilityNames(capabilities));
+   log.print("   flashProgramHeader.flashData       = 0x%08X\n",     dataHeaderAddress);
+
+   if (codeLoadAddress != loadAddress) {
+      log.error("Inconsistent actual (0x%06X) and image load addresses (0x%06X).\n",
+            loadAddress, codeLoadAddress);
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   if ((capabilities&targetTraits.relocatableFlag)!=0) {
+      // Relocate Code
+      codeLoadAddress = (ramStart+3)&~3; // Relocate to start of RAM
+      if (loadAddress != codeLoadAddress) {
+         log.print("Loading at non-default address, load@0x%04X (relocated from=%04X)\n",
+               codeLoadAddress, loadAddress);
+         // Relocate entry point
+         codeEntry += codeLoadAddress - loadAddress;
+      }
+   }
+   if (targetTraits.splitDataSpace) {
+      // Code is in separate program memory - RAM region describes data memory
+      if ((capabilities&CAP_DSC_OVERLAY)!=0) {
+         // Loading code into shared RAM - load data offset by code size
+         log.print(" - loading data into overlaid RAM @ 0x%06X\n", dataHeaderAddress);
+      }
+      else {
+         // Loading code into separate program RAM - load data RAM separately
+         log.print(" - loading data into separate RAM @ 0x%06X\n", dataHeaderAddress);
+      }
+   }
+   else {
+      if ((codeLoadAddress < ramStart) || (codeLoadAddress > ramEnd)) {
+         log.error("Image load address (0x%8X) is invalid: range [0x%8X, 0x%8X].\n", codeLoadAddress, ramStart, ramEnd);
+         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+      if ((codeEntry < ramStart) || (codeEntry > ramEnd)) {
+         log.error("Image Entry point (0x%8X) is invalid: range [0x%8X, 0x%8X].\n", codeEntry, ramStart, ramEnd);
+         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+      }
+      if ((capabilities&CAP_DATA_FIXED)==0) {
+         // Relocate Data Entry to immediately after code (aligned for header access)
+         uint32_t headerAlignmentMask = (targetTraits.headerMemorySpace&MS_SIZE)-1;
+         dataHeaderAddress = (codeLoadAddress+size+headerAlignmentMask)&~headerAlignmentMask;
+         log.print("Relocating flashData @ 0x%06X\n", dataHeaderAddress);
+      }
+   }
+   if (targetTraits.wordAddresses) {
+      // DoubleBufferControl uses byte addresses
+      capabilities &= ~CAP_DOUBLE_BUFFER;
+   }
+   bool doubleBuffered = (capabilities&CAP_DOUBLE_BUFFER)!=0;
+
+   // Required flash flashAlignmentMask
+   uint32_t flashAlignmentMask = flashOperationInfo.alignment-1;
+   uint32_t procAlignmentMask  = targetTraits.codeAlignment-1;
+
+   // Save location of entry point
+   targetProgramInfo.entry        = codeEntry;
+   // Were to load flash buffer (including header)
+   targetProgramInfo.headerAddress  = dataHeaderAddress;
+   // Save offset of RAM data buffer
+   uint32_t dataLoadAddress = dataHeaderAddress+targetTraits.headerSize;
+   if (doubleBuffered) {
+      // Buffer control follows header
+      dataLoadAddress += sizeof(DoubleBufferControl);
+   }
+   // Align buffer address to worse case alignment for processor read
+   dataLoadAddress = (dataLoadAddress+procAlignmentMask)&~procAlignmentMask;
+   targetProgramInfo.dataOffset   = dataLoadAddress-dataHeaderAddress;
+   // Save maximum size of the buffer (in uint8_t)
+   targetProgramInfo.maxDataSize  = ramEnd-dataLoadAddress+1;
+   if (doubleBuffered) {
+      // RAM is shared by two buffers
+      targetProgramInfo.maxDataSize /= 2;
+   }
+   // Align buffer size to worse case alignment for processor read
+   targetProgramInfo.maxDataSize  = targetProgramInfo.maxDataSize&~procAlignmentMask;
+   // Align buffer size to flash alignment requirement
+   targetProgramInfo.maxDataSize  = targetProgramInfo.maxDataSize&~flashAlignmentMask;
+   // Save target program capabilities
+   targetProgramInfo.capabilities   = capabilities;
+   // Save clock calibration factor
+   targetProgramInfo.calibFrequency = calibFrequency;
+   targetProgramInfo.calibFactor    = calibFactor;
+
+   log.print("AlignmentMask=0x%08X\n",
+         flashAlignmentMask);
+   log.print("Program code[0x%06X...0x%06X]\n",
+         codeLoadAddress, codeLoadAddress+size-1);
+   log.print("Parameters[0x%06X...0x%06X]\n",
+         targetProgramInfo.headerAddress,
+         targetProgramInfo.headerAddress+targetProgramInfo.dataOffset-1);
+   log.print("RAM buffer[0x%06X...0x%06X]%s\n",
+         targetProgramInfo.headerAddress+targetProgramInfo.dataOffset,
+         targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+targetProgramInfo.maxDataSize-1,
+         doubleBuffered?" x 2":"");
+   log.print("Entry=0x%06X\n", targetProgramInfo.entry);
+
+   if ((codeLoadAddress & procAlignmentMask) != 0) {
+      log.error("CodeLoadAddress is not aligned\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   if (((targetProgramInfo.headerAddress+targetProgramInfo.dataOffset) & procAlignmentMask) != 0) {
+      log.error("FlashProgramHeader.dataOffset is not aligned\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   // Thumb entry points have bit 0 set
+   uint32_t entryAlignment = targetTraits.thumbEntry?1:0;
+   if ((targetProgramInfo.entry & procAlignmentMask) != entryAlignment) {
+      log.error("FlashProgramHeader.entry is not aligned\n");
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   // Sanity check buffer
+   unsigned bufferCount = doubleBuffered?2:1;
+   if (((uint32_t)(targetProgramInfo.headerAddress+targetProgramInfo.dataOffset)<ramStart) ||
+       ((uint32_t)(targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+bufferCount*targetProgramInfo.maxDataSize-1)>ramEnd)) {
+      log.error("Data buffer location [0x%06X..0x%06X] is outside target RAM [0x%06X-0x%06X]\n",
+            targetProgramInfo.headerAddress+targetProgramInfo.dataOffset,
+            targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+bufferCount*targetProgramInfo.maxDataSize-1,
+            ramStart, ramEnd);
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   if (targetProgramInfo.maxDataSize<40) {
+      log.error("Data buffer is too small - 0x%X \n", targetProgramInfo.maxDataSize);
+      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+   }
+   setTargetField(headerPtr+targetTraits.flashDataOffset, addressSize, targetProgramInfo.headerAddress/addressScale);
+   if (targetTraits.watchdogAddressOffset != 0) {
+      setTargetField(headerPtr+targetTraits.watchdogAddressOffset, addressSize, device->getWatchdogAddress());
+   }
+   log.print("Loaded Image (modified) :\n");
+   log.print("   flashProgramHeader.loadAddress     = 0x%08X\n",      getTargetField(headerPtr, addressSize));
+   log.print("   flashProgramHeader.entry           = 0x%08X\n",      getTargetField(headerPtr+targetTraits.entryOffset, addressSize));
+   log.print("   flashProgramHeader.capabilities    = 0x%08X(%s)\n",  capabilities, getProgramCapabilityNames(capabilities));
+   log.print("   flashProgramHeader.flashData       = 0x%08X\n",      getTargetField(headerPtr+targetTraits.flashDataOffset, addressSize));
+   if (targetTraits.watchdogAddressOffset != 0) {
+      log.print("   flashProgramHeader.watchdogAddress = 0x%08X\n",   getTargetField(headerPtr+targetTraits.watchdogAddressOffset, addressSize));
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Loads a small target program image (routine for single operation)
+ *
+ * @param buffer           Buffer containing program image
+ * @param loadAddress      Address to load image at
+ * @param size             Size of image in bytes
+ * @param flashProgram     Flash program corresponding to image
+ * @param flashOperation   Intended operation
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note Back ends setting TargetTraits::smallPrograms must override this
+ */
+USBDM_ErrorCode FlashProgrammerCommon::loadSmallTargetProgram(uint8_t              *buffer,
+                                                              uint32_t              loadAddress,
+                                                              uint32_t              size,
+                                                              FlashProgramConstPtr  flashProgram,
+                                                              FlashOperation        flashOperation) {
+   LOGGING_Q;
+   log.error("Small target programs not supported\n");
+   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+}
+
+/**
+ * Get names of actions in target program flags
+ *
+ * @param actions  Flags to describe
+ *
+ * @return pointer to static string buffer describing the actions
+ */
+const char *FlashProgrammerCommon::getProgramActionNames(unsigned int actions) const {
+   unsigned index;
+   static thread_local char buff[250] = "";
+   static const char *actionTable[] = {
+         "DO_INIT_FLASH|",         // Do initialisation of flash
+         "DO_ERASE_BLOCK|",        // Mass erase device
+         "DO_ERASE_RANGE|",        // Erase range (including option region)
+         "DO_BLANK_CHECK_RANGE|",  // Blank check region
+         "DO_PROGRAM_RANGE|",      // Program range (including option region)
+         "DO_VERIFY_RANGE|",       // Verify range
+         "??|",
+         "DO_PARTITION_FLEXNVM|",  // Partition FlexNVM boundary
+         "DO_TIMING_LOOP|",        // Execute timing loop on target
+         "DO_DOUBLE_BUFFER|",      // Process data from double buffers
+         "DO_CHECKSUM_RANGE|",     // Calculate CRC of range
+   };
+   buff[0] = '\0';
+   for (index=0;
+        index<sizeof(actionTable)/sizeof(actionTable[0]);
+         index++) {
+      uint32_t mask = 1<<index;
+      if ((actions&mask) != 0) {
+         strcat(buff,actionTable[index]);
+         actions &= ~mask;
+      }
+   }
+   if (actions&targetTraits.completeFlag) {
+      actions &= ~targetTraits.completeFlag;
+      strcat(buff,"IS_COMPLETE|");
+   }
+   if (actions != 0) {
+      strcat(buff,"???");
+   }
+   return buff;
+}
+
+/**
+ * Get names of target program capabilities
+ *
+ * @param capabilities  Capabilities to describe
+ *
+ * @return pointer to static string buffer describing the capabilities
+ */
+const char *FlashProgrammerCommon::getProgramCapabilityNames(unsigned int capabilities) const {
+   unsigned index;
+   static thread_local char buff[250] = "";
+   static const char *capabilityTable[] = {
+         "??|",                     // Do initialisation of flash
+         "CAP_ERASE_BLOCK|",        // Mass erase device
+         "CAP_ERASE_RANGE|",        // Erase range (including option region)
+         "CAP_BLANK_CHECK_RANGE|",  // Blank check region
+         "CAP_PROGRAM_RANGE|",      // Program range (including option region)
+         "CAP_VERIFY_RANGE|",       // Verify range
+         "??|",
+         "CAP_PARTITION_FLEXNVM|",  // Partition FlexNVM boundary
+         "CAP_TIMING|",             // Execute timing loop on target
+   };
+
+   buff[0] = '\0';
+   for (index=0;
+         index<sizeof(capabilityTable)/sizeof(capabilityTable[0]);
+         index++) {
+      if ((capabilities&(1<<index)) != 0) {
+         strcat(buff,capabilityTable[index]);
+      }
+   }
+   if (capabilities&CAP_DSC_OVERLAY) {
+      strcat(buff,"CAP_DSC_OVERLAY|");
+   }
+   if (capabilities&CAP_DATA_FIXED) {
+      strcat(buff,"CAP_DATA_FIXED|");
+   }
+   if (capabilities&CAP_DOUBLE_BUFFER) {
+      strcat(buff,"CAP_DOUBLE_BUFFER|");
+   }
+   if (capabilities&CAP_CHECKSUM_RANGE) {
+      strcat(buff,"CAP_CHECKSUM_RANGE|");
+   }
+   if (capabilities&targetTraits.relocatableFlag) {
+      strcat(buff,"CAP_RELOCATABLE");
+   }
+   return buff;
+}
+
+/**
+ * Initialise the header at the start of the buffer for a large target program
+ *
+ * @param buffer  Buffer to initialise
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note Back ends using executeTargetProgram() must override this
+ */
+USBDM_ErrorCode FlashProgrammerCommon::initLargeTargetBuffer(uint8_t *buffer) {
+   LOGGING_Q;
+   log.error("Large buffer not supported\n");
+   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+}
+
+/**
+ * Initialise the header at the start of the buffer for a small target program
+ *
+ * @param buffer  Buffer to initialise
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::initSmallTargetBuffer(uint8_t *buffer) {
+   LOGGING_Q;
+   log.error("Small buffer not supported\n");
+   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+}
+
+/**
+ * Check if the target is executing
+ *
+ * @return BDM_RC_BUSY if running, BDM_RC_OK if halted, otherwise error code see \ref USBDM_ErrorCode.
+ *
+ * @note Back ends using executeTargetProgram() must override this
+ */
+USBDM_ErrorCode FlashProgrammerCommon::getRunStatus(void) {
+   LOGGING_Q;
+   log.error("Run status not supported\n");
+   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+}
+
+/**
+ * Convert the error code returned by the target program
+ *
+ * @param rc  Code returned by target program
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::convertTargetErrorCode(FlashDriverError_t rc) {
+   return (rc == FLASH_ERR_OK)?PROGRAMMING_RC_OK:PROGRAMMING_RC_ERROR_FAILED_FLASH_COMMAND;
+}
+
+/**
+ * Get page number for a paged address
+ *
+ * @param memoryRegionPtr  Memory region containing address
+ * @param address          Address to map
+ * @param pageNo           Page number for address
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note Back ends setting TargetTraits::pagedAddresses must override this
+ */
+USBDM_ErrorCode FlashProgrammerCommon::getPageAddress(MemoryRegionConstPtr memoryRegionPtr, uint32_t address, uint8_t *pageNo) {
+   LOGGING_Q;
+   log.error("Paged addresses not supported\n");
+   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
+}
+
+/**
+ * Verifies the target memory against flash image by reading back the target
+ *
+ * @param flashImage Description of flash contents to be verified.
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note Assumes the target device has already been opened & USBDM options set.
+ * @note Assumes target connection has been established
+ * @note Assumes call-back has been set up if used.
+ * @note If target clock trimming is enabled then the Non-volatile clock trim
+ *       locations are ignored.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::doReadbackVerify(FlashImagePtr flashImage) {
+   LOGGING;
+   const unsigned MAX_BUFFER=0x800;
+   uint8_t buffer[MAX_BUFFER];
+   int checkResult = TRUE;
+   int blockResult;
+
+   flashImage->printMemoryMap();
+
+   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
+   if (!enumerator->isValid()) {
+      log.print("Empty Memory region\n");
+      flashImage->printMemoryMap();
+   }
+   while (enumerator->isValid()) {
+      uint32_t imageAddress    = enumerator->getAddress();
+      uint32_t memoryAddress;
+
+      if (targetTraits.setPagesForReadback) {
+         USBDM_ErrorCode rc = setPageRegisters(imageAddress);
+         if (rc != PROGRAMMING_RC_OK) {
+            return rc;
+         }
+      }
+      uint32_t      offset;
+      MemorySpace_t memorySpace = getTargetMemorySpace(imageAddress, offset);
+
+      // Find end of block to verify
+      enumerator->lastValid();
+      unsigned regionSize = enumerator->getAddress() - imageAddress + 1;
+
+      memoryAddress = imageAddress-offset;
+      log.print("Verifying Block %s[0x%8.8X..0x%8.8X]\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+regionSize-1);
+
+      __attribute__((unused))
+      bool  reportedError = false;
+
+      while (regionSize>0) {
+         // Get memory block containing address
+         MemoryRegionConstPtr memRegion = device->getMemoryRegionFor(memoryAddress, memorySpace);
+         if (memRegion == NULL) {
+            log.error("Verifying Block %s[0x%8.8X..0x%8.8X] - Not in valid memory region\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+regionSize-1);
+            return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
+         }
+         if (targetTraits.limitToRegionAlignment && (memRegion->getAlignment()<memorySpace)) {
+            memorySpace = (MemorySpace_t)memRegion->getAlignment();
+         }
+         // Get size of continuous block containing address
+         uint32_t lastContinuous=0;
+         memRegion->findLastContiguous(memoryAddress, &lastContinuous);
+         uint32_t continousBlockSize = lastContinuous+1-(memoryAddress);
+
+         unsigned blockSize = regionSize;
+         if (blockSize > continousBlockSize) {
+            blockSize = continousBlockSize;
+         }
+
+         if (blockSize > MAX_BUFFER) {
+            blockSize = MAX_BUFFER;
+         }
+         if (!targetTraits.splitDataSpace) {
+            // Change alignment to match item if necessary
+            if ((imageAddress & ((memorySpace&MS_SIZE)-1)) != 0) {
+               // Unaligned start address
+               memorySpace = (MemorySpace_t)((memorySpace&~MS_SIZE)|MS_Byte);
+            }
+            if (((imageAddress+blockSize) & ((memorySpace&MS_SIZE)-1)) != 0) {
+               // Unaligned end address
+               memorySpace = (MemorySpace_t)((memorySpace&~MS_SIZE)|MS_Byte);
+            }
+         }
+         if (bdmInterface->readMemory(memorySpace, blockSize*sizeof(uint8_t), memoryAddress, (uint8_t *)buffer) != BDM_RC_OK) {
+            return PROGRAMMING_RC_ERROR_BDM_READ;
+         }
+         blockResult = TRUE;
+         uint32_t testIndex;
+         for (testIndex=0; testIndex<blockSize; testIndex++) {
+            if (flashImage->getValue(imageAddress+testIndex) != buffer[testIndex]) {
+               blockResult = FALSE;
+#ifndef LOG
+               break;
+#else
+               if (!reportedError) {
+                  log.print("First failed location[0x%8.8X]=>failed, image=%2.2X != target=%2.2X\n",
+                     imageAddress+testIndex,
+                     (uint8_t)(flashImage->getValue(imageAddress+testIndex)),
+                     buffer[testIndex]);
+                  // Dump region around error
+                  uint32_t start = 0;
+                  if ((imageAddress+testIndex)>31) {
+                     start = (imageAddress+testIndex-31);
+                  }
+                  uint32_t end = 0xFFFFFFFF;
+                  if ((imageAddress+testIndex)<(end-31)) {
+                     end = imageAddress+testIndex;
+                  }
+                  start &= ~0xFUL;
+                  end   |= 0xFUL;
+                  log.print("[0x%08X..0x%08X]\n", start, end);
+                  flashImage->dumpRange(start, end);
+                  reportedError = true;
+                  uint8_t tBuff[end-start+1];
+                  if (bdmInterface->readMemory(memorySpace, (end-start+1), start-offset, (uint8_t *)tBuff) == BDM_RC_OK) {
+                     log.printDump(tBuff, (end-start+1), start-offset);
+                  }
+               }
+#endif
+            }
+         }
+         log.print("Verified Sub-block %s[0x%8.8X..0x%8.8X] => %s\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+blockSize-1, blockResult?"OK":"FAIL");
+         checkResult    = checkResult && blockResult;
+         regionSize    -= blockSize;
+         imageAddress  += blockSize;
+         memoryAddress  = imageAddress-offset;
+         progressTimer->progress(blockSize, NULL);
+#ifndef LOG
+         if (!checkResult) {
+            break;
+         }
+#endif
+      }
+#ifndef LOG
+      if (!checkResult) {
+         break;
+      }
+#endif
+      // Advance to start of next occupied region
+      enumerator->nextValid();
+   }
+   return checkResult?PROGRAMMING_RC_OK:PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+}
+
+/**
+ * Calculate CRC-32 (IEEE 802.3) of a range of a flash image
+ *
+ * Matches the value returned by target flash routines for DO_VERIFY_RANGE|DO_CHECKSUM_RANGE.
+ * Unused locations are included as erased (0xFF).
+ *
+ * @param flashImage    Image to use
+ * @param address       Start of range
+ * @param size          Size of range in bytes
+ *
+ * @return CRC-32 value
+ */
+uint32_t FlashProgrammerCommon::calculateImageCrc32(FlashImagePtr flashImage, uint32_t address, uint32_t size) {
+   const uint32_t MAX_BUFFER=0x800;
+   uint8_t buffer[MAX_BUFFER];
+   uint32_t crc = 0xFFFFFFFFUL;
+   while (size>0) {
+      uint32_t blockSize = (size>MAX_BUFFER)?MAX_BUFFER:size;
+      flashImage->getData(blockSize, address, buffer);
+      crc = updateCrc32(crc, buffer, blockSize);
+      address += blockSize;
+      size    -= blockSize;
+   }
+   return ~crc;
+}
+
+/**
+ * Calculate CRC-32 (IEEE 802.3) of a buffer
+ *
+ * @param data          Data to use
+ * @param size          Size of data in bytes
+ *
+ * @return CRC-32 value
+ */
+uint32_t FlashProgrammerCommon::calculateCrc32(const uint8_t data[], uint32_t size) {
+   return ~updateCrc32(0xFFFFFFFFUL, data, size);
+}
+
+/**
+ * Get the binary image of a target flash program
+ *
+ * The S-records are only parsed on first use.  Images are cached for the life
+ * of the process and shared between programmer instances.
+ *
+ * @param flashProgram   Flash program to obtain image of
+ * @param buffer         Buffer for the image
+ * @param bufferSize     Size of buffer
+ * @param loadedSize     Size of loaded image
+ * @param loadAddress    Memory address for start of buffer
+ * @param wordAddresses  S-records use word addresses (DSC)
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ */
+USBDM_ErrorCode FlashProgrammerCommon::getTargetProgramImage(FlashProgramConstPtr flashProgram,
+                                                             uint8_t              buffer[],
+                                                             unsigned             bufferSize,
+                                                             unsigned            *loadedSize,
+                                                             uint32_t            *loadAddress,
+                                                             bool                 wordAddresses) {
+   LOGGING_Q;
+
+   std::string key = flashProgram->getFlashProgram();
+   if (wordAddresses) {
+      key += ":W";
+   }
+   pthread_mutex_lock(&targetProgramCacheMutex);
+   std::map<std::string, TargetProgramImage>::iterator it = targetProgramImages.find(key);
+   if (it == targetProgramImages.end()) {
+      unsigned size;
+      uint32_t address;
+      USBDM_ErrorCode rc = loadSRec(flashProgram->getFlashProgram().c_str(), buffer, bufferSize, &size, &address, wordAddresses);
+      if (rc != BDM_RC_OK) {
+         pthread_mutex_unlock(&targetProgramCacheMutex);
+         return rc;
+      }
+      log.print("Caching parsed image [0x%06X..0x%06X]\n", address, address+size-1);
+      TargetProgramImage &programImage = targetProgramImages[key];
+      programImage.image.assign(buffer, buffer+size);
+      programImage.loadAddress = address;
+      *loadedSize  = size;
+      *loadAddress = address;
+      pthread_mutex_unlock(&targetProgramCacheMutex);
+      return BDM_RC_OK;
+   }
+   const TargetProgramImage &programImage = it->second;
+   if (programImage.image.size() > bufferSize) {
+      pthread_mutex_unlock(&targetProgramCacheMutex);
+      log.error("Buffer too small for cached image\n");
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   // Image is modified (relocated) by caller so provide a copy
+   memcpy(buffer, programImage.image.data(), programImage.image.size());
+   *loadedSize  = programImage.image.size();
+   *loadAddress = programImage.loadAddress;
+   log.print("Using cached image [0x%06X..0x%06X]\n", *loadAddress, *loadAddress+*loadedSize-1);
+   pthread_mutex_unlock(&targetProgramCacheMutex);
+   return BDM_RC_OK;
+}
+
+/**
+ * Write target flash program code to target RAM
+ *
+ * The download is skipped if this process last loaded identical code at the same
+ * address using the same BDM and checkTargetProgramCode() confirms that the target
+ * still holds it.
+ *
+ * @param memorySpace      Memory space for write
+ * @param codeLoadAddress  Target address to load code at
+ * @param codeLoadSize     Size of code in bytes
+ * @param code             Code to load (after relocation)
+ *
+ * @return error code see \ref USBDM_ErrorCode.
+ *
+ * @note targetProgramInfo must describe the code being loaded
+ */
+USBDM_ErrorCode FlashProgrammerCommon::writeTargetProgramCode(MemorySpace_t memorySpace, uint32_t codeLoadAddress, uint32_t codeLoadSize, const uint8_t code[]) {
+   LOGGING_Q;
+
+   std::string key = bdmInterface->getBdmSerialNumber();
+   if (device != nullptr) {
+      key += ":" + device->getTargetName();
+   }
+   TargetProgramLoad load = {codeLoadAddress, codeLoadSize, calculateCrc32(code, codeLoadSize)};
+
+   pthread_mutex_lock(&targetProgramCacheMutex);
+   std::map<std::string, TargetProgramLoad>::iterator it = targetProgramLoads.find(key);
+   bool previouslyLoaded = (it != targetProgramLoads.end()) &&
+                           (it->second.address == load.address) &&
+                           (it->second.size    == load.size) &&
+                           (it->second.crc     == load.crc);
+   // Forget load until confirmed
+   targetProgramLoads.erase(key);
+   pthread_mutex_unlock(&targetProgramCacheMutex);
+
+   if (previouslyLoaded && (checkTargetProgramCode(memorySpace, codeLoadAddress, codeLoadSize, code) == PROGRAMMING_RC_OK)) {
+      log.print("Suppressing code load as already present [0x%06X..0x%06X]\n", codeLoadAddress, codeLoadAddress+codeLoadSize-1);
+   }
+   else {
+      // Write the flash programming code to target memory
+      USBDM_ErrorCode rc = bdmInterface->writeMemory(memorySpace, codeLoadSize, codeLoadAddress, code);
+      if (rc != BDM_RC_OK) {
+         log.print("bdmInterface->writeMemory() Failed, rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
+         return PROGRAMMING_RC_ERROR_BDM_WRITE;
+      }
+   }
+   pthread_mutex_lock(&targetProgramCacheMutex);
+   targetProgramLoads[key] = load;
+   pthread_mutex_unlock(&targetProgramCacheMutex);
+   return BDM_RC_OK;
+}
+
+/**
+ * Check that target RAM holds a copy of the target flash program code
+ *
+ * The start of the code and the code at the entry point are read back first so the
+ * program is only run if it is plausibly intact.  The program then calculates the CRC
+ * of its own code (DO_VERIFY_RANGE|DO_CHECKSUM_RANGE) which is compared against the code.
+ *
+ * @param memorySpace      Memory space of code
+ * @param codeLoadAddress  Target address of code
+ * @param codeLoadSize     Size of code in bytes
+ * @param code             Expected code (after relocation)
+ *
+ * @return PROGRAMMING_RC_OK if the target copy matches the code, error code otherwise
+ *
+ * @note targetProgramInfo must describe the code
+ */
+USBDM_ErrorCode FlashProgrammerCommon::checkTargetProgramCode(MemorySpace_t memorySpace, uint32_t codeLoadAddress, uint32_t codeLoadSize, const uint8_t code[]) {
+   LOGGING_Q;
+
+   if ((targetTraits.dataAddressOffset == 0) || ((targetProgramInfo.capabilities&CAP_CHECKSUM_RANGE) == 0)) {
+      log.print("Target program doesn't support checksum - reloading\n");
+      return PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+   }
+   // Size of code samples read back before running code
+   const uint32_t SAMPLE_SIZE = 64;
+   const uint32_t sampleOffsets[] = {0, (targetProgramInfo.entry-codeLoadAddress)&~3};
+   for (unsigned index=0; index<sizeof(sampleOffsets)/sizeof(sampleOffsets[0]); index++) {
+      uint32_t offset = sampleOffsets[index];
+      if (offset >= codeLoadSize) {
+         log.print("Entry point outside code - reloading\n");
+         return PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+      }
+      uint32_t sampleSize = codeLoadSize-offset;
+      if (sampleSize > SAMPLE_SIZE) {
+         sampleSize = SAMPLE_SIZE;
+      }
+      // Keep to whole memory accesses
+      sampleSize &= ~3;
+      uint8_t sample[SAMPLE_SIZE];
+      if (bdmInterface->readMemory(memorySpace, sampleSize, codeLoadAddress+offset, sample) != BDM_RC_OK) {
+         return PROGRAMMING_RC_ERROR_BDM_READ;
+      }
+      if (memcmp(sample, code+offset, sampleSize) != 0) {
+         log.print("Code sample @0x%06X has changed - reloading\n", codeLoadAddress+offset);
+         return PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+      }
+   }
+   // Have the target program checksum its own code
+   FlashOperation savedOperation   = currentFlashOperation;
+   uint32_t       savedAddress     = flashOperationInfo.flashAddress;
+   uint32_t       savedSize        = flashOperationInfo.dataSize;
+   currentFlashOperation           = OpVerify;
+   flashOperationInfo.flashAddress = codeLoadAddress;
+   flashOperationInfo.dataSize     = codeLoadSize;
+
+   uint8_t buffer[1000] = {0};
+   USBDM_ErrorCode rc = initLargeTargetBuffer(buffer);
+   if (rc == BDM_RC_OK) {
+      // Checksum only - flash controller is not used
+      setTargetField(buffer+targetTraits.flagsOffset, targetTraits.flagsSize, DO_VERIFY_RANGE|DO_CHECKSUM_RANGE);
+      rc = runTargetProgram(buffer, 0);
+   }
+   if (rc == BDM_RC_OK) {
+      rc = waitForTargetProgram();
+   }
+   currentFlashOperation           = savedOperation;
+   flashOperationInfo.flashAddress = savedAddress;
+   flashOperationInfo.dataSize     = savedSize;
+   if (rc != BDM_RC_OK) {
+      log.print("Checksum of code failed, rc = %d - reloading\n", rc);
+      return rc;
+   }
+   // Target returns result in dataAddress field of header
+   uint8_t result[4];
+   if (bdmInterface->readMemory(targetTraits.headerMemorySpace, sizeof(result),
+                  targetProgramInfo.headerAddress+targetTraits.dataAddressOffset,
+                  result) != BDM_RC_OK) {
+      return PROGRAMMING_RC_ERROR_BDM_READ;
+   }
+   uint32_t targetCrc = getTargetField(result, sizeof(result));
+   uint32_t codeCrc   = calculateCrc32(code, codeLoadSize);
+   if (targetCrc != codeCrc) {
+      log.print("Code CRC=0x%08X != target CRC=0x%08X - reloading\n", codeCrc, targetCrc);
+      return PROGRAMMING_RC_ERROR_FAILED_VERIFY;
+   }
+   log.print("Code [0x%06X..0x%06X] CRC=0x%08X => OK\n", codeLoadAddress, codeLoadAddress+codeLoadSize-1, codeCrc);
+   return PROGRAMMING_RC_OK;
+}
+
 /**
  * Get erase method to use
  *
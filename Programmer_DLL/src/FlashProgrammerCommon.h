@@ -8,6 +8,8 @@
 #ifndef SRC_FLASHPROGRAMMERCOMMON_H_
 #define SRC_FLASHPROGRAMMERCOMMON_H_
 
+#include <vector>
+
 #include "FlashProgrammer.h"
 #include "UsbdmTclInterpreter.h"
 #include "BdmInterface.h"
@@ -18,7 +20,48 @@ class ProgressTimer;
 class FlashProgrammerCommon : public FlashProgrammer {
 
 public:
-   FlashProgrammerCommon(DeviceData::EraseMethod defaultEraseMethod, DeviceData::ResetMethod defaultResetMethod);
+   /**
+    * Describes the target for the flash operations shared by all back ends
+    *
+    * This file is built without TARGET being defined so each back end provides
+    * a constant description of its target when constructed.
+    */
+   struct TargetTraits {
+      TargetType_t   targetType;             //!< Target type
+      MemorySpace_t  memorySpace;            //!< Preferred memory space for bulk target access e.g. read-back
+      bool           splitDataSpace;         //!< Image addresses from FlashImage::DataOffset are DATA (X:) memory (DSC)
+      bool           limitToRegionAlignment; //!< Reduce access size to alignment of memory region (ARM)
+      bool           pagedAddresses;         //!< Image addresses above 0xFFFF are paged and not directly accessible
+      bool           setPagesForReadback;    //!< Set page registers before read-back of a block
+      bool           dataFlashA23;           //!< Set A23 of flash address for FlexNVM/DFlash (CFV1)
+      // Layout of LargeTargetFlashDataHeader used by the target flash program
+      MemorySpace_t  headerMemorySpace;      //!< Memory space used to access header and data buffer
+      bool           bigEndian;              //!< Header fields are big-endian
+      uint8_t        headerSize;             //!< Size of header (DoubleBufferControl follows the header)
+      uint8_t        flagsOffset;            //!< Offset of flags (header and result)
+      uint8_t        flagsSize;              //!< Size of flags (2 or 4 bytes)
+      uint8_t        errorCodeOffset;        //!< Offset of 16-bit error code (header and result)
+      uint8_t        dataAddressOffset;      //!< Offset of 32-bit dataAddress (returns CRC for DO_CHECKSUM_RANGE), 0 if not supported
+      uint32_t       completeFlag;           //!< Flag returned when all actions are complete (IS_COMPLETE)
+      uint32_t       relocatableFlag;        //!< Capability indicating code may be relocated (CAP_RELOCATABLE)
+      // Layout of LargeTargetImageHeader in the target flash program image
+      MemorySpace_t  codeMemorySpace;        //!< Memory space used to load the target program code
+      bool           wordAddresses;          //!< Image addresses are word addresses (DSC)
+      bool           smallPrograms;          //!< Image may be a small target program i.e. starts with LoadInfoStruct (HCS08)
+      bool           headerAtImageStart;     //!< Image header is at start of image rather than at the address found there
+      bool           thumbEntry;             //!< Entry point has bit 0 set (ARM Thumb)
+      uint8_t        codeAlignment;          //!< Alignment of code, entry point and data buffer (1 or 2 bytes)
+      uint8_t        imageAddressSize;       //!< Size of address fields loadAddress, entry, flashData etc (2 or 4 bytes)
+      uint8_t        entryOffset;            //!< Offset of entry
+      uint8_t        capabilitiesOffset;     //!< Offset of capabilities
+      uint8_t        capabilitiesSize;       //!< Size of capabilities (2 or 4 bytes)
+      uint8_t        calibFrequencyOffset;   //!< Offset of 16-bit calibFrequency, 0 if not present
+      uint8_t        calibFactorOffset;      //!< Offset of 32-bit calibFactor, 0 if not present
+      uint8_t        watchdogAddressOffset;  //!< Offset of watchdog address, 0 if not present
+      uint8_t        flashDataOffset;        //!< Offset of flashData (address of LargeTargetFlashDataHeader)
+   };
+
+   FlashProgrammerCommon(const TargetTraits &targetTraits, DeviceData::EraseMethod defaultEraseMethod, DeviceData::ResetMethod defaultResetMethod);
    virtual ~FlashProgrammerCommon();
 
    virtual USBDM_ErrorCode    setDeviceData(const DeviceDataConstPtr device);
@@ -28,9 +71,120 @@ public:
 
    virtual USBDM_ErrorCode    massEraseTarget() { return massEraseTarget(true); };
    virtual uint16_t           getCalculatedTrimValue() { return calculatedClockTrimValue; };
+   virtual void               setDifferentialProgramming(bool enable) { differentialProgramming = enable; };
+   virtual uint32_t           getBytesSkipped() { return bytesSkipped; };
+   virtual void               setSectorComparer(SectorComparer *sectorComparer) { this->sectorComparer = sectorComparer; };
 
 protected:
-   static const int MaxSecurityAreaSize = 100;  //<! Maximum size of a security area that may be saved
+   static const int      MaxSecurityAreaSize  = 100;     //<! Maximum size of a security area that may be saved
+   static const uint32_t MaxChecksumBlockSize = 0x10000; //!< Maximum size of block verified by a single target checksum
+   static const uint32_t RamWriteBlockSize    = 0x800;   //!< Size of block used for RAM writes
+
+   //! Describes the flash programming code (created from loaded flash routines)
+   struct TargetProgramInfo {
+      uint32_t         entry;                   //!< Address of entry routine (for currently loaded routine)
+      uint32_t         headerAddress;           //!< Address where to load data image (including header)
+      uint32_t         dataOffset;              //!< Offset to data buffer within image
+      uint32_t         maxDataSize;             //!< Maximum data buffer size
+      uint32_t         capabilities;            //!< Capabilities of routine
+      uint16_t         calibFrequency;          //!< Frequency (kHz) used for calibFactor
+      uint32_t         calibFactor;             //!< Calibration factor for speed determination
+      bool             smallProgram;            //!< Indicates small version of flash code being used
+      bool             usePagedAddresses;       //!< Set up paged addressing information
+      bool             useWatchdogAddress;      //!< Set up watchdog address
+      uint32_t         programOperation;        //!< either DO_PROGRAM_RANGE or DO_BLANK_CHECK_RANGE|DO_PROGRAM_RANGE|DO_VERIFY_RANGE
+   };
+
+   //! Information for the flash operation to be done
+   struct FlashOperationInfo {
+      uint8_t          operation;               //!< Controls actions of routine
+      uint32_t         controller;              //!< Address of flash controller
+      uint32_t         pageAddress;             //!< Address of PPAGE or EPAGE register
+      uint32_t         flashAddress;            //!< Memory flashAddress being programmed/erased (may include pageNo etc)
+      uint32_t         dataSize;                //!< Size of data to program/verify
+      uint16_t         sectorSize;              //!< Sector size
+      uint32_t         targetBusFrequency;      //!< Measured target bus frequency (kHz)
+      uint32_t         alignment;               //!< Flash programming alignment (1,2,4,8,16,32 bytes)
+      uint32_t         flexNVMPartition;        //!< Value for partitioning FlexNVM
+   };
+
+   //! Follows LargeTargetFlashDataHeader when DO_DOUBLE_BUFFER is used.\n
+   //! Fields are 32-bit in target byte order.
+   //! The target processes the buffers alternately, starting with buffer 0.
+   //! The host fills a buffer and then sets its dataSize. The target clears dataSize
+   //! when it has finished with the buffer.
+   struct DoubleBufferControl {
+      uint32_t         dataAddress[2];          //!< Ptr to each data buffer
+      uint32_t         address[2];              //!< Memory address for data in each buffer
+      uint32_t         dataSize[2];             //!< Size of data in each buffer (0 => free, DoubleBufferEnd => finished)
+   };
+
+   //! Value of DoubleBufferControl.dataSize indicating no more data
+   static const uint32_t DoubleBufferEnd = 0xFFFFFFFF;
+
+   // Error codes return from the flash driver
+   enum FlashDriverError_t {
+        FLASH_ERR_OK                = (0),  //!< No error
+        FLASH_ERR_LOCKED            = (1),  //!< Flash is still locked
+        FLASH_ERR_ILLEGAL_PARAMS    = (2),  //!< Parameters illegal
+        FLASH_ERR_PROG_FAILED       = (3),  //!< STM - Programming operation failed - general
+        FLASH_ERR_PROG_WPROT        = (4),  //!< STM - Programming operation failed - write protected
+        FLASH_ERR_VERIFY_FAILED     = (5),  //!< Verify failed
+        FLASH_ERR_ERASE_FAILED      = (6),  //!< Erase or Blank Check failed
+        FLASH_ERR_TRAP              = (7),  //!< Program trapped (illegal instruction/location etc.)
+        FLASH_ERR_PROG_ACCERR       = (8),  //!< Kinetis/CFVx - Programming operation failed - ACCERR
+        FLASH_ERR_PROG_FPVIOL       = (9),  //!< Kinetis/CFVx - Programming operation failed - FPVIOL
+        FLASH_ERR_PROG_MGSTAT0      = (10), //!< Kinetis - Programming operation failed - MGSTAT0
+        FLASH_ERR_CLKDIV            = (11), //!< CFVx - Clock divider not set
+        FLASH_ERR_ILLEGAL_SECURITY  = (12), //!< Kinetis - Illegal value for security location
+        FLASH_ERR_UNKNOWN           = (13), //!< Unspecified error
+        FLASH_ERR_TIMEOUT           = (14), //!< Timeout waiting for completion
+   };
+
+   //! Actions for target flash program (LargeTargetFlashDataHeader.flags)\n
+   //! IS_COMPLETE depends on the size of flags - see TargetTraits::completeFlag
+   enum TargetProgramActions {
+      DO_INIT_FLASH         = 1<<0,  //!< Do initialisation of flash
+      DO_ERASE_BLOCK        = 1<<1,  //!< Erase entire flash block e.g. Flash, FlexNVM etc
+      DO_ERASE_RANGE        = 1<<2,  //!< Erase range (including option region)
+      DO_BLANK_CHECK_RANGE  = 1<<3,  //!< Blank check region
+      DO_PROGRAM_RANGE      = 1<<4,  //!< Program range (including option region)
+      DO_VERIFY_RANGE       = 1<<5,  //!< Verify range
+      DO_PARTITION_FLEXNVM  = 1<<7,  //!< Program FlexNVM DFLASH/EEPROM partitioning
+      DO_TIMING_LOOP        = 1<<8,  //!< Counting loop to determine clock speed
+      DO_DOUBLE_BUFFER      = 1<<9,  //!< Process data from DoubleBufferControl buffers
+      DO_CHECKSUM_RANGE     = 1<<10, //!< With DO_VERIFY_RANGE - return CRC-32 of range in dataAddress instead of comparing
+   };
+
+   //! Capabilities of target flash program (LargeTargetImageHeader.capabilities)\n
+   //! CAP_RELOCATABLE depends on the size of capabilities - see TargetTraits::relocatableFlag
+   enum TargetProgramCapabilities {
+      CAP_ERASE_BLOCK       = 1<<1,
+      CAP_ERASE_RANGE       = 1<<2,
+      CAP_BLANK_CHECK_RANGE = 1<<3,
+      CAP_PROGRAM_RANGE     = 1<<4,
+      CAP_VERIFY_RANGE      = 1<<5,
+      CAP_PARTITION_FLEXNVM = 1<<7,
+      CAP_TIMING            = 1<<8,
+      CAP_DSC_OVERLAY       = 1<<11, //!< Indicates DSC code in pMEM overlays xRAM
+      CAP_DATA_FIXED        = 1<<12, //!< Indicates TargetFlashDataHeader is at fixed address
+      CAP_DOUBLE_BUFFER     = 1<<13, //!< Supports DO_DOUBLE_BUFFER
+      CAP_CHECKSUM_RANGE    = 1<<14, //!< Supports DO_CHECKSUM_RANGE
+   };
+
+   //! Options in LoadInfoStruct.flags (small target programs)
+   enum TargetProgramOptions {
+      OPT_SMALL_CODE        = 0x80,
+      OPT_PAGED_ADDRESSES   = 0x40,
+      OPT_WDOG_ADDRESS      = 0x20,
+   };
+
+   enum AddressModifiers {
+      ADDRESS_DATA   = 1UL<<31,  //!< DATA (X:) memory (DSC)
+      ADDRESS_LINEAR = 1UL<<31,  //!< Linear address (HCS12)
+      ADDRESS_EEPROM = 1UL<<30,  //!< EEPROM
+      ADDRESS_A23    = 1UL<<23,  //!< A23 bit for Flex/DataFlash on ARM/CFV1+
+   };
 
    /**
     * Used to save a region of a flash image modified for security
@@ -57,6 +211,65 @@ protected:
       }
    };
 
+   /**
+    * Execution statistics for target flash programs, one entry per FlashOperation
+    */
+   struct TargetProgramStatistics {
+      unsigned count;          //!< Number of completed executions
+      unsigned polls;          //!< Total number of status polls
+      double   totalTime;      //!< Total execution time (s)
+      double   minTime;        //!< Shortest execution time (s)
+      double   maxTime;        //!< Longest execution time (s)
+      double   learnedTime;    //!< Smoothed execution time (s/byte, or s for operations without data)
+      uint32_t busFrequency;   //!< Target bus frequency when learnedTime was measured (kHz, 0 if unknown)
+   };
+
+   /**
+    * Adaptive wait for completion of a program executing on the target
+    *
+    * The first poll is made at about half the predicted execution time.
+    * Subsequent polls back off exponentially from MinPollInterval to MaxPollInterval.
+    *
+    * Usage:
+    *    TargetProgramWait wait(*this, flashOperation, dataSize, busFrequency);
+    *    do {
+    *       wait.delay();
+    *       ... poll target ...
+    *    } while (!finished && !wait.isTimedOut());
+    *    wait.stop();
+    *    ...
+    *    if (success) {
+    *       wait.complete();
+    *    }
+    */
+   class TargetProgramWait {
+   public:
+      static const int MinPollInterval = 1;     //!< Initial interval between polls (ms)
+      static const int MaxPollInterval = 16;    //!< Largest interval between polls (ms)
+      static const int MinTimeout      = 4000;  //!< Minimum time to wait for completion (ms)
+
+   private:
+      FlashProgrammerCommon &owner;
+      const FlashOperation   flashOperation;
+      const uint32_t         dataSize;
+      const uint32_t         busFrequency;
+      const double           startTime;
+      double                 stopTime;
+      double                 expectedTime;
+      double                 timeout;
+      int                    pollInterval;
+      unsigned               pollCount;
+      bool                   timedOut;
+
+   public:
+      TargetProgramWait(FlashProgrammerCommon &owner, FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency=0);
+      void   delay();
+      void   stop();
+      bool   isTimedOut();
+      double elapsedTime() const;
+      void   complete();
+   };
+
    //! Structure for MCGCG parameters
    struct MCG_ClockParameters_t {
       uint8_t  mcgC1;
@@ -124,6 +337,414 @@ protected:
     */
    void            restoreSecurityAreas(FlashImagePtr flashImage);
 
+   /**
+    * Range of flash to be erased by a single selective erase operation
+    */
+   struct EraseRange {
+      uint32_t start;   //!< First address in range
+      uint32_t end;     //!< Last address in range
+   };
+   /**
+    * Determine the flash ranges to erase for a flash image
+    *
+    * Image blocks are mapped onto sector boundaries of the containing memory region.
+    * Blocks sharing or adjoining sectors of the same region are merged so that each
+    * sector is erased once and contiguous sectors are erased by a single operation.
+    * Blocks outside programmable memory are passed through unchanged.
+    *
+    * @param flashImage  Flash image used to determine regions to erase
+    * @param eraseRanges Ranges to erase in address order
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode planSelectiveErase(FlashImagePtr flashImage, std::vector<EraseRange> &eraseRanges);
+   /**
+    * Create an image containing only the flash sectors that differ from the target
+    *
+    * Each flash sector touched by the image is compared with the target (unused locations
+    * are taken as erased i.e. 0xFF) using sectorComparer if set, otherwise by reading back.
+    * Sectors that match are dropped.  Non-flash data is always retained.
+    *
+    * @param flashImage    Complete image (after security/trim modifications)
+    * @param changedImage  Image to erase and program (may be flashImage)
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note bytesSkipped is updated
+    */
+   USBDM_ErrorCode getChangedSectors(FlashImagePtr flashImage, FlashImagePtr &changedImage);
+   /**
+    * Calculate CRC-32 (IEEE 802.3) of a range of a flash image
+    *
+    * @param flashImage    Image to use
+    * @param address       Start of range
+    * @param size          Size of range in bytes
+    *
+    * @return CRC-32 value (unused locations are taken as erased i.e. 0xFF)
+    */
+   static uint32_t calculateImageCrc32(FlashImagePtr flashImage, uint32_t address, uint32_t size);
+   /**
+    * Calculate CRC-32 (IEEE 802.3) of a buffer
+    *
+    * @param data          Data to use
+    * @param size          Size of data in bytes
+    *
+    * @return CRC-32 value
+    */
+   static uint32_t calculateCrc32(const uint8_t data[], uint32_t size);
+   /**
+    * Get the binary image of a target flash program
+    *
+    * The S-records are only parsed on first use.  Images are cached for the life
+    * of the process and shared between programmer instances.
+    *
+    * @param flashProgram   Flash program to obtain image of
+    * @param buffer         Buffer for the image
+    * @param bufferSize     Size of buffer
+    * @param loadedSize     Size of loaded image
+    * @param loadAddress    Memory address for start of buffer
+    * @param wordAddresses  S-records use word addresses (DSC)
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   static USBDM_ErrorCode getTargetProgramImage(FlashProgramConstPtr flashProgram,
+                                                uint8_t              buffer[],
+                                                unsigned             bufferSize,
+                                                unsigned            *loadedSize,
+                                                uint32_t            *loadAddress,
+                                                bool                 wordAddresses = false);
+   /**
+    * Write target flash program code to target RAM
+    *
+    * The download is skipped if this process last loaded identical code at the same
+    * address using the same BDM and checkTargetProgramCode() confirms that the target
+    * still holds it.
+    *
+    * @param memorySpace      Memory space for write
+    * @param codeLoadAddress  Target address to load code at
+    * @param codeLoadSize     Size of code in bytes
+    * @param code             Code to load (after relocation)
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note targetProgramInfo must describe the code being loaded
+    */
+   USBDM_ErrorCode writeTargetProgramCode(MemorySpace_t memorySpace, uint32_t codeLoadAddress, uint32_t codeLoadSize, const uint8_t code[]);
+   /**
+    * Check that target RAM holds a copy of the target flash program code
+    *
+    * Samples of the code are read back before the program is run to calculate
+    * the CRC of its own code (DO_VERIFY_RANGE|DO_CHECKSUM_RANGE).
+    *
+    * @param memorySpace      Memory space of code
+    * @param codeLoadAddress  Target address of code
+    * @param codeLoadSize     Size of code in bytes
+    * @param code             Expected code (after relocation)
+    *
+    * @return PROGRAMMING_RC_OK if the target copy matches the code, error code otherwise
+    */
+   USBDM_ErrorCode checkTargetProgramCode(MemorySpace_t memorySpace, uint32_t codeLoadAddress, uint32_t codeLoadSize, const uint8_t code[]);
+   /**
+    * Get memory space and offset used to access an image address on the target
+    *
+    * @param imageAddress  Address in flash image
+    * @param offset        Offset to subtract from image address to obtain target address
+    *
+    * @return Memory space for bulk access
+    */
+   MemorySpace_t getTargetMemorySpace(uint32_t imageAddress, uint32_t &offset) const;
+   /**
+    * Apply a flash operation to target based upon occupied flash addresses
+    *
+    * Each allocated block of the image is passed to doFlashBlock()
+    *
+    * @param flashImage       Flash image to use
+    * @param flashOperation   Operation to do on flash
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode applyFlashOperation(FlashImagePtr flashImage, FlashOperation flashOperation);
+   /**
+    * Apply a flash operation to a block of the target
+    *
+    * @param flashImage       Flash image to use
+    * @param blockSize        Size of block
+    * @param flashAddress     Start address of block (updated)
+    * @param flashOperation   Operation to do on flash
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note Blocks crossing memory regions are split.
+    * @note Program and verify use double buffering if the target program supports it.
+    */
+   USBDM_ErrorCode doFlashBlock(FlashImagePtr flashImage, unsigned int blockSize, uint32_t &flashAddress, FlashOperation flashOperation);
+   /**
+    * Executes target program (start and wait for completion)
+    *
+    * @param buffer  Buffer including space for header describing operation (may be NULL)
+    * @param size    Size of data following header in bytes
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode executeTargetProgram(uint8_t *buffer=0, uint32_t size=0);
+   /**
+    * Starts target program
+    *
+    * @param buffer      Buffer including space for header describing operation (may be NULL)
+    * @param size        Size of data following header in bytes
+    * @param extraFlags  Additional action flags e.g. DO_DOUBLE_BUFFER
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode startTargetProgram(uint8_t *buffer, uint32_t size, uint32_t extraFlags=0);
+   /**
+    * Writes header and data to target and starts target program
+    *
+    * @param buffer      Buffer including initialised header describing operation
+    * @param size        Size of data following header in bytes
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode runTargetProgram(uint8_t *buffer, uint32_t size);
+   /**
+    * Waits for target program to complete and obtains the result
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode waitForTargetProgram();
+   /**
+    * Starts target program in double-buffered mode
+    *
+    * The target program processes blocks queued by queueDoubleBufferedBlock()
+    * until finishDoubleBufferedProgram() is called.
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode startDoubleBufferedProgram();
+   /**
+    * Waits for a double buffer to be released by the target
+    *
+    * @param bufferNum  Buffer to wait for (0 or 1)
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode waitForDoubleBuffer(unsigned bufferNum);
+   /**
+    * Queues a block of data for the target program in double-buffered mode
+    *
+    * @param data       Data to transfer
+    * @param dataSize   Size of data in bytes (<= targetProgramInfo.maxDataSize)
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note flashOperationInfo.flashAddress is the address for the data
+    */
+   USBDM_ErrorCode queueDoubleBufferedBlock(const uint8_t *data, uint32_t dataSize);
+   /**
+    * Completes target program in double-buffered mode
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode finishDoubleBufferedProgram();
+   /**
+    * Check CRC calculated by target program (DO_CHECKSUM_RANGE) against flash image
+    *
+    * @param flashImage  Flash image to check against
+    * @param address     Start of range
+    * @param size        Size of range in bytes
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode checkTargetChecksum(FlashImagePtr flashImage, uint32_t address, uint32_t size);
+   /**
+    * Verifies a range of target memory against the flash image by reading back the target
+    *
+    * @param flashImage  Flash image to check against
+    * @param address     Start of range
+    * @param size        Size of range in bytes
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode readbackVerifyRange(FlashImagePtr flashImage, uint32_t address, uint32_t size);
+   /**
+    * Read a header field in target byte order
+    *
+    * @param data  Field to read
+    * @param size  Size of field (2 or 4 bytes)
+    *
+    * @return Value
+    */
+   uint32_t getTargetField(const uint8_t data[], unsigned size) const;
+   /**
+    * Write a header field in target byte order
+    *
+    * @param data   Field to write
+    * @param size   Size of field (2 or 4 bytes)
+    * @param value  Value to write
+    */
+   void setTargetField(uint8_t data[], unsigned size, uint32_t value) const;
+   /**
+    * Loads the default flash program for the device
+    *
+    * @param flashOperation   Intended operation in case of partial loading
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode loadTargetProgram(FlashOperation flashOperation);
+   /**
+    * Loads the flash program for an operation on a memory region
+    *
+    * @param memoryRegionPtr  Memory region being operated on
+    * @param flashOperation   Operation to do on flash
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   USBDM_ErrorCode loadTargetProgram(MemoryRegionConstPtr memoryRegionPtr, FlashOperation flashOperation);
+   /**
+    * Loads the given flash program
+    *
+    * @param flashProgram     Flash program to load
+    * @param flashOperation   Intended operation in case of partial loading
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note The program is only reloaded if the program, operation or alignment has changed
+    */
+   USBDM_ErrorCode loadTargetProgram(FlashProgramConstPtr flashProgram, FlashOperation flashOperation);
+   /**
+    * Loads a large target program image described by a LargeTargetImageHeader
+    *
+    * The relocated image is cached by program, RAM region, operation and alignment.
+    *
+    * @param buffer           Buffer containing program image
+    * @param loadAddress      Address to load image at
+    * @param size             Size of image in bytes
+    * @param flashProgram     Flash program corresponding to image
+    * @param flashOperation   Intended operation
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note targetProgramInfo is updated with load information
+    */
+   USBDM_ErrorCode loadLargeTargetProgram(uint8_t *buffer, uint32_t loadAddress, uint32_t size,
+                                          FlashProgramConstPtr flashProgram, FlashOperation flashOperation);
+   /**
+    * Relocates a large target program image described by a LargeTargetImageHeader
+    *
+    * @param buffer           Buffer containing program image (modified)
+    * @param loadAddress      Address image was linked at
+    * @param size             Size of image in bytes
+    * @param codeLoadAddress  Address to load relocated code at
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note targetProgramInfo is updated with load information
+    */
+   USBDM_ErrorCode relocateLargeTargetProgram(uint8_t *buffer, uint32_t loadAddress, uint32_t size, uint32_t &codeLoadAddress);
+   /**
+    * Loads a small target program image (routine for single operation)
+    *
+    * @param buffer           Buffer containing program image
+    * @param loadAddress      Address to load image at
+    * @param size             Size of image in bytes
+    * @param flashProgram     Flash program corresponding to image
+    * @param flashOperation   Intended operation
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note Only used if TargetTraits::smallPrograms is set
+    */
+   virtual USBDM_ErrorCode loadSmallTargetProgram(uint8_t *buffer, uint32_t loadAddress, uint32_t size,
+                                                  FlashProgramConstPtr flashProgram, FlashOperation flashOperation);
+   /**
+    * Get names of actions in target program flags
+    *
+    * @param actions  Flags to describe
+    *
+    * @return pointer to static string buffer describing the actions
+    */
+   const char *getProgramActionNames(unsigned int actions) const;
+   /**
+    * Get names of target program capabilities
+    *
+    * @param capabilities  Capabilities to describe
+    *
+    * @return pointer to static string buffer describing the capabilities
+    */
+   const char *getProgramCapabilityNames(unsigned int capabilities) const;
+   /**
+    * Initialise the header at the start of the buffer for a large target program
+    *
+    * @param buffer  Buffer to initialise
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   virtual USBDM_ErrorCode initLargeTargetBuffer(uint8_t *buffer);
+   /**
+    * Initialise the header at the start of the buffer for a small target program
+    *
+    * @param buffer  Buffer to initialise
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   virtual USBDM_ErrorCode initSmallTargetBuffer(uint8_t *buffer);
+   /**
+    * Get value to load into the PC to execute the target program
+    *
+    * @return PC value
+    */
+   virtual uint32_t getTargetProgramPC() { return targetProgramInfo.entry; }
+   /**
+    * Check if the target is executing
+    *
+    * @return BDM_RC_BUSY if running, BDM_RC_OK if halted, otherwise error code see \ref USBDM_ErrorCode.
+    */
+   virtual USBDM_ErrorCode getRunStatus(void);
+   /**
+    * Convert the error code returned by the target program
+    *
+    * @param rc  Code returned by target program
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    */
+   virtual USBDM_ErrorCode convertTargetErrorCode(FlashDriverError_t rc);
+   /**
+    * Log target specific information after a target program has failed e.g. reset status
+    */
+   virtual void reportTargetProgramFailure() {}
+   /**
+    * Get page number for a paged address
+    *
+    * @param memoryRegionPtr  Memory region containing address
+    * @param address          Address to map
+    * @param pageNo           Page number for address
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note Only used if TargetTraits::pagedAddresses is set
+    */
+   virtual USBDM_ErrorCode getPageAddress(MemoryRegionConstPtr memoryRegionPtr, uint32_t address, uint8_t *pageNo);
+   /**
+    * Set page registers for access to a paged address
+    *
+    * @param physicalAddress  Address to access
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note Only used if TargetTraits::setPagesForReadback is set
+    */
+   virtual USBDM_ErrorCode setPageRegisters(uint32_t physicalAddress) { return PROGRAMMING_RC_OK; }
+   /**
+    * Verifies the target memory against flash image by reading back the target
+    *
+    * @param flashImage Description of flash contents to be verified.
+    *
+    * @return error code see \ref USBDM_ErrorCode.
+    *
+    * @note Assumes target connection has been established
+    */
+   USBDM_ErrorCode doReadbackVerify(FlashImagePtr flashImage);
+
    bool                       flashReady;               //!< Safety check - only TRUE when flash is ready for programming
    DeviceDataConstPtr         device;                   //!< Parameters describing the current device
    UsbdmTclInterperPtr        tclInterpreter;           //!< TCL interpreter
@@ -132,16 +753,53 @@ protected:
    ProgressTimerPtr           progressTimer;            //!< Progress timer
    uint16_t                   calculatedClockTrimValue; //!< Clock trim value determined from programmed device
    unsigned                   securityAreaCount;
+   bool                       differentialProgramming;  //!< Only erase & program sectors that differ from target
+   uint32_t                   bytesSkipped;             //!< Image bytes not programmed as unchanged
+   SectorComparer            *sectorComparer;           //!< Optional fast sector comparison for differential programming
    SecurityDataCache          securityData[2];
+   TargetProgramInfo          targetProgramInfo;        //!< Describes loaded flash code
+   FlashOperationInfo         flashOperationInfo;       //!< Describes flash operation
+   FlashOperation             currentFlashOperation;    //!< Current operation loaded
+   uint32_t                   currentFlashAlignment;    //!< Alignment applicable to loaded flash operation
+   bool                       doRamWrites;              //!< Write RAM region of image to target (after programming)
+   unsigned                   nextDoubleBuffer;         //!< Next buffer to fill in double-buffered mode
 
+   const TargetTraits              targetTraits;         //!< Description of target
    const DeviceData::EraseMethod   defaultEraseMethod;   //!< Default erase method if none found for device
    const DeviceData::ResetMethod   defaultResetMethod;   //!< Default reset method if none found for device
 
    uint32_t                ramStart; //!< Start of RAM region for programming
    uint32_t                ramEnd;   //!< End of RAM region for programming
 
+   TargetProgramStatistics    targetProgramStatistics[OpTiming+1]; //!< Execution statistics for target programs
+
    static const char *getFlashOperationName(FlashOperation flashOperation);
 
+   /**
+    * Estimate execution time of a target program
+    *
+    * @param flashOperation   Operation being executed
+    * @param dataSize         Size of data being processed (bytes)
+    * @param busFrequency     Target bus frequency (kHz, 0 if unknown)
+    *
+    * @return Estimated time in seconds
+    */
+   double estimateTargetProgramTime(FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency);
+   /**
+    * Record execution time of a target program to refine later estimates
+    *
+    * @param flashOperation   Operation executed
+    * @param dataSize         Size of data processed (bytes)
+    * @param busFrequency     Target bus frequency (kHz, 0 if unknown)
+    * @param time             Measured execution time (s)
+    * @param polls            Number of status polls used
+    */
+   void recordTargetProgramTime(FlashOperation flashOperation, uint32_t dataSize, uint32_t busFrequency, double time, unsigned polls);
+   /**
+    * Log execution statistics for target programs
+    */
+   void reportTargetProgramStatistics();
+
    virtual USBDM_ErrorCode massEraseTarget(bool resetTarget) = 0;
 
    /**
@@ -25,6 +25,11 @@
 +============================================================================================
 | Revision History
 +============================================================================================
+| 17 Oct 26 | Uses shared doFlashBlock()/executeTargetProgram()             - pgo 4.12.1
+| 17 Oct 26 | Uses cached target program images                             - pgo 4.12.1
+| 17 Oct 26 | Uses shared applyFlashOperation()/doReadbackVerify()          - pgo 4.12.1
+| 17 Oct 26 | Added differential programming                                - pgo 4.12.1
+| 17 Oct 26 | Selective erase merges sectors (planSelectiveErase())         - pgo 4.12.1
 | 14 Apr 17 | Fixed loadTargetProgram() for OpWriteRam                      - pgo 4.12.1.170
 | 29 Mar 15 | Refactored                                                    - pgo 4.11.1.10
 +-----------+--------------------------------------------------------------------------------
@@ -140,6 +145,40 @@ struct ResultStruct {
 };
 #pragma pack()
 
+//! Description of target used by shared flash operations
+static const FlashProgrammerCommon::TargetTraits flashTargetTraits = {
+   /* targetType             */ T_MC56F80xx,
+   /* memorySpace            */ MS_PWord,
+   /* splitDataSpace         */ true,
+   /* limitToRegionAlignment */ false,
+   /* pagedAddresses         */ false,
+   /* setPagesForReadback    */ false,
+   /* dataFlashA23           */ false,
+   /* headerMemorySpace      */ MS_XWord,
+   /* bigEndian              */ false,
+   /* headerSize             */ sizeof(LargeTargetFlashDataHeader),
+   /* flagsOffset            */ offsetof(ResultStruct, flags),
+   /* flagsSize              */ sizeof(ResultStruct::flags),
+   /* errorCodeOffset        */ offsetof(ResultStruct, errorCode),
+   /* dataAddressOffset      */ 0,
+   /* completeFlag           */ 1<<15,
+   /* relocatableFlag        */ 1<<15,
+   /* codeMemorySpace        */ MS_PWord,
+   /* wordAddresses          */ true,
+   /* smallPrograms          */ false,
+   /* headerAtImageStart     */ false,
+   /* thumbEntry             */ false,
+   /* codeAlignment          */ 2,
+   /* imageAddressSize       */ sizeof(LargeTargetImageHeader::loadAddress),
+   /* entryOffset            */ offsetof(LargeTargetImageHeader, entry),
+   /* capabilitiesOffset     */ offsetof(LargeTargetImageHeader, capabilities),
+   /* capabilitiesSize       */ sizeof(LargeTargetImageHeader::capabilities),
+   /* calibFrequencyOffset   */ offsetof(LargeTargetImageHeader, calibFrequency),
+   /* calibFactorOffset      */ offsetof(LargeTargetImageHeader, calibFactor),
+   /* watchdogAddressOffset  */ 0,
+   /* flashDataOffset        */ offsetof(LargeTargetImageHeader, flashData),
+};
+
 /* ======================================================================
  * Notes on BDM clock source (for default CLKSW):
  *
@@ -179,7 +218,7 @@ inline uint32_t getData32Le(uint16_t *data) {
    return (data[1]<<16)+data[0];
 }
 inline const uint8_t *getData4x8Le(uint32_t data) {
-   static uint8_t data8[4];
+   static thread_local uint8_t data8[4];
    data8[0]= data;
    data8[1]= data>>8;
    data8[2]= data>>16;
@@ -187,7 +226,7 @@ inline const uint8_t *getData4x8Le(uint32_t data) {
    return data8;
 }
 inline const uint8_t *getData4x8Be(uint32_t data) {
-   static uint8_t data8[4];
+   static thread_local uint8_t data8[4];
    data8[0]= data>>24;
    data8[1]= data>>16;
    data8[2]= data>>8;
@@ -195,13 +234,13 @@ inline const uint8_t *getData4x8Be(uint32_t data) {
    return data8;
 }
 inline const uint8_t *getData2x8Le(uint32_t data) {
-   static uint8_t data8[2];
+   static thread_local uint8_t data8[2];
    data8[0]= data;
    data8[1]= data>>8;
    return data8;
 }
 inline const uint8_t *getData2x8Be(uint32_t data) {
-   static uint8_t data8[2];
+   static thread_local uint8_t data8[2];
    data8[0]= data>>8;
    data8[1]= data;
    return data8;
@@ -242,12 +281,8 @@ inline uint32_t getData16Target(uint8_t *data) {
 //=======================================================================
 //
 FlashProgrammer_DSC::FlashProgrammer_DSC() :
-      FlashProgrammerCommon(DeviceData::eraseAll, DeviceData::resetHardware),
-      flashReady(false),
+      FlashProgrammerCommon(flashTargetTraits, DeviceData::eraseAll, DeviceData::resetHardware),
       initTargetDone(false),
-      currentFlashOperation(OpNone),
-      currentFlashAlignment(0),
-      doRamWrites(false),
       securityNeedsSelectiveErase(false) {
    LOGGING_E;
 }
@@ -482,449 +517,6 @@ USBDM_ErrorCode FlashProgrammer_DSC::massEraseTarget(bool resetTarget) {
    return PROGRAMMING_RC_OK;
 }
 
-//==============================================================================
-// Flag masks
-#define DO_INIT_FLASH         (1<<0) // Do initialisation of flash
-#define DO_ERASE_BLOCK        (1<<1) // Erase entire flash block e.g. Flash, FlexNVM etc
-#define DO_ERASE_RANGE        (1<<2) // Erase range (including option region)
-#define DO_BLANK_CHECK_RANGE  (1<<3) // Blank check region
-#define DO_PROGRAM_RANGE      (1<<4) // Program range (including option region)
-#define DO_VERIFY_RANGE       (1<<5) // Verify range
-#define DO_PARTITION_FLEXNVM  (1<<7) // Program FlexNVM DFLASH/EEPROM partitioning
-#define DO_TIMING_LOOP        (1<<8) // Counting loop to determine clock speed
-
-// 9 - 14 reserved
-#define IS_COMPLETE           (1<<15)
-
-// Capability masks
-#define CAP_ERASE_BLOCK        (1<<1)
-#define CAP_ERASE_RANGE        (1<<2)
-#define CAP_BLANK_CHECK_RANGE  (1<<3)
-#define CAP_PROGRAM_RANGE      (1<<4)
-#define CAP_VERIFY_RANGE       (1<<5)
-#define CAP_PARTITION_FLEXNVM  (1<<7)
-#define CAP_TIMING             (1<<8)
-
-#define CAP_DSC_OVERLAY        (1<<11) // Indicates DSC code in pMEM overlays xRAM
-#define CAP_DATA_FIXED         (1<<12) // Indicates TargetFlashDataHeader is at fixed address
-//
-#define CAP_RELOCATABLE        (1<<15) // Code may be relocated
-
-#define OPT_SMALL_CODE         (0x80)
-
-//=======================================================================
-//! Loads the default Flash programming code to target memory
-//!
-//! @param  flashOperation    Intended operation in case of partial loading
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//!
-//! @note - Will load device program code or flashRegion specific if necessary
-//! @note - see loadTargetProgram(MemoryRegionConstPtr, FlashOperation) for details
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::loadTargetProgram(FlashOperation flashOperation) {
-   LOGGING;
-   FlashProgramConstPtr flashProgram = device->getFlashProgram();
-   return loadTargetProgram(flashProgram, flashOperation);
-}
-
-//==============================================================================
-//! Loads the given Flash programming code to target memory
-//!
-//! @param  memoryRegionPtr   Memory region to load programming code for
-//! @param  flashOperation    Intended operation in case of partial loading
-//!
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//! @note - see loadTargetProgram(MemoryRegionConstPtr, FlashOperation) for details
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::loadTargetProgram(MemoryRegionConstPtr memoryRegionPtr, FlashOperation flashOperation) {
-   LOGGING_Q;
-
-   FlashProgramConstPtr flashProgram = memoryRegionPtr->getFlashprogram();
-   if (!flashProgram) {
-      // Try to get device general routines
-      flashProgram = device->getCommonFlashProgram();
-   }
-   return loadTargetProgram(flashProgram, flashOperation);
-}
-
-//==============================================================================
-//! Loads the given Flash programming code to target memory
-//!
-//! @param  flashProgram      Flash program to load
-//! @param  flashOperation    Intended operation in case of partial loading
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//!
-//! @note - Assumes the target has been connected to
-//!         Confirms download (if necessary) and checks RAM boundaries.
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::loadTargetProgram(FlashProgramConstPtr flashProgram, FlashOperation flashOperation) {
-   LOGGING;
-   uint8_t     buffer[4000] = {0};
-
-   log.print("Op=%s\n", getFlashOperationName(flashOperation));
-   switch(flashOperation) {
-      case OpSelectiveErase:
-      case OpBlockErase:
-      case OpBlankCheck:
-      case OpProgram:
-      case OpVerify:
-      case OpPartitionFlexNVM:
-      case OpTiming:
-         break;
-      default:
-         // All other operations don't require target Flash code
-         currentFlashOperation = OpNone;
-         log.print("No target program load needed\n");
-         return BDM_RC_OK;
-   }
-   // Check if we have a target flash programming code for this region
-   if (!flashProgram) {
-      log.error("Failed, no flash program found for target memory region\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   // Reload flash code if
-   //  - code changed
-   //  - operation changed
-   //  - alignment changed
-   if (currentFlashProgram != flashProgram)  {
-      log.print("Reloading due to change in flash code\n");
-   }
-   else if ((currentFlashOperation == OpNone) || (currentFlashOperation != flashOperation)) {
-      log.print("Reloading due to change in flash operation\n");
-   }
-   else if (currentFlashAlignment != flashOperationInfo.alignment) {
-      log.print("Reloading due to change in flash alignment\n");
-   }
-   else {
-      log.print("Re-using existing code\n");
-      return PROGRAMMING_RC_OK;
-   }
-   currentFlashOperation = OpNone;
-
-   unsigned size; // In uint8_t
-   uint32_t loadAddress;
-   USBDM_ErrorCode rc = loadSRec(flashProgram->getFlashProgram().c_str(),
-                                 buffer,
-                                 sizeof(buffer)/sizeof(buffer[0]),
-                                 &size,
-                                 &loadAddress,
-                                 true);
-   if (rc !=  BDM_RC_OK) {
-      log.error("Failed, loadSRec() failed\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-
-   // Find RAM region to use
-   device->getRamRegionFor(loadAddress, ramStart, ramEnd);
-   log.print("Using RAM region [0x%8X..0x%8X]\n", ramStart, ramEnd);
-   
-#if 1
-   log.printDump(buffer, size, loadAddress/2, UsbdmSystem::WORD_ADDRESS);
-#endif
-
-   memset(&targetProgramInfo, 0, sizeof(targetProgramInfo));
-
-   MemorySpace_t memorySpace = MS_XWord;
-   // Probe RAM buffer
-   rc = probeMemory(memorySpace, ramStart);
-   if (rc == BDM_RC_OK) {
-      rc = probeMemory(memorySpace, ramEnd);
-   }
-   if (rc != BDM_RC_OK) {
-      log.error("Failed, probeMemory() failed\n");
-      return rc;
-   }
-   targetProgramInfo.smallProgram = false;
-   return loadLargeTargetProgram(buffer, loadAddress, size, flashProgram, flashOperation);
-}
-
-//=======================================================================
-//! Loads the given Flash programming code to target memory
-//!
-//! @param  buffer            buffer containing program image
-//! @param  loadAddress       address to load image at (DSC word address)
-//! @param  size              size of image (in uint8_t)
-//! @param  flashProgram      flash program corresponding to image
-//! @param  flashOperation    intended operation in case of partial loading
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//!
-//! @note - Assumes the target has been connected to
-//!         Confirms download (if necessary) and checks RAM upper boundary.
-//!         targetProgramInfo is updated with load information
-//!
-//! Target Memory map
-//! +---------------------------------------------------+ -+
-//! |   LargeTargetImageHeader  flashProgramHeader;     |  |
-//! +---------------------------------------------------+   > Unchanging written once
-//! |   Flash program code....                          |  |
-//! +---------------------------------------------------+ -+
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::loadLargeTargetProgram(uint8_t              *buffer,
-                                                            uint32_t              loadAddress,
-                                                            uint32_t              size,
-                                                            FlashProgramConstPtr  flashProgram,
-                                                            FlashOperation        flashOperation) {
-   LOGGING;
-   log.print("Op=%s\n", getFlashOperationName(flashOperation));
-
-   // Find 'header' in download image
-   uint32_t headerAddress = 2*getData32Target(buffer);
-   LargeTargetImageHeader *headerPtr = (LargeTargetImageHeader*) (buffer+headerAddress-loadAddress);
-   if (headerPtr > (LargeTargetImageHeader*)(buffer+size)) {
-      log.error("Header ptr out of range\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   // Save the programming data structure
-   uint32_t codeLoadAddress   = 2*targetToNative32(headerPtr->loadAddress);
-   uint32_t codeEntry         = 2*targetToNative32(headerPtr->entry);
-   uint32_t capabilities      =   targetToNative16(headerPtr->capabilities);
-   uint32_t dataHeaderAddress = 2*targetToNative32(headerPtr->flashData);
-   uint32_t calibFrequency    =   targetToNative16(headerPtr->calibFrequency);
-   uint32_t calibFactor       =   targetToNative32(headerPtr->calibFactor);
-
-   log.print("Loaded Image (unmodified) :\n");
-   log.print("   flashProgramHeader headerAddress   = w:0x%08X\n",     headerAddress/2);
-   log.print("   flashProgramHeader.loadAddress     = w:0x%08X\n",     codeLoadAddress/2);
-   log.print("   flashProgramHeader.entry           = w:0x%08X\n",     codeEntry/2);
-   log.print("   flashProgramHeader.capabilities    =   0x%08X(%s)\n", capabilities, getProgramCapabilityNames(capabilities));
-   log.print("   flashProgramHeader.flashData       = w:0x%08X\n",     dataHeaderAddress/2);
-
-   if (codeLoadAddress != loadAddress) {
-      log.error("Inconsistent actual (0x%06X) and image load addresses (0x%06X).\n", loadAddress, codeLoadAddress);
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   uint32_t codeLoadSize = size;
-
-   if ((capabilities&CAP_RELOCATABLE)!=0) {
-      // Relocate Code
-      codeLoadAddress = (ramStart+3)&~3; // Relocate to start of RAM
-      if (loadAddress != codeLoadAddress) {
-         log.print("Loading at non-default address, load@w:0x%04X (relocated from=w:0x%04X)\n",
-               codeLoadAddress, loadAddress);
-         // Relocate entry point
-         codeEntry += codeLoadAddress - loadAddress;
-      }
-   }
-   // Update location of where programming info will be located
-   if ((capabilities&CAP_DSC_OVERLAY)!=0) {
-      // Loading code into shared RAM - load data offset by code size
-      log.error(" - loading data into overlaid RAM @ w:0x%06X\n", dataHeaderAddress/2);
-   }
-   else {
-      // Loading code into separate program RAM - load data RAM separately
-      log.print(" - loading data into separate RAM @ w:0x%06X\n", dataHeaderAddress/2);
-   }
-
-   // Required flash flashAlignmentMask
-   uint32_t flashAlignmentMask = flashOperationInfo.alignment-1;
-   // Word alignment
-   uint32_t procAlignmentMask  = 2-1;
-
-   // Save location of entry point
-   targetProgramInfo.entry        = codeEntry;
-   // Were to load flash buffer (including header)
-   targetProgramInfo.headerAddress  = dataHeaderAddress;
-   // Save offset of RAM data buffer
-   uint32_t dataLoadAddress = dataHeaderAddress+sizeof(LargeTargetFlashDataHeader);
-   // Align buffer address to worse case alignment for processor read
-   dataLoadAddress = (dataLoadAddress+procAlignmentMask)&~procAlignmentMask;
-   targetProgramInfo.dataOffset   = dataLoadAddress-dataHeaderAddress;
-   // Save maximum size of the buffer (in uint8_t)
-   targetProgramInfo.maxDataSize  = ramEnd-dataLoadAddress+1;
-   // Align buffer size to worse case alignment for processor read
-   targetProgramInfo.maxDataSize  = targetProgramInfo.maxDataSize&~procAlignmentMask;
-   // Align buffer size to flash alignment requirement
-   targetProgramInfo.maxDataSize  = targetProgramInfo.maxDataSize&~flashAlignmentMask;
-   // Save target program capabilities
-   targetProgramInfo.capabilities = capabilities;
-   // Save clock calibration factor
-   targetProgramInfo.calibFrequency = calibFrequency;
-   targetProgramInfo.calibFactor    = calibFactor;
-
-   log.print("AlignmentMask=0x%08X\n",           flashAlignmentMask);
-   log.print("Program code[w:0x%06X...w:0x%06X]\n",  codeLoadAddress/2, (codeLoadAddress+size)/2-1);
-   log.print("Parameters[w:0x%06X...w:0x%06X]\n",
-         targetProgramInfo.headerAddress/2,
-         (targetProgramInfo.headerAddress+targetProgramInfo.dataOffset)/2-1);
-   log.print("RAM buffer[w:0x%06X...w:0x%06X]\n",
-         (targetProgramInfo.headerAddress+targetProgramInfo.dataOffset)/2,
-         (targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+targetProgramInfo.maxDataSize)/2-1);
-   log.print("Entry=w:0x%06X\n", targetProgramInfo.entry/2);
-
-   if ((codeLoadAddress & procAlignmentMask) != 0) {
-      log.error("CodeLoadAddress is not aligned\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   if (((targetProgramInfo.headerAddress+targetProgramInfo.dataOffset) & procAlignmentMask) != 0) {
-      log.error("FlashProgramHeader.dataOffset is not aligned\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   if ((targetProgramInfo.entry & procAlignmentMask) != 0){
-      log.error("FlashProgramHeader.entry is not aligned\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   // Sanity check buffer
-   if (((uint32_t)(targetProgramInfo.headerAddress+targetProgramInfo.dataOffset)<ramStart) ||
-       ((uint32_t)(targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+targetProgramInfo.maxDataSize-1)>ramEnd)) {
-      log.error("Data buffer location [w:0x%06X..w:0x%06X] is outside target RAM [w:0x%06X-w:0x%06X]\n",
-            (targetProgramInfo.headerAddress+targetProgramInfo.dataOffset)/2,
-            (targetProgramInfo.headerAddress+targetProgramInfo.dataOffset+targetProgramInfo.maxDataSize)/2-1,
-            ramStart/2, (ramEnd-1)/2+1);
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   if (targetProgramInfo.maxDataSize<40) {
-      log.error("Data buffer is too small - 0x%X \n", targetProgramInfo.maxDataSize);
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   MemorySpace_t memorySpace = MS_PWord;
-   headerPtr->flashData      = nativeToTarget32(targetProgramInfo.headerAddress)/2;
-
-   log.print("Loaded Image (modified) :\n");
-   log.print("   flashProgramHeader.loadAddress     = w:0x%08X\n",      targetToNative32(headerPtr->loadAddress));
-   log.print("   flashProgramHeader.entry           = w:0x%08X\n",      targetToNative32(headerPtr->entry));
-   log.print("   flashProgramHeader.capabilities    =   0x%08X(%s)\n",  capabilities,getProgramCapabilityNames(capabilities));
-   log.print("   flashProgramHeader.flashData       = w:0x%08X\n",      targetToNative32(headerPtr->flashData));
-
-   if (currentFlashProgram != flashProgram)  {
-      log.print("Reloading due to change in flash code\n");
-      // Write the flash programming code to target memory
-      USBDM_ErrorCode rc = bdmInterface->writeMemory(memorySpace, codeLoadSize, codeLoadAddress, (uint8_t *)buffer);
-      if (rc != BDM_RC_OK) {
-         log.print("bdmInterface->writeMemory() Failed, rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
-         return PROGRAMMING_RC_ERROR_BDM_WRITE;
-      }
-   }
-   else {
-      log.print("Suppressing code load as unchanged\n");
-   }
-   currentFlashProgram   = flashProgram;
-   currentFlashOperation = flashOperation;
-   currentFlashAlignment = flashOperationInfo.alignment;
-
-   // Loaded routines support extended operations
-   targetProgramInfo.programOperation = DO_BLANK_CHECK_RANGE|DO_PROGRAM_RANGE|DO_VERIFY_RANGE;
-   return BDM_RC_OK;
-}
-
-//=======================================================================
-//! Loads the given Flash programming code to target memory
-//!
-//! @param  buffer            buffer containing data to load
-//! @param  loadAddress       address to load at
-//! @param  size              size of data in buffer
-//! @param  flashProgram      program to load
-//! @param  flashOperation    operation to do
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//!
-//! @note - Assumes the target has been connected to
-//!         Confirms down-load (if necessary) and checks RAM upper boundary.
-//!
-//! Target Memory map (RAM buffer)
-//! +-----------------------------------------+ -+
-//! |   SmallTagetFlashDataHeader flashData;  |   > Write/Read
-//! +-----------------------------------------+ -+
-//! |   Data to program....                   |   > Write
-//! +-----------------------------------------+ -+
-//! |   Flash program code....                |   > Unchanging written once
-//! +-----------------------------------------+ -+
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::loadSmallTargetProgram(uint8_t    *buffer,
-                                                        uint32_t              loadAddress,
-                                                        uint32_t              size,
-                                                        FlashProgramConstPtr  flashProgram,
-                                                        FlashOperation        flashOperation) {
-   LOGGING;
-
-   log.error("Not supported\n");
-   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-}
-
-//! \brief Maps a Flash action vector to Text
-//!
-//! @param actions => action to describe
-//!
-//! @return pointer to static string buffer describing the actions
-//!
-const char *FlashProgrammer_DSC::getProgramActionNames(unsigned int actions) {
-unsigned index;
-static char buff[250] = "";
-static const char *actionTable[] = {
-"DO_INIT_FLASH|",         // Do initialisation of flash
-"DO_ERASE_BLOCK|",        // Mass erase device
-"DO_ERASE_RANGE|",        // Erase range (including option region)
-"DO_BLANK_CHECK_RANGE|",  // Blank check region
-"DO_PROGRAM_RANGE|",      // Program range (including option region)
-"DO_VERIFY_RANGE|",       // Verify range
-"??|",
-"DO_PARTITION_FLEXNVM|",  // Partition FlexNVM boundary
-"DO_TIMING_LOOP|",        // Execute timing loop on target
-};
-   buff[0] = '\0';
-   for (index=0;
-        index<sizeof(actionTable)/sizeof(actionTable[0]);
-         index++) {
-      uint32_t mask = 1<<index;
-      if ((actions&mask) != 0) {
-         strcat(buff,actionTable[index]);
-         actions &= ~mask;
-      }
-   }
-   if (actions&IS_COMPLETE) {
-      actions &= ~IS_COMPLETE;
-      strcat(buff,"IS_COMPLETE|");
-   }
-   if (actions != 0) {
-      strcat(buff,"???");
-   }
-   return buff;
-}
-
-//! \brief Maps a Flash capability vector to Text
-//!
-//! @param actions => actions to describe
-//!
-//! @return pointer to static string buffer describing actions
-//!
-const char *FlashProgrammer_DSC::getProgramCapabilityNames(unsigned int actions) {
-   unsigned index;
-   static char buff[250] = "";
-   static const char *actionTable[] = {
-         "??|",                     // Do initialisation of flash
-         "CAP_ERASE_BLOCK|",        // Mass erase device
-         "CAP_ERASE_RANGE|",        // Erase range (including option region)
-         "CAP_BLANK_CHECK_RANGE|",  // Blank check region
-         "CAP_PROGRAM_RANGE|",      // Program range (including option region)
-         "CAP_VERIFY_RANGE|",       // Verify range
-         "??|",
-         "DO_PARTITION_FLEXNVM|",   // Un/lock flash with default security options  (+mass erase if needed)
-         "CAP_TIMING|",             // Lock flash with default security options
-   };
-
-   buff[0] = '\0';
-   for (index=0;
-         index<sizeof(actionTable)/sizeof(actionTable[0]);
-         index++) {
-      if ((actions&(1<<index)) != 0) {
-         strcat(buff,actionTable[index]);
-      }
-   }
-   if (actions&CAP_DSC_OVERLAY) {
-      strcat(buff,"CAP_DSC_OVERLAY|");
-   }
-   if (actions&CAP_DATA_FIXED) {
-      strcat(buff,"CAP_DATA_FIXED|");
-   }
-   if (actions&CAP_RELOCATABLE) {
-      strcat(buff,"CAP_RELOCATABLE");
-   }
-   return buff;
-}
-
 USBDM_ErrorCode FlashProgrammer_DSC::convertTargetErrorCode(FlashDriverError_t rc) {
 
    switch (rc) {
@@ -976,6 +568,13 @@ USBDM_ErrorCode FlashProgrammer_DSC::getRunStatus(void) {
    }
 }
 
+//=======================================================================
+//! Entry point of target program (word address)
+//!
+uint32_t FlashProgrammer_DSC::getTargetProgramPC() {
+   return targetProgramInfo.entry/2;
+}
+
 USBDM_ErrorCode FlashProgrammer_DSC::initLargeTargetBuffer(uint8_t *buffer) {
    LOGGING;
    LargeTargetFlashDataHeader *pFlashHeader = (LargeTargetFlashDataHeader*)buffer;
@@ -1045,164 +644,6 @@ USBDM_ErrorCode FlashProgrammer_DSC::initLargeTargetBuffer(uint8_t *buffer) {
    return BDM_RC_OK;
 }
 
-USBDM_ErrorCode FlashProgrammer_DSC::initSmallTargetBuffer(uint8_t *buffer) {
-   LOGGING_Q;
-   log.error("Small buffer not supported\n");
-   return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-}
-
-//=======================================================================
-//! \brief Executes program on target.
-//!
-//! @return error code, see \ref USBDM_ErrorCode
-//!
-//! @param pBuffer  - buffer including space for header describing operation (may be NULL)
-//! @param dataSize - size of data following header in uint8_t units
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::executeTargetProgram(uint8_t *pBuffer, uint32_t dataSize) {
-   LOGGING;
-   log.print("dataSize=0x%X\n", dataSize);
-
-   USBDM_ErrorCode rc = BDM_RC_OK;
-   uint8_t buffer[1000] = {0};
-   if (pBuffer == NULL) {
-      if (dataSize != 0) {
-         log.error("Error: No buffer but size non-zero\n");
-         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-      }
-      pBuffer = buffer;
-   }
-   if (targetProgramInfo.smallProgram) {
-      rc = initSmallTargetBuffer(pBuffer);
-   }
-   else {
-      rc = initLargeTargetBuffer(pBuffer);
-   }
-   if (rc != BDM_RC_OK) {
-      return rc;
-   }
-   log.print("Writing Header+Data\n");
-
-   MemorySpace_t memorySpace = MS_XWord;
-
-   // Write the flash parameters & data to target memory
-   if (bdmInterface->writeMemory(memorySpace,
-                   (targetProgramInfo.dataOffset+dataSize)*sizeof(uint8_t),
-                   targetProgramInfo.headerAddress,
-                   (uint8_t *)pBuffer) != BDM_RC_OK) {
-      return PROGRAMMING_RC_ERROR_BDM_WRITE;
-   }
-   // Set target PC to start of code & verify
-   long unsigned targetRegPC;
-   if (bdmInterface->writePC(targetProgramInfo.entry/2) != BDM_RC_OK) {
-      log.error("PC write failed\n");
-      return PROGRAMMING_RC_ERROR_BDM_WRITE;
-   }
-   if (bdmInterface->readPC(&targetRegPC) != BDM_RC_OK) {
-      log.error("PC read failed\n");
-      return PROGRAMMING_RC_ERROR_BDM_READ;
-   }
-   if ((targetProgramInfo.entry/2) != targetRegPC) {
-      log.error("PC verify failed\n");
-      return PROGRAMMING_RC_ERROR_BDM_WRITE;
-   }
-#if defined(LOG) && 0
-   // Single-step initial instructions for debug
-   log.print("        PC       Instr'n      R0       SP  \n"
-         "=============================================\n");
-   const int maxtrace = 200;
-   for (int i=0;;i++) {
-      // Execute the Flash program on target
-      unsigned long pcValue, r0Value, spValue;
-      uint8_t instruction[8];
-      bdmInterface->readReg(DSC_RegPC, &pcValue);
-      bdmInterface->readReg(DSC_RegR0, &r0Value);
-      bdmInterface->readReg(DSC_RegSP, &spValue);
-      DSC_bdmInterface->readMemory(MS_PWord, 4, pcValue, instruction);
-      if (i == maxtrace)
-         break;
-      log.print("%3d: 0x%06X: 0x%04X %04X 0x%06X 0x%06X \n",
-              i, pcValue, getData16Le(instruction), getData16Le(instruction+2), r0Value, spValue);
-      if (DSC_TargetStep() != BDM_RC_OK) {
-         log.print("FlashProgrammer_DSC::executeTargetProgram() - TargetStep() failed\n");
-         return PROGRAMMING_RC_ERROR_BDM;
-      }
-   }
-#endif
-   // Execute the Flash program on target
-   if (bdmInterface->go() != BDM_RC_OK) {
-      log.error("bdmInterface->go() failed\n");
-      return PROGRAMMING_RC_ERROR_BDM;
-   }
-   progressTimer->progress(0, NULL);
-#ifdef LOG
-   log.print("Polling");
-   int dotCount = 50;
-#endif
-   // Wait for target stop at execution completion
-   int timeout = 400; // x 10 ms
-   do {
-      UsbdmSystem::milliSleep(10);
-#ifdef LOG
-      log.printq(".");
-      if (progressTimer != 0) {
-         progressTimer->progress(0);
-      }
-      if (++dotCount == 100) {
-         log.printq("\n");
-         dotCount = 0;
-      }
-#endif
-   } while ((getRunStatus() == BDM_RC_BUSY) && (--timeout>0));
-   log.printq("\n");
-   bdmInterface->halt();
-   unsigned long value;
-   bdmInterface->connect();
-   bdmInterface->readPC(&value);
-   log.print("Start PC = 0x%08lX, end PC = 0x%08lX\n", (unsigned long)targetRegPC, (unsigned long)value);
-
-   // Read the flash parameters back from target memory
-   ResultStruct executionResult;
-   if (bdmInterface->readMemory(memorySpace, sizeof(ResultStruct),
-                  targetProgramInfo.headerAddress,
-                  (uint8_t*)&executionResult) != BDM_RC_OK) {
-      return PROGRAMMING_RC_ERROR_BDM_READ;
-   }
-   uint16_t errorCode = targetToNative16(executionResult.errorCode);
-   if ((timeout <= 0) && (errorCode == FLASH_ERR_OK)) {
-      errorCode = FLASH_ERR_TIMEOUT;
-      log.error("Error, Timeout waiting for completion.\n");
-   }
-   if (targetProgramInfo.smallProgram) {
-      log.print("Complete, errCode=%d\n", errorCode);
-   }
-   else {
-      uint32_t flags = targetToNative16(executionResult.flags);
-      if ((flags != IS_COMPLETE) && (errorCode == FLASH_ERR_OK)) {
-         errorCode = FLASH_ERR_UNKNOWN;
-         log.error("Error, Unexpected flag result.\n");
-      }
-      log.print("Complete, flags = 0x%08X(%s), errCode=%d\n",
-            flags, getProgramActionNames(flags),
-            errorCode);
-   }
-   rc = convertTargetErrorCode((FlashDriverError_t)errorCode);
-   if (rc != BDM_RC_OK) {
-      log.error("Raw error code - %d\n", errorCode);
-      log.error("Error - %s\n", bdmInterface->getErrorString(rc));
-#if (TARGET == MC56F80xx) && 0
-      executionResult.data = targetToNative16(executionResult.data);
-      executionResult.dataSize = targetToNative16(executionResult.dataSize);
-      log.print("   Address = 0x%06X, Data = 0x%04X\n", executionResult.data, executionResult.dataSize);
-#endif
-   }
-#if defined(LOG) && 0
-   uint8_t stackBuffer[50];
-   bdmInterface->readMemory(memorySpace, sizeof(stackBuffer), 0x3F0, stackBuffer);
-#endif
-   return rc;
-}
-
 #if (TARGET == CFVx) || (TARGET == HCS12) || (TARGET == S12Z) || (TARGET == MC56F80xx) || (TARGET == ARM)
 //=======================================================================
 //! \brief Determines the target execution speed
@@ -1224,7 +665,7 @@ USBDM_ErrorCode FlashProgrammer_DSC::determineTargetSpeed(void) {
       return rc;
    }
    LargeTargetTimingDataHeader timingData = {0};
-   timingData.flags      = nativeToTarget16(DO_TIMING_LOOP|IS_COMPLETE); // IS_COMPLETE as check - should be cleared
+   timingData.flags      = nativeToTarget16(DO_TIMING_LOOP|targetTraits.completeFlag); // IS_COMPLETE as check - should be cleared
    timingData.controller = nativeToTarget32(-1);                         // Dummy value - not used
 
    log.print("flags      = 0x%08X(%s)\n",
@@ -1629,304 +1070,6 @@ USBDM_ErrorCode FlashProgrammer_DSC::setFlashSecurity(FlashImagePtr flashImage)
    return rc;
 }
 
-//==================================================================================
-//! Applies a flash operation to a block of Target Flash memory
-//!
-//! @param flashImage       Description of flash contents to be processed.
-//! @param blockSize        Size of block to process (bytes)
-//! @param flashAddress     Start address of block in memory to process
-//! @param flashOperation   Operation to do on flash
-//!
-//! @return error code see \ref USBDM_ErrorCode.
-//!
-//! @note - Assumes flash programming code has already been loaded to target.
-//! @note - The memory range must be within one page for paged devices.
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::doFlashBlock(FlashImagePtr   flashImage,
-                                                  unsigned int    blockSize,
-                                                  uint32_t       &flashAddress,
-                                                  FlashOperation  flashOperation) {
-   LOGGING;
-   log.print("op=%s, [w:0x%06X..w:0x%06X]\n", getFlashOperationName(flashOperation), flashAddress, flashAddress+blockSize-1);
-
-   if (!flashReady) {
-      log.error(" - Error, Flash not ready\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   // OK for empty block
-   if (blockSize==0) {
-      return PROGRAMMING_RC_OK;
-   }
-   //
-   // Find flash region to program - this will recurse to handle sub regions
-   //
-   MemorySpace_t memorySpace       = MS_None;     // Memory space for target access
-   uint32_t      memoryAddressMask = 0xFFFFFFFF;  // Mask to apply to flash address to get memory address
-
-   // MC56F80xx map DATA addresses as high addresses in flashImage
-   if (flashAddress >= FlashImage::DataOffset) {
-      memorySpace       = MS_XWord;
-      memoryAddressMask = 0x00FFFFFF;
-   }
-   else {
-      memorySpace       = MS_PWord;
-   }
-   // Locate containing Memory region (Programmable or RAM)
-   MemoryRegionConstPtr memoryRegionPtr = device->getMemoryRegionFor(flashAddress&memoryAddressMask, memorySpace);
-   if (memoryRegionPtr == NULL) {
-      log.error("Block %s[0x%06X...] is not within target memory.\n", getMemSpaceName(memorySpace), flashAddress&memoryAddressMask);
-      MemoryRegionConstPtr regPtr = device->getMemoryRegion(0);
-      log.error("Region 0=%s[0x%06X...0x%06X]\n", regPtr->getMemoryTypeName(), regPtr->getMemoryRange(0)->start, regPtr->getMemoryRange(0)->end);
-      regPtr = device->getMemoryRegion(1);
-      log.error("Region 0=%s[0x%06X...0x%06X]\n", regPtr->getMemoryTypeName(), regPtr->getMemoryRange(0)->start, regPtr->getMemoryRange(0)->end);
-      return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
-   }
-   uint32_t lastContiguous;  // Last contiguous address in memory space
-   if (!memoryRegionPtr->findLastContiguous(flashAddress&memoryAddressMask, &lastContiguous, memorySpace)) {
-      // This should never fail!
-      log.error("Block %s[0x%06X...] is within target memory BUT location not found!.\n", getMemSpaceName(memorySpace), flashAddress&memoryAddressMask);
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-
-   // Check if block crosses boundary and will need to be split
-   if (((flashAddress&memoryAddressMask)+blockSize-1) > lastContiguous) {
-      // The block is split into a contiguous block + rest. Each is handled by recursion
-      log.print("  ...Block crosses FLASH boundary - recursing\n");
-      uint32_t firstBlockSize = 2*(lastContiguous - flashAddress) + 1;
-      USBDM_ErrorCode rc;
-      rc = doFlashBlock(flashImage, firstBlockSize, flashAddress, flashOperation);
-      if (rc != PROGRAMMING_RC_OK) {
-         return rc;
-      }
-      rc = doFlashBlock(flashImage, blockSize-firstBlockSize, flashAddress, flashOperation);
-      return rc;
-   }
-
-   /*
-    * We have a memory block to process
-    * Check that operation is suitable for this phase
-    */
-   if (memoryRegionPtr->isProgrammableMemory()) {
-      /*
-       * ROM type
-       */
-      switch (flashOperation) {
-         case OpBlankCheck:
-         case OpProgram:
-         case OpSelectiveErase:
-         case OpVerify:
-            // OK operation on ROM
-            break;
-         case OpWriteRam:
-            // Assume to be done in later RAM phase
-            log.print("  ...Skipping block %s[w:0x%06X..w:0x%06X] as ROM memory assumed processed in earlier phase\n",
-                  memoryRegionPtr->getMemoryTypeName(), (flashAddress&memoryAddressMask), (flashAddress&memoryAddressMask)+blockSize-1);
-            // No further processing of this block
-            flashAddress += blockSize;
-            return BDM_RC_OK;
-         default:
-            // Unexpected
-            log.error("  ...Unexpected flashOperation\n");
-            return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-      }
-   }
-   else if (memoryRegionPtr->isWritableMemory() && doRamWrites) {
-      /*
-       * RAM type & writes enabled
-       */
-         switch (flashOperation) {
-         case OpBlankCheck:
-         case OpProgram:
-         case OpSelectiveErase:
-            // Assume done in earlier Flash pass or not applicable
-            log.print("  ...Skipping block %s[w:0x%06X..w:0x%06X] as RAM memory assumed processed in later phase\n",
-                  memoryRegionPtr->getMemoryTypeName(), (flashAddress&memoryAddressMask), (flashAddress&memoryAddressMask)+blockSize-1);
-            // No further processing of this block
-            flashAddress += blockSize;
-            return BDM_RC_OK;
-         case OpWriteRam:
-         case OpVerify:
-            // OK Operation on RAM
-            break;
-         default:
-            // Unexpected
-            log.error("  ...Unexpected ramOperation\n");
-            return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-         }
-   }
-   else {
-      // Unexpected
-      log.error("Block %s[w:0x%06X..w:0x%06X] is not within target memory\n",
-            memoryRegionPtr->getMemoryTypeName(), (flashAddress&memoryAddressMask), (flashAddress&memoryAddressMask)+blockSize-1);
-      return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
-   }
-
-   /*
-    * Have block and suitable operation
-    */
-   MemType_t memoryType = memoryRegionPtr->getMemoryType();
-   log.print("Processing %s[w:0x%06X..w:0x%06X]\n",
-         MemoryRegion::getMemoryTypeName(memoryType), (flashAddress&memoryAddressMask), (flashAddress&memoryAddressMask)+blockSize-1);
-   log.print("Within %s[w:0x%06X..w:0x%06X] (first region)\n",
-         MemoryRegion::getMemoryTypeName(memoryType), memoryRegionPtr->getMemoryRange(0)->start, memoryRegionPtr->getMemoryRange(0)->end);
-
-   flashOperationInfo.controller = memoryRegionPtr->getRegisterAddress();
-   flashOperationInfo.alignment  = memoryRegionPtr->getAlignment();
-   flashOperationInfo.sectorSize = memoryRegionPtr->getSectorSize();
-
-   if ((flashOperation == OpSelectiveErase) && (flashOperationInfo.sectorSize == 0)) {
-      log.error("Error: sector size is 0\n");
-      return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-   }
-   USBDM_ErrorCode rc = loadTargetProgram(memoryRegionPtr, flashOperation);
-   if (rc != PROGRAMMING_RC_OK) {
-      return rc;
-   }
-
-   // Maximum size of data to write
-   unsigned int maxSplitBlockSize = targetProgramInfo.maxDataSize;
-
-   // Buffer for memory write (header+buffer)
-   uint8_t  buffer[100+maxSplitBlockSize];
-   memset(buffer, 0, sizeof(buffer));
-   uint8_t *bufferData = buffer+targetProgramInfo.dataOffset;
-
-   uint32_t alignMask = memoryRegionPtr->getAlignment()-1;
-   log.print("Align mask = 0x%08X\n", alignMask);
-
-   // splitBlockSize must be aligned
-   maxSplitBlockSize &= ~alignMask;
-
-   // Calculate any odd padding bytes at start of block
-   unsigned int oddBytes = flashAddress & alignMask;
-
-   uint32_t addressFlag = 0;        // Modifier for target memory address
-
-      if (memoryType == MemXROM) {
-         // Flag used to indicate data (X:) address
-         log.print("Setting MemXROM address\n");
-         addressFlag |= ADDRESS_DATA;
-      }
-   // Round start address off to alignment requirements
-   flashAddress  &= ~alignMask;
-
-   // Pad block size with odd leading bytes
-   blockSize += oddBytes;
-
-   // Pad block size to alignment requirements
-   blockSize = (blockSize+alignMask)&~alignMask;
-
-   progressTimer->progress(0, NULL);
-
-   while (blockSize>0) {
-      unsigned flashIndex  = 0;
-      unsigned size        = 0;
-      // Determine size of block to process
-      unsigned int splitBlockSize = blockSize;
-      if ((flashOperation == OpProgram)||(flashOperation == OpVerify)||(flashOperation == OpWriteRam)) {
-         // Requires data transfer using buffer
-         if (splitBlockSize>maxSplitBlockSize) {
-            splitBlockSize = maxSplitBlockSize;
-         }
-         // Pad any odd leading elements as 0xFF..
-         for (flashIndex=0; flashIndex<oddBytes; flashIndex++) {
-            bufferData[flashIndex] = (uint8_t)-1;
-         }
-         // Copy flash data to buffer
-         for(flashIndex=0; flashIndex<splitBlockSize; flashIndex++) {
-            bufferData[flashIndex] = flashImage->getValue(flashAddress+flashIndex);
-         }
-         // Pad trailing elements to aligned address
-         for (; (flashIndex&alignMask) != 0; flashIndex++) {
-            bufferData[flashIndex] = flashImage->getValue(flashAddress+flashIndex);
-         }
-         // Actual data bytes to write
-         size = flashIndex;
-      }
-      else {
-         // No data transfer so no size limits
-         flashIndex  = (blockSize+alignMask)&~alignMask;
-         size = 0;
-      }
-      uint32_t targetAddress = flashAddress&memoryAddressMask;
-
-      flashOperationInfo.flashAddress = addressFlag|targetAddress;
-      flashOperationInfo.dataSize     = flashIndex;
-      if (splitBlockSize==0) {
-         log.error(" - Error: splitBlockSize size is 0\n");
-         return PROGRAMMING_RC_ERROR_INTERNAL_CHECK_FAILED;
-      }
-      flashOperationInfo.pageAddress  = memoryRegionPtr->getPageAddress();
-      USBDM_ErrorCode rc = BDM_RC_OK;
-
-      if (flashOperation == OpWriteRam) {
-         /*
-          * RAM Writes
-          */
-         log.print("ramBlock splitBlock %s, %s[w:0x%06X..w:0x%06X]\n",
-               MemoryRegion::getMemoryTypeName(memoryType), getMemSpaceName(memorySpace), targetAddress/2, targetAddress+(splitBlockSize/2)-1);
-         rc = bdmInterface->writeMemory(memorySpace, splitBlockSize, targetAddress, bufferData);
-//         log.printDump((const uint8_t *)bufferData, splitBlockSize*sizeof(uint8_t), targetAddress, WORD_ADDRESS);
-      }
-      else {
-         /*
-          * Flash writes
-          */
-         log.print("splitBlock %s[w:0x%06X..w:0x%06X]\n",
-               MemoryRegion::getMemoryTypeName(memoryType), (flashAddress&memoryAddressMask)/2, (flashAddress&memoryAddressMask)+(splitBlockSize/2)-1);
-         log.print("flashOperationInfo.flashAddress = 0x%08X\n", flashOperationInfo.flashAddress);
-         rc = executeTargetProgram(buffer, size);
-      }
-      if (rc != PROGRAMMING_RC_OK) {
-         log.error("Error rc = %d (%s)\n", rc, bdmInterface->getErrorString(rc));
-         return rc;
-      }
-      // Advance to next block of data
-      flashAddress  += splitBlockSize;
-      blockSize     -= splitBlockSize;
-      oddBytes       = 0; // No odd bytes on subsequent blocks
-      progressTimer->progress(splitBlockSize*sizeof(uint8_t), NULL);
-   }
-   return PROGRAMMING_RC_OK;
-}
-
-//==============================================================================
-//! Apply a flash operation to target based upon occupied flash addresses
-//!
-//! @param flashImage       Flash image to use
-//! @param flashOperation   Operation to do on flash
-//!
-//! @return error code see \ref USBDM_ErrorCode
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::applyFlashOperation(FlashImagePtr flashImage, FlashOperation flashOperation) {
-   LOGGING;
-   USBDM_ErrorCode rc = PROGRAMMING_RC_OK;
-   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
-
-   log.print("Op=%s, Total Bytes = %d\n", getFlashOperationName(flashOperation), flashImage->getByteCount());
-   // Go through each allocated block of memory applying operation
-   while (enumerator->isValid()) {
-      // Start address of block to program to flash
-      uint32_t startBlock = enumerator->getAddress();
-      // Find end of block to process
-      enumerator->lastValid();
-      uint32_t blockSize = enumerator->getAddress() - startBlock + 1;
-      if (blockSize>0) {
-         // Process block [startBlock..endBlock]
-         rc = doFlashBlock(flashImage, blockSize, startBlock, flashOperation);
-         if (rc != PROGRAMMING_RC_OK) {
-            log.error("applyFlashOperation() - Error \n");
-            break;
-         }
-      }
-      else {
-         log.print("applyFlashOperation() - empty block\n");
-      }
-      enumerator->setAddress(startBlock);
-   }
-   return rc;
-}
-
 //==============================================================================
 //! Blank check, program and verify target from flash image
 //!
@@ -1975,140 +1118,24 @@ USBDM_ErrorCode FlashProgrammer_DSC::doProgram(FlashImagePtr flashImage) {
 //!
 //! @return error code see \ref USBDM_ErrorCode
 //!
-//! Todo This is sub-optimal as it may erase the same sector multiple times.
+//! @note Each sector is erased once and contiguous sectors are erased by a single operation
 //!
 USBDM_ErrorCode FlashProgrammer_DSC::doSelectiveErase(FlashImagePtr flashImage) {
    LOGGING;
    progressTimer->restart("Selective Erasing...");
 
-   USBDM_ErrorCode rc;
-   rc = applyFlashOperation(flashImage, OpSelectiveErase);
+   std::vector<EraseRange> eraseRanges;
+   USBDM_ErrorCode rc = planSelectiveErase(flashImage, eraseRanges);
+   for (unsigned index=0; (rc == PROGRAMMING_RC_OK) && (index<eraseRanges.size()); index++) {
+      uint32_t flashAddress = eraseRanges[index].start;
+      rc = doFlashBlock(flashImage, eraseRanges[index].end-eraseRanges[index].start+1, flashAddress, OpSelectiveErase);
+   }
    if (rc != PROGRAMMING_RC_OK) {
       log.error("Selective erase failed, Reason= %s\n", bdmInterface->getErrorString(rc));
    }
    return rc;
 }
 
-//==================================================================================
-//! doReadbackVerify - Verifies the Target memory against memory image
-//!
-//! @param flashImage Description of flash contents to be verified.
-//!
-//! @return error code see \ref USBDM_ErrorCode
-//!
-//! @note Assumes the target device has already been opened & USBDM options set.
-//! @note Assumes target connection has been established
-//! @note Assumes call-back has been set up if used.
-//! @note If target clock trimming is enabled then the Non-volatile clock trim
-//!       locations are ignored.
-//!
-USBDM_ErrorCode FlashProgrammer_DSC::doReadbackVerify(FlashImagePtr flashImage) {
-   LOGGING;
-   const unsigned MAX_BUFFER=0x800;
-   uint8_t buffer[MAX_BUFFER];
-   int checkResult = TRUE;
-   int blockResult;
-
-   FlashImage::EnumeratorPtr enumerator = flashImage->getEnumerator();
-   if (!enumerator->isValid()) {
-      log.print("Empty Memory region\n");
-      flashImage->printMemoryMap();
-   }
-   while (enumerator->isValid()) {
-      uint32_t imageAddress    = enumerator->getAddress();
-      uint32_t memoryAddress;
-      uint32_t      offset      = 0;
-      MemorySpace_t memorySpace = MS_None;
-
-      if (imageAddress >= FlashImage::DataOffset) {
-         memorySpace = MS_XWord;
-         offset      = FlashImage::DataOffset;
-      }
-      else {
-         memorySpace = MS_PWord;
-         offset      = 0;
-      }
-      // Find end of block to verify
-      enumerator->lastValid();
-      unsigned regionSize = enumerator->getAddress() - imageAddress + 1;
-
-      memoryAddress = imageAddress-offset;
-      log.print("Verifying Block %s[0x%8.8X..0x%8.8X]\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+regionSize-1);
-
-      while (regionSize>0) {
-         // Get memory block containing address
-         MemoryRegionConstPtr memRegion = device->getMemoryRegionFor(memoryAddress, memorySpace);
-         if (memRegion == NULL) {
-            log.error("Verifying Block %s[0x%8.8X..0x%8.8X] - Not in valid memory region\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+regionSize-1);
-            return PROGRAMMING_RC_ERROR_OUTSIDE_TARGET_FLASH;
-         }
-         // Get size of continuous block containing address
-         uint32_t lastContinuous=0;
-         memRegion->findLastContiguous(memoryAddress, &lastContinuous);
-         uint32_t continousBlockSize = lastContinuous+1-(memoryAddress);
-
-         unsigned blockSize = regionSize;
-         if (blockSize > continousBlockSize) {
-            blockSize = continousBlockSize;
-         }
-
-         if (blockSize > MAX_BUFFER) {
-            blockSize = MAX_BUFFER;
-         }
-#if (TARGET != MC56F80xx)
-         // Change alignment to match item if necessary
-         if ((imageAddress & ((memorySpace&MS_SIZE)-1)) != 0) {
-            // Unaligned start address
-            memorySpace = (MemorySpace_t)((memorySpace&~MS_SIZE)|MS_Byte);
-         }
-         if (((imageAddress+blockSize) & ((memorySpace&MS_SIZE)-1)) != 0) {
-            // Unaligned end address
-            memorySpace = (MemorySpace_t)((memorySpace&~MS_SIZE)|MS_Byte);
-         }
-#endif
-         if (bdmInterface->readMemory(memorySpace, blockSize*sizeof(uint8_t), memoryAddress, (uint8_t *)buffer) != BDM_RC_OK) {
-            return PROGRAMMING_RC_ERROR_BDM_READ;
-         }
-         blockResult = TRUE;
-         uint32_t testIndex;
-         for (testIndex=0; testIndex<blockSize; testIndex++) {
-            if (flashImage->getValue(imageAddress+testIndex) != buffer[testIndex]) {
-               blockResult = FALSE;
-#ifndef LOG
-               break;
-#endif
-//               log.print("Verifying location[0x%8.8X]=>failed, image=%2.2X != target=%2.2X\n",
-//                     imageAddress+testIndex,
-//                     (uint8_t)(flashImage->getValue(imageAddress+testIndex]),
-//                     buffer[testIndex]);
-            }
-         }
-         log.print("Verifying Sub-block %s[0x%8.8X..0x%8.8X] => %s\n", getMemSpaceName(memorySpace), memoryAddress, memoryAddress+blockSize-1, blockResult?"OK":"FAIL");
-         if (!blockResult) {
-            log.printDump((const uint8_t *)buffer, blockSize*sizeof(uint8_t), memoryAddress);
-         }
-         checkResult    = checkResult && blockResult;
-         regionSize    -= blockSize;
-         imageAddress  += blockSize;
-         memoryAddress  = imageAddress-offset;
-         progressTimer->progress(blockSize, NULL);
-#ifndef LOG
-         if (!checkResult) {
-            break;
-         }
-#endif
-      }
-#ifndef LOG
-      if (!checkResult) {
-         break;
-      }
-#endif
-      // Advance to start of next occupied region
-      enumerator->nextValid();
-   }
-   return checkResult?PROGRAMMING_RC_OK:PROGRAMMING_RC_ERROR_FAILED_VERIFY;
-}
-
 //==============================================================================
 //! Verify target against flash image
 //!
@@ -2415,6 +1442,14 @@ USBDM_ErrorCode FlashProgrammer_DSC::programFlash(FlashImagePtr flashImage,
       if (rc != PROGRAMMING_RC_OK) {
          return rc;
       }
+   }
+   // Only erase and program flash sectors that differ from the target
+   FlashImagePtr programImage = flashImage;
+   if (differentialProgramming) {
+      rc = getChangedSectors(flashImage, programImage);
+      if (rc != PROGRAMMING_RC_OK) {
+         return rc;
+      }
    }
       if (getEraseMethod() == DeviceData::eraseAll) {
       // Erase all flash arrays
@@ -2422,7 +1457,7 @@ USBDM_ErrorCode FlashProgrammer_DSC::programFlash(FlashImagePtr flashImage,
    }
       else if (getEraseMethod() == DeviceData::eraseSelective) {
       // Selective erase area to be programmed - this may have collateral damage!
-      rc = doSelectiveErase(flashImage);
+      rc = doSelectiveErase(programImage);
    }
    if (rc != PROGRAMMING_RC_OK) {
       log.error("Erasing failed, Reason= %s\n", bdmInterface->getErrorString(rc));
@@ -2441,13 +1476,13 @@ USBDM_ErrorCode FlashProgrammer_DSC::programFlash(FlashImagePtr flashImage,
          eraseTime, flashImage->getByteCount()/(1+1024*eraseTime),  rc);
 #endif
    // Program flash
-   rc = doProgram(flashImage);
+   rc = doProgram(programImage);
    if (rc != PROGRAMMING_RC_OK) {
       log.error("Programming failed, Reason= %s\n", bdmInterface->getErrorString(rc));
       return rc;
    }
    if (doRamWrites){
-      rc = doWriteRam(flashImage);
+      rc = doWriteRam(programImage);
       if (rc != PROGRAMMING_RC_OK) {
          log.error("RAM write failed, Reason= %s\n", bdmInterface->getErrorString(rc));
          return rc;
@@ -2467,6 +1502,7 @@ USBDM_ErrorCode FlashProgrammer_DSC::programFlash(FlashImagePtr flashImage,
 
    log.print("Programming & verifying Time = %3.2f s, Speed = %2.2f kBytes/s, rc = %d\n",
          programTime, flashImage->getByteCount()/(1+1024*programTime),  rc);
+   reportTargetProgramStatistics();
 
    return rc;
 }
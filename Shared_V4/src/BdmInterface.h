@@ -274,6 +274,22 @@ public:
     */
    virtual bool                       getBdmMatchRequired() = 0;
 
+   /**
+    *  Select the BDM session used by the calling thread
+    *
+    *  By default all threads share a single session.
+    *  A thread that opens its own BDM concurrently with other threads must use a private session.
+    *
+    *  @param usePrivate - true => use a session private to the calling thread, false => use the shared session
+    *
+    *  @return
+    *      BDM_RC_OK    => OK \n
+    *      other        => Error code - see \ref USBDM_ErrorCode
+    *
+    *  @note Must be called before initBdm()
+    */
+   virtual USBDM_ErrorCode            useThreadSession(bool usePrivate) = 0;
+
    /**
     *  Opens & initialises the currently selected BDM (based on serial number)
     *
@@ -717,6 +733,30 @@ public:
    */
    virtual USBDM_ErrorCode            writeMemory( unsigned memorySpace, unsigned byteCount, unsigned address, unsigned const char *data) = 0;
 
+  /**
+   * Read data from target memory from a list of requests
+   *
+   *  @param count    = Number of requests
+   *  @param requests = List of requests, processed in order
+   *
+   *  @return error code
+   *      BDM_RC_OK    => OK \n
+   *      other        => Error code - see \ref USBDM_ErrorCode
+   */
+   virtual USBDM_ErrorCode            readMemoryV(unsigned count, USBDM_MemoryRequest requests[]) = 0;
+
+  /**
+   * Write data to target memory from a list of requests
+   *
+   *  @param count    = Number of requests
+   *  @param requests = List of requests, processed in order
+   *
+   *  @return error code
+   *      BDM_RC_OK    => OK \n
+   *      other        => Error code - see \ref USBDM_ErrorCode
+   */
+   virtual USBDM_ErrorCode            writeMemoryV(unsigned count, USBDM_MemoryRequest requests[]) = 0;
+
   /**
    * Write Target Program Counter
    *
@@ -108,6 +108,25 @@ DeviceInterface::DeviceInterface(TargetType_t targetType) : targetType(targetTyp
    currentDevice->setSecurity(SEC_SMART);
 }
 
+/**
+ *  Create device interface to given target sharing an existing device database
+ *
+ *  @param targetType      Type of target
+ *  @param deviceDatabase  Database to share (loaded if NULL)
+ *
+ *  @note The shared database must not be modified once shared
+ */
+DeviceInterface::DeviceInterface(TargetType_t targetType, DeviceDataBasePtr deviceDatabase) :
+   targetType(targetType), deviceDatabase(deviceDatabase) {
+
+   LOGGING_Q;
+   log.print("Target Type = %s, shared database = %s\n", getTargetTypeName(targetType), (deviceDatabase != NULL)?"Yes":"No");
+
+   currentDeviceIndex   = 0;
+   loadDeviceDatabase();
+   currentDevice->setSecurity(SEC_SMART);
+}
+
 /**
  *  Destructor
  */
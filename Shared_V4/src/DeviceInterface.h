@@ -20,6 +20,8 @@
 
     Change History
    +====================================================================
+   | 17 Oct 2026 | Added constructor sharing device database
+   +====================================================================
    | 27 Feb 2010 | Created
    +====================================================================
     \endverbatim
@@ -65,6 +67,13 @@ public:
     *  Create interface
     */
    DeviceInterface(TargetType_t targetType);
+   /**
+    *  Create interface sharing an existing device database
+    *
+    *  @param targetType      Type of target
+    *  @param deviceDatabase  Database to share (loaded if NULL)
+    */
+   DeviceInterface(TargetType_t targetType, DeviceDataBasePtr deviceDatabase);
    virtual ~DeviceInterface();
 
    /**
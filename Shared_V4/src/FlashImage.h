@@ -117,7 +117,7 @@ public:
        */
       virtual bool       nextValid() = 0;
       /**
-       *  Advance location to just before the next unoccupied flash location or page boundary
+       *  Advance location to just before the next unoccupied flash location
        *  Assumes current location is occupied.
        */
       virtual void       lastValid() = 0;
@@ -256,6 +256,14 @@ public:
     * @note This is only of use if uint8_t is not a byte
     */
    virtual USBDM_ErrorCode      loadDataBytes(uint32_t bufferSize, uint32_t address, const uint8_t data[], bool dontOverwrite = false) = 0;
+   /**
+    * Copy a range of the Flash image to a buffer
+    *
+    * @param bufferSize    - size of data to copy (in uint8_t)
+    * @param address       - start address of range
+    * @param data          - buffer for data (unallocated locations are returned as 0xFF)
+    */
+   virtual void                 getData(uint32_t bufferSize, uint32_t address, uint8_t data[]) = 0;
 
    /**
     * Get first allocated address
@@ -287,6 +295,15 @@ public:
     *  @param address   -  start address of range
     */
    virtual void fillUnused(uint32_t size, uint32_t address, uint8_t fillValue = 0xFF) = 0;
+
+   /**
+    *  Enable caching of parsed images. \n
+    *  When enabled, loadFile() keeps a binary copy of each parsed image in the
+    *  configuration directory and re-uses it while the source file is unchanged.
+    *
+    *  @param enable - true to enable caching
+    */
+   virtual void enableImageCache(bool enable = true) = 0;
 };
 
 typedef std::shared_ptr<FlashImage> FlashImagePtr;
@@ -20,6 +20,7 @@
 
     Change History
    +====================================================================
+   | 17 Oct 2026 | Added differential programming
    |    May 2015 | Created
    +====================================================================
    \endverbatim
@@ -28,6 +29,7 @@
 #define _FLASHPROGRAMER_H_
 
 #include <memory>
+#include <vector>
 
 #include "Common.h"
 #include "DeviceData.h"
@@ -81,6 +83,32 @@ public:
     */
    typedef USBDM_ErrorCode (*CallBackT)(USBDM_ErrorCode status, int percent, const char *message);
 
+   /**
+    * Compares flash sectors with the target for differential programming\n
+    * Allows a client to provide a faster comparison than reading back the target (e.g. target CRC)
+    */
+   class SectorComparer {
+   public:
+      /**
+       * Flash sector to compare
+       */
+      struct Sector {
+         uint32_t address;  //!< Start address (image and target)
+         uint32_t size;     //!< Size in bytes
+         bool     changed;  //!< Set if target differs from image (unused locations are 0xFF)
+      };
+      virtual ~SectorComparer() {}
+      /**
+       * Compare sectors of the image with the target
+       *
+       * @param flashImage  Image to compare
+       * @param sectors     Sectors to compare, changed is updated
+       *
+       * @return error code - on failure the sectors are read back instead
+       */
+      virtual USBDM_ErrorCode compareSectors(FlashImagePtr flashImage, std::vector<Sector> &sectors) = 0;
+   };
+
    virtual ~FlashProgrammer() {}
 
    /**
@@ -162,6 +190,32 @@ public:
     * @return trim value
     */
    virtual uint16_t           getCalculatedTrimValue() = 0;
+   /**
+    * Enable differential programming\n
+    * Flash sectors are compared with the target before erasing and only
+    * sectors that differ are erased and programmed
+    *
+    * @param enable - true to enable
+    *
+    * @note Ignored if the erase method is Mass or All
+    */
+   virtual void               setDifferentialProgramming(bool enable) = 0;
+   /**
+    * Get number of image bytes that were not programmed by the last
+    * differential programming operation as they were unchanged
+    *
+    * @return byte count
+    */
+   virtual uint32_t           getBytesSkipped() = 0;
+   /**
+    * Set comparer used by differential programming\n
+    * If not set (or it fails) sectors are compared by reading back the target
+    *
+    * @param sectorComparer - comparer to use or NULL
+    *
+    * @note Only used with Selective erase
+    */
+   virtual void               setSectorComparer(SectorComparer *sectorComparer) = 0;
 
 protected:
    FlashProgrammer() {};
@@ -724,6 +724,16 @@ typedef struct {
    TargetVppSelect_t    flash_state;       //!< State of Target Vpp
 } USBDMStatus_t;
 
+//! Describes one memory access in a list of accesses
+//! See USBDM_ReadMemoryV() and USBDM_WriteMemoryV()
+//!
+typedef struct {
+   unsigned int   memorySpace;  //!< Memory space and size of data elements (1/2/4 bytes)
+   unsigned int   byteCount;    //!< Number of _bytes_ to transfer
+   unsigned int   address;      //!< Memory address
+   unsigned char  *data;        //!< Data to write or where to place data read
+} USBDM_MemoryRequest;
+
 //=======================================================================
 //
 //  JTAG Interface
@@ -902,6 +912,25 @@ USBDM_ErrorCode USBDM_Init(void);
 USBDM_API
 USBDM_ErrorCode USBDM_Exit(void);
 
+//! Select the session used by the calling thread
+//!
+//! By default all threads share a single process-wide session so that a BDM
+//! opened by one thread may be used by another.\n
+//! A thread may instead use a session private to that thread.  This allows
+//! several BDMs to be used concurrently by opening each one from its own thread.
+//!
+//! @param usePrivate - true  => Use a session private to the calling thread\n
+//!                     false => Use the process-wide session
+//!
+//! @return \n
+//!     BDM_RC_OK             => OK \n
+//!     BDM_RC_ILLEGAL_PARAMS => A BDM is open in the current session
+//!
+//! @note This must be called before USBDM_Init() for the session to be used
+//!
+USBDM_API
+USBDM_ErrorCode USBDM_UseThreadSession(bool usePrivate);
+
 //! Get version of the DLL
 //!
 //! @return version number (e.g. V4.9.5 => 0x40905)
@@ -994,6 +1023,10 @@ USBDM_ErrorCode  USBDM_GetBDMDescription(const char **deviceDescription);
 //! @note The range of device numbers must be obtained from USBDM_FindDevices() before
 //! calling this function.
 //!
+//! @note By default the opened device is shared by all threads of the process.
+//! Several BDMs may be used concurrently by opening each one from its own thread
+//! after selecting a private session - see USBDM_UseThreadSession().
+//!
 //! @return \n
 //!     BDM_RC_OK => OK \n
 //!     other     => Error code - see \ref USBDM_ErrorCode
@@ -1550,6 +1583,42 @@ USBDM_ErrorCode USBDM_ReadMemory( unsigned int  memorySpace,
                                   unsigned int  address,
                                   unsigned char *data);
 
+//! Write data to target memory from a list of requests
+//!
+//! Adjacent requests (same memory space & contiguous addresses) are combined
+//! into single transfers and transfers are pipelined where the BDM allows.
+//! This is much faster than multiple calls to USBDM_WriteMemory() for small accesses.
+//!
+//! @param count    = Number of requests
+//! @param requests = List of requests, processed in order
+//!
+//! @return error code \n
+//!     BDM_RC_OK    => OK \n
+//!     other        => Error code - see \ref USBDM_ErrorCode
+//!
+//! @note No requests are done if any request is illegal
+//!
+USBDM_API
+USBDM_ErrorCode USBDM_WriteMemoryV(unsigned int count, USBDM_MemoryRequest requests[]);
+
+//! Read data from target memory from a list of requests
+//!
+//! Adjacent requests (same memory space & contiguous addresses) are combined
+//! into single transfers and transfers are pipelined where the BDM allows.
+//! This is much faster than multiple calls to USBDM_ReadMemory() for small accesses.
+//!
+//! @param count    = Number of requests
+//! @param requests = List of requests, processed in order
+//!
+//! @return error code \n
+//!     BDM_RC_OK    => OK \n
+//!     other        => Error code - see \ref USBDM_ErrorCode
+//!
+//! @note No requests are done if any request is illegal
+//!
+USBDM_API
+USBDM_ErrorCode USBDM_ReadMemoryV(unsigned int count, USBDM_MemoryRequest requests[]);
+
 //*****************************************************************************
 //*****************************************************************************
 //*****************************************************************************
@@ -193,10 +193,33 @@ struct BDMState_t {
    BDMActivityState_t      activityFlag;         //!< Indicates the BDM has been asked to do something interesting
 };
 
-//! Internal state USBDM DLL
-extern BDMState_t bdmState;
+//! Information describing the ARM debug Interface
+struct ARM_DebugInformation {
+   // Details from AHB-AP
+   uint8_t          componentClass;               //!< Component class
+   uint32_t         debugBaseaddr;                //!< Base address of Debug ROM
+   unsigned         size4Kb;                      //!< Size of Debug ROM
+   bool             MDM_AP_present;               //!< Indicates if target has Kinetis MDM-AP
+   bool             KinetisSecured;               //!< Indicates if kinetis target is secured
+   // Memory interface capabilities
+   bool             memAccessLimitsChecked;       //!< Have they been checked?
+   bool             byteAccessSupported;          //!< Byte/Halfword access supported?
+   uint32_t         memAPConfig;                  //!< Memory CFG register contents
+};
+
+//! State of an open BDM
+struct BdmSession {
+   BDMState_t              bdmState;             //!< Internal state USBDM DLL
+   USBDM_bdmInformation_t  bdmInfo;              //!< Characteristics of open BDM
+   bool                    bdmInfoValid;         //!< bdmInfo has been obtained from the BDM
+   bool                    pendingResetRelease;  //!< Release of reset deferred to next target access
+   USBDM_ExtendedOptions_t bdmOptions;           //!< Options for BDM
+   bool                    armInitialiseDone;    //!< ARM debug interface has been initialised
+   ARM_DebugInformation    armDebugInformation;  //!< ARM debug interface details
+};
 
-extern USBDM_bdmInformation_t bdmInfo;
+//! Session used by the current thread (process-wide session unless the thread has opted in to a private one)
+extern thread_local BdmSession *currentBdmSession;
 
 /**
  * Does basic connect to target
@@ -2617,8 +2617,9 @@ void UsbdmDialogue::OnLoadFileButtonClick( wxCommandEvent& event ) {
    LOGGING;
 
    wxString caption  = _("Select Binary File to Load");
-   wxString wildcard = _("Binary Files(*.s19,*.sx,*.s,*.srec,*.afx,*.axf,*.elf,*.abs,*.bin)|*.s19;*.sx;*.s;*.srec;*.afx;*.axf;*.elf;*.abs;*.bin|"
+   wxString wildcard = _("Binary Files(*.s19,*.sx,*.s,*.srec,*.hex,*.afx,*.axf,*.elf,*.abs,*.bin)|*.s19;*.sx;*.s;*.srec;*.hex;*.afx;*.axf;*.elf;*.abs;*.bin|"
                          "SREC Hex files (*.s19,*.sx,*.s,*.srec)|*.s19;*.sx;*.s;*.srec|"
+                         "Intel Hex files (*.hex)|*.hex|"
                          "Elf files (*.afx,*.axf,*.elf,*.abs)|*.afx;*.axf;*.elf;*.abs|"
                          "Absolute Binary image files (*.bin,*.abs)|*.bin;*.abs|"
                          "All Files|*");
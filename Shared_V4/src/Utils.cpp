@@ -25,6 +25,7 @@
     \verbatim
    Change History
    -============================================================================
+   | 17 Oct 2026 | Added CRC-32 functions (shared tables)                  - pgo
    |  2 May 2012 | Added hex functions                                     - pgo
    | 10 Jan 2011 | Created                                                 - pgo
    +============================================================================
@@ -133,3 +134,62 @@ string filter(const string &data, const string &pattern) {
    return s;
 }
 
+namespace {
+//! CRC-32 lookup table
+struct Crc32Table {
+   uint32_t entry[256];
+
+   //! @param msbFirst  true => polynomial 0x04C11DB7 MSB first, false => 0xEDB88320 reflected
+   Crc32Table(bool msbFirst) {
+      for (uint32_t index=0; index<256; index++) {
+         uint32_t value;
+         if (msbFirst) {
+            value = index<<24;
+            for (int bit=0; bit<8; bit++) {
+               value = (value<<1)^((value&0x80000000UL)?0x04C11DB7UL:0);
+            }
+         }
+         else {
+            value = index;
+            for (int bit=0; bit<8; bit++) {
+               value = (value>>1)^((value&1)?0xEDB88320UL:0);
+            }
+         }
+         entry[index] = value;
+      }
+   }
+};
+}
+
+//! Update a CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+//!
+//! @param crc    Current CRC value (0xFFFFFFFF to start)
+//! @param data   Data to add
+//! @param size   Size of data in bytes
+//!
+//! @return Updated CRC value (not inverted)
+//!
+uint32_t updateCrc32(uint32_t crc, const uint8_t data[], uint32_t size) {
+   // Initialisation of local static is thread-safe
+   static const Crc32Table crcTable(false);
+   for (uint32_t index=0; index<size; index++) {
+      crc = crcTable.entry[(crc^data[index])&0xFF]^(crc>>8);
+   }
+   return crc;
+}
+
+//! Update a CRC-32 as used by GDB qCRC (polynomial 0x04C11DB7, MSB first)
+//!
+//! @param crc    Current CRC value (0xFFFFFFFF to start)
+//! @param data   Data to add
+//! @param size   Size of data in bytes
+//!
+//! @return Updated CRC value (no final inversion is used)
+//!
+uint32_t updateCrc32Msb(uint32_t crc, const uint8_t data[], uint32_t size) {
+   static const Crc32Table crcTable(true);
+   for (uint32_t index=0; index<size; index++) {
+      crc = crcTable.entry[((crc>>24)^data[index])&0xFF]^(crc<<8);
+   }
+   return crc;
+}
@@ -61,6 +61,26 @@ uint32_t hex8ToDecimal( char **ptr);
 //! @return filtered string
 //!
 std::string filter(const std::string &data, const std::string &pattern);
+
+//! Update a CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+//!
+//! @param crc    Current CRC value (0xFFFFFFFF to start)
+//! @param data   Data to add
+//! @param size   Size of data in bytes
+//!
+//! @return Updated CRC value (not inverted)
+//!
+uint32_t updateCrc32(uint32_t crc, const uint8_t data[], uint32_t size);
+
+//! Update a CRC-32 as used by GDB qCRC (polynomial 0x04C11DB7, MSB first)
+//!
+//! @param crc    Current CRC value (0xFFFFFFFF to start)
+//! @param data   Data to add
+//! @param size   Size of data in bytes
+//!
+//! @return Updated CRC value (no final inversion is used)
+//!
+uint32_t updateCrc32Msb(uint32_t crc, const uint8_t data[], uint32_t size);
 #endif
 
 #endif /* UTILS_H_ */
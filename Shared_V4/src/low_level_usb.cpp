@@ -25,6 +25,8 @@
 
     Change History
    +===========================================================================================
+   |  17 Oct 2026 | Pipelined transactions drain responses after a failure, retry    V4.12.1
+   |  17 Oct 2026 | Added bdm_usb_pipelined_transactions()                           V4.12.1
    |   1 Jun 2015 | Added check for phantom device (for Windows 8)                   V4.11.1.50
    |  31 May 2015 | Removed clear halts as breaks USB3 under linux                   V4.11.1.50
    |  27 Dec 2012 | Changed bdm_usb_recv_epIn() to use geometric backoffs            V4.10.4
@@ -44,6 +46,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #ifdef WIN32
 #include <windows.h>
 #include "libusb.h"
@@ -131,8 +134,17 @@ const char *libusb_error_name(int errNo) {
 // Maximum number of BDMs recognized
 #define MAX_BDM_DEVICES (10)
 
+/*
+ * The device list and LIBUSB context are shared by the process.
+ * The state of the open device is held in a session.
+ * By default all threads share the process-wide session so a device opened
+ * by one thread may be used by another. A thread may opt in to a private
+ * session (see bdm_usb_useThreadSession()) so that several BDMs may be driven
+ * concurrently, one per thread.
+ */
 
-static unsigned int timeoutValue = DEFAULT_USB_TIMEOUT_VALUE; // ms
+// Protects the shared device list, context, open count & the process-wide session
+static pthread_mutex_t deviceListMutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Count of devices found
 static unsigned deviceCount = 0;
@@ -140,14 +152,58 @@ static unsigned deviceCount = 0;
 // Pointers to all BDM devices found. Terminated by NULL pointer entry
 static struct libusb_device *bdmDevices[MAX_BDM_DEVICES+1] = {NULL};
 
-// Handle of opened device
-static libusb_device_handle *usbDeviceHandle = NULL;
+// Number of devices currently open (all sessions)
+static unsigned openDeviceCount = 0;
 
 // Indicates LIBUSB has been initialized
 static bool initialised = FALSE;
 
-// Defaults to 32 bytes unless a larger value can be confirmed
-static int outEndpointMaxPacketSize = 32;
+//! State of an open device
+struct UsbSession {
+   libusb_device_handle *deviceHandle;             //!< Handle of open device
+   int                   outEndpointMaxPacketSize; //!< Defaults to 32 bytes unless a larger value can be confirmed
+   unsigned int          timeoutValue;             //!< Timeout for current transaction (ms)
+   bool                  commandToggle;            //!< JMxx command toggle
+   int                   sequence;                 //!< JMxx sequence state
+   int                   sequenceNumber;           //!< Version 5 sequence number (simple & pipelined)
+};
+
+static const UsbSession defaultUsbSession = {
+      NULL,                         // deviceHandle
+      32,                           // outEndpointMaxPacketSize
+      DEFAULT_USB_TIMEOUT_VALUE,    // timeoutValue
+      false,                        // commandToggle
+      0,                            // sequence
+      0,                            // sequenceNumber
+};
+
+// Session shared by all threads that have not opted in to a private session
+static UsbSession processUsbSession = defaultUsbSession;
+
+// Private session of the current thread (if any)
+static thread_local UsbSession threadUsbSession = defaultUsbSession;
+
+// Session in use by the current thread
+static thread_local UsbSession *currentUsbSession = &processUsbSession;
+
+/**
+ * Serialises use of the process-wide session by different threads.\n
+ * Has no effect for a thread using a private session.
+ */
+class UsbSessionLock {
+   bool locked;
+public:
+   UsbSessionLock() : locked(currentUsbSession == &processUsbSession) {
+      if (locked) {
+         pthread_mutex_lock(&deviceListMutex);
+      }
+   }
+   ~UsbSessionLock() {
+      if (locked) {
+         pthread_mutex_unlock(&deviceListMutex);
+      }
+   }
+};
 
 #define SEQUENCE_MASK (0xC0)
 
@@ -163,8 +219,12 @@ DLL_LOCAL
 USBDM_ErrorCode bdm_usb_init( void ) {
    LOGGING;
 
-   // Not initialised
-   initialised = false;
+   pthread_mutex_lock(&deviceListMutex);
+   if (initialised) {
+      // Already initialised (possibly by another thread) - keep existing devices & context
+      pthread_mutex_unlock(&deviceListMutex);
+      return BDM_RC_OK;
+   }
 
    // Clear array of devices found so far
    for (int i=0; i<=MAX_BDM_DEVICES; i++) {
@@ -184,9 +244,11 @@ USBDM_ErrorCode bdm_usb_init( void ) {
    int rc = libusb_init(&context);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_init() Failed, rc=%d, %s\n", rc, libusb_error_name(rc));
+      pthread_mutex_unlock(&deviceListMutex);
       return BDM_RC_USB_ERROR;
    }
    initialised = true;
+   pthread_mutex_unlock(&deviceListMutex);
    return BDM_RC_OK;
 }
 
@@ -199,12 +261,20 @@ USBDM_ErrorCode bdm_usb_init( void ) {
 DLL_LOCAL
 USBDM_ErrorCode bdm_usb_exit( void ) {
    LOGGING_Q;
+   bdm_usb_close();     // Close device open in the current session
+   pthread_mutex_lock(&deviceListMutex);
+   if (initialised && (openDeviceCount > 0)) {
+      // Other sessions still have devices open
+      log.print("libusb_exit() deferred, %d device(s) still open\n", openDeviceCount);
+      pthread_mutex_unlock(&deviceListMutex);
+      return BDM_RC_OK;
+   }
    if (initialised) {
-      bdm_usb_close();     // Close any open devices
       libusb_exit(context);
       log.print("libusb_exit() called\n");
    }
    initialised = false;
+   pthread_mutex_unlock(&deviceListMutex);
    return BDM_RC_OK;
 }
 
@@ -213,8 +283,7 @@ USBDM_ErrorCode bdm_usb_exit( void ) {
  *
  *  @return BDM_RC_OK        - success
  */
-DLL_LOCAL
-USBDM_ErrorCode bdm_usb_releaseDevices(void) {
+static USBDM_ErrorCode releaseDevices(void) {
    LOGGING_Q;
 
    if (!initialised) {
@@ -233,6 +302,21 @@ USBDM_ErrorCode bdm_usb_releaseDevices(void) {
    return BDM_RC_OK;
 }
 
+/**
+ *  Release all devices referenced by bdm_usb_findDevices
+ *
+ *  @note Devices already opened are unaffected
+ *
+ *  @return BDM_RC_OK        - success
+ */
+DLL_LOCAL
+USBDM_ErrorCode bdm_usb_releaseDevices(void) {
+   pthread_mutex_lock(&deviceListMutex);
+   USBDM_ErrorCode rc = releaseDevices();
+   pthread_mutex_unlock(&deviceListMutex);
+   return rc;
+}
+
 /**
  *  Find all USBDM devices attached to the computer
  *
@@ -252,8 +336,10 @@ USBDM_ErrorCode bdm_usb_findDevices(unsigned *devCount, const UsbId usbIds[]) {
    log.printq("\n");
    *devCount = 0; // Assume failure
 
+   pthread_mutex_lock(&deviceListMutex);
+
    // Release any currently referenced devices
-   bdm_usb_releaseDevices();
+   releaseDevices();
 
    // discover all USB devices
    libusb_device **list;
@@ -261,6 +347,7 @@ USBDM_ErrorCode bdm_usb_findDevices(unsigned *devCount, const UsbId usbIds[]) {
    ssize_t cnt = libusb_get_device_list(context, &list);
    if (cnt < 0) {
       log.error("libusb_get_device_list() failed! \n");
+      pthread_mutex_unlock(&deviceListMutex);
       return BDM_RC_USB_ERROR;
    }
 
@@ -313,6 +400,8 @@ USBDM_ErrorCode bdm_usb_findDevices(unsigned *devCount, const UsbId usbIds[]) {
 
    *devCount = deviceCount;
 
+   pthread_mutex_unlock(&deviceListMutex);
+
    if(deviceCount>0) {
       return BDM_RC_OK;
    }
@@ -364,12 +453,14 @@ USBDM_ErrorCode bdm_walkConfig( libusb_device *device ) {
 //               config->interface[interface].altsetting[0].endpoint[0].bEndpointAddress);
 //         return BDM_RC_USB_ERROR;
       }
-      outEndpointMaxPacketSize = config->interface[interface].altsetting[0].endpoint[0].wMaxPacketSize;
-      log.print("endpointMaxPacketSize = %d\n", outEndpointMaxPacketSize);
+      currentUsbSession->outEndpointMaxPacketSize = config->interface[interface].altsetting[0].endpoint[0].wMaxPacketSize;
+      log.print("endpointMaxPacketSize = %d\n", currentUsbSession->outEndpointMaxPacketSize);
    }
    return (BDM_RC_OK);
 }
 
+static USBDM_ErrorCode openDevice(libusb_device *device);
+
 /**
  *  Open connection to device enumerated by bdm_usb_find_devices()
  *
@@ -382,24 +473,52 @@ DLL_LOCAL
 USBDM_ErrorCode bdm_usb_open( unsigned int device_no ) {
    LOGGING_Q;
 //   log.print("device_no = %d\n", device_no);
+   if (currentUsbSession->deviceHandle != NULL) {
+      log.print("Closing previous device\n");
+      bdm_usb_close();
+   }
+   pthread_mutex_lock(&deviceListMutex);
    if (!initialised) {
       log.error("Not Initialised device\n");
+      pthread_mutex_unlock(&deviceListMutex);
       return BDM_RC_NOT_INITIALISED;
    }
    if (device_no >= deviceCount) {
       log.error("Illegal device #\n");
+      pthread_mutex_unlock(&deviceListMutex);
       return BDM_RC_ILLEGAL_PARAMS;
    }
-   if (usbDeviceHandle != NULL) {
-      log.print("Closing previous device\n");
-      bdm_usb_close();
-   }
+   // Hold reference to device while opening in case list is refreshed by another thread
+   libusb_device *device = libusb_ref_device(bdmDevices[device_no]);
+   pthread_mutex_unlock(&deviceListMutex);
+
 //   log.print("libusb_open(), bdmDevices[device_no] = %p\n", bdmDevices[device_no]);
-   int rc = libusb_open(bdmDevices[device_no], &usbDeviceHandle);
+   USBDM_ErrorCode rc2 = openDevice(device);
+   libusb_unref_device(device);
+   if (rc2 == BDM_RC_OK) {
+      pthread_mutex_lock(&deviceListMutex);
+      openDeviceCount++;
+      pthread_mutex_unlock(&deviceListMutex);
+   }
+   return rc2;
+}
+
+/**
+ *  Open connection to device
+ *
+ *  @param device Device to open
+ *
+ *  @return == BDM_RC_OK (0)     => Success
+ *  @return == BDM_RC_USB_ERROR  => USB failure
+ */
+static USBDM_ErrorCode openDevice(libusb_device *device) {
+   LOGGING_Q;
+
+   int rc = libusb_open(device, &currentUsbSession->deviceHandle);
 
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_open() failed, rc = (%d):%s\n", rc, libusb_error_name(rc));
-      usbDeviceHandle = NULL;
+      currentUsbSession->deviceHandle = NULL;
       if (rc == LIBUSB_ERROR_ACCESS) {
          // Probably device is busy (open in another app)
          return BDM_RC_USB_DEVICE_BUSY;
@@ -414,27 +533,27 @@ USBDM_ErrorCode bdm_usb_open( unsigned int device_no ) {
       }
    }
    int configuration = 0;
-   rc = libusb_get_configuration(usbDeviceHandle, &configuration);
+   rc = libusb_get_configuration(currentUsbSession->deviceHandle, &configuration);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_get_configuration() failed, rc = (%d):%s\n", rc, libusb_error_name(rc));
    }
 //   log.print("libusb_get_configuration() done, configuration = %d\n", configuration);
    if (configuration != 1) {
       // It should be possible to set the same configuration but this fails with LIBUSB_ERROR_BUSY
-      rc = libusb_set_configuration(usbDeviceHandle, 1);
+      rc = libusb_set_configuration(currentUsbSession->deviceHandle, 1);
       if (rc != LIBUSB_SUCCESS) {
          log.error("libusb_set_configuration(1) failed, rc = (%d):%s\n", rc, libusb_error_name(rc));
          // Release the device
-         libusb_close(usbDeviceHandle);
-         usbDeviceHandle = NULL;
+         libusb_close(currentUsbSession->deviceHandle);
+         currentUsbSession->deviceHandle = NULL;
          return BDM_RC_DEVICE_OPEN_FAILED;
       }
    }
-   rc = libusb_claim_interface(usbDeviceHandle, 0);
+   rc = libusb_claim_interface(currentUsbSession->deviceHandle, 0);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_claim_interface(0) failed, rc = (%d):%s\n", rc, libusb_error_name(rc));
-      libusb_close(usbDeviceHandle);
-      usbDeviceHandle = NULL;
+      libusb_close(currentUsbSession->deviceHandle);
+      currentUsbSession->deviceHandle = NULL;
       if ((rc == LIBUSB_ERROR_ACCESS)||(rc == LIBUSB_ERROR_NOT_SUPPORTED)) {
          // Probably device driver is not installed
          return BDM_RC_USB_DEVICE_NOT_INSTALLED;
@@ -444,20 +563,23 @@ USBDM_ErrorCode bdm_usb_open( unsigned int device_no ) {
          return BDM_RC_DEVICE_OPEN_FAILED;
       }
    }
-   USBDM_ErrorCode rc2 = bdm_walkConfig(bdmDevices[device_no]);
+   USBDM_ErrorCode rc2 = bdm_walkConfig(device);
    if (rc2 != BDM_RC_OK) {
       log.error("bdm_walkConfig(0) failed, USBDM rc = (%d)\n", rc2);
+      libusb_release_interface(currentUsbSession->deviceHandle, 0);
+      libusb_close(currentUsbSession->deviceHandle);
+      currentUsbSession->deviceHandle = NULL;
       return BDM_RC_USB_ERROR;
    }
 
 //   log.print("libusb_claim_interface() done\n");
 //   This breaks USB-3 under linux
-//   rc = libusb_clear_halt(usbDeviceHandle, EP_IN);
+//   rc = libusb_clear_halt(currentUsbSession->deviceHandle, EP_IN);
 //   if (rc != LIBUSB_SUCCESS) {
 //      // Ignore
 //      log.error("libusb_clear_halt(...,EP_IN(0x%02X)) failed, rc = %s\n", EP_IN, libusb_error_name((libusb_error)rc));
 //   }
-//   rc = libusb_clear_halt(usbDeviceHandle, EP_OUT);
+//   rc = libusb_clear_halt(currentUsbSession->deviceHandle, EP_OUT);
 //   if (rc != LIBUSB_SUCCESS) {
 //      // Ignore
 //      log.error("libusb_clear_halt(...,EP_OUT(0x%02X)) failed, rc = %s\n", EP_OUT, libusb_error_name((libusb_error)rc));
@@ -476,16 +598,16 @@ USBDM_ErrorCode bdm_usb_close( void ) {
    int rc;
    LOGGING_Q;
 
-   if (usbDeviceHandle == NULL) {
+   if (currentUsbSession->deviceHandle == NULL) {
       log.print("Device not open - no action\n");
       return BDM_RC_OK;
    }
-   rc = libusb_release_interface(usbDeviceHandle, 0);
+   rc = libusb_release_interface(currentUsbSession->deviceHandle, 0);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_release_interface() failed, rc = %s\n", libusb_error_name((libusb_error)rc));
    }
    int configValue;
-   rc = libusb_get_configuration(usbDeviceHandle, &configValue);
+   rc = libusb_get_configuration(currentUsbSession->deviceHandle, &configValue);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_get_configuration() failed, rc = %s\n", libusb_error_name((libusb_error)rc));
    }
@@ -493,15 +615,42 @@ USBDM_ErrorCode bdm_usb_close( void ) {
    // I know the libusb documentation says to use -1 but this ends up being passed
    // to the USB device WHICH IS NOT A GOOD THING!
    //#ifdef xWIN32
-   //   rc = libusb_set_configuration(usbDeviceHandle, 0);
+   //   rc = libusb_set_configuration(currentUsbSession->deviceHandle, 0);
    //#else
-   //   rc = libusb_set_configuration(usbDeviceHandle, -1);
+   //   rc = libusb_set_configuration(currentUsbSession->deviceHandle, -1);
    //#endif
    //   if (rc != LIBUSB_SUCCESS) {
    //      log.error("libusb_set_configuration(-1) failed, rc = %s\n", libusb_error_name((libusb_error)rc));
    //   }
-   libusb_close(usbDeviceHandle);
-   usbDeviceHandle = NULL;
+   libusb_close(currentUsbSession->deviceHandle);
+   currentUsbSession->deviceHandle = NULL;
+
+   pthread_mutex_lock(&deviceListMutex);
+   openDeviceCount--;
+   pthread_mutex_unlock(&deviceListMutex);
+   return BDM_RC_OK;
+}
+
+/**
+ *  Select the session used by the current thread
+ *
+ *  @param usePrivate - true  => Use a session private to this thread\n
+ *                      false => Use the process-wide session shared by all threads
+ *
+ *  @return BDM_RC_OK             => success
+ *  @return BDM_RC_ILLEGAL_PARAMS => A device is open in the current session
+ *
+ *  @note The current session must not have an open device
+ */
+DLL_LOCAL
+USBDM_ErrorCode bdm_usb_useThreadSession(bool usePrivate) {
+   LOGGING_Q;
+
+   if (currentUsbSession->deviceHandle != NULL) {
+      log.error("Device open in current session\n");
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   currentUsbSession = usePrivate?&threadUsbSession:&processUsbSession;
    return BDM_RC_OK;
 }
 
@@ -522,18 +671,19 @@ USBDM_ErrorCode bdm_usb_getStringDescriptor(int index, char *descriptorBuffer, u
 
    memset(descriptorBuffer, '\0', maxLength);
 
-   if (usbDeviceHandle == NULL) {
+   UsbSessionLock lock;
+   if (currentUsbSession->deviceHandle == NULL) {
       log.error("Device handle NULL! \n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
-   int rc = libusb_control_transfer(usbDeviceHandle ,
+   int rc = libusb_control_transfer(currentUsbSession->deviceHandle ,
                                     LIBUSB_REQUEST_TYPE_STANDARD|EP_CONTROL_IN, // bmRequestType
                                     LIBUSB_REQUEST_GET_DESCRIPTOR,              // bRequest
                                     (DT_STRING << 8) + index,                   // wValue
                                     0,                                          // wIndex
                                     (unsigned char *)descriptorBuffer,          // data
                                     maxLength,                                  // size
-                                    timeoutValue);                              // timeout
+                                    currentUsbSession->timeoutValue);           // timeout
 
    if ((rc < 0) || (descriptorBuffer[1] != DT_STRING)) {
       memset(descriptorBuffer, '\0', maxLength);
@@ -586,7 +736,7 @@ USBDM_ErrorCode bdm_usb_send_ep0( const unsigned char * data ) {
    unsigned index;
    LOGGING_Q;
 
-   if (usbDeviceHandle == NULL) {
+   if (currentUsbSession->deviceHandle == NULL) {
       log.error("Device handle NULL!\n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
@@ -604,14 +754,14 @@ USBDM_ErrorCode bdm_usb_send_ep0( const unsigned char * data ) {
          break;
       setupPkt[index] = data[index];
    }
-   rc=libusb_control_transfer(usbDeviceHandle,
+   rc=libusb_control_transfer(currentUsbSession->deviceHandle,
                LIBUSB_REQUEST_TYPE_VENDOR|EP_CONTROL_OUT,      // requestType=Vendor
                setupPkt[1],                                    // request
                setupPkt[2]+(setupPkt[3]<<8),                   // value
                setupPkt[4]+(setupPkt[5]<<8),                   // index
                (unsigned char *)((size>5)?data+6:setupPkt),    // data bytes
                (size>5)?(size-5):0,                            // size (# of data bytes)
-               timeoutValue);                                  // how long to wait for reply
+               currentUsbSession->timeoutValue);               // how long to wait for reply
    if (rc < 0) {
       log.error("libusb_control_transfer() failed, send failed (USB error = %d)\n", rc);
       return(BDM_RC_USB_ERROR);
@@ -654,7 +804,7 @@ USBDM_ErrorCode bdm_usb_recv_ep0(unsigned char *data, unsigned *actualRxSize) {
    }
    *actualRxSize = 0;
 
-   if (usbDeviceHandle == NULL) {
+   if (currentUsbSession->deviceHandle == NULL) {
       log.error("ERROR : Device handle NULL!\n");
       data[0] = BDM_RC_DEVICE_NOT_OPEN;
       return BDM_RC_DEVICE_NOT_OPEN;
@@ -669,14 +819,14 @@ USBDM_ErrorCode bdm_usb_recv_ep0(unsigned char *data, unsigned *actualRxSize) {
 #endif // LOG_LOW_LEVEL
 
    do {
-      rc = libusb_control_transfer(usbDeviceHandle,
+      rc = libusb_control_transfer(currentUsbSession->deviceHandle,
                LIBUSB_REQUEST_TYPE_VENDOR|EP_CONTROL_IN, // bmRequestType
                cmd,                                      // bRequest
                data[2]+(data[3]<<8),                     // wValue
                data[4]+(data[5]<<8),                     // wIndex
                (unsigned char*)data,                     // ptr to data buffer (for Rx)
                size,                                     // wLength = size of transfer
-               timeoutValue                              // timeout
+               currentUsbSession->timeoutValue           // timeout
                );
       if (rc < 0) {
          log.error("libusb_control_transfer(sz=%d) failed - Transfer error (USB error = %s) - retry %d \n", size, libusb_error_name((libusb_error)rc), retry);
@@ -743,7 +893,7 @@ USBDM_ErrorCode bdm_usb_raw_send_ep0(unsigned int         bmRequest,
    int rc;
    LOGGING_Q;
 
-   if (usbDeviceHandle == NULL) {
+   if (currentUsbSession->deviceHandle == NULL) {
       log.error("Device not open\n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
@@ -752,7 +902,7 @@ USBDM_ErrorCode bdm_usb_raw_send_ep0(unsigned int         bmRequest,
          LIBUSB_REQUEST_TYPE_VENDOR|EP_CONTROL_OUT, bmRequest, wValue, wIndex, wLength);
    log.printDump(data, wLength);
 #endif
-   rc = libusb_control_transfer(usbDeviceHandle,
+   rc = libusb_control_transfer(currentUsbSession->deviceHandle,
             LIBUSB_REQUEST_TYPE_VENDOR|LIBUSB_ENDPOINT_OUT, // bmRequestType
             bmRequest,                                      // bRequest
             wValue,                                         // wValue
@@ -795,7 +945,7 @@ USBDM_ErrorCode bdm_usb_raw_recv_ep0(unsigned int   bmRequest,
                                      unsigned int   timeout) {
    int rc;
    LOGGING_E;
-   if (usbDeviceHandle == NULL) {
+   if (currentUsbSession->deviceHandle == NULL) {
       log.error("Device not open\n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
@@ -803,7 +953,7 @@ USBDM_ErrorCode bdm_usb_raw_recv_ep0(unsigned int   bmRequest,
    log.print("rtype=%2.2X, req=%2.2X, val=%4.4X, ind=%4.4X, size=%d\n",
          LIBUSB_REQUEST_TYPE_VENDOR|LIBUSB_ENDPOINT_IN, bmRequest, wValue, wIndex, wLength);
 #endif
-   rc = libusb_control_transfer(usbDeviceHandle,
+   rc = libusb_control_transfer(currentUsbSession->deviceHandle,
             LIBUSB_REQUEST_TYPE_VENDOR|LIBUSB_ENDPOINT_IN,  // bmRequestType
             bmRequest,                                      // bRequest
             wValue,                                         // wValue
@@ -858,7 +1008,7 @@ USBDM_ErrorCode bdm_usb_send_epOut(unsigned int count, const unsigned char *data
    int transferCount;
    LOGGING_Q;
 
-   if (usbDeviceHandle==NULL) {
+   if (currentUsbSession->deviceHandle==NULL) {
       log.error("Device not open\n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
@@ -885,19 +1035,19 @@ USBDM_ErrorCode bdm_usb_send_epOut(unsigned int count, const unsigned char *data
    }
    log.printDump(data, count);
 #endif // LOG_LOW_LEVEL
-   rc = libusb_bulk_transfer(usbDeviceHandle,
+   rc = libusb_bulk_transfer(currentUsbSession->deviceHandle,
                        EP_OUT,                  // Endpoint & direction
                        (unsigned char *)data,   // ptr to Tx data
                        count,                   // number of bytes to Tx
                        &transferCount,          // number of bytes actually Tx
-                       timeoutValue             // timeout
+                       currentUsbSession->timeoutValue // timeout
                        );
    if (rc != LIBUSB_SUCCESS) {
-      log.error("Transfer failed (USB error = %s, timeout=%d)\n", libusb_error_name((libusb_error)rc), timeoutValue);
+      log.error("Transfer failed (USB error = %s, timeout=%d)\n", libusb_error_name((libusb_error)rc), currentUsbSession->timeoutValue);
       return BDM_RC_USB_ERROR;
    }
    if (count != (unsigned)transferCount) {
-      log.error("Transfer failed (USB error = \'incomplete\', timeout=%d)\n", timeoutValue);
+      log.error("Transfer failed (USB error = \'incomplete\', timeout=%d)\n", currentUsbSession->timeoutValue);
       return BDM_RC_USB_ERROR;
    }
    return BDM_RC_OK;
@@ -906,7 +1056,7 @@ USBDM_ErrorCode bdm_usb_send_epOut(unsigned int count, const unsigned char *data
 /**
  * Temporary buffer for IN transactions
  */
-static unsigned char dummyBuffer[512];
+static thread_local unsigned char dummyBuffer[512];
 
 /**
  *  Receives a response from the USBDM device over the In Bulk Endpoint\n
@@ -934,7 +1084,7 @@ USBDM_ErrorCode bdm_usb_recv_epIn(unsigned count, unsigned char *data, unsigned
 
    *actualCount = 0; // Assume failure
 
-   if (usbDeviceHandle==NULL) {
+   if (currentUsbSession->deviceHandle==NULL) {
       log.error("Device not open\n");
       return BDM_RC_DEVICE_NOT_OPEN;
    }
@@ -945,23 +1095,23 @@ USBDM_ErrorCode bdm_usb_recv_epIn(unsigned count, unsigned char *data, unsigned
    int backoffLimit = 5000; // Maximum time to backoff before giving up (ms)
    int backoff      = 1;    // How long to wait before retry (ms)
    do {
-      rc = libusb_bulk_transfer(usbDeviceHandle,
+      rc = libusb_bulk_transfer(currentUsbSession->deviceHandle,
                                 EP_IN,                         // Endpoint & direction
                                 (unsigned char *)dummyBuffer,  // Ptr to Rx data
                                 sizeof(dummyBuffer)-5,         // Number of bytes to Rx
                                 &transferCount,                // Number of bytes actually Rx
-                                timeoutValue                   // Timeout
+                                currentUsbSession->timeoutValue // Timeout
                                 );
       if ((rc == LIBUSB_SUCCESS)  && (dummyBuffer[0] == BDM_RC_BUSY)) {
          // The BDM has indicated it's busy for a while - try again in 10 ms
-         log.error("BDM Busy (timeoutValue=%d ms, backoff=%d ms)\n", timeoutValue, backoff);
+         log.error("BDM Busy (timeoutValue=%d ms, backoff=%d ms)\n", currentUsbSession->timeoutValue, backoff);
          UsbdmSystem::milliSleep(backoff); // So we don't monopolise the USB
          backoff *= 2; // Try 1,2,4,8,16 ... ms
       }
    } while ((rc == LIBUSB_SUCCESS) && (dummyBuffer[0] == BDM_RC_BUSY) && (backoff<=backoffLimit));
 
    if (rc != LIBUSB_SUCCESS) {
-      log.error("Transfer failed (Count = %d, USB error = %s, timeout=%d)\n", count, libusb_error_name((libusb_error)rc), timeoutValue);
+      log.error("Transfer failed (Count = %d, USB error = %s, timeout=%d)\n", count, libusb_error_name((libusb_error)rc), currentUsbSession->timeoutValue);
       data[0] = BDM_RC_USB_ERROR;
       memset(&data[1], 0x00, count-1);
       return BDM_RC_USB_ERROR;
@@ -993,15 +1143,15 @@ USBDM_ErrorCode bdm_usb_reset_connection(void) {
    int rc;
    LOGGING_Q;
 
-   rc = libusb_set_configuration(usbDeviceHandle, 1);
+   rc = libusb_set_configuration(currentUsbSession->deviceHandle, 1);
    if (rc != LIBUSB_SUCCESS) {
       log.error("libusb_set_configuration(1) failed, rc = (%d):%s\n", rc, libusb_error_name(rc));
    }
-//   rc = libusb_clear_halt(usbDeviceHandle, EP_IN);
+//   rc = libusb_clear_halt(currentUsbSession->deviceHandle, EP_IN);
 //   if (rc != LIBUSB_SUCCESS) {
 //      log.error("libusb_clear_halt(...,EP_IN(0x%02X)) failed, rc = %s\n", EP_IN, libusb_error_name((libusb_error)rc));
 //   }
-//   rc = libusb_clear_halt(usbDeviceHandle, EP_OUT);
+//   rc = libusb_clear_halt(currentUsbSession->deviceHandle, EP_OUT);
 //   if (rc != LIBUSB_SUCCESS) {
 //      log.error("libusb_clear_halt(...,EP_OUT(0x%02X)) failed, rc = %s\n", EP_OUT, libusb_error_name((libusb_error)rc));
 //   }
@@ -1027,6 +1177,7 @@ USBDM_ErrorCode bdm_usb_getversion(uint8_t usb_data[10], unsigned *rxSize) {
    usb_data[3] = 1;
    usb_data[4] = 0;
    usb_data[5] = 0;
+   UsbSessionLock lock;
    return bdm_usb_recv_ep0(usb_data, rxSize); // USB EP0
 }
 
@@ -1124,7 +1275,7 @@ USBDM_ErrorCode bdmJMxx_simple_usb_transaction( bool                 commandTogg
    if (rc == BDM_RC_USB_ERROR) {
       // Single retry on Rx error
       log.error("USB Rx error\n");
-      timeoutValue *= 4;
+      currentUsbSession->timeoutValue *= 4;
       rc = bdm_usb_recv_epIn(rxSize, inData, actualRxSize);
       if (rc == BDM_RC_USB_ERROR) {
          log.error("USB Rx error - retry failed\n");
@@ -1169,8 +1320,8 @@ USBDM_ErrorCode bdmJMxx_usb_transaction( unsigned int   txSize,
                                          unsigned int   rxSize,
                                          unsigned char *data,
                                          unsigned int  *actualRxSize) {
-   static bool     commandToggle       = 0;
-   static int      sequence            = 0;
+   bool &commandToggle = currentUsbSession->commandToggle;
+   int  &sequence      = currentUsbSession->sequence;
 //   bool            resetFlag           = false;
 //   bool            reportFlag          = false;
 //   USBDM_ErrorCode rc                  = BDM_RC_OK;
@@ -1206,17 +1357,16 @@ USBDM_ErrorCode bdmVersion5_simple_usb_transaction(
 
    uint8_t         sendBuffer[txSize];
    USBDM_ErrorCode rc;
-   static int sequenceNumber = 0;
 
    LOGGING_Q;
 
-   sequenceNumber = (sequenceNumber + 1)&0x3;
+   currentUsbSession->sequenceNumber = (currentUsbSession->sequenceNumber + 1)&0x3;
    if (outData[1] == CMD_USBDM_GET_CAPABILITIES) {
       log.print("Resetting sequence number=0\n");
-      sequenceNumber = 0;
+      currentUsbSession->sequenceNumber = 0;
    }
    memcpy(sendBuffer, outData, txSize);
-   sendBuffer[1] |= (sequenceNumber<<6)&0xC0;
+   sendBuffer[1] |= (currentUsbSession->sequenceNumber<<6)&0xC0;
 
    sendBuffer[0] = txSize;
    rc = bdm_usb_send_epOut(txSize, (const unsigned char *)sendBuffer);
@@ -1224,7 +1374,7 @@ USBDM_ErrorCode bdmVersion5_simple_usb_transaction(
       log.error("Tx failed\n");
       return rc;
    }
-   if ((txSize%outEndpointMaxPacketSize) == 0) {
+   if ((txSize%currentUsbSession->outEndpointMaxPacketSize) == 0) {
       // Send ZLP
       rc = bdm_usb_send_epOut(0, NULL);
    }
@@ -1233,7 +1383,7 @@ USBDM_ErrorCode bdmVersion5_simple_usb_transaction(
    if (rc == BDM_RC_USB_ERROR) {
       // Single retry on Rx error
       log.error("USB Rx error\n");
-      timeoutValue *= 4;
+      currentUsbSession->timeoutValue *= 4;
       rc = bdm_usb_recv_epIn(rxSize, inData, actualRxSize);
       if (rc == BDM_RC_USB_ERROR) {
          log.error("USB Rx error - retry failed\n");
@@ -1242,17 +1392,17 @@ USBDM_ErrorCode bdmVersion5_simple_usb_transaction(
       log.error(" USB Rx error- retry success\n");
    }
    int receivedSequenceNumber = (inData[0]>>6)&0x03;
-   if (sequenceNumber != receivedSequenceNumber) {
+   if (currentUsbSession->sequenceNumber != receivedSequenceNumber) {
       // Single retry on sequence error (clear any pending Rx)
-      log.error("USB Sequence error, S=%d, R=%d\n", sequenceNumber, receivedSequenceNumber);
+      log.error("USB Sequence error, S=%d, R=%d\n", currentUsbSession->sequenceNumber, receivedSequenceNumber);
       UsbdmSystem::milliSleep(100);
       rc = bdm_usb_recv_epIn(rxSize, inData, actualRxSize);
       receivedSequenceNumber = (inData[0]>>6)&0x03;
-      if ((rc == BDM_RC_USB_ERROR) || (sequenceNumber != receivedSequenceNumber)) {
-         log.error("Immediate retry failed, S=%d, R=%d\n", sequenceNumber, receivedSequenceNumber);
+      if ((rc == BDM_RC_USB_ERROR) || (currentUsbSession->sequenceNumber != receivedSequenceNumber)) {
+         log.error("Immediate retry failed, S=%d, R=%d\n", currentUsbSession->sequenceNumber, receivedSequenceNumber);
          return BDM_RC_USB_ERROR;
       }
-      log.error("Immediate retry succeeded, S=%d, R=%d\n", sequenceNumber, receivedSequenceNumber);
+      log.error("Immediate retry succeeded, S=%d, R=%d\n", currentUsbSession->sequenceNumber, receivedSequenceNumber);
    }
    // Mask sequence bits out of data
    inData[0] &= ~SEQUENCE_MASK;
@@ -1332,16 +1482,17 @@ USBDM_ErrorCode bdm_usb_transaction( unsigned int   txSize,
    LOGGING_Q;
 //   log.setLoggingLevel(0);
 
-   if (usbDeviceHandle==NULL) {
+   UsbSessionLock lock;
+   if (currentUsbSession->deviceHandle==NULL) {
       log.error("device not open\n");
 	  return BDM_RC_DEVICE_NOT_OPEN;
    }
-   timeoutValue = timeout;
+   currentUsbSession->timeoutValue = timeout;
 
-   if (bdmState.useOnlyEp0) {
+   if (currentBdmSession->bdmState.useOnlyEp0) {
       rc = bdmJB16_usb_transaction(txSize, rxSize, data, &tempRxSize);
    }
-   else if (bdmState.version5Protocol) {
+   else if (currentBdmSession->bdmState.version5Protocol) {
       rc = bdmVersion5_usb_transaction(txSize, rxSize, data, &tempRxSize);
    }
    else {
@@ -1367,4 +1518,321 @@ USBDM_ErrorCode bdm_usb_transaction( unsigned int   txSize,
 #endif // LOG_LOW_LEVEL
    return rc;
 }
+
+/**
+ * Maximum number of commands that may be outstanding at once.\n
+ * The 2-bit sequence number in data[1] must be able to distinguish
+ * all outstanding commands from a stale response.
+ */
+#define MAX_PIPELINE_DEPTH (3)
+
+/**
+ * State of a command queued on the OUT endpoint
+ */
+struct PipelineSlot {
+   libusb_transfer *transfer;                  //!< Transfer for command
+   libusb_transfer *zlpTransfer;               //!< Transfer for ZLP following command (if needed)
+   int              completed;                 //!< Command transfer has completed
+   int              zlpCompleted;              //!< ZLP transfer has completed
+   int              sequenceNumber;            //!< Sequence number used for command
+   bool             active;                    //!< Transfers have been submitted
+   uint8_t          buffer[MAX_PACKET_SIZE+1]; //!< Copy of command (with sequence number)
+};
+
+/**
+ * Callback from libusb on OUT transfer completion
+ *
+ * @param transfer - Completed transfer, user_data points to completion flag
+ */
+static void LIBUSB_CALL pipelineCallback(libusb_transfer *transfer) {
+   *(int *)(transfer->user_data) = 1;
+}
+
+/**
+ * Wait for a submitted OUT transfer to complete
+ *
+ * @param transfer  - Transfer to wait for
+ * @param completed - Completion flag set by pipelineCallback()
+ *
+ * @return BDM_RC_OK        => Transfer completed and sent all data
+ * @return BDM_RC_USB_ERROR => Transfer failed, timed out or was cancelled
+ */
+static USBDM_ErrorCode waitForTransfer(libusb_transfer *transfer, int *completed) {
+   LOGGING_Q;
+
+   while (!*completed) {
+      struct timeval tv = {1, 0};
+      int rc = libusb_handle_events_timeout_completed(context, &tv, completed);
+      if ((rc != LIBUSB_SUCCESS) && (rc != LIBUSB_ERROR_INTERRUPTED)) {
+         log.error("libusb_handle_events_timeout_completed() failed, rc = %s\n", libusb_error_name(rc));
+         return BDM_RC_USB_ERROR;
+      }
+   }
+   if ((transfer->status != LIBUSB_TRANSFER_COMPLETED) || (transfer->actual_length != transfer->length)) {
+      log.error("Transfer failed (status = %d, sent %d of %d)\n", transfer->status, transfer->actual_length, transfer->length);
+      return BDM_RC_USB_ERROR;
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Queue a command on the OUT endpoint without waiting for completion
+ *
+ * @param slot        - Slot to use for transfer (must be inactive)
+ * @param transaction - Command to send
+ *
+ * @return BDM_RC_OK => Command queued
+ */
+static USBDM_ErrorCode submitPipelinedCommand(PipelineSlot &slot, const UsbTransaction &transaction) {
+   LOGGING_Q;
+
+   if (transaction.txSize > sizeof(slot.buffer)) {
+      log.error("Command too large (%d bytes)\n", transaction.txSize);
+      return BDM_RC_ILLEGAL_PARAMS;
+   }
+   currentUsbSession->sequenceNumber = (currentUsbSession->sequenceNumber + 1)&0x3;
+
+   memcpy(slot.buffer, transaction.data, transaction.txSize);
+   slot.buffer[0]       = transaction.txSize;
+   slot.buffer[1]      |= (currentUsbSession->sequenceNumber<<6)&SEQUENCE_MASK;
+   slot.sequenceNumber  = currentUsbSession->sequenceNumber;
+   slot.completed       = 0;
+   slot.zlpCompleted    = 1;
+
+#ifdef LOG_LOW_LEVEL
+   log.print("Queueing %s, seq=%d, size=%d\n", getCommandName(transaction.data[1]), currentUsbSession->sequenceNumber, transaction.txSize);
+   log.printDump(slot.buffer, transaction.txSize);
+#endif // LOG_LOW_LEVEL
+
+   libusb_fill_bulk_transfer(slot.transfer, currentUsbSession->deviceHandle, EP_OUT,
+         slot.buffer, transaction.txSize, pipelineCallback, &slot.completed, transaction.timeout);
+   int rc = libusb_submit_transfer(slot.transfer);
+   if (rc != LIBUSB_SUCCESS) {
+      log.error("libusb_submit_transfer() failed, rc = %s\n", libusb_error_name(rc));
+      return BDM_RC_USB_ERROR;
+   }
+   slot.active = true;
+   if ((transaction.txSize%currentUsbSession->outEndpointMaxPacketSize) == 0) {
+      // Send ZLP
+      slot.zlpCompleted = 0;
+      libusb_fill_bulk_transfer(slot.zlpTransfer, currentUsbSession->deviceHandle, EP_OUT,
+            slot.buffer, 0, pipelineCallback, &slot.zlpCompleted, transaction.timeout);
+      rc = libusb_submit_transfer(slot.zlpTransfer);
+      if (rc != LIBUSB_SUCCESS) {
+         log.error("libusb_submit_transfer(ZLP) failed, rc = %s\n", libusb_error_name(rc));
+         slot.zlpCompleted = 1;
+         return BDM_RC_USB_ERROR;
+      }
+   }
+   return BDM_RC_OK;
+}
+
+/**
+ * Wait for completion of the OUT transfers belonging to a slot
+ *
+ * @param slot   - Slot to retire
+ * @param cancel - Cancel the transfers rather than waiting for them to complete
+ *
+ * @return BDM_RC_OK => All transfers completed successfully
+ */
+static USBDM_ErrorCode retirePipelinedCommand(PipelineSlot &slot, bool cancel) {
+   if (!slot.active) {
+      return BDM_RC_OK;
+   }
+   if (cancel) {
+      if (!slot.completed) {
+         libusb_cancel_transfer(slot.transfer);
+      }
+      if (!slot.zlpCompleted) {
+         libusb_cancel_transfer(slot.zlpTransfer);
+      }
+   }
+   USBDM_ErrorCode rc = waitForTransfer(slot.transfer, &slot.completed);
+   if (!slot.zlpCompleted) {
+      USBDM_ErrorCode zlpRc = waitForTransfer(slot.zlpTransfer, &slot.zlpCompleted);
+      if (rc == BDM_RC_OK) {
+         rc = zlpRc;
+      }
+   }
+   slot.active = false;
+   return rc;
+}
+
+/**
+ * Receive the response to a pipelined command
+ *
+ * As for the simple transaction, a USB Rx error is retried once with a longer timeout and
+ * a sequence error is retried once to discard a stale response.
+ *
+ * @param transaction - Transaction to receive response for
+ * @param slot        - Slot used to send command
+ *
+ * @return BDM_RC_OK        => OK response received and matched to command
+ * @return BDM_RC_USB_ERROR => USB failure or response could not be matched
+ * @return else             => Error code from BDM
+ */
+static USBDM_ErrorCode receivePipelinedResponse(UsbTransaction &transaction, const PipelineSlot &slot) {
+   LOGGING_Q;
+
+   currentUsbSession->timeoutValue = transaction.timeout;
+   USBDM_ErrorCode rc = bdm_usb_recv_epIn(transaction.rxSize, transaction.data, &transaction.actualRxSize);
+   if (rc == BDM_RC_USB_ERROR) {
+      // Single retry on Rx error
+      log.error("USB Rx error\n");
+      currentUsbSession->timeoutValue *= 4;
+      rc = bdm_usb_recv_epIn(transaction.rxSize, transaction.data, &transaction.actualRxSize);
+      if (rc == BDM_RC_USB_ERROR) {
+         log.error("USB Rx error - retry failed\n");
+         transaction.actualRxSize = 0;
+         return rc;
+      }
+      log.error(" USB Rx error- retry success\n");
+   }
+   int receivedSequenceNumber = (transaction.data[0]>>6)&0x03;
+   if (slot.sequenceNumber != receivedSequenceNumber) {
+      // Single retry on sequence error (discard stale response)
+      log.error("USB Sequence error, S=%d, R=%d\n", slot.sequenceNumber, receivedSequenceNumber);
+      UsbdmSystem::milliSleep(100);
+      rc = bdm_usb_recv_epIn(transaction.rxSize, transaction.data, &transaction.actualRxSize);
+      receivedSequenceNumber = (transaction.data[0]>>6)&0x03;
+      if ((rc == BDM_RC_USB_ERROR) || (slot.sequenceNumber != receivedSequenceNumber)) {
+         log.error("Immediate retry failed, S=%d, R=%d\n", slot.sequenceNumber, receivedSequenceNumber);
+         transaction.actualRxSize = 0;
+         return BDM_RC_USB_ERROR;
+      }
+      log.error("Immediate retry succeeded, S=%d, R=%d\n", slot.sequenceNumber, receivedSequenceNumber);
+   }
+   // Mask sequence bits out of data
+   transaction.data[0] &= ~SEQUENCE_MASK;
+   return rc;
+}
+
+/**
+ *  Executes a sequence of USB transactions with pipelining.
+ *
+ *  Up to MAX_PIPELINE_DEPTH commands are queued on the OUT endpoint ahead of the
+ *  IN responses so the BDM does not idle waiting for the host between commands.
+ *  Responses are matched to commands using the sequence number in data[1].\n
+ *  Only used for Version 5 BDMs. Other BDMs use individual bdm_usb_transaction() calls.\n
+ *  Processing stops at the first failing command.  Commands already delivered to the BDM
+ *  at that point are still executed by it.  Their responses are drained so the next
+ *  transaction is not out of step.
+ *
+ *  @param count        = Number of transactions
+ *  @param transactions = Transactions to execute in order - see \ref bdm_usb_transaction()\n
+ *                        The response to each command must be exactly rxSize bytes.\n
+ *                        On return transactions[].executed indicates which commands were
+ *                        delivered to the BDM (including any after a failure).
+ *
+ *  @return == BDM_RC_OK (0)     => Success, OK response from device for all commands \n
+ *  @return == BDM_RC_USB_ERROR  => USB failure                                       \n
+ *  @return == else              => Error code from BDM
+ */
+DLL_LOCAL
+USBDM_ErrorCode bdm_usb_pipelined_transactions(unsigned int count, UsbTransaction transactions[]) {
+   USBDM_ErrorCode rc = BDM_RC_OK;
+   LOGGING_Q;
+
+   for (unsigned index=0; index<count; index++) {
+      transactions[index].executed     = false;
+      transactions[index].actualRxSize = 0;
+   }
+   if (currentUsbSession->deviceHandle==NULL) {
+      log.error("device not open\n");
+      return BDM_RC_DEVICE_NOT_OPEN;
+   }
+   if (currentBdmSession->bdmState.useOnlyEp0 || !currentBdmSession->bdmState.version5Protocol || (count <= 1)) {
+      // No pipelining - do each transaction in turn
+      for (unsigned index=0; (index<count) && (rc == BDM_RC_OK); index++) {
+         UsbTransaction &transaction = transactions[index];
+         rc = bdm_usb_transaction(transaction.txSize, transaction.rxSize, transaction.data, transaction.timeout);
+         transaction.executed     = (rc != BDM_RC_USB_ERROR);
+         transaction.actualRxSize = (rc == BDM_RC_OK)?transaction.rxSize:0;
+      }
+      return rc;
+   }
+   UsbSessionLock lock;
+   PipelineSlot slots[MAX_PIPELINE_DEPTH];
+   for (unsigned index=0; index<MAX_PIPELINE_DEPTH; index++) {
+      slots[index].active      = false;
+      slots[index].transfer    = libusb_alloc_transfer(0);
+      slots[index].zlpTransfer = libusb_alloc_transfer(0);
+      if ((slots[index].transfer == NULL) || (slots[index].zlpTransfer == NULL)) {
+         log.error("libusb_alloc_transfer() failed\n");
+         rc = BDM_RC_USB_ERROR;
+      }
+   }
+   unsigned submitted = 0;
+   unsigned received  = 0;
+   while ((rc == BDM_RC_OK) && (received < count)) {
+      // Keep OUT queue full
+      while ((submitted < count) && ((submitted-received) < MAX_PIPELINE_DEPTH)) {
+         rc = submitPipelinedCommand(slots[submitted%MAX_PIPELINE_DEPTH], transactions[submitted]);
+         if (rc != BDM_RC_OK) {
+            break;
+         }
+         submitted++;
+      }
+      if (rc != BDM_RC_OK) {
+         break;
+      }
+      // Get response to oldest outstanding command
+      UsbTransaction &transaction = transactions[received];
+      PipelineSlot   &slot        = slots[received%MAX_PIPELINE_DEPTH];
+      uint8_t         command     = transaction.data[1];
+
+      rc = receivePipelinedResponse(transaction, slot);
+      received++;
+      USBDM_ErrorCode outRc = retirePipelinedCommand(slot, rc == BDM_RC_USB_ERROR);
+      if (rc == BDM_RC_USB_ERROR) {
+         // Command may or may not have been executed
+         transaction.executed = (outRc == BDM_RC_OK);
+         break;
+      }
+      // Response received => command was executed
+      transaction.executed = true;
+      if (outRc != BDM_RC_OK) {
+         rc = outRc;
+         break;
+      }
+      if ((rc == BDM_RC_OK) && (transaction.actualRxSize != transaction.rxSize)) {
+         // Expect exact data size
+         log.error("Failed, cmd = %s, Expected %d; received %d\n",
+               getCommandName(command), transaction.rxSize, transaction.actualRxSize);
+         rc = BDM_RC_UNEXPECTED_RESPONSE;
+      }
+      if (rc != BDM_RC_OK) {
+         log.error("Failed, cmd = %s, rc = %s\n", getCommandName(command), UsbdmSystem::getErrorString(rc));
+      }
+   }
+   // Stop any commands not yet delivered and drain responses to those that were
+   bool     usbOk    = (rc != BDM_RC_USB_ERROR);
+   unsigned executed = 0;
+   for (; received < submitted; received++) {
+      UsbTransaction &transaction = transactions[received];
+      PipelineSlot   &slot        = slots[received%MAX_PIPELINE_DEPTH];
+      if (retirePipelinedCommand(slot, true) != BDM_RC_OK) {
+         // Cancelled before delivery - later commands can't have been delivered either
+         break;
+      }
+      transaction.executed = true;
+      executed++;
+      if (usbOk && (receivePipelinedResponse(transaction, slot) == BDM_RC_USB_ERROR)) {
+         log.error("Failed to drain response, cmd = %s\n", getCommandName(slot.buffer[1]&~SEQUENCE_MASK));
+         usbOk = false;
+      }
+   }
+   for (unsigned index=0; index<MAX_PIPELINE_DEPTH; index++) {
+      retirePipelinedCommand(slots[index], true);
+      libusb_free_transfer(slots[index].transfer);
+      libusb_free_transfer(slots[index].zlpTransfer);
+   }
+   if (executed > 0) {
+      log.error("%d queued commands were executed after the failure\n", executed);
+   }
+   if ((rc == BDM_RC_OK) && !usbOk) {
+      rc = BDM_RC_USB_ERROR;
+   }
+   return rc;
+}
 #endif
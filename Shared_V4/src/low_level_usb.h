@@ -22,6 +22,7 @@ USBDM_ErrorCode bdm_usb_releaseDevices(void);
 USBDM_ErrorCode bdm_usb_getDeviceCount(unsigned int *deviceCount);
 USBDM_ErrorCode bdm_usb_open(unsigned int device_no);
 USBDM_ErrorCode bdm_usb_close(void);
+USBDM_ErrorCode bdm_usb_useThreadSession(bool usePrivate);
 USBDM_ErrorCode bdm_usb_send_ep0(const unsigned char * data);
 USBDM_ErrorCode bdm_usb_recv_ep0(unsigned char *data, unsigned *actualRxSize=0);
 USBDM_ErrorCode bdm_usb_raw_send_ep0(unsigned int  request,
@@ -59,6 +60,20 @@ inline USBDM_ErrorCode bdm_usb_transaction(unsigned int   txSize,
 }
 USBDM_ErrorCode bdm_usb_getversion(uint8_t usb_data[10], unsigned *rxSize=0);
 
+/**
+ * Describes a single command for bdm_usb_pipelined_transactions()
+ */
+struct UsbTransaction {
+   unsigned int    txSize;        //!< Size of transmitted packet
+   unsigned int    rxSize;        //!< Maximum size of received packet
+   unsigned char  *data;          //!< IN/OUT buffer for data - see bdm_usb_transaction()
+   unsigned int    timeout;       //!< Timeout in ms
+   unsigned int    actualRxSize;  //!< Number of bytes actually received
+   bool            executed;      //!< Command was delivered to the BDM (set by bdm_usb_pipelined_transactions())
+};
+
+USBDM_ErrorCode bdm_usb_pipelined_transactions(unsigned int count, UsbTransaction transactions[]);
+
 //**********************************************************
 //!
 //! Sleep for given number of milliseconds (or longer!)
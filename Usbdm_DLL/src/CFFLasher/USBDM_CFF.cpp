@@ -47,7 +47,6 @@
 
 static bool initDone = false;
 
-extern USBDM_ExtendedOptions_t bdmOptions;
 
 CFF_API int bdm_close_device(void) {
    LOGGING_E;
@@ -139,7 +138,7 @@ CFF_API int bdm_test_for_halt(void) {
    USBDMStatus_t USBDMStatus;
    USBDM_GetBDMStatus(&USBDMStatus);
 
-   if (bdmOptions.usePSTSignals) {
+   if (currentBdmSession->bdmOptions.usePSTSignals) {
       // Check processor state using PST signals
       if (USBDMStatus.halt_state == TARGET_HALTED) {
          return 1;
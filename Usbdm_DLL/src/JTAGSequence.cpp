@@ -399,10 +399,10 @@ static const uint8_t *skipSequence(const uint8_t *sequence, uint8_t sentinel, in
 //! Maximum size subroutine that can be cached
 #define MAX_CACHE (64)
 
-static const uint8_t *sequence;
-static const uint8_t *dataOutPtr;
-static const uint8_t *subPtrs[]  = {NULL, NULL, NULL, NULL};
-static       uint8_t subroutineCache[MAX_CACHE];
+static thread_local const uint8_t *sequence;
+static thread_local const uint8_t *dataOutPtr;
+static thread_local const uint8_t *subPtrs[]  = {NULL, NULL, NULL, NULL};
+static thread_local       uint8_t subroutineCache[MAX_CACHE];
 
 typedef struct {
    const uint8_t* startOfLoop;
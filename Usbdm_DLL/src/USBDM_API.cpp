@@ -30,6 +30,8 @@
 \verbatim
  Change History
 +======================================================================================================
+| 17 Oct 2026 | Added USBDM_UseThreadSession()                                     - V4.12.1
+| 17 Oct 2026 | Added USBDM_ReadMemoryV() & USBDM_WriteMemoryV()                   - V4.12.1
 | 10 Dec 2015 | Fixes to USBDM_BDMCommand() (used for S12z mass erase)              - pgo V4.12.1.50
 |  7 Aug 2015 | Added HCS08_SBDFR handling and changed bdmOptions format            - pgo V4.12.1.10
 | 27 Jul 2015 | Changes to handling of default and required bdmOptions              - pgo V4.10.6.260
@@ -98,6 +100,14 @@
 
 #define JTAG_HEADER_SIZE (5) // Number of bytes to reserved for BDM header in JTAG Commands
 
+/*
+ * The following state describes the open BDM and is held in a session.
+ * By default all threads share the process-wide session so that a BDM opened
+ * by one thread may be used by another (e.g. JNI callers).
+ * A thread may opt in to a private session with USBDM_UseThreadSession()
+ * so that a process may drive several BDMs concurrently, one per thread.
+ */
+
 //! Internal state USBDM library
 static const BDMState_t defaultBDMState = {
   /*  initialised          */  false,         // Indicates if the library has been initialised
@@ -107,20 +117,9 @@ static const BDMState_t defaultBDMState = {
   /*  targetType           */  T_OFF,         // Target connected to BDM
   /*  activityFlag         */  BDM_INACTIVE}; // Indicates the BDM has been asked to do something interesting
 
-CPP_DLL_LOCAL
-BDMState_t bdmState = defaultBDMState;
-
 //! Structure describing characteristics of currently open BDM
 static const USBDM_bdmInformation_t defaultBdmInfo =
                    {sizeof(USBDM_bdmInformation_t), 0, 0, 0, 0, BDM_CAP_NONE, 100, 100};
-CPP_DLL_LOCAL
-USBDM_bdmInformation_t bdmInfo = defaultBdmInfo;
-
-CPP_DLL_LOCAL
-bool bdmInfoValid = false;
-
-CPP_DLL_LOCAL
-bool pendingResetRelease = false;
 
 //! Options for BDM
 static const USBDM_ExtendedOptions_t defaultBdmOptions = {
@@ -145,8 +144,37 @@ static const USBDM_ExtendedOptions_t defaultBdmOptions = {
       HCS08_SBDFR_DEFAULT, // hcs08sbdfrAddress       - Address to use to access SBDFR register
 };
 
+//! Information describing the ARM debug Interface
+static const ARM_DebugInformation defaultArmDebugInformation = {
+      0x0,
+      0x0,
+      0,
+      false,
+      false,
+      false,
+      false,
+      0x0,
+};
+
+//! Session initial state
+static const BdmSession defaultBdmSession = {
+      defaultBDMState,              // bdmState
+      defaultBdmInfo,               // bdmInfo
+      false,                        // bdmInfoValid
+      false,                        // pendingResetRelease
+      defaultBdmOptions,            // bdmOptions
+      false,                        // armInitialiseDone
+      defaultArmDebugInformation,   // armDebugInformation
+};
+
+//! Session shared by all threads that have not opted in to a private session
+static BdmSession processBdmSession = defaultBdmSession;
+
+//! Private session of the current thread (if any)
+static thread_local BdmSession threadBdmSession = defaultBdmSession;
+
 CPP_DLL_LOCAL
-USBDM_ExtendedOptions_t bdmOptions = defaultBdmOptions;
+thread_local BdmSession *currentBdmSession = &processBdmSession;
 
 // The following option reduces the rate of polling of the BDM by the codewarrior
 // software.  On the HCS12 version this was interfering with my USB mouse!
@@ -156,7 +184,7 @@ USBDM_ExtendedOptions_t bdmOptions = defaultBdmOptions;
 #define MESSAGE_HEADER_SIZE (8) //!< Size of header for target memory read/write
 
 //! Buffer for USB I/O messages
-static unsigned char usb_data[MAX_PACKET_SIZE+1]; //!< Buffer for USB I/O messages
+static thread_local unsigned char usb_data[MAX_PACKET_SIZE+1]; //!< Buffer for USB I/O messages
 
 static USBDM_ErrorCode updateBdmInfo(void);
 
@@ -181,14 +209,14 @@ USBDM_ErrorCode USBDM_Init(void) {
 
    LOGGING_E;
 
-   bdmState = defaultBDMState;
+   currentBdmSession->bdmState = defaultBDMState;
 
    USBDM_ErrorCode rc = bdm_usb_init();
 
-   bdmState.initialised = (rc == BDM_RC_OK);
+   currentBdmSession->bdmState.initialised = (rc == BDM_RC_OK);
 
-   bdmInfoValid = false;
-   bdmInfo      = defaultBdmInfo;
+   currentBdmSession->bdmInfoValid = false;
+   currentBdmSession->bdmInfo      = defaultBdmInfo;
 
    return rc;
 }
@@ -211,11 +239,40 @@ USBDM_ErrorCode USBDM_Exit(void) {
 
    log.closeLogFile();
 
-   bdmState.initialised = false;
+   currentBdmSession->bdmState.initialised = false;
 
    return rc;
 }
 
+/**
+ * Select the session used by the calling thread
+ *
+ * By default all threads share a single process-wide session so that a BDM
+ * opened by one thread may be used by another.\n
+ * A thread may instead use a session private to that thread.  This allows
+ * several BDMs to be used concurrently by opening each one from its own thread.
+ *
+ * @param usePrivate - true  => Use a session private to the calling thread\n
+ *                     false => Use the process-wide session
+ *
+ * @return \n
+ *     BDM_RC_OK             => OK \n
+ *     BDM_RC_ILLEGAL_PARAMS => A BDM is open in the current session
+ *
+ * @note This must be called before USBDM_Init() for the session to be used
+ */
+USBDM_API
+USBDM_ErrorCode USBDM_UseThreadSession(bool usePrivate) {
+   LOGGING_E;
+
+   USBDM_ErrorCode rc = bdm_usb_useThreadSession(usePrivate);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   currentBdmSession = usePrivate?&threadBdmSession:&processBdmSession;
+   return BDM_RC_OK;
+}
+
 /**
  * Get version of the library
  *
@@ -296,7 +353,7 @@ USBDM_ErrorCode USBDM_FindDevices(unsigned int *deviceCount) {
    };
    *deviceCount = 0;
 
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
    // look for USBDM devices on all USB busses
@@ -332,12 +389,12 @@ USBDM_ErrorCode USBDM_ReleaseDevices(void) {
  */
 USBDM_API
 USBDM_ErrorCode USBDM_GetBDMSerialNumber(const char **deviceSerialNumber) {
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
 
    LOGGING_Q;
-   static char buffer[100];
+   static thread_local char buffer[100];
    *deviceSerialNumber = buffer+2;// Skip over length/DT_STRING bytes
 
    //ToDo - assumes serial number is string descr. #3 - should check device descriptor.
@@ -361,12 +418,12 @@ USBDM_ErrorCode USBDM_GetBDMSerialNumber(const char **deviceSerialNumber) {
  */
 USBDM_API
 USBDM_ErrorCode USBDM_GetBDMDescription(const char **deviceDescription) {
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
 
    LOGGING_Q;
-   static char buffer[100];
+   static thread_local char buffer[100];
    *deviceDescription = buffer+2;// Skip over length/DT_STRING bytes
 
    //ToDo - assumes description is string descr. #2 - should check device descriptor.
@@ -394,12 +451,12 @@ USBDM_API
 USBDM_ErrorCode USBDM_Open(unsigned char deviceNo) {
    LOGGING;
 
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
 
    // Set conservative transfer size
-   bdmInfo.commandBufferSize = DEFAULT_PACKET_SIZE;
+   currentBdmSession->bdmInfo.commandBufferSize = DEFAULT_PACKET_SIZE;
 
    USBDM_ErrorCode rc = BDM_RC_OK;
 
@@ -418,15 +475,15 @@ USBDM_ErrorCode USBDM_Open(unsigned char deviceNo) {
    log.print("\n"
          "         BDM S/W version = %d.%d.%d, H/W version (from BDM) = %1X.%X\n"
          "         ICP S/W version = %1X.%1X,   H/W version (from ICP) = %1X.%X\n",
-         (bdmInfo.BDMsoftwareVersion>>16)&0xFF,(bdmInfo.BDMsoftwareVersion>>8)&0xFF,bdmInfo.BDMsoftwareVersion&0xFF,
-         (bdmInfo.BDMhardwareVersion >> 6) & 0x03,
-         bdmInfo.BDMhardwareVersion & 0x3F,
-         (bdmInfo.ICPsoftwareVersion >> 4) & 0x0F,
-         bdmInfo.ICPsoftwareVersion & 0x0F,
-         (bdmInfo.ICPhardwareVersion >> 6) & 0x03,
-         bdmInfo.ICPhardwareVersion & 0x3F
+         (currentBdmSession->bdmInfo.BDMsoftwareVersion>>16)&0xFF,(currentBdmSession->bdmInfo.BDMsoftwareVersion>>8)&0xFF,currentBdmSession->bdmInfo.BDMsoftwareVersion&0xFF,
+         (currentBdmSession->bdmInfo.BDMhardwareVersion >> 6) & 0x03,
+         currentBdmSession->bdmInfo.BDMhardwareVersion & 0x3F,
+         (currentBdmSession->bdmInfo.ICPsoftwareVersion >> 4) & 0x0F,
+         currentBdmSession->bdmInfo.ICPsoftwareVersion & 0x0F,
+         (currentBdmSession->bdmInfo.ICPhardwareVersion >> 6) & 0x03,
+         currentBdmSession->bdmInfo.ICPhardwareVersion & 0x3F
          );
-   bdmOptions = defaultBdmOptions;
+   currentBdmSession->bdmOptions = defaultBdmOptions;
    return (rc);
 }
 
@@ -443,19 +500,19 @@ USBDM_ErrorCode USBDM_Close(void) {
 
    log.print("Trying to close the device\n");
 
-   if ((bdmOptions.targetType == T_ARM_SWD) || (bdmOptions.targetType == T_ARM_JTAG)) {
+   if ((currentBdmSession->bdmOptions.targetType == T_ARM_SWD) || (currentBdmSession->bdmOptions.targetType == T_ARM_JTAG)) {
       log.print("Doing armDisconnect()\n");
-      armDisconnect(bdmState.targetType);
+      armDisconnect(currentBdmSession->bdmState.targetType);
    }
-   if (bdmState.targetType != T_OFF) { // USBDM on ?
+   if (currentBdmSession->bdmState.targetType != T_OFF) { // USBDM on ?
       // Tell the BDM that we're finished (power down)
       log.print("Telling BDM to close (poweroff)\n");
       USBDM_SetTargetType(T_OFF);
    }
    bdm_usb_close();
 
-   bdmInfoValid = false;
-   bdmInfo      = defaultBdmInfo;
+   currentBdmSession->bdmInfoValid = false;
+   currentBdmSession->bdmInfo      = defaultBdmInfo;
 
    return BDM_RC_OK;
 }
@@ -482,7 +539,7 @@ USBDM_API
 USBDM_ErrorCode USBDM_GetVersion(USBDM_Version_t *version) {
    LOGGING_Q;
 
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
    USBDM_ErrorCode rc;
@@ -527,21 +584,21 @@ USBDM_API
 USBDM_ErrorCode USBDM_GetCapabilities(HardwareCapabilities_t *capabilities) {
    LOGGING_Q;
 
-   if (!bdmState.initialised) {
+   if (!currentBdmSession->bdmState.initialised) {
       return BDM_RC_NOT_INITIALISED;
    }
 
-   if (!bdmInfoValid) {
+   if (!currentBdmSession->bdmInfoValid) {
       return BDM_RC_DEVICE_NOT_OPEN;
    }
    // This library is incompatible with BDM versions < 4.9.5
-   if (bdmInfo.BDMsoftwareVersion < VERSION_NUM(4,9,5)) {
+   if (currentBdmSession->bdmInfo.BDMsoftwareVersion < VERSION_NUM(4,9,5)) {
       *capabilities = BDM_CAP_NONE;
-      log.print("=> Incompatible BDM Firmware Version 0x%06X!\n", bdmInfo.BDMsoftwareVersion);
+      log.print("=> Incompatible BDM Firmware Version 0x%06X!\n", currentBdmSession->bdmInfo.BDMsoftwareVersion);
       return BDM_RC_WRONG_BDM_REVISION;
    }
-   *capabilities = bdmInfo.capabilities;
-   log.print("=> %s\n", getCapabilityName(bdmInfo.capabilities));
+   *capabilities = currentBdmSession->bdmInfo.capabilities;
+   log.print("=> %s\n", getCapabilityName(currentBdmSession->bdmInfo.capabilities));
    return BDM_RC_OK;
 }
 
@@ -558,32 +615,32 @@ static USBDM_ErrorCode updateBdmInfo(void) {
    LOGGING_Q;
 
    // Set safe defaults
-   bdmInfo             = defaultBdmInfo;
-   bdmInfoValid        = false;
-   bdmState.useOnlyEp0 = true;
+   currentBdmSession->bdmInfo             = defaultBdmInfo;
+   currentBdmSession->bdmInfoValid        = false;
+   currentBdmSession->bdmState.useOnlyEp0 = true;
 
    rc = USBDM_GetVersion(&USBDMVersion);
    if (rc != BDM_RC_OK) {
       log.print("USBDM_GetVersion() - Failed!\n");
       return rc;
    }
-   bdmInfo.BDMsoftwareVersion = ((USBDMVersion.bdmSoftwareVersion&0xF0)<<12)+((USBDMVersion.bdmSoftwareVersion&0x0F)<<8);
-   bdmInfo.BDMhardwareVersion = USBDMVersion.bdmHardwareVersion;
-   bdmInfo.ICPsoftwareVersion = USBDMVersion.icpSoftwareVersion;
-   bdmInfo.ICPhardwareVersion = USBDMVersion.icpHardwareVersion;
+   currentBdmSession->bdmInfo.BDMsoftwareVersion = ((USBDMVersion.bdmSoftwareVersion&0xF0)<<12)+((USBDMVersion.bdmSoftwareVersion&0x0F)<<8);
+   currentBdmSession->bdmInfo.BDMhardwareVersion = USBDMVersion.bdmHardwareVersion;
+   currentBdmSession->bdmInfo.ICPsoftwareVersion = USBDMVersion.icpSoftwareVersion;
+   currentBdmSession->bdmInfo.ICPhardwareVersion = USBDMVersion.icpHardwareVersion;
 
    // Use EP0 for JB16 version hardware
-   bdmState.useOnlyEp0   = ((USBDMVersion.icpHardwareVersion & 0xC0) == 0);
-   log.print("=> useOnlyEp0 = %s\n", bdmState.useOnlyEp0?"True":"False");
+   currentBdmSession->bdmState.useOnlyEp0   = ((USBDMVersion.icpHardwareVersion & 0xC0) == 0);
+   log.print("=> useOnlyEp0 = %s\n", currentBdmSession->bdmState.useOnlyEp0?"True":"False");
 
    // Use simplified protocol
-   log.print("bdmInfo.BDMsoftwareVersion = 0x%X\n", bdmInfo.BDMsoftwareVersion);
-   bdmState.version5Protocol = (bdmInfo.BDMsoftwareVersion >= 0x050000);
-   log.print("bdmState.version5Protocol = %s\n", bdmState.version5Protocol?"true":"false");
+   log.print("bdmInfo.BDMsoftwareVersion = 0x%X\n", currentBdmSession->bdmInfo.BDMsoftwareVersion);
+   currentBdmSession->bdmState.version5Protocol = (currentBdmSession->bdmInfo.BDMsoftwareVersion >= 0x050000);
+   log.print("bdmState.version5Protocol = %s\n", currentBdmSession->bdmState.version5Protocol?"true":"false");
 
    if (USBDMVersion.bdmSoftwareVersion == 0xFF) {
       // In ICP mode - use defaults
-      bdmInfoValid = true;
+      currentBdmSession->bdmInfoValid = true;
       return BDM_RC_OK;
    }
    unsigned rxSize = 8; // expect up to 8 bytes
@@ -597,24 +654,24 @@ static USBDM_ErrorCode updateBdmInfo(void) {
 //   log.print("updateBdmInfo() raw=>0x%2.2X-0x%2.2X%2.2X\n",
 //         usb_data[0], usb_data[1], usb_data[2]);
    // BDM_CAP_HCS08 & BDM_CAP_CFV1 are inverted for backwards compatibility
-   bdmInfo.capabilities = (HardwareCapabilities_t)(((usb_data[1]<<8)+usb_data[2])^(BDM_CAP_HCS08|BDM_CAP_CFV1));
+   currentBdmSession->bdmInfo.capabilities = (HardwareCapabilities_t)(((usb_data[1]<<8)+usb_data[2])^(BDM_CAP_HCS08|BDM_CAP_CFV1));
    log.print("=> CAPABILITIES = 0x%2.2X (%s)\n",
-         bdmInfo.capabilities, getCapabilityName(bdmInfo.capabilities));
+         currentBdmSession->bdmInfo.capabilities, getCapabilityName(currentBdmSession->bdmInfo.capabilities));
    if (rxSize >= 5) {
       // Newer BDMs report command buffer size
       unsigned bufferSize = (usb_data[3]<<8) + usb_data[4];
       log.print("=> BDM command buffer size = %d bytes\n", bufferSize);
       if (bufferSize>MAX_PACKET_SIZE)
          bufferSize = MAX_PACKET_SIZE;
-      bdmInfo.commandBufferSize = bufferSize;
-      bdmInfo.jtagBufferSize    = bufferSize-JTAG_HEADER_SIZE;
+      currentBdmSession->bdmInfo.commandBufferSize = bufferSize;
+      currentBdmSession->bdmInfo.jtagBufferSize    = bufferSize-JTAG_HEADER_SIZE;
    }
    if (rxSize >= 8) {
       // Newer BDMs report extended software version
-      bdmInfo.BDMsoftwareVersion = (usb_data[5]<<16)+(usb_data[6]<<8)+usb_data[7];
+      currentBdmSession->bdmInfo.BDMsoftwareVersion = (usb_data[5]<<16)+(usb_data[6]<<8)+usb_data[7];
       log.print("=> Software version = %d.%d.%d\n", usb_data[5], usb_data[6], usb_data[7]);
    }
-   bdmInfoValid = true;
+   currentBdmSession->bdmInfoValid = true;
    return rc;
 }
 
@@ -642,13 +699,13 @@ USBDM_ErrorCode USBDM_GetBdmInformation(USBDM_bdmInformation_t *info) {
          "         bdmInfo.BDMsoftwareVersion = %d.%d.%d\n"
          "         bdmInfo.ICPhardwareVersion = %d.%d\n"
          "         bdmInfo.ICPsoftwareVersion = %d.%d\n",
-         getCapabilityName(bdmInfo.capabilities),
-         bdmInfo.commandBufferSize,
-         bdmInfo.jtagBufferSize,
-         (bdmInfo.BDMhardwareVersion>>6),(bdmInfo.BDMhardwareVersion&0x3F),
-         (bdmInfo.BDMsoftwareVersion>>16),((bdmInfo.BDMsoftwareVersion>>8)&0xFF),(bdmInfo.BDMsoftwareVersion&0xFF),
-         (bdmInfo.ICPhardwareVersion>>6),(bdmInfo.ICPhardwareVersion&0x3F),
-         (bdmInfo.ICPsoftwareVersion>>4),(bdmInfo.ICPsoftwareVersion&0x0F)
+         getCapabilityName(currentBdmSession->bdmInfo.capabilities),
+         currentBdmSession->bdmInfo.commandBufferSize,
+         currentBdmSession->bdmInfo.jtagBufferSize,
+         (currentBdmSession->bdmInfo.BDMhardwareVersion>>6),(currentBdmSession->bdmInfo.BDMhardwareVersion&0x3F),
+         (currentBdmSession->bdmInfo.BDMsoftwareVersion>>16),((currentBdmSession->bdmInfo.BDMsoftwareVersion>>8)&0xFF),(currentBdmSession->bdmInfo.BDMsoftwareVersion&0xFF),
+         (currentBdmSession->bdmInfo.ICPhardwareVersion>>6),(currentBdmSession->bdmInfo.ICPhardwareVersion&0x3F),
+         (currentBdmSession->bdmInfo.ICPsoftwareVersion>>4),(currentBdmSession->bdmInfo.ICPsoftwareVersion&0x0F)
         );
 
    unsigned size = info->size;
@@ -659,11 +716,11 @@ USBDM_ErrorCode USBDM_GetBdmInformation(USBDM_bdmInformation_t *info) {
    if (size == 0) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
-   if (!bdmInfoValid) {
+   if (!currentBdmSession->bdmInfoValid) {
       return BDM_RC_DEVICE_NOT_OPEN;
    }
    // Copy subset of structure that is common.
-   memcpy(info, &bdmInfo, size);
+   memcpy(info, &currentBdmSession->bdmInfo, size);
    info->size = size; // Actual size returned
 
    return BDM_RC_OK;
@@ -679,19 +736,19 @@ USBDM_ErrorCode USBDM_GetBdmInformation(USBDM_bdmInformation_t *info) {
  */
 static USBDM_ErrorCode sendBdmOptions_old(void) {
    LOGGING_E;
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    int index = 0;
    usb_data[index++] = 0;
    usb_data[index++] = CMD_USBDM_SET_OPTIONS;
-   usb_data[index++] = (uint8_t)  bdmOptions.targetVdd;
-   usb_data[index++] = (uint8_t)  bdmOptions.cycleVddOnReset;
-   usb_data[index++] = (uint8_t)  bdmOptions.cycleVddOnConnect;
-   usb_data[index++] = (uint8_t)  bdmOptions.leaveTargetPowered;
-   usb_data[index++] = (uint8_t)  bdmOptions.autoReconnect;
-   usb_data[index++] = (uint8_t)  bdmOptions.guessSpeed;
-   usb_data[index++] = (uint8_t)  bdmOptions.bdmClockSource;
-   usb_data[index++] = (uint8_t)  bdmOptions.useResetSignal;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.targetVdd;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.cycleVddOnReset;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.cycleVddOnConnect;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.leaveTargetPowered;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.autoReconnect;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.guessSpeed;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.bdmClockSource;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.useResetSignal;
 
    return bdm_usb_transaction(index, 1, usb_data);
 }
@@ -706,34 +763,34 @@ static USBDM_ErrorCode sendBdmOptions_old(void) {
  */
 static USBDM_ErrorCode sendBdmOptionsV4_12_1(void) {
    LOGGING_E;
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    int index = 0;
    usb_data[index++] = 0;
    usb_data[index++] = CMD_USBDM_SET_OPTIONS;
    uint8_t options = 0;
-   if (bdmOptions.cycleVddOnReset) {
+   if (currentBdmSession->bdmOptions.cycleVddOnReset) {
       options |= (1<<0);
    }
-   if (bdmOptions.cycleVddOnConnect) {
+   if (currentBdmSession->bdmOptions.cycleVddOnConnect) {
       options |= (1<<1);
    }
-   if (bdmOptions.leaveTargetPowered) {
+   if (currentBdmSession->bdmOptions.leaveTargetPowered) {
       options |= (1<<2);
    }
-   if (bdmOptions.guessSpeed) {
+   if (currentBdmSession->bdmOptions.guessSpeed) {
       options |= (1<<3);
    }
-   if (bdmOptions.useResetSignal) {
+   if (currentBdmSession->bdmOptions.useResetSignal) {
       options |= (1<<4);
    }
    usb_data[index++] = options;
-   usb_data[index++] = (uint8_t)  bdmOptions.targetVdd;
-   usb_data[index++] = (uint8_t)  bdmOptions.bdmClockSource;
-   usb_data[index++] = (uint8_t)  bdmOptions.autoReconnect;
-   if (bdmOptions.targetType == T_HCS08) {
-      usb_data[index++] = (uint8_t)(bdmOptions.hcs08sbdfrAddress>>8);
-      usb_data[index++] = (uint8_t)bdmOptions.hcs08sbdfrAddress;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.targetVdd;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.bdmClockSource;
+   usb_data[index++] = (uint8_t)  currentBdmSession->bdmOptions.autoReconnect;
+   if (currentBdmSession->bdmOptions.targetType == T_HCS08) {
+      usb_data[index++] = (uint8_t)(currentBdmSession->bdmOptions.hcs08sbdfrAddress>>8);
+      usb_data[index++] = (uint8_t)currentBdmSession->bdmOptions.hcs08sbdfrAddress;
    }
    log.printDump(usb_data, index);
    return bdm_usb_transaction(index, 1, usb_data);
@@ -746,7 +803,7 @@ static USBDM_ErrorCode sendBdmOptionsV4_12_1(void) {
  *      other     => Error code - see \ref USBDM_ErrorCode
  */
 static USBDM_ErrorCode sendBdmOptions(void) {
-   if (bdmInfo.BDMsoftwareVersion>=0x040C01) {
+   if (currentBdmSession->bdmInfo.BDMsoftwareVersion>=0x040C01) {
       return sendBdmOptionsV4_12_1();
    }
    else {
@@ -851,26 +908,26 @@ USBDM_ErrorCode USBDM_SetOptions(BDM_Options_t *newBdmOptions) {
    LOGGING_Q;
 
    // Copy subset of options
-   bdmOptions = defaultBdmOptions;
-   bdmOptions.targetType         =                     bdmState.targetType;
-
-   bdmOptions.targetVdd          = (TargetVddSelect_t) newBdmOptions->targetVdd;
-   bdmOptions.cycleVddOnReset    =              (bool) newBdmOptions->cycleVddOnReset;
-   bdmOptions.cycleVddOnConnect  =              (bool) newBdmOptions->cycleVddOnConnect;
-   bdmOptions.leaveTargetPowered =              (bool) newBdmOptions->leaveTargetPowered;
-   bdmOptions.autoReconnect      =     (AutoConnect_t) newBdmOptions->autoReconnect;
-   bdmOptions.guessSpeed         =              (bool) newBdmOptions->guessSpeed;
-   bdmOptions.bdmClockSource     =     (ClkSwValues_t) newBdmOptions->useAltBDMClock;
-   bdmOptions.useResetSignal     =              (bool) newBdmOptions->useResetSignal;
-   bdmOptions.maskInterrupts     =              (bool) newBdmOptions->maskInterrupts;
+   currentBdmSession->bdmOptions = defaultBdmOptions;
+   currentBdmSession->bdmOptions.targetType         =                     currentBdmSession->bdmState.targetType;
+
+   currentBdmSession->bdmOptions.targetVdd          = (TargetVddSelect_t) newBdmOptions->targetVdd;
+   currentBdmSession->bdmOptions.cycleVddOnReset    =              (bool) newBdmOptions->cycleVddOnReset;
+   currentBdmSession->bdmOptions.cycleVddOnConnect  =              (bool) newBdmOptions->cycleVddOnConnect;
+   currentBdmSession->bdmOptions.leaveTargetPowered =              (bool) newBdmOptions->leaveTargetPowered;
+   currentBdmSession->bdmOptions.autoReconnect      =     (AutoConnect_t) newBdmOptions->autoReconnect;
+   currentBdmSession->bdmOptions.guessSpeed         =              (bool) newBdmOptions->guessSpeed;
+   currentBdmSession->bdmOptions.bdmClockSource     =     (ClkSwValues_t) newBdmOptions->useAltBDMClock;
+   currentBdmSession->bdmOptions.useResetSignal     =              (bool) newBdmOptions->useResetSignal;
+   currentBdmSession->bdmOptions.maskInterrupts     =              (bool) newBdmOptions->maskInterrupts;
    // No longer used                            (bool) newBdmOptions->manuallyCycleVdd;
-   bdmOptions.interfaceFrequency =                     newBdmOptions->interfaceSpeed;
-   bdmOptions.usePSTSignals      =              (bool) newBdmOptions->usePSTSignals;
+   currentBdmSession->bdmOptions.interfaceFrequency =                     newBdmOptions->interfaceSpeed;
+   currentBdmSession->bdmOptions.usePSTSignals      =              (bool) newBdmOptions->usePSTSignals;
 
-   adaptRequiredBdmOptions(&bdmOptions);
+   adaptRequiredBdmOptions(&currentBdmSession->bdmOptions);
 
    log.print("=>\n");
-   log.printq("%s", printBdmOptions(&bdmOptions));
+   log.printq("%s", printBdmOptions(&currentBdmSession->bdmOptions));
 
    return sendBdmOptions();
 }
@@ -984,23 +1041,23 @@ USBDM_ErrorCode USBDM_SetExtendedOptions(const USBDM_ExtendedOptions_t *newBdmOp
    }
    // Save current target type (as may already be set)
    TargetType_t currentTargetType   = newBdmOptions->targetType;
-   bdmOptions = defaultBdmOptions;
-   memcpy(&bdmOptions, newBdmOptions, newBdmOptions->size);
-   if ( bdmState.targetType != T_NONE) {
+   currentBdmSession->bdmOptions = defaultBdmOptions;
+   memcpy(&currentBdmSession->bdmOptions, newBdmOptions, newBdmOptions->size);
+   if ( currentBdmSession->bdmState.targetType != T_NONE) {
       // Override hint with currently set target type
       // before adapting to target
-      bdmOptions.targetType = bdmState.targetType;
+      currentBdmSession->bdmOptions.targetType = currentBdmSession->bdmState.targetType;
    }
    else {
       // Use hint provided
-      bdmOptions.targetType = currentTargetType;
+      currentBdmSession->bdmOptions.targetType = currentTargetType;
    }
-   adaptRequiredBdmOptions(&bdmOptions);
+   adaptRequiredBdmOptions(&currentBdmSession->bdmOptions);
    // Restore current target type
-   bdmOptions.targetType = currentTargetType;
+   currentBdmSession->bdmOptions.targetType = currentTargetType;
 
    log.print("accepted => \n");
-   log.printq("%s", printBdmOptions(&bdmOptions));
+   log.printq("%s", printBdmOptions(&currentBdmSession->bdmOptions));
 
    return sendBdmOptions();
 }
@@ -1027,11 +1084,11 @@ USBDM_ErrorCode USBDM_GetExtendedOptions(USBDM_ExtendedOptions_t *currentBdmOpti
    if (size == 0) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
-   memcpy(currentBdmOptions, &bdmOptions, size);
+   memcpy(currentBdmOptions, &currentBdmSession->bdmOptions, size);
    currentBdmOptions->size = size;
 
    log.print("=>\n");
-   log.printq("%s", printBdmOptions(&bdmOptions));
+   log.printq("%s", printBdmOptions(&currentBdmSession->bdmOptions));
 
    return BDM_RC_OK;
 }
@@ -1061,23 +1118,23 @@ USBDM_ErrorCode  USBDM_SetTargetVdd(TargetVddSelect_t targetVdd) {
    switch (targetVdd) {
    case BDM_TARGET_VDD_ENABLE:
       // Set to last level
-      targetVdd = bdmOptions.targetVdd;
-      armInitialiseDone     = false;
+      targetVdd = currentBdmSession->bdmOptions.targetVdd;
+      currentBdmSession->armInitialiseDone     = false;
       break;
    case BDM_TARGET_VDD_DISABLE:
       // Change to off but do not change last level
       targetVdd = BDM_TARGET_VDD_OFF;
-      armInitialiseDone     = false;
+      currentBdmSession->armInitialiseDone     = false;
       break;
    case BDM_TARGET_VDD_OFF:
-      armInitialiseDone     = false;
+      currentBdmSession->armInitialiseDone     = false;
       break;
    default:
       // Record new level
-      bdmOptions.targetVdd = targetVdd;
+      currentBdmSession->bdmOptions.targetVdd = targetVdd;
       break;
    }
-   if (!bdmOptions.leaveTargetPowered && (bdmState.targetType == T_OFF)) {
+   if (!currentBdmSession->bdmOptions.leaveTargetPowered && (currentBdmSession->bdmState.targetType == T_OFF)) {
       // Force Vdd off
       // Vdd will be enabled by setTargetType()
       targetVdd = BDM_TARGET_VDD_OFF;
@@ -1110,7 +1167,7 @@ USBDM_ErrorCode USBDM_GetBDMStatus(USBDMStatus_t *USBDMStatus) {
    unsigned          BDMStatus       = 0;
    USBDM_ErrorCode   rc;
 
-   USBDMStatus->target_type = bdmState.targetType;
+   USBDMStatus->target_type = currentBdmSession->bdmState.targetType;
 
    // Poll the BDM
    usb_data[0] = 0;
@@ -1231,7 +1288,7 @@ USBDM_API
 USBDM_ErrorCode USBDM_ControlPins(unsigned int control, unsigned int *status) {
    LOGGING_Q;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("0x%X(%s)\n", control, getPinLevelName((PinLevelMasks_t)control));
    usb_data[0] = 0;
@@ -1243,9 +1300,9 @@ USBDM_ErrorCode USBDM_ControlPins(unsigned int control, unsigned int *status) {
    if ((rc == BDM_RC_OK) && (status != NULL)) {
       *status = (usb_data[1]<<8) + usb_data[2];
    }
-   if (pendingResetRelease && ((control&PIN_RESET) != PIN_RESET_NC)) {
+   if (currentBdmSession->pendingResetRelease && ((control&PIN_RESET) != PIN_RESET_NC)) {
       // Manually set reset level - clear pending release
-      pendingResetRelease = false;
+      currentBdmSession->pendingResetRelease = false;
       log.print("Clearing pending RESET release\n");
    }
    return rc;
@@ -1285,10 +1342,10 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   bdmState.activityFlag = BDM_ACTIVE;
-   bdmState.targetType   = T_OFF;
-   pendingResetRelease   = false;
-   armInitialiseDone     = false;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.targetType   = T_OFF;
+   currentBdmSession->pendingResetRelease   = false;
+   currentBdmSession->armInitialiseDone     = false;
 
    if (targetType == T_ARM) {
       // Convert to either T_ARM_SWD or T_ARM_JTAG as supported
@@ -1312,20 +1369,20 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
    if (rc != BDM_RC_OK) {
       log.print("Error, rc= %s\n", UsbdmSystem::getErrorString(rc));
       USBDM_SetTargetVdd(BDM_TARGET_VDD_DISABLE);
-      UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
-      bdmState.targetType = T_OFF;
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
+      currentBdmSession->bdmState.targetType = T_OFF;
       return rc;
    }
-   bdmState.targetType = targetType;
+   currentBdmSession->bdmState.targetType = targetType;
 
    if (targetType == T_OFF) {
-      if (!bdmOptions.leaveTargetPowered) {
+      if (!currentBdmSession->bdmOptions.leaveTargetPowered) {
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_DISABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
       }
       return rc;
    }
-   bdmOptions.targetType = targetType;
+   currentBdmSession->bdmOptions.targetType = targetType;
    switch (targetType) {
    case T_ARM_JTAG:
    case T_ARM_SWD:
@@ -1333,15 +1390,15 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
    case T_MC56F80xx:
    case T_EZFLASH:
    case T_JTAG:
-      if (bdmOptions.interfaceFrequency == 0) {
-         bdmOptions.interfaceFrequency = 500; // kHz default
+      if (currentBdmSession->bdmOptions.interfaceFrequency == 0) {
+         currentBdmSession->bdmOptions.interfaceFrequency = 500; // kHz default
       }
-      USBDM_SetSpeed(bdmOptions.interfaceFrequency);
+      USBDM_SetSpeed(currentBdmSession->bdmOptions.interfaceFrequency);
       break;
    default:
       break;
    }
-   if ((bdmInfo.capabilities & BDM_CAP_VDDCONTROL) == 0) {
+   if ((currentBdmSession->bdmInfo.capabilities & BDM_CAP_VDDCONTROL) == 0) {
       return rc;
    }
    //=====================================================================
@@ -1353,7 +1410,7 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   if (bdmOptions.targetVdd == BDM_TARGET_VDD_OFF) {
+   if (currentBdmSession->bdmOptions.targetVdd == BDM_TARGET_VDD_OFF) {
       if (bdmStatus.power_state == BDM_TARGET_VDD_INT) {
          // Turn off power if controlled
          return USBDM_SetTargetVdd(BDM_TARGET_VDD_OFF);
@@ -1362,7 +1419,7 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
    }
    // Check if POR needed
    if ((bdmStatus.power_state == BDM_TARGET_VDD_INT) ||
-       ( ((bdmInfo.capabilities & BDM_CAP_VDDSENSE) != 0) && (bdmStatus.power_state == BDM_TARGET_VDD_EXT))) {
+       ( ((currentBdmSession->bdmInfo.capabilities & BDM_CAP_VDDSENSE) != 0) && (bdmStatus.power_state == BDM_TARGET_VDD_EXT))) {
       // Target already powered - don't do POR
       log.print("Target already powered - no POR\n");
       return BDM_RC_OK;
@@ -1375,56 +1432,56 @@ USBDM_ErrorCode USBDM_SetTargetType(TargetType_t targetType) {
          // Specific power/pin sequence to enter BKGD mode
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKGD_LOW);
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
          USBDM_ControlPins(PIN_RESET_3STATE);
-         UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
          USBDM_ControlPins(PIN_RELEASE);
-         UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
          break;
       case T_RS08:
       case T_HCS08:
       case T_CFV1:
          // Specific power/pin sequence to enter BKGD mode
-         if (bdmOptions.useResetSignal) {
+         if (currentBdmSession->bdmOptions.useResetSignal) {
             USBDM_ControlPins(PIN_RESET_LOW|PIN_BKGD_LOW);
          }
          else {
             USBDM_ControlPins(PIN_BKGD_LOW);
          }
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
-         if (bdmOptions.useResetSignal) {
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
+         if (currentBdmSession->bdmOptions.useResetSignal) {
             USBDM_ControlPins(PIN_RESET_3STATE);
-            UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+            UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
          }
          USBDM_ControlPins(PIN_RELEASE);
-         UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
          break;
       case T_CFVx:
          // Specific power/pin sequence to enter BKGD mode
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKPT_LOW);
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
          USBDM_ControlPins(PIN_RESET_3STATE);
-         UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
          USBDM_ControlPins(PIN_RELEASE);
-         UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
          break;
       case T_ARM_JTAG:
       case T_ARM_SWD:
          // To prevent watch-dog problems leave target in hardware RESET
          // The target will enter debug mode on 1st USBDM_Connect()
          USBDM_ControlPins(PIN_RESET_LOW);
-         pendingResetRelease = true;
+         currentBdmSession->pendingResetRelease = true;
          log.print("ARM - Setting pending reset release\n");
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
          break;
       case T_MC56F80xx:
       case T_EZFLASH:
       case T_JTAG:
          rc = USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-         UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+         UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
          break;
       default:
          log.print("Illegal target type\n");
@@ -1513,14 +1570,14 @@ USBDM_ErrorCode USBDM_Connect(void) {
 USBDM_ErrorCode rc;
    LOGGING;
    log.setLoggingLevel(10); // Always log connect sequence
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
 
-   if ((bdmOptions.targetType == T_ARM_SWD) || (bdmOptions.targetType == T_ARM_JTAG)) {
-      rc = armConnect(bdmOptions.targetType);
+   if ((currentBdmSession->bdmOptions.targetType == T_ARM_SWD) || (currentBdmSession->bdmOptions.targetType == T_ARM_JTAG)) {
+      rc = armConnect(currentBdmSession->bdmOptions.targetType);
       // Don't retry if secured as it will upset detection
       if ((rc != BDM_RC_OK) && (rc != BDM_RC_SECURED)) {
-         rc = armConnect(bdmOptions.targetType);
+         rc = armConnect(currentBdmSession->bdmOptions.targetType);
       }
       if (rc != BDM_RC_OK) {
          log.print("ARM connect, rc = %d\n", rc);
@@ -1532,12 +1589,12 @@ USBDM_ErrorCode rc;
          return rc;
       }
    }
-   if (pendingResetRelease) {
+   if (currentBdmSession->pendingResetRelease) {
       // Release pending reset
-      log.print("Releasing pending reset and waiting %d ms\n", bdmOptions.resetRecoveryInterval);
-      pendingResetRelease = false;
+      log.print("Releasing pending reset and waiting %d ms\n", currentBdmSession->bdmOptions.resetRecoveryInterval);
+      currentBdmSession->pendingResetRelease = false;
       USBDM_ControlPins(PIN_RESET_3STATE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
    }
    return rc;
 }
@@ -1562,11 +1619,11 @@ USBDM_ErrorCode USBDM_SetSpeed( unsigned long frequency) {
    unsigned int value;
    LOGGING_Q;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("BDM Clk = %lukHz\n", frequency);
 
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
       case T_HC12 :
       case T_S12Z :
       case T_HCS08 :
@@ -1588,7 +1645,7 @@ USBDM_ErrorCode USBDM_SetSpeed( unsigned long frequency) {
       case T_ARM_JTAG:
       case T_ARM_SWD:
          // BDM command value is frequency in kHz. Should be less than 1/5 target clk
-         bdmOptions.interfaceFrequency = frequency;
+         currentBdmSession->bdmOptions.interfaceFrequency = frequency;
          value = frequency;
          break;
       default :
@@ -1640,7 +1697,7 @@ USBDM_ErrorCode USBDM_GetSpeedHz(unsigned long *frequency /* Hz */) {
       *frequency = 8001000; // default to safe 8MHz on error
    }
    else {
-      switch (bdmState.targetType) {
+      switch (currentBdmSession->bdmState.targetType) {
       case T_HC12 :
       case T_S12Z :
       case T_HCS08 :
@@ -1689,9 +1746,9 @@ USBDM_ErrorCode USBDM_GetSpeedHz(unsigned long *frequency /* Hz */) {
 USBDM_API
 USBDM_ErrorCode USBDM_ReadStatusReg(unsigned long *BDMStatusReg) {
    USBDM_ErrorCode rc;
-   static          int  pollCount          = 0;
-   static          int  pollInterval       = 0;
-   static unsigned long lastBDMStatusReg   = -1;
+   static thread_local int           pollCount        = 0;
+   static thread_local int           pollInterval     = 0;
+   static thread_local unsigned long lastBDMStatusReg = -1;
    LOGGING_Q;
 
    (void)pollCount;
@@ -1701,11 +1758,11 @@ USBDM_ErrorCode USBDM_ReadStatusReg(unsigned long *BDMStatusReg) {
    int dummy              = FALSE;
 #endif
 
-   if ((bdmState.activityFlag&BDM_STATUSREG) != 0) {
+   if ((currentBdmSession->bdmState.activityFlag&BDM_STATUSREG) != 0) {
       // Reset polling info
       pollCount      = 0;
       pollInterval   = 0;
-      bdmState.activityFlag = (BDMActivityState_t) (bdmState.activityFlag & ~BDM_STATUSREG);
+      currentBdmSession->bdmState.activityFlag = (BDMActivityState_t) (currentBdmSession->bdmState.activityFlag & ~BDM_STATUSREG);
    }
 #if USB_THROTTLE != 0
    if (++pollCount < pollInterval) {
@@ -1740,13 +1797,13 @@ USBDM_ErrorCode USBDM_ReadStatusReg(unsigned long *BDMStatusReg) {
 
       log.print("Changed => 0x%lX = %s %s\n",
             *BDMStatusReg,
-            getStatusRegName(bdmState.targetType,*BDMStatusReg),
+            getStatusRegName(currentBdmSession->bdmState.targetType,*BDMStatusReg),
             dummyString);
    }
    else {
       log.print("=> 0x%lX = %s\n",
             *BDMStatusReg,
-            getStatusRegName(bdmState.targetType,*BDMStatusReg));
+            getStatusRegName(currentBdmSession->bdmState.targetType,*BDMStatusReg));
    }
 #endif // LOG
    lastBDMStatusReg = *BDMStatusReg;
@@ -1772,9 +1829,9 @@ USBDM_API
 USBDM_ErrorCode USBDM_WriteControlReg(unsigned int value) {
    LOGGING_Q;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
-   log.print("reg=%s\n", getStatusRegName(bdmState.targetType, value));
+   log.print("reg=%s\n", getStatusRegName(currentBdmSession->bdmState.targetType, value));
    usb_data[0] = 0;
    usb_data[1] = CMD_USBDM_WRITE_CONTROL_REG;
    usb_data[2] = 0;     // 32-bit BE
@@ -1804,7 +1861,7 @@ static USBDM_ErrorCode resetHCS(TargetMode_t targetMode) {
    TargetMode_t resetMode   = (TargetMode_t)(targetMode&RESET_MODE_MASK);
    log.print("mode=%s\n", getTargetModeName((TargetMode_t)(resetMethod|resetMode)));
    if (resetMethod == RESET_DEFAULT) {
-      if ((bdmOptions.targetType == T_HCS12) || (bdmOptions.targetType == T_S12Z)) {
+      if ((currentBdmSession->bdmOptions.targetType == T_HCS12) || (currentBdmSession->bdmOptions.targetType == T_S12Z)) {
          resetMethod = RESET_HARDWARE;
       }
       else {
@@ -1818,7 +1875,7 @@ static USBDM_ErrorCode resetHCS(TargetMode_t targetMode) {
       if (rc != BDM_RC_OK) {
          return rc;
       }
-      UsbdmSystem::milliSleep(bdmOptions.powerOffDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOffDuration);
       // Note - BKGD may have been set low by the
       // Vdd transition (auto connect interrupt code)
       if (resetMode == RESET_SPECIAL) {
@@ -1831,16 +1888,16 @@ static USBDM_ErrorCode resetHCS(TargetMode_t targetMode) {
       if (rc != BDM_RC_OK) {
          return rc;
       }
-      UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
       USBDM_ControlPins(PIN_RESET_3STATE);
-      UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
          return rc;
       }
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       return BDM_RC_OK;
    }
    if (resetMethod == RESET_HARDWARE) {
@@ -1851,16 +1908,16 @@ static USBDM_ErrorCode resetHCS(TargetMode_t targetMode) {
       else {
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKGD_3STATE);
       }
-      UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
       USBDM_ControlPins(PIN_RESET_3STATE);
-      UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
          return rc;
       }
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       return BDM_RC_OK;
    }
    // RESET_SOFTWARE must be done by BDM
@@ -1868,7 +1925,7 @@ static USBDM_ErrorCode resetHCS(TargetMode_t targetMode) {
    usb_data[1] = CMD_USBDM_TARGET_RESET;
    usb_data[2] = (resetMethod|resetMode);
    rc = bdm_usb_transaction(3, 1, usb_data);
-   UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
    return rc;
 }
 
@@ -1891,7 +1948,7 @@ static USBDM_ErrorCode resetCFVx(TargetMode_t targetMode) {
    }
    if (resetMethod == RESET_POWER) {
       USBDM_SetTargetVdd(BDM_TARGET_VDD_DISABLE);
-      UsbdmSystem::milliSleep(bdmOptions.powerOffDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOffDuration);
       if (resetMode == RESET_SPECIAL) {
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKPT_LOW);
       }
@@ -1899,16 +1956,16 @@ static USBDM_ErrorCode resetCFVx(TargetMode_t targetMode) {
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKPT_3STATE);
       }
       USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-      UsbdmSystem::milliSleep(bdmOptions.powerOnRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.powerOnRecoveryInterval);
       USBDM_ControlPins(PIN_RESET_3STATE);
-      UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
          return rc;
       }
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       return BDM_RC_OK;
    }
    if (resetMethod == RESET_HARDWARE) {
@@ -1918,16 +1975,16 @@ static USBDM_ErrorCode resetCFVx(TargetMode_t targetMode) {
       else {
          USBDM_ControlPins(PIN_RESET_LOW|PIN_BKPT_3STATE);
       }
-      UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
       USBDM_ControlPins(PIN_RESET_3STATE);
-      UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
          return rc;
       }
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       return BDM_RC_OK;
    }
    return BDM_RC_ILLEGAL_PARAMS;
@@ -1951,12 +2008,12 @@ static USBDM_ErrorCode resetOther(TargetMode_t targetMode) {
    }
    if (resetMethod == RESET_POWER) {
       USBDM_SetTargetVdd(BDM_TARGET_VDD_DISABLE);
-      UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
       USBDM_ControlPins(PIN_RESET_LOW);
       USBDM_SetTargetVdd(BDM_TARGET_VDD_ENABLE);
-      UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
@@ -1966,9 +2023,9 @@ static USBDM_ErrorCode resetOther(TargetMode_t targetMode) {
    }
    if (resetMethod == RESET_HARDWARE) {
       USBDM_ControlPins(PIN_RESET_LOW);
-      UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
       USBDM_ControlPins(PIN_RELEASE);
-      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
       // Check for reset rise
       rc = USBDM_ControlPins(PIN_RESET_3STATE);
       if (rc != BDM_RC_OK) {
@@ -1996,10 +2053,10 @@ USBDM_API
 USBDM_ErrorCode USBDM_TargetReset(TargetMode_t target_mode) {
    LOGGING;
    USBDM_ErrorCode rc;
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
    log.print("mode=%s\n", getTargetModeName(target_mode));
 
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
    case T_HC12:
    case T_S12Z:
    case T_HCS08:
@@ -2011,10 +2068,10 @@ USBDM_ErrorCode USBDM_TargetReset(TargetMode_t target_mode) {
    case T_ARM_SWD:
    case T_ARM_JTAG:
       rc = resetARM(target_mode);
-      if (pendingResetRelease) {
+      if (currentBdmSession->pendingResetRelease) {
          // Clear pending reset
          log.print("Clearing pending reset flag\n");
-         pendingResetRelease = false;
+         currentBdmSession->pendingResetRelease = false;
       }
       return rc;
    default:
@@ -2033,7 +2090,7 @@ USBDM_API
 USBDM_ErrorCode USBDM_TargetStep(void) {
    LOGGING_E;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    usb_data[0] = 1;  // receive up to 1 byte
    usb_data[1] = CMD_USBDM_TARGET_STEP;
@@ -2051,7 +2108,7 @@ USBDM_API
 USBDM_ErrorCode USBDM_TargetGo(void) {
    LOGGING_E;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    usb_data[0] = 1;  // receive up to 1 byte
    usb_data[1] = CMD_USBDM_TARGET_GO;
@@ -2069,7 +2126,7 @@ USBDM_API
 USBDM_ErrorCode USBDM_TargetHalt(void) {
    LOGGING_E;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    usb_data[0] = 1;  // receive up to 1 byte
    usb_data[1] = CMD_USBDM_TARGET_HALT;
@@ -2105,13 +2162,13 @@ USBDM_ErrorCode USBDM_WriteReg(unsigned int regNo, unsigned long regValue) {
 
 #ifdef LOG
    log.print("reg=%s(%d), 0x%lX\n",
-         getRegName( bdmState.targetType, regNo ), regNo, regValue);
+         getRegName( currentBdmSession->bdmState.targetType, regNo ), regNo, regValue);
 #endif
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    // Reading HCS12 CCR from value saved in BDM address space!
-   if ((bdmState.targetType == T_HC12) && (regNo == HCS12_RegCCR)) {
+   if ((currentBdmSession->bdmState.targetType == T_HC12) && (regNo == HCS12_RegCCR)) {
       return USBDM_WriteDReg(HCS12_DRegCCR, regValue);
    }
    usb_data[0] = 0;
@@ -2150,12 +2207,12 @@ USBDM_ErrorCode USBDM_ReadReg(unsigned int regNo, unsigned long *regValue) {
    LOGGING_Q;
    USBDM_ErrorCode rc;
 
-//   bdmState.activityFlag = BDM_ACTIVE;
+//   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
 //   log.print("USBDM_readReg(%d)\n", regNo);
 
    // Read HCS12 CCR from value saved in BDM address space!
-   if ((bdmState.targetType == T_HC12) && (regNo == HCS12_RegCCR)) {
+   if ((currentBdmSession->bdmState.targetType == T_HC12) && (regNo == HCS12_RegCCR)) {
       return USBDM_ReadDReg(HCS12_DRegCCR, regValue);
    }
    usb_data[0] = 0;
@@ -2177,7 +2234,7 @@ USBDM_ErrorCode USBDM_ReadReg(unsigned int regNo, unsigned long *regValue) {
    }
 #ifdef LOG
    log.print("reg=%s => 0x%lX\n",
-         getRegName( bdmState.targetType, regNo ), *regValue);
+         getRegName( currentBdmSession->bdmState.targetType, regNo ), *regValue);
 #endif
 
 return rc;
@@ -2220,7 +2277,7 @@ USBDM_ErrorCode USBDM_ReadMultipleRegs(unsigned char regValueBuffer[], unsigned
    }
 #ifdef LOG
 //   log.print("reg=%s => 0x%X\n",
-//         getRegName( bdmState.targetType, regNo ), *regValue);
+//         getRegName( currentBdmSession->bdmState.targetType, regNo ), *regValue);
    log.print("reg=[#%d..#%d] =>\n", startRegIndex, endRegIndex);
    log.printDump(regValueBuffer, size);
 #endif
@@ -2250,10 +2307,10 @@ USBDM_API
 USBDM_ErrorCode USBDM_WriteCReg(unsigned int regNo, unsigned long regValue) {
    LOGGING_Q;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
 #ifdef LOG
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
       case T_CFV1 :
          log.print("reg=%s(0x%X), 0x%lX\n",
                getCFV1ControlRegName(regNo), regNo, regValue);
@@ -2285,7 +2342,7 @@ USBDM_ErrorCode USBDM_WriteCReg(unsigned int regNo, unsigned long regValue) {
 
    usb_data[0] = 0;
    usb_data[1] = CMD_USBDM_WRITE_CREG;
-   if ((bdmState.targetType == T_ARM_SWD)||(bdmState.targetType == T_ARM_JTAG)) {
+   if ((currentBdmSession->bdmState.targetType == T_ARM_SWD)||(currentBdmSession->bdmState.targetType == T_ARM_JTAG)) {
       // Register number is 'compressed into 2 bytes'
       usb_data[2] = (uint8_t)(regNo>>24);
    }
@@ -2323,13 +2380,13 @@ USBDM_ErrorCode USBDM_ReadCReg(unsigned int regNo, unsigned long *regValue) {
    LOGGING_Q;
    USBDM_ErrorCode rc;
 
-//   bdmState.activityFlag = BDM_ACTIVE;
+//   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    *regValue = 0xAAAA;
 
    usb_data[0] = 0;
    usb_data[1] = CMD_USBDM_READ_CREG;
-   if ((bdmState.targetType == T_ARM_SWD)||(bdmState.targetType == T_ARM_JTAG)) {
+   if ((currentBdmSession->bdmState.targetType == T_ARM_SWD)||(currentBdmSession->bdmState.targetType == T_ARM_JTAG)) {
       // Register number is 'compressed into 2 bytes'
       usb_data[2] = (uint8_t)(regNo>>24);
    }
@@ -2351,7 +2408,7 @@ USBDM_ErrorCode USBDM_ReadCReg(unsigned int regNo, unsigned long *regValue) {
                   (usb_data[4]);
    }
 #ifdef LOG
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
       case T_CFV1 :
          log.print("reg=%s(0x%X), 0x%lX\n", getCFV1ControlRegName(regNo), regNo, *regValue);
          break;
@@ -2400,9 +2457,9 @@ USBDM_API
 USBDM_ErrorCode USBDM_WriteDReg(unsigned int regNo, unsigned long regValue) {
    LOGGING_Q;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 #ifdef LOG
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
       case T_HC12 :
          log.print("%s(0x%X) <= 0x%lX\n",
                getHCS12DebugRegName(regNo), regNo, regValue);
@@ -2437,7 +2494,7 @@ USBDM_ErrorCode USBDM_WriteDReg(unsigned int regNo, unsigned long regValue) {
    };
 #endif
 
-//   if ((bdmState.targetType == T_CFV1) && (regNo == CFV1_DRegCSR)) {
+//   if ((currentBdmSession->bdmState.targetType == T_CFV1) && (regNo == CFV1_DRegCSR)) {
 //      // MCF51AC Hack
 //      log.print("Setting CSR.VBD bit CSR=%08X\n", regValue);
 //      regValue |= CFV1_CSR_VBD;
@@ -2475,7 +2532,7 @@ USBDM_ErrorCode USBDM_ReadDReg(unsigned int regNo, unsigned long *regValue) {
    LOGGING_Q;
    USBDM_ErrorCode rc;
 
-//   bdmState.activityFlag = BDM_ACTIVE;
+//   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 //   log.print("USBDM_readDReg(0x%X, 0x%X)\n", regNo, regValue);
    usb_data[0] = 0;
    usb_data[1] = CMD_USBDM_READ_DREG;
@@ -2493,7 +2550,7 @@ USBDM_ErrorCode USBDM_ReadDReg(unsigned int regNo, unsigned long *regValue) {
                   (usb_data[4]);
    }
 #ifdef LOG
-   switch (bdmState.targetType) {
+   switch (currentBdmSession->bdmState.targetType) {
       case T_HC12 :
          log.print("%s(0x%X) => 0x%lX\n",
                getHCS12DebugRegName(regNo), regNo, *regValue);
@@ -2539,8 +2596,9 @@ USBDM_ErrorCode USBDM_ReadDReg(unsigned int regNo, unsigned long *regValue) {
 
 
 /** ======================================================================
- *  Assemble a memory read/write message header into the usb data buffer
+ *  Assemble a memory read/write message header into a usb data buffer
  *
+ *  @param buffer      = Buffer to assemble message in
  *  @param command     = Target command
  *  @param memorySpace = Memory space & size of data elements (1/2/4)
  *  @param count       = Count of bytes to transfer
@@ -2569,61 +2627,67 @@ USBDM_ErrorCode USBDM_ReadDReg(unsigned int regNo, unsigned long *regValue) {
  *  +---+----------------------------------+ \n
  *  \endverbatim
  */
-static void assembleMessageHeader(uint8_t command,
+static void assembleMessageHeader(uint8_t *buffer,
+                                  uint8_t command,
                                   uint8_t memorySpace,
                                   uint8_t count,
                                   uint32_t address) {
    U32u temp;
-   usb_data[0] = 0;
-   usb_data[1] = command;
-   usb_data[2] = memorySpace; // or size
-   usb_data[3] = count;
+   buffer[0] = 0;
+   buffer[1] = command;
+   buffer[2] = memorySpace; // or size
+   buffer[3] = count;
    temp.longword = address;
-   usb_data[4] = temp.bytes[3]; // LittleEndian -> BigEndian
-   usb_data[5] = temp.bytes[2];
-   usb_data[6] = temp.bytes[1];
-   usb_data[7] = temp.bytes[0];
+   buffer[4] = temp.bytes[3]; // LittleEndian -> BigEndian
+   buffer[5] = temp.bytes[2];
+   buffer[6] = temp.bytes[1];
+   buffer[7] = temp.bytes[0];
 
 #if MESSAGE_HEADER_SIZE != 8
 #error "MESSAGE_HEADER_SIZE IS INCORRECT"
 #endif
 }
 
-/** ======================================================================
- *  Write data to target memory
+//! Number of memory transactions assembled before passing to bdm_usb_pipelined_transactions()
+#define MEMORY_PIPELINE_BATCH (16)
+
+//! Buffers for pipelined memory transactions
+static thread_local unsigned char memoryPipelineBuffers[MEMORY_PIPELINE_BATCH][MAX_PACKET_SIZE+1];
+
+//! Transactions for pipelined memory transactions
+static thread_local UsbTransaction memoryTransactions[MEMORY_PIPELINE_BATCH];
+
+/**
+ *  Report how much of a failed batch of memory transactions was executed by the BDM
  *
- *  @param memorySpace = Size of data elements (1/2/4 bytes)
- *  @param byteCount   = Number of _bytes_ to transfer
+ *  @param batchCount = Number of transactions in batch
+ */
+static void reportFailedBatch(unsigned batchCount) {
+   LOGGING_Q;
+   unsigned executed = 0;
+   for (unsigned index=0; index<batchCount; index++) {
+      if (memoryTransactions[index].executed) {
+         executed++;
+      }
+   }
+   log.error("%d of %d transactions in batch were executed\n", executed, batchCount);
+}
+
+/**
+ *  Check alignment of a memory access
+ *
+ *  @param memorySpace = Memory space and size of data elements (1/2/4 bytes)\n
+ *                       May be adjusted to a smaller size to allow an unaligned access (FIX_ALIGNMENT)
+ *  @param byteCount   = Number of bytes to transfer
  *  @param address     = Memory address
- *  @param data        = Ptr to block of data to write
  *
  *  @return error code \n
- *      BDM_RC_OK    => OK \n
- *      other        => Error code - see \ref USBDM_ErrorCode
+ *      BDM_RC_OK              => OK \n
+ *      BDM_RC_ILLEGAL_PARAMS  => Access is not aligned
  */
-USBDM_API
-USBDM_ErrorCode USBDM_WriteMemory( unsigned int        memorySpace,
-                                   unsigned int        byteCount,
-                                   unsigned int        address,
-                                   unsigned const char *data) {
+static USBDM_ErrorCode checkMemoryAlignment(unsigned int &memorySpace, unsigned int byteCount, unsigned int address) {
    LOGGING_Q;
-   if (log.getLoggingLevel()>=0) {
-      // Turn off Log below this level
-      log.setLoggingLevel(0);
-   }
-   unsigned blockSize;
    unsigned elementSize = memorySpace&MS_SIZE;
-   USBDM_ErrorCode rc, stickyRc=BDM_RC_OK;
-
-   // Make multiple of 4, allow for header
-   const unsigned int MaxDataSize = (bdmInfo.commandBufferSize-MESSAGE_HEADER_SIZE)&~0x03;
-
-   bdmState.activityFlag = BDM_ACTIVE;
-
-   log.print("elementSize=%d, count=0x%X(%d), addr=[%s0x%06X..0x%06X]\n",
-         elementSize, byteCount, byteCount, getMemSpaceAbbreviatedName((MemorySpace_t)memorySpace), address, address+byteCount-1);
-
-   log.printDump(data, byteCount, address);
 
 #ifdef FIX_ALIGNMENT
    // Check size alignment
@@ -2671,47 +2735,119 @@ USBDM_ErrorCode USBDM_WriteMemory( unsigned int        memorySpace,
       log.print("Alignment error - adjusted memory space size\n");
    }
 #else
-   bool unaligned = false;
-   // Check address & size alignment
+   // Check address and size alignment
+   bool unaligned;
    switch (elementSize) {
-      case 1:  unaligned = 0;               // No alignment requirement
+      case 1: unaligned = 0;               // No alignment requirement
          break;
-      case 2:  unaligned = ((address&1) != 0) || ((byteCount&1) != 0); // Multiple of 2
+      case 2: unaligned = ((address&1) != 0) || ((byteCount&1) != 0); // Multiple of 2
          break;
-      case 4:  unaligned = ((address&3) != 0) || ((byteCount&3) != 0); // Multiple of 4
+      case 4: unaligned = ((address&3) != 0) || ((byteCount&3) != 0); // Multiple of 4
          break;
       default: unaligned = 1;               // No alignment requirement
          break;
    }
    if (unaligned) {
-      log.print("Failed - alignment error\n");
+      log.error("Failed - alignment error\n");
       return BDM_RC_ILLEGAL_PARAMS;
    }
 #endif
-//   log.printDump(data, count);
+   return BDM_RC_OK;
+}
 
-   while (byteCount>0) {
-      blockSize = byteCount;
-      if (blockSize > MaxDataSize) {
-         blockSize = MaxDataSize;
-      }
-      if ((bdmState.targetType == T_HC12) && ((memorySpace&MS_SPACE) == MS_Global)) {
-         // Make sure HCS12 Global access doesn't cross page boundary
-         uint32_t nextPageBoundary = (address + 0x10000UL)&~0xFFFFUL;
-         if ((address+blockSize-1) >= nextPageBoundary) {
-            log.print("Access split due to Global boundary, A=0x%X, B=0x%X\n", address, nextPageBoundary);
-            blockSize = nextPageBoundary-address;
-         }
-      }
-      if ((bdmState.targetType == T_ARM_SWD)||(bdmState.targetType == T_ARM_JTAG)) {
-         // Make sure ARM memory access doesn't cross 2^10 boundary as limitation of MDM-AP
-         uint32_t nextPageBoundary = (address + (1UL<<10))&~((1UL<<10)-1);
-         if ((address+blockSize-1) >= nextPageBoundary) {
-            log.print("Access split due to crossing 2^10 boundary, A=0x%X, B=0x%X\n", address, nextPageBoundary);
-            blockSize = nextPageBoundary-address;
-         }
+/**
+ *  Get mask describing the address boundary that a single memory transaction may not cross
+ *
+ *  @param memorySpace = Memory space
+ *
+ *  @return Mask e.g. 0x3FF => transaction may not cross a 2^10 boundary \n
+ *          0 => No restriction
+ */
+static uint32_t getMemoryBoundaryMask(unsigned int memorySpace) {
+   if ((currentBdmSession->bdmState.targetType == T_HC12) && ((memorySpace&MS_SPACE) == MS_Global)) {
+      // HCS12 Global access may not cross page boundary
+      return 0xFFFFUL;
+   }
+   if ((currentBdmSession->bdmState.targetType == T_ARM_SWD) || (currentBdmSession->bdmState.targetType == T_ARM_JTAG)) {
+      // ARM memory access may not cross 2^10 boundary as limitation of MDM-AP
+      return (1UL<<10)-1;
+   }
+   return 0;
+}
+
+/**
+ *  Get size of next memory transaction
+ *
+ *  @param boundaryMask = Boundary that may not be crossed (from getMemoryBoundaryMask())
+ *  @param byteCount    = Number of bytes remaining
+ *  @param address      = Memory address
+ *  @param maxDataSize  = Maximum data in a single transaction
+ *
+ *  @return Number of bytes to transfer
+ */
+static inline unsigned int getMemoryBlockSize(uint32_t boundaryMask, unsigned int byteCount, uint32_t address, unsigned int maxDataSize) {
+   unsigned blockSize = byteCount;
+   if (blockSize > maxDataSize) {
+      blockSize = maxDataSize;
+   }
+   if (boundaryMask != 0) {
+      uint32_t bytesToBoundary = (boundaryMask+1) - (address&boundaryMask);
+      if (blockSize > bytesToBoundary) {
+         UsbdmSystem::Log::print("Access split due to boundary, A=0x%X, B=0x%X\n", address, address+bytesToBoundary);
+         blockSize = bytesToBoundary;
       }
-      assembleMessageHeader( CMD_USBDM_WRITE_MEM, // Command
+   }
+   return blockSize;
+}
+
+/** ======================================================================
+ *  Write data to target memory
+ *
+ *  @param memorySpace = Size of data elements (1/2/4 bytes)
+ *  @param byteCount   = Number of _bytes_ to transfer
+ *  @param address     = Memory address
+ *  @param data        = Ptr to block of data to write
+ *
+ *  @return error code \n
+ *      BDM_RC_OK    => OK \n
+ *      other        => Error code - see \ref USBDM_ErrorCode
+ */
+USBDM_API
+USBDM_ErrorCode USBDM_WriteMemory( unsigned int        memorySpace,
+                                   unsigned int        byteCount,
+                                   unsigned int        address,
+                                   unsigned const char *data) {
+   LOGGING_Q;
+   if (log.getLoggingLevel()>=0) {
+      // Turn off Log below this level
+      log.setLoggingLevel(0);
+   }
+   unsigned blockSize;
+   unsigned elementSize = memorySpace&MS_SIZE;
+   USBDM_ErrorCode rc, stickyRc=BDM_RC_OK;
+
+   // Make multiple of 4, allow for header
+   const unsigned int MaxDataSize = (currentBdmSession->bdmInfo.commandBufferSize-MESSAGE_HEADER_SIZE)&~0x03;
+
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
+
+   log.print("elementSize=%d, count=0x%X(%d), addr=[%s0x%06X..0x%06X]\n",
+         elementSize, byteCount, byteCount, getMemSpaceAbbreviatedName((MemorySpace_t)memorySpace), address, address+byteCount-1);
+
+   log.printDump(data, byteCount, address);
+
+   rc = checkMemoryAlignment(memorySpace, byteCount, address);
+   if (rc != BDM_RC_OK) {
+      return rc;
+   }
+   const uint32_t boundaryMask = getMemoryBoundaryMask(memorySpace);
+
+   unsigned batchCount = 0;
+   while (byteCount>0) {
+      blockSize = getMemoryBlockSize(boundaryMask, byteCount, address, MaxDataSize);
+      uint8_t *buffer = memoryPipelineBuffers[batchCount];
+      assembleMessageHeader( buffer,
+                             CMD_USBDM_WRITE_MEM, // Command
                              memorySpace,         // Size of data element
                              blockSize,           // # of elements to Tx,
                              address              // Memory address
@@ -2719,17 +2855,29 @@ USBDM_ErrorCode USBDM_WriteMemory( unsigned int        memorySpace,
 //      log.print("  USBDM_WriteMemory-pkt(addr=0x%8X, blocksize=%6d, memorySpace=%2d)\n",
 //            address, blockSize, memorySpace);
       //log.printDump(data, blockSize);
-      memcpy(usb_data+MESSAGE_HEADER_SIZE, data, blockSize);
-      rc = bdm_usb_transaction(blockSize+MESSAGE_HEADER_SIZE, 1, usb_data, 100);
-      if ((rc == BDM_RC_USB_RETRY_OK)) {
-         stickyRc = BDM_RC_USB_RETRY_OK;
-      }
-      if ((rc != BDM_RC_OK) && (rc != BDM_RC_USB_RETRY_OK)) {
-         return rc;
-      }
+      memcpy(buffer+MESSAGE_HEADER_SIZE, data, blockSize);
+      memoryTransactions[batchCount].txSize  = blockSize+MESSAGE_HEADER_SIZE;
+      memoryTransactions[batchCount].rxSize  = 1;
+      memoryTransactions[batchCount].data    = buffer;
+      memoryTransactions[batchCount].timeout = 100;
+      batchCount++;
+
       data        += blockSize;   // update location in buffer
       address     += blockSize;   // update memory address
       byteCount   -= blockSize;   // update count
+
+      if ((batchCount == MEMORY_PIPELINE_BATCH) || (byteCount == 0)) {
+         // Send batch of writes
+         rc = bdm_usb_pipelined_transactions(batchCount, memoryTransactions);
+         if ((rc == BDM_RC_USB_RETRY_OK)) {
+            stickyRc = BDM_RC_USB_RETRY_OK;
+         }
+         if ((rc != BDM_RC_OK) && (rc != BDM_RC_USB_RETRY_OK)) {
+            reportFailedBatch(batchCount);
+            return rc;
+         }
+         batchCount = 0;
+      }
    }
    return stickyRc;
 }
@@ -2764,124 +2912,286 @@ USBDM_ErrorCode USBDM_ReadMemory( unsigned int  memorySpace,
    unsigned int   elementSize     = memorySpace&MS_SIZE;
 
    // Make multiple of 4, Allow for status byte
-   const unsigned int MaxDataSize = (bdmInfo.commandBufferSize-1)&~0x03;
+   const unsigned int MaxDataSize = (currentBdmSession->bdmInfo.commandBufferSize-1)&~0x03;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("elementSize=%d, count=0x%X(%d), addr=[%s0x%06X..0x%06X]\n",
           elementSize, byteCount, byteCount, getMemSpaceAbbreviatedName((MemorySpace_t)memorySpace), address, address+byteCount-1);
 
-   #ifdef FIX_ALIGNMENT
-   // Check size alignment
-   bool unaligned = false;
-   switch (elementSize) {
-      case 1: unaligned = false;                // No alignment requirement
-         break;
-      case 2: unaligned = ((byteCount&1) != 0); // Multiple of 2
-         break;
-      case 4: unaligned = ((byteCount&3) != 0); // Multiple of 4
-         break;
-      default: unaligned = 1;                   // Impossible
-         break;
+   rc = checkMemoryAlignment(memorySpace, byteCount, address);
+   if (rc != BDM_RC_OK) {
+      return rc;
    }
-   if (unaligned) {
-      log.error("Failed - alignment (size of transfer) error\n");
-      return BDM_RC_ILLEGAL_PARAMS;
+   const uint32_t boundaryMask = getMemoryBoundaryMask(memorySpace);
+
+   unsigned batchCount = 0;
+   while (byteCount>0) {
+      blockSize = getMemoryBlockSize(boundaryMask, byteCount, address, MaxDataSize);
+      uint8_t *buffer = memoryPipelineBuffers[batchCount];
+      assembleMessageHeader( buffer,
+                             CMD_USBDM_READ_MEM, // Command
+                             memorySpace,        // Size of data element
+                             blockSize,          // # of bytes to Rx,
+                             address             // Memory address
+                            );
+//      log.print("  USBDM_ReadMemory-pkt(addr=0x%8X, blocksize=%3d, memorySpace=%2d)\n",
+//            address, blockSize, memorySpace);
+      memoryTransactions[batchCount].txSize  = MESSAGE_HEADER_SIZE;
+      memoryTransactions[batchCount].rxSize  = blockSize+1;
+      memoryTransactions[batchCount].data    = buffer;
+      memoryTransactions[batchCount].timeout = 100;
+      batchCount++;
+
+      address     += blockSize;   // update address
+      byteCount   -= blockSize;   // update count
+
+      if ((batchCount == MEMORY_PIPELINE_BATCH) || (byteCount == 0)) {
+         // Do batch of reads
+         rc = bdm_usb_pipelined_transactions(batchCount, memoryTransactions);
+         if ((rc == BDM_RC_USB_RETRY_OK)) {
+            stickyRc = BDM_RC_USB_RETRY_OK;
+         }
+         if ((rc != BDM_RC_OK) && (rc != BDM_RC_USB_RETRY_OK)) {
+            reportFailedBatch(batchCount);
+            return rc;
+         }
+         for (unsigned index=0; index<batchCount; index++) {
+            unsigned size = memoryTransactions[index].rxSize-1;
+            memcpy(data, memoryTransactions[index].data+1, size);
+            //log.printDump(data, size);
+            data += size;   // update destination in buffer
+         }
+         batchCount = 0;
+      }
    }
-   // Check address alignment & adjust memory space
-   switch (elementSize) {
-      default:
-      case 1:   // No alignment requirement
-         break;
-      case 2:   // Multiple of 2
-         if ((address&1) != 0) {
-            // Change to byte transfer
-            unaligned = true;
-            memorySpace = (memorySpace&~MS_SIZE)|1;
+   log.printDump(originalData, originalCount, originalAddress);
+
+   return stickyRc;
+}
+
+/**
+ * Walks the data buffers of a list of memory requests as if they were a single buffer.
+ *
+ * Used to gather write data from, or scatter read data to, the requests
+ * when adjacent requests have been coalesced into a single transaction.
+ */
+class MemoryRequestCursor {
+   const USBDM_MemoryRequest *request;   //!< Current request
+   unsigned                   offset;    //!< Offset into current request
+
+public:
+   MemoryRequestCursor(const USBDM_MemoryRequest requests[]) : request(requests), offset(0) {
+   }
+   /**
+    * Copy data from requests
+    *
+    * @param destination - Where to place data
+    * @param size        - Number of bytes to copy
+    */
+   void gather(uint8_t *destination, unsigned size) {
+      while (size>0) {
+         unsigned available = request->byteCount-offset;
+         if (available == 0) {
+            request++;
+            offset = 0;
+            continue;
          }
-         break;
-      case 4:   // Multiple of 4
-         if ((address&1) != 0) {
-            // Change to byte transfer
-            unaligned = true;
-            memorySpace = (memorySpace&~MS_SIZE)|1;
+         if (available > size) {
+            available = size;
          }
-         else if ((address&2) != 0) {
-            // Change to word transfer
-            unaligned = true;
-            memorySpace = (memorySpace&~MS_SIZE)|2;
+         memcpy(destination, request->data+offset, available);
+         destination += available;
+         offset      += available;
+         size        -= available;
+      }
+   }
+   /**
+    * Copy data to requests
+    *
+    * @param source - Data to copy
+    * @param size   - Number of bytes to copy
+    */
+   void scatter(const uint8_t *source, unsigned size) {
+      while (size>0) {
+         unsigned available = request->byteCount-offset;
+         if (available == 0) {
+            request++;
+            offset = 0;
+            continue;
          }
-         break;
+         if (available > size) {
+            available = size;
+         }
+         memcpy(request->data+offset, source, available);
+         source += available;
+         offset += available;
+         size   -= available;
+      }
    }
-   if (unaligned) {
-      log.print("Alignment error - adjusted memory space size\n");
+};
+
+/**
+ *  Execute a batch of memory transactions assembled in memoryTransactions[]
+ *
+ *  @param isWrite    = Transactions are writes (otherwise read data is scattered to requests)
+ *  @param batchCount = Number of transactions, set to zero on return
+ *  @param cursor     = Cursor used to scatter read data
+ *  @param stickyRc   = Set to BDM_RC_USB_RETRY_OK if a transaction was retried
+ *
+ *  @return error code \n
+ *      BDM_RC_OK    => OK \n
+ *      other        => Error code - see \ref USBDM_ErrorCode
+ */
+static USBDM_ErrorCode flushMemoryBatch(bool isWrite, unsigned &batchCount, MemoryRequestCursor &cursor, USBDM_ErrorCode &stickyRc) {
+   USBDM_ErrorCode rc = bdm_usb_pipelined_transactions(batchCount, memoryTransactions);
+   if ((rc == BDM_RC_USB_RETRY_OK)) {
+      stickyRc = BDM_RC_USB_RETRY_OK;
    }
-#else
-   // Check address and size alignment
-   bool unaligned;
-   switch (elementSize) {
-      case 1: unaligned = 0;               // No alignment requirement
-         break;
-      case 2: unaligned = ((address&1) != 0) || ((byteCount&1) != 0); // Multiple of 2
-         break;
-      case 4: unaligned = ((address&3) != 0) || ((byteCount&3) != 0); // Multiple of 4
-         break;
-      default: unaligned = 1;               // No alignment requirement
-         break;
+   if ((rc != BDM_RC_OK) && (rc != BDM_RC_USB_RETRY_OK)) {
+      reportFailedBatch(batchCount);
+      return rc;
    }
-   if (unaligned) {
-      log.error("Failed - alignment error\n");
-      return BDM_RC_ILLEGAL_PARAMS;
+   if (!isWrite) {
+      for (unsigned index=0; index<batchCount; index++) {
+         cursor.scatter(memoryTransactions[index].data+1, memoryTransactions[index].rxSize-1);
+      }
    }
-#endif
-   while (byteCount>0) {
-      blockSize = byteCount;
-      if (blockSize > MaxDataSize) {
-         blockSize = MaxDataSize;
+   batchCount = 0;
+   return BDM_RC_OK;
+}
+
+/**
+ *  Transfer a list of memory requests
+ *
+ *  Adjacent requests (same memory space and contiguous addresses) are coalesced into a
+ *  single transaction.  Transactions are pipelined using bdm_usb_pipelined_transactions().
+ *
+ *  @param command  = CMD_USBDM_READ_MEM/CMD_USBDM_WRITE_MEM
+ *  @param count    = Number of requests
+ *  @param requests = Requests to process
+ *
+ *  @return error code \n
+ *      BDM_RC_OK    => OK \n
+ *      other        => Error code - see \ref USBDM_ErrorCode
+ */
+static USBDM_ErrorCode transferMemoryV(uint8_t command, unsigned int count, USBDM_MemoryRequest requests[]) {
+   LOGGING_Q;
+   USBDM_ErrorCode rc, stickyRc = BDM_RC_OK;
+   const bool isWrite = (command == CMD_USBDM_WRITE_MEM);
+
+   // Make multiple of 4, allow for header or status byte
+   const unsigned int MaxDataSize = isWrite?
+         (currentBdmSession->bdmInfo.commandBufferSize-MESSAGE_HEADER_SIZE)&~0x03:
+         (currentBdmSession->bdmInfo.commandBufferSize-1)&~0x03;
+
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
+
+   // Validate all requests before any are done (requests[] is not modified)
+   for (unsigned index=0; index<count; index++) {
+      unsigned int memorySpace = requests[index].memorySpace;
+      rc = checkMemoryAlignment(memorySpace, requests[index].byteCount, requests[index].address);
+      if (rc != BDM_RC_OK) {
+         log.error("Request #%d, addr=[%s0x%06X..0x%06X] failed\n", index,
+               getMemSpaceAbbreviatedName((MemorySpace_t)requests[index].memorySpace),
+               requests[index].address, requests[index].address+requests[index].byteCount-1);
+         return rc;
       }
-      if ((bdmState.targetType == T_HC12) && ((memorySpace&MS_SPACE) == MS_Global)) {
-         log.print("Global Access 0x%6X\n", address);
-         // Make sure HCS12 Global access doesn't cross page boundary
-         uint32_t nextPageBoundary = (address + 0x10000UL)&~0xFFFFUL;
-         if ((address+blockSize-1) >= nextPageBoundary) {
-            log.print("Access split due to Global boundary, A=0x%X, B=0x%X\n", address, nextPageBoundary);
-            blockSize = nextPageBoundary-address;
+   }
+   MemoryRequestCursor cursor(requests);
+   unsigned batchCount = 0;
+   unsigned index      = 0;
+   while (index<count) {
+      // Find run of adjacent requests
+      unsigned int memorySpace = requests[index].memorySpace;
+      uint32_t     address     = requests[index].address;
+      unsigned int byteCount   = requests[index].byteCount;
+      checkMemoryAlignment(memorySpace, byteCount, address);
+      for (index++; index<count; index++) {
+         unsigned int nextMemorySpace = requests[index].memorySpace;
+         checkMemoryAlignment(nextMemorySpace, requests[index].byteCount, requests[index].address);
+         if ((nextMemorySpace != memorySpace) ||
+             (requests[index].address     != address+byteCount)) {
+            break;
          }
+         byteCount += requests[index].byteCount;
       }
-      if ((bdmState.targetType == T_ARM_SWD) || (bdmState.targetType == T_ARM_JTAG)) {
-         // Make sure ARM memory access doesn't cross 2^10 boundary as limitation of MDM-AP
-         uint32_t nextPageBoundary = (address + (1UL<<10))&~((1UL<<10)-1);
-         if ((address+blockSize-1) >= nextPageBoundary) {
-            log.print("Access split due to crossing 2^10 boundary, A=0x%X, B=0x%X\n", address, nextPageBoundary);
-            blockSize = nextPageBoundary-address;
+      log.print("%s addr=[%s0x%06X..0x%06X]\n", isWrite?"Write":"Read",
+            getMemSpaceAbbreviatedName((MemorySpace_t)memorySpace), address, address+byteCount-1);
+
+      const uint32_t boundaryMask = getMemoryBoundaryMask(memorySpace);
+      while (byteCount>0) {
+         unsigned blockSize = getMemoryBlockSize(boundaryMask, byteCount, address, MaxDataSize);
+         uint8_t *buffer = memoryPipelineBuffers[batchCount];
+         assembleMessageHeader( buffer,
+                                command,      // Command
+                                memorySpace,  // Size of data element
+                                blockSize,    // # of bytes
+                                address       // Memory address
+                               );
+         if (isWrite) {
+            cursor.gather(buffer+MESSAGE_HEADER_SIZE, blockSize);
+            memoryTransactions[batchCount].txSize  = blockSize+MESSAGE_HEADER_SIZE;
+            memoryTransactions[batchCount].rxSize  = 1;
+         }
+         else {
+            memoryTransactions[batchCount].txSize  = MESSAGE_HEADER_SIZE;
+            memoryTransactions[batchCount].rxSize  = blockSize+1;
+         }
+         memoryTransactions[batchCount].data    = buffer;
+         memoryTransactions[batchCount].timeout = 100;
+         batchCount++;
+
+         address     += blockSize;   // update address
+         byteCount   -= blockSize;   // update count
+
+         if (batchCount == MEMORY_PIPELINE_BATCH) {
+            rc = flushMemoryBatch(isWrite, batchCount, cursor, stickyRc);
+            if (rc != BDM_RC_OK) {
+               return rc;
+            }
          }
       }
-      assembleMessageHeader( CMD_USBDM_READ_MEM, // Command
-                             memorySpace,        // Size of data element
-                             blockSize,          // # of bytes to Rx,
-                             address             // Memory address
-                            );
-//      log.print("  USBDM_ReadMemory-pkt(addr=0x%8X, blocksize=%3d, memorySpace=%2d)\n",
-//            address, blockSize, memorySpace);
-      rc = bdm_usb_transaction(MESSAGE_HEADER_SIZE, blockSize+1, usb_data, 100);
-      if ((rc == BDM_RC_USB_RETRY_OK)) {
-         stickyRc = BDM_RC_USB_RETRY_OK;
-      }
-      if ((rc != BDM_RC_OK) && (rc != BDM_RC_USB_RETRY_OK)) {
+   }
+   if (batchCount > 0) {
+      rc = flushMemoryBatch(isWrite, batchCount, cursor, stickyRc);
+      if (rc != BDM_RC_OK) {
          return rc;
       }
-      memcpy(data, usb_data+1, blockSize);
-      //log.printDump(data, blockSize);
-
-      data        += blockSize;   // update destination in buffer
-      address     += blockSize;   // update address
-      byteCount   -= blockSize;   // update count
    }
-   log.printDump(originalData, originalCount, originalAddress);
-
    return stickyRc;
 }
 
+/** ======================================================================
+ *  Write data to target memory from a list of requests
+ *
+ *  @param count    = Number of requests
+ *  @param requests = Requests to process
+ *
+ *  @return error code \n
+ *      BDM_RC_OK    => OK \n
+ *      other        => Error code - see \ref USBDM_ErrorCode
+ */
+USBDM_API
+USBDM_ErrorCode USBDM_WriteMemoryV(unsigned int count, USBDM_MemoryRequest requests[]) {
+   return transferMemoryV(CMD_USBDM_WRITE_MEM, count, requests);
+}
+
+/** ======================================================================
+ *  Read data from target memory from a list of requests
+ *
+ *  @param count    = Number of requests
+ *  @param requests = Requests to process
+ *
+ *  @return error code \n
+ *      BDM_RC_OK    => OK \n
+ *      other        => Error code - see \ref USBDM_ErrorCode
+ */
+USBDM_API
+USBDM_ErrorCode USBDM_ReadMemoryV(unsigned int count, USBDM_MemoryRequest requests[]) {
+   return transferMemoryV(CMD_USBDM_READ_MEM, count, requests);
+}
+
 #if 0
 
 /**
@@ -2913,11 +3223,11 @@ USBDM_ErrorCode USBDM_RS08FlashProgramPreamble(void) {
    //const unsigned int defaultTrimFrequency = 4000; // kHz
    //const unsigned int defaultTrimValue     = 256;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("USBDM_RS08FlashProgramPreamble()\n");
 
-   bdmState.flashState = FLASH_Idle; // Assume fail!
+   currentBdmSession->bdmState.flashState = FLASH_Idle; // Assume fail!
 
    // Check if RS08 derivative is set
    if (RS08_FlashInfo == NULL) {
@@ -3006,11 +3316,11 @@ USBDM_ErrorCode USBDM_RS08FlashStatus(void) {
    int rc;
    USBDMStatus_t      USBDMStatus;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("USBDM_RS08FlashStatus()\n");
 
-   if (bdmState.flashState != FLASH_Ready)
+   if (currentBdmSession->bdmState.flashState != FLASH_Ready)
       return BDM_RC_WRONG_PROGRAMMING_MODE;
 
    rc = USBDM_GetBDMStatus(&USBDMStatus);
@@ -3039,7 +3349,7 @@ USBDM_ErrorCode USBDM_RS08FlashProgramPostamble(void){
    USBDMStatus_t   USBDMStatus;
    USBDM_ErrorCode rc;
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
    log.print("USBDM_RS08FlashProgramPostamble()\n");
 
@@ -3049,7 +3359,7 @@ USBDM_ErrorCode USBDM_RS08FlashProgramPostamble(void){
    // Don't try to restore Trim in error situation
    if ((savedTrimValue != 0) &&
        (RS08_FlashInfo != NULL) &&
-       (bdmState.flashState == FLASH_Ready)) {
+       (currentBdmSession->bdmState.flashState == FLASH_Ready)) {
       // Retrieve the clock trim value from the RS08 Flash
       // This value may have been programmed as part of the user code image
       rc = USBDM_ReadMemory(1, 2, RS_TRIM_FLASH, buff );
@@ -3071,7 +3381,7 @@ USBDM_ErrorCode USBDM_RS08FlashProgramPostamble(void){
    }
 #endif
 
-   bdmState.flashState = FLASH_Idle;
+   currentBdmSession->bdmState.flashState = FLASH_Idle;
 
    // Turn off Flash programming
    rc = USBDM_SetTargetVpp(BDM_TARGET_VPP_OFF);
@@ -3133,9 +3443,9 @@ USBDM_ErrorCode USBDM_RS08WriteFlashBlock( unsigned int        byteCount,
    log.print("USBDM_RS08WriteFlashBlock(count=0x%X(%d), addr=[0x%06X..0x%06X])\n",
          byteCount, byteCount, address, address+byteCount-1);
 
-   bdmState.activityFlag = BDM_ACTIVE;
+   currentBdmSession->bdmState.activityFlag = BDM_ACTIVE;
 
-   if (bdmState.flashState != FLASH_Ready) {
+   if (currentBdmSession->bdmState.flashState != FLASH_Ready) {
       return BDM_RC_WRONG_PROGRAMMING_MODE;
    }
 
@@ -3248,7 +3558,7 @@ USBDM_ErrorCode USBDM_RS08WriteFlash( unsigned int        elementSize,
       return BDM_RC_ILLEGAL_PARAMS;
 
    // Check if ready for programming
-   if (bdmState.flashState != FLASH_Ready) {
+   if (currentBdmSession->bdmState.flashState != FLASH_Ready) {
       return BDM_RC_WRONG_PROGRAMMING_MODE;
    }
 
@@ -3430,7 +3740,7 @@ USBDM_ErrorCode USBDM_JTAG_Write(unsigned char       bitCount,
    LOGGING_Q;
    unsigned byteSize = (bitCount>>3)+((bitCount&0x07)!=0);
 
-   if ((bitCount == 0) || (byteSize>bdmInfo.jtagBufferSize)) {
+   if ((bitCount == 0) || (byteSize>currentBdmSession->bdmInfo.jtagBufferSize)) {
       log.print("USBDM_JTAG_Write(): Illegal operands\n");
       return BDM_RC_ILLEGAL_PARAMS;
    }
@@ -3477,7 +3787,7 @@ USBDM_ErrorCode USBDM_JTAG_Read( unsigned char bitCount,
    USBDM_ErrorCode rc;
    unsigned byteSize = (bitCount>>3)+((bitCount&0x07)!=0);
 
-   if ((bitCount == 0) || (byteSize>bdmInfo.jtagBufferSize)){
+   if ((bitCount == 0) || (byteSize>currentBdmSession->bdmInfo.jtagBufferSize)){
       log.print("USBDM_JTAG_Read(): Illegal operands\n");
       return BDM_RC_ILLEGAL_PARAMS;
    }
@@ -3533,7 +3843,7 @@ USBDM_ErrorCode USBDM_JTAG_ReadWrite( unsigned char bitCount,
    USBDM_ErrorCode rc;
    unsigned byteSize = (bitCount>>3)+((bitCount&0x07)!=0);
 
-   if ((bitCount == 0) || (byteSize>bdmInfo.jtagBufferSize)){
+   if ((bitCount == 0) || (byteSize>currentBdmSession->bdmInfo.jtagBufferSize)){
       log.print("USBDM_JTAG_ReadWrite(): Illegal operands\n");
       return BDM_RC_ILLEGAL_PARAMS;
    }
@@ -3582,10 +3892,10 @@ USBDM_ErrorCode USBDM_JTAG_ExecuteSequence(unsigned char       length,
 
    log.print("USBDM_JTAG_ExecuteSequence(seqLength=%d, inLength=%d)\n", length, inLength);
 
-   if (length>bdmInfo.jtagBufferSize) {
+   if (length>currentBdmSession->bdmInfo.jtagBufferSize) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
-   if (inLength>bdmInfo.commandBufferSize-1) {
+   if (inLength>currentBdmSession->bdmInfo.commandBufferSize-1) {
       return BDM_RC_ILLEGAL_PARAMS;
    }
    usb_data[0] = 0;
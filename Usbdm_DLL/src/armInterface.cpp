@@ -58,7 +58,6 @@
 #include "armInterface.h"
 #include "JTAGSequence.h"
 
-extern USBDM_ExtendedOptions_t bdmOptions;
 
 #define DHCSR (0xE000EDF0) // RW Debug Halting Control and Status Register
 #define DCSR  (0xE000EDF4) // WO Debug Core Selector Register
@@ -88,28 +87,6 @@ extern USBDM_ExtendedOptions_t bdmOptions;
 #define JTAG_BYPASS_LENGTH          (1)
 #define JTAG_BYPASS_COMMAND         (~0x00) // BYPASS reg
 
-/**  Information describing the debug Interface */
-static struct ARM_DebugInformation {
-   // Details from AHB-AP
-   uint8_t          componentClass;               //!< Component class
-   uint32_t         debugBaseaddr;                //!< Base address of Debug ROM
-   unsigned         size4Kb;                      //!< Size of Debug ROM
-   bool             MDM_AP_present;               //!< Indicates if target has Kinetis MDM-AP
-   bool             KinetisSecured;               //!< Indicates if kinetis target is secured
-   // Memory interface capabilities
-   bool             memAccessLimitsChecked;       //!< Have they been checked?
-   bool             byteAccessSupported;          //!< Byte/Halfword access supported?
-   uint32_t         memAPConfig;                  //!< Memory CFG register contents
-} armDebugInformation = {
-      0x0,
-      0x0,
-      0,
-      false,
-      false,
-      false,
-      0x0,
-};
-
 /** Additional bits to set when writing to DP_CONTROL/STAT register */
 static const uint32_t dpControlStatBaseValue = CSYSPWRUPREQ|CDBGPWRUPREQ;
 
@@ -246,7 +223,7 @@ static USBDM_ErrorCode resetHardware(TargetMode_t resetMode) {
 
    // Require target access
    rc = armInitialise();
-   if ((rc != BDM_RC_OK) || armDebugInformation.MDM_AP_present) {
+   if ((rc != BDM_RC_OK) || currentBdmSession->armDebugInformation.MDM_AP_present) {
       /*
        * If initialize failed or it's a Freescale device
        * apply reset early
@@ -257,7 +234,7 @@ static USBDM_ErrorCode resetHardware(TargetMode_t resetMode) {
       // Require target access - try again
       armInitialise();
    }
-   if (armDebugInformation.KinetisSecured) {
+   if (currentBdmSession->armDebugInformation.KinetisSecured) {
       log.error("Secured Kinetis device - using truncated reset\n");
    }
    else {
@@ -265,15 +242,15 @@ static USBDM_ErrorCode resetHardware(TargetMode_t resetMode) {
    }
 
    // Apply hardware reset (if not already applied)
-   if (!armDebugInformation.MDM_AP_present) {
+   if (!currentBdmSession->armDebugInformation.MDM_AP_present) {
       USBDM_ControlPins(PIN_RESET_LOW);
    }
-   UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
 
    // Release hardware reset
    USBDM_ControlPins(PIN_RELEASE);
 
-   UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
 
    // Check reset rise
    rc = USBDM_ControlPins(PIN_RESET_3STATE);
@@ -293,18 +270,18 @@ static USBDM_ErrorCode resetSoftware(TargetMode_t resetMode) {
 
    resetMode = (TargetMode_t)(resetMode&RESET_MODE_MASK);
 
-//   if (bdmOptions.useResetSignal) {
+//   if (currentBdmSession->bdmOptions.useResetSignal) {
 //      // Apply hardware reset as well
 //      USBDM_ControlPins(PIN_RESET_LOW);
 //   }
 //   else {
 //      // Make sure any pending hardware reset is released
 //      USBDM_ControlPins(PIN_RESET_3STATE);
-//      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+//      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
 //   }
 
 //   // Try to disable ST watch-dog
-//   if (!armDebugInformation.MDM_AP_present) {
+//   if (!currentBdmSession->armDebugInformation.MDM_AP_present) {
 //      log.print("Attempting to disable ST Watchdog\n");
 //      armWriteMemoryWord(DBGMCU_CR, (DBGMCU_IWDG_STOP|DBGMCU_WWDG_STOP));
 //   }
@@ -322,11 +299,11 @@ static USBDM_ErrorCode resetSoftware(TargetMode_t resetMode) {
    unsigned long aiscrValue = AIRCR_VECTKEY|AIRCR_SYSRESETREQ;
    rc = armWriteMemoryWord(AIRCR, aiscrValue);
 
-//   if (bdmOptions.useResetSignal) {
+//   if (currentBdmSession->bdmOptions.useResetSignal) {
 //      // Release any hardware reset
 //      USBDM_ControlPins(PIN_RESET_3STATE);
 //   }
-   UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
 
    return rc;
 }
@@ -344,17 +321,17 @@ static USBDM_ErrorCode resetVendor(TargetMode_t resetMode) {
 
    resetMode = (TargetMode_t)(resetMode&RESET_MODE_MASK);
 
-   if (!armDebugInformation.MDM_AP_present) {
+   if (!currentBdmSession->armDebugInformation.MDM_AP_present) {
       return BDM_RC_FEATURE_NOT_SUPPORTED;
    }
 
-//   if (bdmOptions.useResetSignal) {
+//   if (currentBdmSession->bdmOptions.useResetSignal) {
 //      USBDM_ControlPins(PIN_RESET_LOW);
 //   }
 //   else {
 //      // Make sure any pending hardware reset is released
 //      USBDM_ControlPins(PIN_RESET_3STATE);
-//      UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+//      UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
 //   }
 
    // Require target access
@@ -375,26 +352,26 @@ static USBDM_ErrorCode resetVendor(TargetMode_t resetMode) {
    // Clear Halt and Reset bits
    mdm_ap_control &= ~(MDM_AP_Control_Debug_Request|MDM_AP_Control_System_Reset_Request);
 
-//   if (bdmOptions.useResetSignal) {
+//   if (currentBdmSession->bdmOptions.useResetSignal) {
 //      // Release any hardware reset - ignore errors as reset will remain low
 //      log.error("Ignore BDM_RC_RESET_TIMEOUT_RISE as reset held low by target\n");
 //      (void)USBDM_ControlPins(PIN_RESET_3STATE);
 //   }
 
-   if (armDebugInformation.KinetisSecured) {
+   if (currentBdmSession->armDebugInformation.KinetisSecured) {
       log.error("Secured Kinetis device - using truncated reset\n");
    }
    else {
       doSetupResetRegisters(resetMode);
    }
 
-   UsbdmSystem::milliSleep(bdmOptions.resetDuration);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetDuration);
 
    // Release MDM-AP software reset
    rcMDM = USBDM_WriteCReg(ARM_CRegMDM_AP_Control, mdm_ap_control);
 
-   UsbdmSystem::milliSleep(bdmOptions.resetReleaseInterval);
-   UsbdmSystem::milliSleep(bdmOptions.resetRecoveryInterval);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetReleaseInterval);
+   UsbdmSystem::milliSleep(currentBdmSession->bdmOptions.resetRecoveryInterval);
    return rcMDM;
 }
 
@@ -453,7 +430,7 @@ USBDM_ErrorCode resetARM(TargetMode_t targetMode) {
       log.print("modified=(%s)\n", getTargetModeName((TargetMode_t)(resetMethod|resetMode)));
    }
 #ifdef LOG
-   if (!armDebugInformation.KinetisSecured) {
+   if (!currentBdmSession->armDebugInformation.KinetisSecured) {
       unsigned long dhcsrValue;
       USBDM_ErrorCode rc2 = armReadMemoryWord(DHCSR, &dhcsrValue);
       if (rc2 == BDM_RC_OK) {
@@ -499,7 +476,7 @@ USBDM_ErrorCode resetARM(TargetMode_t targetMode) {
    }
 
 #ifdef LOG
-   if (!armDebugInformation.KinetisSecured) {
+   if (!currentBdmSession->armDebugInformation.KinetisSecured) {
       unsigned long dhcsrValue;
       USBDM_ErrorCode rc2 = armReadMemoryWord(DHCSR, &dhcsrValue);
       if (rc2 == BDM_RC_OK) {
@@ -527,19 +504,19 @@ static USBDM_ErrorCode armCheckAPs(void) {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   armDebugInformation.KinetisSecured = false;
-   armDebugInformation.MDM_AP_present = ((dataIn & 0xFFFFFF00)== 0x001C0000);
-   if (armDebugInformation.MDM_AP_present) {
+   currentBdmSession->armDebugInformation.KinetisSecured = false;
+   currentBdmSession->armDebugInformation.MDM_AP_present = ((dataIn & 0xFFFFFF00)== 0x001C0000);
+   if (currentBdmSession->armDebugInformation.MDM_AP_present) {
       log.print("MDM-AP (Kinetis) found (Id=0x%08lX)\n", dataIn);
       unsigned long mdm_ap_status;
       USBDM_ErrorCode rc = USBDM_ReadCReg(ARM_CRegMDM_AP_Status, &mdm_ap_status);
       if (rc != BDM_RC_OK) {
          log.error("Checking Freescale MDM-AP.Status - failed read\n");
-         armDebugInformation.MDM_AP_present = 0;
+         currentBdmSession->armDebugInformation.MDM_AP_present = 0;
       }
       else {
-         armDebugInformation.KinetisSecured = (mdm_ap_status & MDM_AP_Status_System_Security) != 0;
-         if (armDebugInformation.KinetisSecured ) {
+         currentBdmSession->armDebugInformation.KinetisSecured = (mdm_ap_status & MDM_AP_Status_System_Security) != 0;
+         if (currentBdmSession->armDebugInformation.KinetisSecured ) {
             log.error("Checking Freescale MDM-AP.Status - device is secured\n");
          }
       }
@@ -559,7 +536,7 @@ static USBDM_ErrorCode armCheckAPs(void) {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   armDebugInformation.memAPConfig = dataIn;
+   currentBdmSession->armDebugInformation.memAPConfig = dataIn;
    bool bigEndian = (dataIn&AHB_AP_CFG_BIGENDIAN)!=0;
    log.print("AHB_AP.CFG => 0x%08lX, %s\n", dataIn, bigEndian?"BigEndian":"LittleEndian");
 
@@ -569,7 +546,7 @@ static USBDM_ErrorCode armCheckAPs(void) {
       return rc;
    }
    log.print("AHB_AP.Base => 0x%08lX\n", dataIn);
-   armDebugInformation.debugBaseaddr = dataIn & 0xFFFFF000;
+   currentBdmSession->armDebugInformation.debugBaseaddr = dataIn & 0xFFFFF000;
 
    return BDM_RC_OK;
 }
@@ -585,7 +562,7 @@ static USBDM_ErrorCode armReadDebugInformation(void) {
    // Read ID registers
    unsigned long buffer[4];
    for (int index=0; index<4; index++) {
-      rc = armReadMemoryWord(armDebugInformation.debugBaseaddr+0xFF0+4*index, buffer+index);
+      rc = armReadMemoryWord(currentBdmSession->armDebugInformation.debugBaseaddr+0xFF0+4*index, buffer+index);
       if (rc != BDM_RC_OK) {
          return rc;
       }
@@ -600,24 +577,21 @@ static USBDM_ErrorCode armReadDebugInformation(void) {
    if ((id & 0xFFFF0FFF) != 0xB105000D) {
       log.error("   armReadDebugInformation(): ID invalid\n");
    }
-   armDebugInformation.componentClass = (id>>12)&0xF;
-   log.print("   armReadDebugInformation(): component class => 0x%X\n", armDebugInformation.componentClass);
+   currentBdmSession->armDebugInformation.componentClass = (id>>12)&0xF;
+   log.print("   armReadDebugInformation(): component class => 0x%X\n", currentBdmSession->armDebugInformation.componentClass);
 
    // Read Peripheral ID0 register
-   rc = armReadMemoryWord(armDebugInformation.debugBaseaddr+0xFD0, buffer);
+   rc = armReadMemoryWord(currentBdmSession->armDebugInformation.debugBaseaddr+0xFD0, buffer);
    if (rc != BDM_RC_OK) {
       return rc;
    }
    id  = (buffer[0x0]>>4)&0xFF;
-   armDebugInformation.size4Kb = 1<<id;
-   log.print("   armReadDebugInformation(): 4Kb size => %d\n", armDebugInformation.size4Kb);
+   currentBdmSession->armDebugInformation.size4Kb = 1<<id;
+   log.print("   armReadDebugInformation(): 4Kb size => %d\n", currentBdmSession->armDebugInformation.size4Kb);
    return BDM_RC_OK;
 }
 #endif
 
-CPP_DLL_LOCAL
-bool armInitialiseDone = false;
-
 /*
  * Check for target power
  *
@@ -651,7 +625,7 @@ static USBDM_ErrorCode checkTargetPower(void) {
 static USBDM_ErrorCode targetDebugEnable() {
    LOGGING;
 
-   if (armDebugInformation.MDM_AP_present) {
+   if (currentBdmSession->armDebugInformation.MDM_AP_present) {
       // Check if Secured Kinetis device
       unsigned long mdm_ap_status;
       USBDM_ErrorCode rc = USBDM_ReadCReg(ARM_CRegMDM_AP_Status, &mdm_ap_status);
@@ -813,7 +787,7 @@ static USBDM_ErrorCode armJtagInitialise() {
    LOGGING;
    USBDM_ErrorCode rc = BDM_RC_OK;
 
-   armInitialiseDone = false;
+   currentBdmSession->armInitialiseDone = false;
    rc = checkTargetPower();
    if (rc != BDM_RC_OK) {
       return rc;
@@ -881,7 +855,7 @@ static USBDM_ErrorCode armJtagInitialise() {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   armInitialiseDone = true;
+   currentBdmSession->armInitialiseDone = true;
    return BDM_RC_OK;
 }
 
@@ -920,7 +894,7 @@ static USBDM_ErrorCode armInitialise() {
    LOGGING;
    USBDM_ErrorCode rc = BDM_RC_OK;
 
-   armInitialiseDone = false;
+   currentBdmSession->armInitialiseDone = false;
 
    rc = USBDM_BasicConnect();
    if (rc != BDM_RC_OK) {
@@ -942,7 +916,7 @@ static USBDM_ErrorCode armInitialise() {
    if (rc != BDM_RC_OK) {
       return rc;
    }
-   armInitialiseDone = true;
+   currentBdmSession->armInitialiseDone = true;
    return BDM_RC_OK;
 }
 
@@ -1002,13 +976,13 @@ USBDM_ErrorCode armConnect(TargetType_t targetType) {
  */
 CPP_DLL_LOCAL
 USBDM_ErrorCode armDisconnect(TargetType_t targetType) {
-   if (armInitialiseDone) {
+   if (currentBdmSession->armInitialiseDone) {
       // Clear reset captures (ignore errors)
       armWriteMemoryWord(DEMCR, 0);
       // Disabled as immediately start target execution which I think is undesirable.
       //      armWriteMemoryWord(DHCSR, DHCSR_DBGKEY);
    }
-   armInitialiseDone = false;
+   currentBdmSession->armInitialiseDone = false;
    return BDM_RC_OK;
 }
 